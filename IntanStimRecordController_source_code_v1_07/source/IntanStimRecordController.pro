@@ -4,6 +4,33 @@ QT            += widgets multimedia
 
 CONFIG        += static
 
+# Vectorized filter kernels use SSE2 by default on x86 processors.  64-bit
+# compilers and 32-bit MSVC enable it by default; 32-bit GCC and Clang (e.g.
+# MinGW) are asked for it here.  To use AVX2 or AVX-512 instead, uncomment one
+# of these lines (the program will then only run on processors that support
+# that instruction set).
+!msvc:contains(QT_ARCH, i386): QMAKE_CXXFLAGS += -msse2 -mfpmath=sse
+# QMAKE_CXXFLAGS += -mavx2
+# QMAKE_CXXFLAGS += -mavx512f
+
+# Amplifier and board waveforms are processed in double precision by default.
+# Uncomment this line to process them in single precision, which halves memory
+# traffic and doubles the number of channels filtered per vector instruction,
+# at a cost in accuracy on low-frequency content, where single-precision
+# rounding is amplified most.  The float build is then not LSB-accurate: the
+# mains notch deviates from the double build by up to about 9 uV at 30 kS/s,
+# and an LFP filter bank band by up to 0.5 uV (more than two amplifier LSBs).
+# tools/kerneltest reports the accuracy and speed of either build.
+# DEFINES += SIGNAL_PROCESSOR_FLOAT
+
+# The amplifier notch and highpass filters run in floating point, in the
+# precision above.  Uncomment this line to run them in fixed point on the
+# amplifier codes instead (MultiChannelFixedNotch), which is within a few
+# hundredths of an LSB of the double build in either precision, but only about
+# as fast as double precision with AVX2 or AVX-512, and slower otherwise.
+# tools/kerneltest compares both.
+# DEFINES += SIGNAL_PROCESSOR_FIXED_POINT
+
 macx:{
 QMAKE_RPATHDIR += /users/intan/qt/5.7/clang_64/lib
 QMAKE_RPATHDIR += /users/intan/downloads/
@@ -22,7 +49,6 @@ HEADERS       = \
     spikescopedialog.h \
     spikeplot.h \
     keyboardshortcutdialog.h \
-    randomnumber.h \
     impedancefreqdialog.h \
     globalconstants.h \
     triggerrecorddialog.h \
@@ -54,7 +80,46 @@ HEADERS       = \
     voltagespinbox.h \
     startupdialog.h \
     ampsettledialog.h \
-    chargerecoverydialog.h
+    chargerecoverydialog.h \
+    savejournal.h \
+    crc32c.h \
+    checksummedfile.h \
+    multichannelbiquad.h \
+    filterdesign.h \
+    filterbank.h \
+    filterbankdialog.h \
+    samplevector.h \
+    spatialreference.h \
+    spatialreferencedialog.h \
+    artifactsuppressor.h \
+    artifactdialog.h \
+    realfft.h \
+    spectrumanalyzer.h \
+    spectrumplot.h \
+    spectrumdialog.h \
+    spikedetector.h \
+    spikeeventfile.h \
+    spikedetectiondialog.h \
+    spikesorter.h \
+    impedancespectrumdialog.h \
+    syntheticdatagenerator.h \
+    syntheticdatadialog.h \
+    multichannelnotch.h \
+    multichannelfixednotch.h \
+    multichannelfixedbiquad.h \
+    linenoisecanceller.h \
+    linenoisedialog.h \
+    bandpowerdetector.h \
+    bandpowerdialog.h \
+    phasetracker.h \
+    phasetrackingdialog.h \
+    correlationanalyzer.h \
+    correlationdialog.h \
+    signalqualitymonitor.h \
+    signalqualitydialog.h \
+    dacthresholdtracker.h \
+    waveformdecimator.h \
+    displayring.h
 
 SOURCES       = main.cpp \
     okFrontPanelDLL.cpp \
@@ -69,7 +134,6 @@ SOURCES       = main.cpp \
     spikescopedialog.cpp \
     spikeplot.cpp \
     keyboardshortcutdialog.cpp \
-    randomnumber.cpp \
     impedancefreqdialog.cpp \
     triggerrecorddialog.cpp \
     setsaveformatdialog.cpp \
@@ -100,7 +164,45 @@ SOURCES       = main.cpp \
     voltagespinbox.cpp \
     startupdialog.cpp \
     ampsettledialog.cpp \
-    chargerecoverydialog.cpp
+    chargerecoverydialog.cpp \
+    savejournal.cpp \
+    crc32c.cpp \
+    checksummedfile.cpp \
+    multichannelbiquad.cpp \
+    filterdesign.cpp \
+    filterbank.cpp \
+    filterbankdialog.cpp \
+    spatialreference.cpp \
+    spatialreferencedialog.cpp \
+    artifactsuppressor.cpp \
+    artifactdialog.cpp \
+    realfft.cpp \
+    spectrumanalyzer.cpp \
+    spectrumplot.cpp \
+    spectrumdialog.cpp \
+    spikedetector.cpp \
+    spikeeventfile.cpp \
+    spikedetectiondialog.cpp \
+    spikesorter.cpp \
+    impedancespectrumdialog.cpp \
+    syntheticdatagenerator.cpp \
+    syntheticdatadialog.cpp \
+    multichannelnotch.cpp \
+    multichannelfixednotch.cpp \
+    multichannelfixedbiquad.cpp \
+    linenoisecanceller.cpp \
+    linenoisedialog.cpp \
+    bandpowerdetector.cpp \
+    bandpowerdialog.cpp \
+    phasetracker.cpp \
+    phasetrackingdialog.cpp \
+    correlationanalyzer.cpp \
+    correlationdialog.cpp \
+    signalqualitymonitor.cpp \
+    signalqualitydialog.cpp \
+    dacthresholdtracker.cpp \
+    waveformdecimator.cpp \
+    displayring.cpp
     
 RESOURCES     = IntanStimRecordController.qrc
 
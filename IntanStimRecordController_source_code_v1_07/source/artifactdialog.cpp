@@ -0,0 +1,120 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "artifactdialog.h"
+
+// Stimulation artifact suppression dialog.
+// This dialog allows users to blank or interpolate across the samples marked by
+// stimulation, amplifier settle, and charge recovery markers, or to subtract a
+// learned artifact template following each stimulation onset.
+
+ArtifactDialog::ArtifactDialog(const ArtifactSettings &settings, QWidget *parent) :
+    QDialog(parent)
+{
+    modeComboBox = new QComboBox();
+    modeComboBox->addItem(tr("Off"));
+    modeComboBox->addItem(tr("Blank (hold last value)"));
+    modeComboBox->addItem(tr("Interpolate"));
+    modeComboBox->addItem(tr("Subtract artifact template"));
+    modeComboBox->setCurrentIndex(settings.mode);
+
+    scopeComboBox = new QComboBox();
+    scopeComboBox->addItem(tr("Markers on the same channel"));
+    scopeComboBox->addItem(tr("Markers on any channel of the headstage"));
+    scopeComboBox->setCurrentIndex(settings.scope);
+
+    tailSpinBox = new QDoubleSpinBox();
+    tailSpinBox->setRange(0.0, 20.0);
+    tailSpinBox->setDecimals(2);
+    tailSpinBox->setSingleStep(0.1);
+    tailSpinBox->setSuffix(" ms");
+    tailSpinBox->setValue(settings.tailMsec);
+
+    templateSpinBox = new QDoubleSpinBox();
+    templateSpinBox->setRange(0.1, 20.0);
+    templateSpinBox->setDecimals(2);
+    templateSpinBox->setSingleStep(0.5);
+    templateSpinBox->setSuffix(" ms");
+    templateSpinBox->setValue(settings.templateMsec);
+
+    averageSpinBox = new QSpinBox();
+    averageSpinBox->setRange(1, 256);
+    averageSpinBox->setValue(settings.numAveraged);
+
+    connect(modeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateControls()));
+
+    QFormLayout *formLayout = new QFormLayout();
+    formLayout->addRow(tr("Method"), modeComboBox);
+    formLayout->addRow(tr("Triggered by"), scopeComboBox);
+    formLayout->addRow(tr("Blanking tail after markers"), tailSpinBox);
+    formLayout->addRow(tr("Template length after onset"), templateSpinBox);
+    formLayout->addRow(tr("Artifacts averaged in template"), averageSpinBox);
+
+    QLabel *noteLabel = new QLabel(tr("Artifact suppression is applied to all amplifier channels before "
+                                      "re-referencing and software filtering, and affects displayed waveforms, "
+                                      "the spike scope, and filtered outputs.  Saved data are not affected.  "
+                                      "The template is a running average of recent artifacts aligned to "
+                                      "stimulation onset, and is subtracted from each artifact after the first."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Stimulation Artifact Suppression"));
+
+    updateControls();
+}
+
+// Enable the controls that apply to the selected method.
+void ArtifactDialog::updateControls()
+{
+    ArtifactSuppressor::Mode mode = (ArtifactSuppressor::Mode) modeComboBox->currentIndex();
+
+    scopeComboBox->setEnabled(mode != ArtifactSuppressor::ArtifactOff);
+    tailSpinBox->setEnabled(mode == ArtifactSuppressor::ArtifactBlank || mode == ArtifactSuppressor::ArtifactInterpolate);
+    templateSpinBox->setEnabled(mode == ArtifactSuppressor::ArtifactTemplate);
+    averageSpinBox->setEnabled(mode == ArtifactSuppressor::ArtifactTemplate);
+}
+
+ArtifactSettings ArtifactDialog::getSettings() const
+{
+    ArtifactSettings settings;
+    settings.mode = (ArtifactSuppressor::Mode) modeComboBox->currentIndex();
+    settings.scope = (ArtifactSuppressor::TriggerScope) scopeComboBox->currentIndex();
+    settings.tailMsec = tailSpinBox->value();
+    settings.templateMsec = templateSpinBox->value();
+    settings.numAveraged = averageSpinBox->value();
+    return settings;
+}
@@ -0,0 +1,69 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ARTIFACTDIALOG_H
+#define ARTIFACTDIALOG_H
+
+#include <QDialog>
+
+#include "artifactsuppressor.h"
+
+class QDialogButtonBox;
+class QComboBox;
+class QSpinBox;
+class QDoubleSpinBox;
+
+// Stimulation artifact suppression settings, with lengths in milliseconds so
+// they are independent of the sample rate.
+struct ArtifactSettings
+{
+    ArtifactSuppressor::Mode mode;
+    ArtifactSuppressor::TriggerScope scope;
+    double tailMsec;
+    double templateMsec;
+    int numAveraged;
+};
+
+class ArtifactDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit ArtifactDialog(const ArtifactSettings &settings, QWidget *parent);
+
+    ArtifactSettings getSettings() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateControls();
+
+private:
+    QComboBox *modeComboBox;
+    QComboBox *scopeComboBox;
+    QDoubleSpinBox *tailSpinBox;
+    QDoubleSpinBox *templateSpinBox;
+    QSpinBox *averageSpinBox;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // ARTIFACTDIALOG_H
@@ -0,0 +1,219 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cstring>
+
+#include "artifactsuppressor.h"
+#include "rhs2000datablock.h"
+
+// Constructor.
+ArtifactSuppressor::ArtifactSuppressor()
+{
+    mode = ArtifactOff;
+    scope = TriggerChannel;
+    tailSamples = 0;
+    templateLength = 1;
+    numAveraged = 1;
+    numStreams = 0;
+}
+
+// Allocate state for numStreams data streams and data blocks of up to
+// maxSamples time steps.  Clears all artifact state.
+void ArtifactSuppressor::setNumStreams(int numStreams_, int maxSamples)
+{
+    numStreams = numStreams_;
+    marked.resize(maxSamples);
+    noMarks.resize(maxSamples);
+    noMarks.fill(0);
+    streamMarked.resize(numStreams);
+    for (int stream = 0; stream < numStreams; ++stream) {
+        streamMarked[stream].resize(maxSamples);
+    }
+    resetState();
+}
+
+// Set the suppression method.  tailSamples is the number of samples blanked after
+// each marked stretch; templateLength is the number of samples after each
+// stimulation onset covered by the artifact template, and numAveraged the
+// number of recent artifacts the template averages.  Templates are cleared if
+// the mode or template length changes.
+void ArtifactSuppressor::setParameters(Mode mode_, TriggerScope scope_, int tailSamples_, int templateLength_,
+                                       int numAveraged_)
+{
+    bool clear = (mode_ != mode || templateLength_ != templateLength);
+
+    mode = mode_;
+    scope = scope_;
+    tailSamples = qMax(0, tailSamples_);
+    templateLength = qMax(1, templateLength_);
+    numAveraged = qMax(1, numAveraged_);
+
+    if (clear) resetState();
+}
+
+void ArtifactSuppressor::resetState()
+{
+    int numLanes = numStreams * CHANNELS_PER_STREAM;
+    LaneState initial = { 0, 0, false, -1, 0 };
+    laneState.resize(numLanes);
+    laneState.fill(initial);
+    templates.resize(numLanes * templateLength);
+    templates.fill(0);
+}
+
+ArtifactSuppressor::Mode ArtifactSuppressor::getMode() const
+{
+    return mode;
+}
+
+// Suppress artifacts in numFrames time steps of data.
+void ArtifactSuppressor::apply(Sample *data, int numFrames,
+                               const QVector<QVector<QVector<int> > > &stimOn,
+                               const QVector<QVector<QVector<int> > > &ampSettle,
+                               const QVector<QVector<QVector<int> > > &chargeRecov)
+{
+    if (mode == ArtifactOff) return;
+
+    int numLanes = numStreams * CHANNELS_PER_STREAM;
+
+    // Headstage-wide markers are the union of the markers of all channels.
+    QVector<bool> streamHasMarks(numStreams);
+    if (scope == TriggerHeadstage) {
+        for (int stream = 0; stream < numStreams; ++stream) {
+            char *mark = streamMarked[stream].data();
+            memset(mark, 0, numFrames);
+            bool any = false;
+            for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+                if (markChannel(marked.data(), stream, channel, numFrames, stimOn, ampSettle, chargeRecov)) {
+                    for (int t = 0; t < numFrames; ++t) mark[t] |= marked[t];
+                    any = true;
+                }
+            }
+            streamHasMarks[stream] = any;
+        }
+    }
+
+    for (int stream = 0; stream < numStreams; ++stream) {
+        for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+            int lane = channel * numStreams + stream;
+            LaneState &state = laneState[lane];
+
+            const char *mark;
+            bool anyMarked;
+            if (scope == TriggerHeadstage) {
+                mark = streamMarked[stream].constData();
+                anyMarked = streamHasMarks[stream];
+            } else {
+                anyMarked = markChannel(marked.data(), stream, channel, numFrames, stimOn, ampSettle, chargeRecov);
+                mark = marked.constData();
+            }
+
+            if (mode == ArtifactTemplate) {
+                if (!anyMarked && state.phase < 0) {
+                    state.prevMarked = false;
+                    continue;
+                }
+                if (!anyMarked) mark = noMarks.constData();
+                subtractTemplate(data + lane, numLanes, mark, numFrames, state,
+                                 templates.data() + lane * templateLength);
+            } else {
+                if (!anyMarked && state.blankRemaining == 0) {
+                    state.holdValue = data[(numFrames - 1) * numLanes + lane];
+                    continue;
+                }
+                if (!anyMarked) mark = noMarks.constData();
+                blankLane(data + lane, numLanes, mark, numFrames, state);
+            }
+        }
+    }
+}
+
+// Set mark[t] if any artifact marker is set for this channel at time t.
+// Returns false (leaving mark undefined) if no markers are set in the block.
+bool ArtifactSuppressor::markChannel(char *mark, int stream, int channel, int numFrames,
+                                     const QVector<QVector<QVector<int> > > &stimOn,
+                                     const QVector<QVector<QVector<int> > > &ampSettle,
+                                     const QVector<QVector<QVector<int> > > &chargeRecov) const
+{
+    const int *pStimOn = stimOn[stream][channel].constData();
+    const int *pAmpSettle = ampSettle[stream][channel].constData();
+    const int *pChargeRecov = chargeRecov[stream][channel].constData();
+
+    int any = 0;
+    for (int t = 0; t < numFrames; ++t) {
+        int m = pStimOn[t] | pAmpSettle[t] | pChargeRecov[t];
+        mark[t] = (m != 0);
+        any |= m;
+    }
+    return any != 0;
+}
+
+// Blank or interpolate across marked samples of one lane, plus tailSamples after each.
+void ArtifactSuppressor::blankLane(Sample *x, int stride, const char *mark, int numFrames, LaneState &state) const
+{
+    int segmentStart = (state.blankRemaining > 0) ? 0 : -1;
+
+    for (int t = 0; t < numFrames; ++t) {
+        if (mark[t]) state.blankRemaining = tailSamples + 1;
+
+        if (state.blankRemaining > 0) {
+            --state.blankRemaining;
+            if (segmentStart < 0) segmentStart = t;
+            x[t * stride] = state.holdValue;
+        } else {
+            if (segmentStart >= 0 && mode == ArtifactInterpolate) {
+                Sample end = x[t * stride];
+                Sample step = (end - state.holdValue) / (t - segmentStart + 1);
+                for (int i = segmentStart; i < t; ++i) {
+                    x[i * stride] = state.holdValue + step * (i - segmentStart + 1);
+                }
+            }
+            segmentStart = -1;
+            state.holdValue = x[t * stride];
+        }
+    }
+}
+
+// Subtract the running-average artifact template from one lane for the
+// templateLength samples after each stimulation onset (the first marked
+// sample after an unmarked one), then fold the new artifact into the template.
+// The template is built from raw samples, so it is unaffected by the
+// subtraction; the first artifact after the template is cleared passes through.
+void ArtifactSuppressor::subtractTemplate(Sample *x, int stride, const char *mark, int numFrames,
+                                          LaneState &state, Sample *laneTemplate) const
+{
+    for (int t = 0; t < numFrames; ++t) {
+        if (mark[t] && !state.prevMarked) {
+            state.phase = 0;
+            if (state.numTemplates < numAveraged) ++state.numTemplates;
+        }
+        state.prevMarked = (mark[t] != 0);
+
+        if (state.phase >= 0) {
+            Sample raw = x[t * stride];
+            Sample &templateValue = laneTemplate[state.phase];
+            x[t * stride] = raw - templateValue;
+            templateValue += (raw - templateValue) / state.numTemplates;
+            if (++state.phase == templateLength) state.phase = -1;
+        }
+    }
+}
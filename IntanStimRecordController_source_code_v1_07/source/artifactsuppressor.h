@@ -0,0 +1,106 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ARTIFACTSUPPRESSOR_H
+#define ARTIFACTSUPPRESSOR_H
+
+#include <QVector>
+
+#include "globalconstants.h"
+
+// Online suppression of stimulation artifacts in amplifier data.
+//
+// Works in place on time-major data (sample t of the lane for stream s and
+// channel c at data[t * numLanes + c * numStreams + s], the layout of
+// SignalProcessor::amplifierPreFilterFast), using the stimOn, ampSettle and
+// chargeRecov markers loaded with each data block.  A sample is marked if any
+// of these markers is set for its channel or, optionally, for any channel on
+// the same headstage.
+//
+// Blanking holds the last unmarked value through each marked stretch and a
+// following tail.  Interpolation instead draws a straight line from that value
+// to the first good sample after the stretch; if the stretch runs past the end
+// of a data block, the samples already passed on are held and the line starts
+// from the held value, so no delay is added.  Template subtraction keeps, for
+// each channel, a running average of the templateLength samples following each
+// stimulation onset, and subtracts it from the next artifact.  Lanes with no
+// marked samples and no artifact in progress are skipped, so the cost is low
+// when stimulation is sparse.
+class ArtifactSuppressor
+{
+public:
+    enum Mode {
+        ArtifactOff,
+        ArtifactBlank,
+        ArtifactInterpolate,
+        ArtifactTemplate
+    };
+
+    enum TriggerScope {
+        TriggerChannel,
+        TriggerHeadstage
+    };
+
+    ArtifactSuppressor();
+
+    void setNumStreams(int numStreams_, int maxSamples);
+    void setParameters(Mode mode_, TriggerScope scope_, int tailSamples_, int templateLength_, int numAveraged_);
+    void resetState();
+    Mode getMode() const;
+
+    void apply(Sample *data, int numFrames,
+               const QVector<QVector<QVector<int> > > &stimOn,
+               const QVector<QVector<QVector<int> > > &ampSettle,
+               const QVector<QVector<QVector<int> > > &chargeRecov);
+
+private:
+    struct LaneState
+    {
+        int blankRemaining;     // samples still to be blanked (including tail)
+        Sample holdValue;       // last unmarked sample
+        bool prevMarked;
+        int phase;              // samples since stimulation onset, or -1 outside the template window
+        int numTemplates;       // artifacts averaged into the template so far (up to numAveraged)
+    };
+
+    Mode mode;
+    TriggerScope scope;
+    int tailSamples;
+    int templateLength;
+    int numAveraged;
+    int numStreams;
+
+    QVector<LaneState> laneState;
+    QVector<Sample> templates;          // templateLength samples per lane
+    QVector<char> marked;               // markers for one lane in the current block
+    QVector<char> noMarks;              // all zero
+    QVector<QVector<char> > streamMarked;
+
+    bool markChannel(char *mark, int stream, int channel, int numFrames,
+                     const QVector<QVector<QVector<int> > > &stimOn,
+                     const QVector<QVector<QVector<int> > > &ampSettle,
+                     const QVector<QVector<QVector<int> > > &chargeRecov) const;
+    void blankLane(Sample *x, int stride, const char *mark, int numFrames, LaneState &state) const;
+    void subtractTemplate(Sample *x, int stride, const char *mark, int numFrames, LaneState &state,
+                          Sample *laneTemplate) const;
+};
+
+#endif // ARTIFACTSUPPRESSOR_H
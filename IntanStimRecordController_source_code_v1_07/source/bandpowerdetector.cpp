@@ -0,0 +1,407 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cmath>
+
+#include "bandpowerdetector.h"
+#include "multichannelbiquad.h"
+#include "filterdesign.h"
+#include "samplevector.h"
+
+using namespace std;
+
+// The envelope is computed with SIMD vectors across lanes (see samplevector.h).
+// The threshold loops run over adjacent lanes of one frame without branches,
+// so compilers can vectorize them across lanes as well.
+
+// The band-pass output buffer is aligned to a cache line.
+static const int BufferAlignment = 64;
+
+// Approximate interval between baseline updates, in seconds.
+static const double BaselineUpdateInterval = 0.001;
+
+// Scalar envelope kernel for lanes [firstLane, lastLane): replaces each sample
+// y with the lowpass-filtered power p += a * (y * y - p).
+static void envelopeScalar(Sample *data, int numFrames, int numLanes, int firstLane, int lastLane,
+                           Sample a, Sample *power)
+{
+    for (int lane = firstLane; lane < lastLane; ++lane) {
+        Sample p = power[lane];
+        Sample *y = data + lane;
+        for (int t = 0; t < numFrames; ++t) {
+            p += a * (*y * *y - p);
+            *y = p;
+            y += numLanes;
+        }
+        power[lane] = p;
+    }
+}
+
+#ifdef SAMPLE_VECTOR_SIMD
+// Vector envelope kernel for lanes [firstLane, lastLane).  Returns the first
+// lane not processed, which is lastLane unless the range is not a multiple of
+// the vector width.
+static int envelopeVector(Sample *data, int numFrames, int numLanes, int firstLane, int lastLane,
+                          Sample a, Sample *power)
+{
+    typedef SampleVector Vec;
+    typedef Vec::V V;
+    const int Width = Vec::Width;
+    const V va = Vec::set1(a);
+
+    int lane = firstLane;
+    for (; lane + Width <= lastLane; lane += Width) {
+        V p = Vec::loadu(power + lane);
+        Sample *y = data + lane;
+        for (int t = 0; t < numFrames; ++t) {
+            V x = Vec::loadu(y);
+            p = Vec::add(p, Vec::mul(va, Vec::sub(Vec::mul(x, x), p)));
+            Vec::storeu(y, p);
+            y += numLanes;
+        }
+        Vec::storeu(power + lane, p);
+    }
+    return lane;
+}
+#endif
+
+// Constructor.
+BandPowerDetector::BandPowerDetector()
+{
+    enabled = false;
+    lowCutoff = 150.0;
+    highCutoff = 250.0;
+    order = 2;
+    sampleRate = 30000.0;
+    onThreshold = 3.0;
+    offThreshold = 1.0;
+    smoothingRate = 1;
+    baselineRate = 1;
+    baselineInterval = 1;
+    minChannels = 1;
+    minDuration = 1;
+    refractoryPeriod = 0;
+    numLanes = 0;
+    maxFrames = 0;
+    bandData = nullptr;
+    baselineInitialized = false;
+    framesProcessed = 0;
+    runLength = 0;
+    runOnsetFrame = 0;
+    runOnsetTimestamp = 0;
+    eventActive = false;
+    refractoryEnd = 0;
+    numActiveChannels = 0;
+}
+
+BandPowerDetector::~BandPowerDetector()
+{
+    freeCascade();
+    qFreeAligned(bandData);
+}
+
+void BandPowerDetector::freeCascade()
+{
+    qDeleteAll(cascade);
+    cascade.clear();
+}
+
+// Allocate state for numLanes_ interleaved channels and blocks of up to
+// maxFrames_ frames.  All lanes may vote until setActiveLanes() is called.
+// The detector state is reset.
+void BandPowerDetector::setNumLanes(int numLanes_, int maxFrames_)
+{
+    numLanes = numLanes_;
+    maxFrames = maxFrames_;
+
+    qFreeAligned(bandData);
+    bandData = static_cast<Sample*>(qMallocAligned(qMax(numLanes * maxFrames, 1) * sizeof(Sample),
+                                                   BufferAlignment));
+    for (int i = 0; i < cascade.size(); ++i) {
+        cascade[i]->setNumLanes(numLanes);
+    }
+
+    power.resize(numLanes);
+    mean.resize(numLanes);
+    variance.resize(numLanes);
+    onPower.resize(numLanes);
+    offPower.resize(numLanes);
+    active.resize(numLanes);
+    laneMask.fill(1, numLanes);
+    activeFlags.resize(numLanes * maxFrames);
+    resetState();
+}
+
+// Set the detection parameters.  The band runs from lowCutoff_ to highCutoff_
+// (in Hz), with a Butterworth band-pass filter of the given prototype order.
+// smoothingTime is the time constant of the envelope lowpass filter and
+// baselineTimeConstant that of the running baseline, both in seconds.
+// Thresholds are in standard deviations of the amplitude envelope above its
+// mean.  minDuration_ and refractoryPeriod_ are in samples.  Returns false,
+// disabling the detector, if the band cannot be designed at this sample rate.
+// The detector is reset if the band or sample rate changes.
+bool BandPowerDetector::setParameters(bool enabled_, double lowCutoff_, double highCutoff_, int order_,
+                                      double smoothingTime, double baselineTimeConstant,
+                                      double onThreshold_, double offThreshold_, int minChannels_,
+                                      int minDuration_, int refractoryPeriod_, double sampleRate_)
+{
+    bool bandChanged = (lowCutoff_ != lowCutoff) || (highCutoff_ != highCutoff) || (order_ != order) ||
+            (sampleRate_ != sampleRate) || cascade.isEmpty();
+
+    lowCutoff = lowCutoff_;
+    highCutoff = highCutoff_;
+    order = order_;
+    sampleRate = sampleRate_;
+    onThreshold = onThreshold_;
+    offThreshold = qMin(offThreshold_, onThreshold_);
+    minChannels = qMax(1, minChannels_);
+    minDuration = qMax(1, minDuration_);
+    refractoryPeriod = qMax(0, refractoryPeriod_);
+
+    smoothingRate = (Sample) (1.0 - exp(-1.0 / qMax(1.0, smoothingTime * sampleRate)));
+    baselineInterval = qMax(1, qRound(BaselineUpdateInterval * sampleRate));
+    baselineRate = (Sample) (1.0 - exp(-baselineInterval / qMax(1.0, baselineTimeConstant * sampleRate)));
+
+    bool valid = true;
+    if (bandChanged) {
+        FilterSpec spec;
+        spec.prototype = FilterButterworth;
+        spec.response = FilterBandpass;
+        spec.order = order;
+        spec.lowCutoff = lowCutoff;
+        spec.highCutoff = highCutoff;
+        spec.passbandRipple = 0.0;
+        spec.stopbandAttenuation = 0.0;
+
+        QVector<BiquadSection> sections;
+        valid = FilterDesign::design(spec, sampleRate, sections);
+
+        freeCascade();
+        if (valid) {
+            for (int i = 0; i < sections.size(); ++i) {
+                const BiquadSection &s = sections[i];
+                MultiChannelBiquad *biquad = new MultiChannelBiquad();
+                biquad->setNumLanes(numLanes);
+                biquad->setCoefficients(s.b0, s.b1, s.b2, s.a1, s.a2);
+                cascade.append(biquad);
+            }
+        }
+    }
+
+    enabled = enabled_ && valid;
+    if (bandChanged || !enabled) {
+        resetState();
+    } else {
+        for (int lane = 0; lane < numLanes; ++lane) {
+            updateThresholds(lane);
+        }
+    }
+    return valid;
+}
+
+// Only the listed lanes (normally the enabled amplifier channels) vote for events.
+void BandPowerDetector::setActiveLanes(const QVector<int> &lanes)
+{
+    laneMask.fill(0, numLanes);
+    for (int i = 0; i < lanes.size(); ++i) {
+        if (lanes[i] >= 0 && lanes[i] < numLanes) {
+            laneMask[lanes[i]] = 1;
+        }
+    }
+}
+
+// Reset filter state, envelopes, and baselines, and end any event.  The
+// baseline is relearned from the next block.
+void BandPowerDetector::resetState()
+{
+    for (int i = 0; i < cascade.size(); ++i) {
+        cascade[i]->resetState();
+    }
+    power.fill(0);
+    mean.fill(0);
+    variance.fill(0);
+    onPower.fill(0);
+    offPower.fill(0);
+    active.fill(0);
+    activeFlags.fill(0);
+    baselineInitialized = false;
+    framesProcessed = 0;
+    runLength = 0;
+    eventActive = false;
+    refractoryEnd = 0;
+    numActiveChannels = 0;
+    events.clear();
+}
+
+bool BandPowerDetector::isEnabled() const
+{
+    return enabled;
+}
+
+// Convert a lane's baseline to power thresholds.
+void BandPowerDetector::updateThresholds(int lane)
+{
+    Sample sd = sqrt(variance[lane]);
+    Sample on = qMax((Sample) 0, (Sample) (mean[lane] + onThreshold * sd));
+    Sample off = qMax((Sample) 0, (Sample) (mean[lane] + offThreshold * sd));
+    onPower[lane] = on * on;
+    offPower[lane] = off * off;
+}
+
+// Start each lane's baseline from the statistics of its amplitude envelope in
+// the first block (held in bandData as power), sampled at the baseline interval.
+void BandPowerDetector::initializeBaseline(int numFrames, int firstLane, int lastLane)
+{
+    for (int lane = firstLane; lane < lastLane; ++lane) {
+        double sum = 0.0, sumSquares = 0.0;
+        int count = 0;
+        for (int t = 0; t < numFrames; t += baselineInterval) {
+            double e = sqrt(bandData[t * numLanes + lane]);
+            sum += e;
+            sumSquares += e * e;
+            ++count;
+        }
+        double m = sum / count;
+        mean[lane] = (Sample) m;
+        variance[lane] = (Sample) qMax(0.0, sumSquares / count - m * m);
+        updateThresholds(lane);
+    }
+}
+
+// Band-pass filter numFrames frames of lanes [firstLane, lastLane), update
+// their envelopes and baselines, and mark the frames at which each lane is
+// active.  Different threads may process disjoint lane ranges at the same
+// time; vote() must be called once all lanes are done.
+void BandPowerDetector::filter(const Sample *in, int numFrames, int firstLane, int lastLane)
+{
+    if (!enabled) return;
+
+    cascade[0]->filter(in, bandData, numFrames, firstLane, lastLane);
+    for (int i = 1; i < cascade.size(); ++i) {
+        cascade[i]->filter(bandData, bandData, numFrames, firstLane, lastLane);
+    }
+
+    // Replace the band-pass output with its smoothed power envelope.
+    int lane = firstLane;
+#ifdef SAMPLE_VECTOR_SIMD
+    lane = envelopeVector(bandData, numFrames, numLanes, firstLane, lastLane, smoothingRate, power.data());
+#endif
+    envelopeScalar(bandData, numFrames, numLanes, lane, lastLane, smoothingRate, power.data());
+
+    if (!baselineInitialized) {
+        initializeBaseline(numFrames, firstLane, lastLane);
+    }
+
+    // Hysteresis thresholds, with the baseline of inactive lanes updated every
+    // baselineInterval frames counted from reset.
+    int nextBaselineFrame = (baselineInterval - (int) (framesProcessed % baselineInterval)) % baselineInterval;
+    char *isActive = active.data();
+    const char *mask = laneMask.constData();
+    const Sample *on = onPower.constData();
+    const Sample *off = offPower.constData();
+    const Sample r = baselineRate;
+    for (int t = 0; t < numFrames; ++t) {
+        const Sample *env = bandData + t * numLanes;
+        char *flags = activeFlags.data() + t * numLanes;
+        for (int lane = firstLane; lane < lastLane; ++lane) {
+            char a = (env[lane] > on[lane]) | (isActive[lane] & (env[lane] >= off[lane]));
+            isActive[lane] = a;
+            flags[lane] = a & mask[lane];
+        }
+
+        if (t == nextBaselineFrame) {
+            for (int lane = firstLane; lane < lastLane; ++lane) {
+                if (isActive[lane]) continue;
+                Sample d = sqrt(env[lane]) - mean[lane];
+                mean[lane] += r * d;
+                variance[lane] = (1 - r) * (variance[lane] + r * d * d);
+                updateThresholds(lane);
+            }
+            nextBaselineFrame += baselineInterval;
+        }
+    }
+}
+
+// Count the voting lanes active at each of the numFrames frames last passed
+// to filter() for all lanes, and declare events.  timestamps holds the board
+// timestamp of each frame.
+void BandPowerDetector::vote(int numFrames, const qint32 *timestamps)
+{
+    events.clear();
+    if (!enabled) return;
+
+    int count = 0;
+    for (int t = 0; t < numFrames; ++t) {
+        const char *flags = activeFlags.constData() + t * numLanes;
+        count = 0;
+        for (int lane = 0; lane < numLanes; ++lane) {
+            count += flags[lane];
+        }
+
+        qint64 frame = framesProcessed + t;
+        if (eventActive) {
+            if (count < minChannels) {
+                eventActive = false;
+                refractoryEnd = frame + refractoryPeriod;
+            }
+        } else if (count >= minChannels && frame >= refractoryEnd) {
+            if (runLength == 0) {
+                runOnsetFrame = frame;
+                runOnsetTimestamp = timestamps[t];
+            }
+            if (++runLength >= minDuration) {
+                BandPowerEvent event;
+                event.onsetFrame = runOnsetFrame;
+                event.onsetTimestamp = runOnsetTimestamp;
+                event.detectionTimestamp = timestamps[t];
+                event.numChannels = count;
+                events.append(event);
+                eventActive = true;
+                runLength = 0;
+            }
+        } else {
+            runLength = 0;
+        }
+    }
+
+    numActiveChannels = count;
+    framesProcessed += numFrames;
+    baselineInitialized = true;
+}
+
+// Events declared during the last call to vote().
+const QVector<BandPowerEvent>& BandPowerDetector::getEvents() const
+{
+    return events;
+}
+
+// True if the most recent event had not ended by the last frame passed to vote().
+bool BandPowerDetector::isEventActive() const
+{
+    return eventActive;
+}
+
+// Number of voting lanes active at the last frame passed to vote().
+int BandPowerDetector::getNumActiveChannels() const
+{
+    return numActiveChannels;
+}
@@ -0,0 +1,133 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BANDPOWERDETECTOR_H
+#define BANDPOWERDETECTOR_H
+
+#include <QVector>
+
+#include "globalconstants.h"
+
+class MultiChannelBiquad;
+
+// One band power event (e.g., a hippocampal sharp-wave ripple).  The onset is
+// the first frame at which at least minChannels channels were above threshold;
+// the event is declared minDuration frames later, at the detection frame, if
+// enough channels stayed active.  Frames count samples since the detector was
+// reset, and timestamps are board timestamps.
+struct BandPowerEvent
+{
+    qint64 onsetFrame;
+    qint32 onsetTimestamp;
+    qint32 detectionTimestamp;
+    int numChannels;            // channels above threshold at the detection frame
+};
+
+// Real-time detector of events of high power in one frequency band, such as
+// hippocampal ripples (150-250 Hz), on all amplifier channels.
+//
+// Works on time-major data (sample t of lane l at data[t * numLanes + l], the
+// layout of SignalProcessor::amplifierPostFilterFast).  Each lane is band-pass
+// filtered by a Butterworth cascade designed by FilterDesign, and its power
+// envelope is the squared filter output smoothed by a one-pole lowpass filter.
+// The amplitude envelope (the square root of the power envelope) has a running
+// mean and standard deviation, learned while the lane is inactive so that
+// events do not raise their own threshold.  A lane becomes active when its
+// envelope rises above the mean plus onThreshold standard deviations, and
+// stays active until it falls below the mean plus offThreshold standard
+// deviations.  Thresholds are converted to power so that the per-sample work
+// is a few multiplies and comparisons; the baseline, which changes slowly, is
+// only updated about once per millisecond.
+//
+// Filtering and the per-lane thresholds run in filter(), on disjoint lane ranges
+// in the filter worker threads.  vote() then counts the active channels at each
+// frame and declares an event when at least minChannels are active for
+// minDuration frames, after which no new event is declared until the count has
+// dropped below minChannels and a refractory period has passed.
+class BandPowerDetector
+{
+public:
+    BandPowerDetector();
+    ~BandPowerDetector();
+
+    void setNumLanes(int numLanes_, int maxFrames_);
+    bool setParameters(bool enabled_, double lowCutoff_, double highCutoff_, int order_,
+                       double smoothingTime, double baselineTimeConstant,
+                       double onThreshold_, double offThreshold_, int minChannels_,
+                       int minDuration_, int refractoryPeriod_, double sampleRate_);
+    void setActiveLanes(const QVector<int> &lanes);
+    void resetState();
+    bool isEnabled() const;
+
+    void filter(const Sample *in, int numFrames, int firstLane, int lastLane);
+    void vote(int numFrames, const qint32 *timestamps);
+
+    const QVector<BandPowerEvent>& getEvents() const;
+    bool isEventActive() const;
+    int getNumActiveChannels() const;
+
+private:
+    bool enabled;
+    double lowCutoff;
+    double highCutoff;
+    int order;
+    double sampleRate;
+    double onThreshold;
+    double offThreshold;
+    Sample smoothingRate;       // envelope lowpass coefficient per sample
+    Sample baselineRate;        // baseline update coefficient per baseline interval
+    int baselineInterval;       // frames between baseline updates
+    int minChannels;
+    int minDuration;
+    int refractoryPeriod;
+
+    int numLanes;
+    int maxFrames;
+    QVector<MultiChannelBiquad*> cascade;
+    Sample *bandData;           // band-pass filter output, time-major
+
+    // Per-lane state
+    QVector<Sample> power;      // smoothed power envelope
+    QVector<Sample> mean;       // baseline mean of the amplitude envelope
+    QVector<Sample> variance;   // baseline variance of the amplitude envelope
+    QVector<Sample> onPower;    // power thresholds for activation and release
+    QVector<Sample> offPower;
+    QVector<char> active;
+    QVector<char> laneMask;     // lanes allowed to vote
+    QVector<char> activeFlags;  // active and allowed lanes for each frame, time-major
+
+    bool baselineInitialized;
+    qint64 framesProcessed;
+    int runLength;              // frames in the current run of enough active channels
+    qint64 runOnsetFrame;
+    qint32 runOnsetTimestamp;
+    bool eventActive;
+    qint64 refractoryEnd;
+    int numActiveChannels;
+
+    QVector<BandPowerEvent> events;
+
+    void freeCascade();
+    void initializeBaseline(int numFrames, int firstLane, int lastLane);
+    void updateThresholds(int lane);
+};
+
+#endif // BANDPOWERDETECTOR_H
@@ -0,0 +1,192 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "bandpowerdialog.h"
+#include "rhs2000evalboard.h"
+#include "rhs2000datablock.h"
+
+// Band power event detection dialog.
+// This dialog allows users to detect events of high power in one frequency
+// band (e.g., hippocampal sharp-wave ripples) across amplifier channels, and
+// optionally to fire a manual stimulation trigger when an event is detected.
+
+BandPowerDialog::BandPowerDialog(const BandPowerSettings &settings, QWidget *parent) :
+    QDialog(parent)
+{
+    enableCheckBox = new QCheckBox(tr("Enable band power event detection"));
+    enableCheckBox->setChecked(settings.enabled);
+
+    lowCutoffSpinBox = new QDoubleSpinBox();
+    lowCutoffSpinBox->setRange(1.0, 5000.0);
+    lowCutoffSpinBox->setDecimals(1);
+    lowCutoffSpinBox->setSuffix(" Hz");
+    lowCutoffSpinBox->setValue(settings.lowCutoff);
+
+    highCutoffSpinBox = new QDoubleSpinBox();
+    highCutoffSpinBox->setRange(2.0, 10000.0);
+    highCutoffSpinBox->setDecimals(1);
+    highCutoffSpinBox->setSuffix(" Hz");
+    highCutoffSpinBox->setValue(settings.highCutoff);
+
+    orderSpinBox = new QSpinBox();
+    orderSpinBox->setRange(1, 4);
+    orderSpinBox->setValue(settings.order);
+
+    smoothingSpinBox = new QDoubleSpinBox();
+    smoothingSpinBox->setRange(0.5, 100.0);
+    smoothingSpinBox->setDecimals(1);
+    smoothingSpinBox->setSuffix(" ms");
+    smoothingSpinBox->setValue(settings.smoothingMsec);
+
+    baselineSpinBox = new QDoubleSpinBox();
+    baselineSpinBox->setRange(1.0, 600.0);
+    baselineSpinBox->setDecimals(0);
+    baselineSpinBox->setSuffix(" s");
+    baselineSpinBox->setValue(settings.baselineTimeConstantSec);
+
+    onThresholdSpinBox = new QDoubleSpinBox();
+    onThresholdSpinBox->setRange(0.5, 20.0);
+    onThresholdSpinBox->setDecimals(1);
+    onThresholdSpinBox->setSingleStep(0.5);
+    onThresholdSpinBox->setSuffix(tr(" SD"));
+    onThresholdSpinBox->setValue(settings.onThreshold);
+
+    offThresholdSpinBox = new QDoubleSpinBox();
+    offThresholdSpinBox->setRange(0.0, 20.0);
+    offThresholdSpinBox->setDecimals(1);
+    offThresholdSpinBox->setSingleStep(0.5);
+    offThresholdSpinBox->setSuffix(tr(" SD"));
+    offThresholdSpinBox->setValue(settings.offThreshold);
+
+    minChannelsSpinBox = new QSpinBox();
+    minChannelsSpinBox->setRange(1, MAX_NUM_DATA_STREAMS * CHANNELS_PER_STREAM);
+    minChannelsSpinBox->setValue(settings.minChannels);
+
+    minDurationSpinBox = new QDoubleSpinBox();
+    minDurationSpinBox->setRange(0.0, 100.0);
+    minDurationSpinBox->setDecimals(1);
+    minDurationSpinBox->setSuffix(" ms");
+    minDurationSpinBox->setValue(settings.minDurationMsec);
+
+    refractorySpinBox = new QDoubleSpinBox();
+    refractorySpinBox->setRange(0.0, 10000.0);
+    refractorySpinBox->setDecimals(0);
+    refractorySpinBox->setSingleStep(10.0);
+    refractorySpinBox->setSuffix(" ms");
+    refractorySpinBox->setValue(settings.refractoryMsec);
+
+    triggerCheckBox = new QCheckBox(tr("Fire stimulation trigger on events"));
+    triggerCheckBox->setChecked(settings.triggerEnabled);
+
+    triggerComboBox = new QComboBox();
+    for (int i = 1; i <= 8; ++i) {
+        triggerComboBox->addItem(tr("KEYPRESS: %1").arg(i));
+    }
+    triggerComboBox->setCurrentIndex(settings.trigger);
+
+    connect(enableCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateControls()));
+    connect(triggerCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateControls()));
+
+    QFormLayout *formLayout = new QFormLayout();
+    formLayout->addRow(tr("Low cutoff frequency"), lowCutoffSpinBox);
+    formLayout->addRow(tr("High cutoff frequency"), highCutoffSpinBox);
+    formLayout->addRow(tr("Butterworth filter order"), orderSpinBox);
+    formLayout->addRow(tr("Envelope smoothing"), smoothingSpinBox);
+    formLayout->addRow(tr("Baseline time constant"), baselineSpinBox);
+    formLayout->addRow(tr("Event start threshold"), onThresholdSpinBox);
+    formLayout->addRow(tr("Event end threshold"), offThresholdSpinBox);
+    formLayout->addRow(tr("Minimum channels"), minChannelsSpinBox);
+    formLayout->addRow(tr("Minimum duration"), minDurationSpinBox);
+    formLayout->addRow(tr("Refractory period"), refractorySpinBox);
+    formLayout->addRow(triggerCheckBox);
+    formLayout->addRow(tr("Trigger source"), triggerComboBox);
+
+    QLabel *noteLabel = new QLabel(tr("Each enabled amplifier channel is band-pass filtered after the notch "
+                                      "filter, and its smoothed amplitude envelope is compared with thresholds "
+                                      "in standard deviations above its running baseline.  A channel stays "
+                                      "active from the start threshold until it falls below the end threshold.  "
+                                      "An event is detected when enough channels have been active for the "
+                                      "minimum duration.  The trigger source is the same as pressing the "
+                                      "corresponding number key, and is held while the event lasts; stimulation "
+                                      "must be enabled on the channels that use it.  Detection latency is "
+                                      "shown next to the Band Power Events button."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(enableCheckBox);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Band Power Event Detection"));
+
+    updateControls();
+}
+
+// Enable the controls that apply to the selected options.
+void BandPowerDialog::updateControls()
+{
+    bool enabled = enableCheckBox->isChecked();
+
+    lowCutoffSpinBox->setEnabled(enabled);
+    highCutoffSpinBox->setEnabled(enabled);
+    orderSpinBox->setEnabled(enabled);
+    smoothingSpinBox->setEnabled(enabled);
+    baselineSpinBox->setEnabled(enabled);
+    onThresholdSpinBox->setEnabled(enabled);
+    offThresholdSpinBox->setEnabled(enabled);
+    minChannelsSpinBox->setEnabled(enabled);
+    minDurationSpinBox->setEnabled(enabled);
+    refractorySpinBox->setEnabled(enabled);
+    triggerCheckBox->setEnabled(enabled);
+    triggerComboBox->setEnabled(enabled && triggerCheckBox->isChecked());
+}
+
+BandPowerSettings BandPowerDialog::getSettings() const
+{
+    BandPowerSettings settings;
+    settings.enabled = enableCheckBox->isChecked();
+    settings.lowCutoff = qMin(lowCutoffSpinBox->value(), highCutoffSpinBox->value());
+    settings.highCutoff = qMax(lowCutoffSpinBox->value(), highCutoffSpinBox->value());
+    settings.order = orderSpinBox->value();
+    settings.smoothingMsec = smoothingSpinBox->value();
+    settings.baselineTimeConstantSec = baselineSpinBox->value();
+    settings.onThreshold = onThresholdSpinBox->value();
+    settings.offThreshold = qMin(offThresholdSpinBox->value(), onThresholdSpinBox->value());
+    settings.minChannels = minChannelsSpinBox->value();
+    settings.minDurationMsec = minDurationSpinBox->value();
+    settings.refractoryMsec = refractorySpinBox->value();
+    settings.triggerEnabled = triggerCheckBox->isChecked();
+    settings.trigger = triggerComboBox->currentIndex();
+    return settings;
+}
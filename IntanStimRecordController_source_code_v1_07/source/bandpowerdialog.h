@@ -0,0 +1,84 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BANDPOWERDIALOG_H
+#define BANDPOWERDIALOG_H
+
+#include <QDialog>
+
+class QDialogButtonBox;
+class QCheckBox;
+class QComboBox;
+class QSpinBox;
+class QDoubleSpinBox;
+
+// Band power event detection settings, with times in milliseconds or seconds
+// so they are independent of the sample rate.
+struct BandPowerSettings
+{
+    bool enabled;
+    double lowCutoff;
+    double highCutoff;
+    int order;
+    double smoothingMsec;
+    double baselineTimeConstantSec;
+    double onThreshold;
+    double offThreshold;
+    int minChannels;
+    double minDurationMsec;
+    double refractoryMsec;
+    bool triggerEnabled;
+    int trigger;
+};
+
+class BandPowerDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit BandPowerDialog(const BandPowerSettings &settings, QWidget *parent);
+
+    BandPowerSettings getSettings() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateControls();
+
+private:
+    QCheckBox *enableCheckBox;
+    QDoubleSpinBox *lowCutoffSpinBox;
+    QDoubleSpinBox *highCutoffSpinBox;
+    QSpinBox *orderSpinBox;
+    QDoubleSpinBox *smoothingSpinBox;
+    QDoubleSpinBox *baselineSpinBox;
+    QDoubleSpinBox *onThresholdSpinBox;
+    QDoubleSpinBox *offThresholdSpinBox;
+    QSpinBox *minChannelsSpinBox;
+    QDoubleSpinBox *minDurationSpinBox;
+    QDoubleSpinBox *refractorySpinBox;
+    QCheckBox *triggerCheckBox;
+    QComboBox *triggerComboBox;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // BANDPOWERDIALOG_H
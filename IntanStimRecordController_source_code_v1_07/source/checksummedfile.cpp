@@ -0,0 +1,215 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QByteArray>
+#include <QtEndian>
+#include <cstring>
+#include <iostream>
+
+#include "globalconstants.h"
+#include "checksummedfile.h"
+#include "crc32c.h"
+
+using namespace std;
+
+// Data file with CRC-32C checksums computed in the write path.
+//
+// Every byte written through QFile::write() (and therefore through any
+// QDataStream attached to the file) passes through writeData(), where it is
+// added to the checksum of the current chunk.  When a chunk is complete, its
+// checksum is stored and combined into the checksum of all completed chunks,
+// so the checksum of the whole file never requires a second pass over the data.
+//
+// At the end of a recording, writeChecksumFile() saves the chunk and file
+// checksums of all data files in a single sidecar file, which the rhsverify
+// tool uses to check the data files for corruption.
+
+ChecksummedFile::ChecksummedFile(const QString &name, bool checksumsEnabled) :
+    QFile(name)
+{
+    enabled = checksumsEnabled;
+    completedChunksCrc = 0;
+    currentChunkCrc = 0;
+    currentChunkBytes = 0;
+}
+
+bool ChecksummedFile::checksumsEnabled() const
+{
+    return enabled;
+}
+
+// Return the CRC-32C of all data written to the file so far.
+quint32 ChecksummedFile::fileCrc() const
+{
+    return crc32cCombine(completedChunksCrc, currentChunkCrc, currentChunkBytes);
+}
+
+// Return the CRC-32C of each chunk written so far, including the final partial chunk.
+QVector<quint32> ChecksummedFile::chunkCrcs() const
+{
+    QVector<quint32> crcs = completedChunkCrcs;
+    if (currentChunkBytes > 0) {
+        crcs.append(currentChunkCrc);
+    }
+    return crcs;
+}
+
+qint64 ChecksummedFile::writeData(const char *data, qint64 len)
+{
+    qint64 written = QFile::writeData(data, len);
+    if (!enabled || written <= 0) {
+        return written;
+    }
+
+    qint64 remaining = written;
+    while (remaining > 0) {
+        qint64 n = qMin(remaining, (qint64) CHECKSUM_CHUNK_SIZE - currentChunkBytes);
+        currentChunkCrc = crc32c(currentChunkCrc, data, n);
+        currentChunkBytes += n;
+        data += n;
+        remaining -= n;
+
+        if (currentChunkBytes == CHECKSUM_CHUNK_SIZE) {
+            completedChunkCrcs.append(currentChunkCrc);
+            completedChunksCrc = crc32cCombine(completedChunksCrc, currentChunkCrc, currentChunkBytes);
+            currentChunkCrc = 0;
+            currentChunkBytes = 0;
+        }
+    }
+    return written;
+}
+
+// Return the checksum filename for a recording with the specified base name.
+QString ChecksummedFile::checksumFileName(const QString &path, const QString &baseName)
+{
+    return path + "/" + baseName + ".crc32c";
+}
+
+// Write a checksum file listing the length, file checksum and chunk checksums
+// of each of the specified data files.  Data files are listed relative to the
+// directory containing the checksum file.
+bool ChecksummedFile::writeChecksumFile(const QString &fileName, const QVector<ChecksummedFile*> &files)
+{
+    QByteArray contents;
+    QDataStream out(&contents, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_8);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    QDir checksumDir = QFileInfo(fileName).absoluteDir();
+
+    out << (quint32) CHECKSUM_FILE_MAGIC_NUMBER;
+    out << (qint16) CHECKSUM_FILE_MAIN_VERSION_NUMBER;
+    out << (qint16) CHECKSUM_FILE_SECONDARY_VERSION_NUMBER;
+    out << (qint32) CHECKSUM_CHUNK_SIZE;
+    out << (qint32) files.size();
+    for (int i = 0; i < files.size(); ++i) {
+        QVector<quint32> crcs = files[i]->chunkCrcs();
+        out << checksumDir.relativeFilePath(QFileInfo(files[i]->fileName()).absoluteFilePath());
+        out << (qint64) files[i]->pos();
+        out << (quint32) files[i]->fileCrc();
+        out << (qint32) crcs.size();
+        for (int j = 0; j < crcs.size(); ++j) {
+            out << (quint32) crcs[j];
+        }
+    }
+    out << (quint32) crc32c(0, contents.constData(), contents.size());
+
+    QFile checksumFile(fileName);
+    if (!checksumFile.open(QIODevice::WriteOnly)) {
+        cerr << "Cannot open checksum file for writing: " <<
+                qPrintable(checksumFile.errorString()) << endl;
+        return false;
+    }
+    bool ok = (checksumFile.write(contents) == contents.size());
+    checksumFile.close();
+    return ok;
+}
+
+// Read a checksum file written by writeChecksumFile().  Returns false (with
+// errorMessage set) if the file cannot be read or is itself damaged.
+bool ChecksummedFile::readChecksumFile(const QString &fileName, qint64 &chunkSize,
+                                       QVector<ChecksumFileEntry> &entries, QString &errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorMessage = "Cannot open checksum file: " + file.errorString();
+        return false;
+    }
+    QByteArray contents = file.readAll();
+    if (contents.size() < 8) {
+        errorMessage = "Checksum file is incomplete.";
+        return false;
+    }
+
+    QDataStream in(contents);
+    in.setVersion(QDataStream::Qt_4_8);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 tempQuint32;
+    qint32 tempQint32;
+    qint16 versionMain, versionSecondary;
+
+    in >> tempQuint32;
+    if (tempQuint32 != CHECKSUM_FILE_MAGIC_NUMBER) {
+        errorMessage = "Not a valid checksum file.";
+        return false;
+    }
+    in >> versionMain >> versionSecondary;
+    if (versionMain > CHECKSUM_FILE_MAIN_VERSION_NUMBER) {
+        errorMessage = "Checksum file version is newer than this program supports.";
+        return false;
+    }
+
+    quint32 storedCrc;
+    memcpy(&storedCrc, contents.constData() + contents.size() - 4, 4);
+    storedCrc = qFromLittleEndian(storedCrc);
+    if (storedCrc != crc32c(0, contents.constData(), contents.size() - 4)) {
+        errorMessage = "Checksum file is damaged.";
+        return false;
+    }
+
+    in >> tempQint32;
+    chunkSize = tempQint32;
+    in >> tempQint32;
+    int numFiles = tempQint32;
+
+    entries.clear();
+    for (int i = 0; i < numFiles; ++i) {
+        ChecksumFileEntry entry;
+        in >> entry.fileName;
+        in >> entry.length;
+        in >> entry.fileCrc;
+        in >> tempQint32;
+        entry.chunkCrcs.resize(tempQint32);
+        for (int j = 0; j < entry.chunkCrcs.size(); ++j) {
+            in >> entry.chunkCrcs[j];
+        }
+        entries.append(entry);
+    }
+    if (in.status() != QDataStream::Ok) {
+        errorMessage = "Checksum file is incomplete.";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CHECKSUMMEDFILE_H
+#define CHECKSUMMEDFILE_H
+
+#include <QFile>
+#include <QVector>
+#include <QStringList>
+
+// Data files are checksummed in chunks of this many bytes (plus a final partial chunk).
+#define CHECKSUM_CHUNK_SIZE 1048576
+
+// One data file entry in a checksum file, as read back by
+// ChecksummedFile::readChecksumFile().
+struct ChecksumFileEntry
+{
+    QString fileName;       // relative to the directory containing the checksum file
+    qint64 length;
+    quint32 fileCrc;
+    QVector<quint32> chunkCrcs;
+};
+
+// A QFile that computes CRC-32C checksums of everything written to it, both for
+// each fixed-size chunk of the file and for the file as a whole.  Checksums are
+// only computed if enabled in the constructor; otherwise the class behaves
+// exactly like QFile.  Files must be written sequentially (no seeking).
+class ChecksummedFile : public QFile
+{
+public:
+    ChecksummedFile(const QString &name, bool checksumsEnabled);
+
+    bool checksumsEnabled() const;
+    quint32 fileCrc() const;
+    QVector<quint32> chunkCrcs() const;
+
+    static QString checksumFileName(const QString &path, const QString &baseName);
+    static bool writeChecksumFile(const QString &fileName, const QVector<ChecksummedFile*> &files);
+    static bool readChecksumFile(const QString &fileName, qint64 &chunkSize,
+                                 QVector<ChecksumFileEntry> &entries, QString &errorMessage);
+
+protected:
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    bool enabled;
+    quint32 completedChunksCrc;     // CRC of all completed chunks
+    quint32 currentChunkCrc;
+    qint64 currentChunkBytes;
+    QVector<quint32> completedChunkCrcs;
+};
+
+#endif // CHECKSUMMEDFILE_H
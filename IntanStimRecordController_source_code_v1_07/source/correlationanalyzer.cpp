@@ -0,0 +1,407 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "correlationanalyzer.h"
+#include "filterbank.h"
+#include "samplevector.h"
+
+// Frames of input filtered at a time.
+static const int AnalysisChunkFrames = 4096;
+
+// Decimated frames gathered before the sums are updated.  Longer blocks
+// amortize the forgetting factor and the loading of each tile row.
+static const int BlockFrames = 32;
+
+// Lanes per side of a square tile of the product matrix.  A tile of products
+// (2 kB of doubles) and the block columns it reads stay in L1 cache.
+static const int TileLanes = 16;
+static const int TileVectors = TileLanes / SampleVector::Width;
+
+// At most this many correlated pairs are reported, strongest first.
+static const int MaxReportedPairs = 1000;
+
+static bool strongerCorrelation(const CorrelatedPair &a, const CorrelatedPair &b)
+{
+    return a.correlation > b.correlation;
+}
+
+// Constructor.
+CorrelationAnalyzer::CorrelationAnalyzer(QObject *parent) :
+    QThread(parent)
+{
+    stopping = false;
+    numLanes = 0;
+    sampleRate = 30000.0;
+    lowCutoff = 300.0;
+    decimation = 4;
+    timeConstant = 2.0;
+    threshold = 0.9;
+    removeCommonAverage = true;
+    refreshMsec = 500;
+    inputCapacity = 0;
+    inputFrames = 0;
+    inputGap.storeRelease(0);
+    droppedFrames = 0;
+    bandFilter = new FilterBank();
+    decimationPhase = 0;
+    numTiles = 0;
+    paddedLanes = 0;
+    blockFill = 0;
+    blockDecay = 1.0;
+    weight = 0.0;
+    minimumWeight = 1.0;
+    numUpdates = 0;
+    load = 0.0;
+}
+
+CorrelationAnalyzer::~CorrelationAnalyzer()
+{
+    stop();
+    wait();
+    delete bandFilter;
+}
+
+// Ask the analysis thread to finish.
+void CorrelationAnalyzer::stop()
+{
+    waitMutex.lock();
+    stopping = true;
+    wakeCondition.wakeAll();
+    waitMutex.unlock();
+}
+
+// Set up analysis of numLanes lanes sampled at sampleRate.  Data are band-pass
+// filtered from lowCutoff (Hz) to 40% of the decimated sample rate, and the
+// sums forget old data with time constant timeConstant (s).  Pairs with a
+// correlation of at least threshold are reported.  Clears all results.
+void CorrelationAnalyzer::configure(int numLanes_, double sampleRate_, double lowCutoff_, int decimation_,
+                                    double timeConstant_, double threshold_, bool removeCommonAverage_,
+                                    int refreshMsec_)
+{
+    QMutexLocker analysisLocker(&analysisMutex);
+
+    numLanes = numLanes_;
+    sampleRate = sampleRate_;
+    decimation = qMax(1, decimation_);
+    lowCutoff = qBound(1.0, lowCutoff_, 0.2 * sampleRate / decimation);
+    timeConstant = qMax(0.1, timeConstant_);
+    threshold = threshold_;
+    removeCommonAverage = removeCommonAverage_;
+    refreshMsec = qMax(10, refreshMsec_);
+
+    // Band-pass filter, which also serves as the anti-aliasing filter.
+    bandFilter->setNumLanes(numLanes, AnalysisChunkFrames);
+    QVector<FilterBankBand> bands;
+    FilterBankBand band;
+    band.name = "Correlation";
+    band.spec.prototype = FilterButterworth;
+    band.spec.response = FilterBandpass;
+    band.spec.order = 2;
+    band.spec.lowCutoff = lowCutoff;
+    band.spec.highCutoff = 0.4 * sampleRate / decimation;
+    band.spec.passbandRipple = 0.1;
+    band.spec.stopbandAttenuation = 60.0;
+    bands.append(band);
+    bandFilter->setBands(bands, sampleRate);
+    decimationPhase = 0;
+
+    numTiles = (numLanes + TileLanes - 1) / TileLanes;
+    paddedLanes = numTiles * TileLanes;
+    block.resize(BlockFrames * paddedLanes);
+    block.fill(0.0);
+    blockFill = 0;
+
+    double decimatedRate = sampleRate / decimation;
+    blockDecay = exp(-BlockFrames / (timeConstant * decimatedRate));
+    minimumWeight = 0.5 * BlockFrames / (1.0 - blockDecay);
+    resetSums();
+
+    inputMutex.lock();
+    inputCapacity = qMax(AnalysisChunkFrames, (int) (2.0 * sampleRate * refreshMsec / 1000.0));
+    inputBuffer.resize(inputCapacity * numLanes);
+    inputFrames = 0;
+    inputGap.storeRelease(0);
+    droppedFrames = 0;
+    inputMutex.unlock();
+    workBuffer.resize(inputCapacity * numLanes);
+
+    resultMutex.lock();
+    correlations.clear();
+    correlatedPairs.clear();
+    numUpdates = 0;
+    load = 0.0;
+    resultMutex.unlock();
+}
+
+void CorrelationAnalyzer::resetSums()
+{
+    sums.resize(paddedLanes);
+    sums.fill(0.0);
+    products.resize(numTiles * numTiles * TileLanes * TileLanes);
+    products.fill(0.0);
+    weight = 0.0;
+}
+
+// Queue numFrames frames of time-major raw amplifier data, given as signed ADC
+// codes, for analysis, converting them to microvolts.  Never blocks: if the
+// analysis thread is using the input buffer, or the buffer is full, the data
+// are dropped.  Must be called from the thread that calls configure().
+void CorrelationAnalyzer::addData(const qint16 *codes, int numFrames)
+{
+    if (!inputMutex.tryLock()) {
+        droppedFrames += numFrames;
+        inputGap.storeRelease(1);
+        return;
+    }
+    if (numLanes == 0 || inputFrames + numFrames > inputCapacity) {
+        droppedFrames += numFrames;
+        inputGap.storeRelease(1);
+    } else {
+        Sample *dst = inputBuffer.data() + inputFrames * numLanes;
+        const Sample scale = (Sample) AMPLIFIER_MICROVOLTS_PER_BIT;
+        for (int i = 0; i < numFrames * numLanes; ++i) {
+            dst[i] = scale * codes[i];
+        }
+        inputFrames += numFrames;
+    }
+    inputMutex.unlock();
+}
+
+void CorrelationAnalyzer::run()
+{
+    QElapsedTimer wallTimer;
+    QElapsedTimer processingTimer;
+    wallTimer.start();
+
+    while (!stopping) {
+        waitMutex.lock();
+        if (!stopping) {
+            wakeCondition.wait(&waitMutex, refreshMsec);
+        }
+        waitMutex.unlock();
+        if (stopping) break;
+
+        QMutexLocker analysisLocker(&analysisMutex);
+        processingTimer.start();
+
+        // Swap buffers rather than copying, so addData() is locked out only briefly.
+        inputMutex.lock();
+        int numFrames = inputFrames;
+        inputBuffer.swap(workBuffer);
+        inputFrames = 0;
+        inputMutex.unlock();
+        bool gap = inputGap.fetchAndStoreAcquire(0) != 0;
+
+        // A partial block would straddle the gap; the sums themselves remain valid.
+        if (gap) {
+            blockFill = 0;
+        }
+        for (int start = 0; start < numFrames; start += AnalysisChunkFrames) {
+            processInput(workBuffer.constData() + start * numLanes, qMin(AnalysisChunkFrames, numFrames - start));
+        }
+        if (numFrames > 0) {
+            updateResults();
+        }
+
+        double elapsed = (double) wallTimer.nsecsElapsed();
+        wallTimer.restart();
+        resultMutex.lock();
+        load = (elapsed > 0.0) ? processingTimer.nsecsElapsed() / elapsed : 0.0;
+        resultMutex.unlock();
+    }
+}
+
+// Filter and decimate frames into the current block, updating the sums each
+// time the block is full.
+void CorrelationAnalyzer::processInput(const Sample *data, int numFrames)
+{
+    bandFilter->filter(data, numFrames, 0, numLanes);
+    const Sample *filtered = bandFilter->getOutput(0);
+
+    int t;
+    for (t = decimationPhase; t < numFrames; t += decimation) {
+        const Sample *frame = filtered + t * numLanes;
+        Sample *row = block.data() + blockFill * paddedLanes;
+        if (removeCommonAverage) {
+            Sample mean = 0.0;
+            for (int lane = 0; lane < numLanes; ++lane) mean += frame[lane];
+            mean /= numLanes;
+            for (int lane = 0; lane < numLanes; ++lane) row[lane] = frame[lane] - mean;
+        } else {
+            memcpy(row, frame, numLanes * sizeof(Sample));
+        }
+        if (++blockFill == BlockFrames) {
+            accumulateBlock();
+            blockFill = 0;
+        }
+    }
+    decimationPhase = t - numFrames;
+}
+
+// Decay the sums and add the frames of a full block.
+void CorrelationAnalyzer::accumulateBlock()
+{
+    for (int lane = 0; lane < numLanes; ++lane) {
+        Sample sum = 0.0;
+        for (int t = 0; t < BlockFrames; ++t) {
+            sum += block[t * paddedLanes + lane];
+        }
+        sums[lane] = blockDecay * sums[lane] + sum;
+    }
+    weight = blockDecay * weight + BlockFrames;
+
+    for (int tileRow = 0; tileRow < numTiles; ++tileRow) {
+        for (int tileColumn = tileRow; tileColumn < numTiles; ++tileColumn) {
+            updateTile(tileRow, tileColumn);
+        }
+    }
+}
+
+// Decay one tile of the product sums and add the products of the block.  Each
+// row of the tile is held in registers while the block's frames are streamed
+// through it.
+void CorrelationAnalyzer::updateTile(int tileRow, int tileColumn)
+{
+    Sample *tile = products.data() + (tileRow * numTiles + tileColumn) * TileLanes * TileLanes;
+    const Sample *rowLanes = block.constData() + tileRow * TileLanes;
+    const Sample *columnLanes = block.constData() + tileColumn * TileLanes;
+    const SampleVector::V decay = SampleVector::set1(blockDecay);
+
+    for (int r = 0; r < TileLanes; ++r) {
+        SampleVector::V sum[TileVectors];
+        for (int v = 0; v < TileVectors; ++v) {
+            sum[v] = SampleVector::mul(SampleVector::loadu(tile + r * TileLanes + v * SampleVector::Width), decay);
+        }
+        for (int t = 0; t < BlockFrames; ++t) {
+            const SampleVector::V x = SampleVector::set1(rowLanes[t * paddedLanes + r]);
+            const Sample *y = columnLanes + t * paddedLanes;
+            for (int v = 0; v < TileVectors; ++v) {
+                sum[v] = SampleVector::add(sum[v], SampleVector::mul(x, SampleVector::loadu(y + v * SampleVector::Width)));
+            }
+        }
+        for (int v = 0; v < TileVectors; ++v) {
+            SampleVector::storeu(tile + r * TileLanes + v * SampleVector::Width, sum[v]);
+        }
+    }
+}
+
+// Weighted sum of products of lanes i and j, where i <= j.
+inline Sample CorrelationAnalyzer::productSum(int i, int j) const
+{
+    return products[((i / TileLanes) * numTiles + j / TileLanes) * TileLanes * TileLanes +
+                    (i % TileLanes) * TileLanes + j % TileLanes];
+}
+
+// Recompute the correlation matrix and the list of correlated pairs from the sums.
+void CorrelationAnalyzer::updateResults()
+{
+    if (weight < minimumWeight) return;
+
+    QVector<double> means(numLanes);
+    QVector<double> scales(numLanes);
+    for (int i = 0; i < numLanes; ++i) {
+        means[i] = sums[i] / weight;
+        double variance = productSum(i, i) / weight - means[i] * means[i];
+        // Lanes with no signal (e.g., unconnected amplifiers) are never flagged.
+        scales[i] = (variance > 1.0e-6) ? 1.0 / sqrt(variance) : 0.0;
+    }
+
+    QVector<float> matrix(numLanes * numLanes);
+    QVector<CorrelatedPair> pairs;
+    for (int i = 0; i < numLanes; ++i) {
+        matrix[i * numLanes + i] = (scales[i] > 0.0) ? 1.0f : 0.0f;
+        for (int j = i + 1; j < numLanes; ++j) {
+            double r = (productSum(i, j) / weight - means[i] * means[j]) * scales[i] * scales[j];
+            matrix[i * numLanes + j] = (float) r;
+            matrix[j * numLanes + i] = (float) r;
+            if (r >= threshold && scales[i] > 0.0 && scales[j] > 0.0) {
+                CorrelatedPair pair;
+                pair.lane1 = i;
+                pair.lane2 = j;
+                pair.correlation = r;
+                pairs.append(pair);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), strongerCorrelation);
+    if (pairs.size() > MaxReportedPairs) {
+        pairs.resize(MaxReportedPairs);
+    }
+
+    QMutexLocker resultLocker(&resultMutex);
+    correlations.swap(matrix);
+    correlatedPairs.swap(pairs);
+    ++numUpdates;
+}
+
+int CorrelationAnalyzer::getNumLanes() const
+{
+    return numLanes;
+}
+
+double CorrelationAnalyzer::getDecimatedSampleRate() const
+{
+    return sampleRate / decimation;
+}
+
+qint64 CorrelationAnalyzer::getDroppedFrames() const
+{
+    return droppedFrames;
+}
+
+// Fraction of wall-clock time spent by the analysis thread processing data.
+double CorrelationAnalyzer::getLoad() const
+{
+    QMutexLocker resultLocker(&resultMutex);
+    return load;
+}
+
+// Number of times the results have been recomputed since the last call to configure().
+quint64 CorrelationAnalyzer::getNumUpdates() const
+{
+    QMutexLocker resultLocker(&resultMutex);
+    return numUpdates;
+}
+
+// Latest correlation matrix, numLanes x numLanes in row-major order.  Returns
+// false if not enough data have been analyzed yet.
+bool CorrelationAnalyzer::getCorrelationMatrix(QVector<float> &matrix) const
+{
+    QMutexLocker resultLocker(&resultMutex);
+    if (correlations.isEmpty()) return false;
+    matrix = correlations;
+    return true;
+}
+
+// Pairs of lanes whose correlation reached the threshold at the latest update,
+// strongest first.
+QVector<CorrelatedPair> CorrelationAnalyzer::getCorrelatedPairs() const
+{
+    QMutexLocker resultLocker(&resultMutex);
+    return correlatedPairs;
+}
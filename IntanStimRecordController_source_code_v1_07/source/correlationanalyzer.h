@@ -0,0 +1,138 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CORRELATIONANALYZER_H
+#define CORRELATIONANALYZER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QVector>
+
+#include "globalconstants.h"
+
+class FilterBank;
+
+// A pair of amplifier lanes whose signals are suspiciously similar.
+struct CorrelatedPair
+{
+    int lane1;
+    int lane2;
+    double correlation;
+};
+
+// Running correlation matrix of all amplifier channels, computed in a
+// background thread to find electrodes that are bridged or shorted together.
+//
+// Data are queued by addData() exactly as for SpectrumAnalyzer: the call only
+// copies into an input buffer and drops the block if the buffer is busy, so
+// acquisition never waits for analysis.  The analysis thread band-pass filters
+// the data to remove LFP and DC (which are legitimately shared by neighboring
+// electrodes), decimates it, and optionally subtracts the common average of
+// each frame.  Frames are gathered into short blocks, and each block updates
+// exponentially weighted sums of every lane and of every product of two lanes.
+// The product update is the bulk of the work; it is done one square tile of
+// lanes at a time, with a row of each tile held in vector registers while the
+// block is streamed through, so the working set stays in L1 cache.  Only the
+// upper triangle of tiles is computed.  Cost grows with the square of the
+// number of lanes and linearly with the decimated sample rate, so it stays
+// bounded for large arrays by choosing a larger decimation factor.
+//
+// Every refresh period the correlation matrix is recomputed from the sums and
+// pairs whose correlation exceeds the threshold are reported.
+class CorrelationAnalyzer : public QThread
+{
+    Q_OBJECT
+public:
+    explicit CorrelationAnalyzer(QObject *parent = 0);
+    ~CorrelationAnalyzer();
+
+    void run() override;
+    void stop();
+
+    void configure(int numLanes_, double sampleRate_, double lowCutoff_, int decimation_,
+                   double timeConstant_, double threshold_, bool removeCommonAverage_,
+                   int refreshMsec_);
+    void addData(const qint16 *codes, int numFrames);
+
+    int getNumLanes() const;
+    double getDecimatedSampleRate() const;
+    qint64 getDroppedFrames() const;
+    double getLoad() const;
+    quint64 getNumUpdates() const;
+    bool getCorrelationMatrix(QVector<float> &matrix) const;
+    QVector<CorrelatedPair> getCorrelatedPairs() const;
+
+private:
+    volatile bool stopping;
+    QMutex waitMutex;
+    QWaitCondition wakeCondition;
+
+    // Held by the analysis thread while processing, and by configure().
+    QMutex analysisMutex;
+    int numLanes;
+    double sampleRate;
+    double lowCutoff;
+    int decimation;
+    double timeConstant;
+    double threshold;
+    bool removeCommonAverage;
+    int refreshMsec;
+
+    // Input buffer, written by addData() and read by the analysis thread.
+    QMutex inputMutex;
+    QVector<Sample> inputBuffer;
+    int inputCapacity;
+    int inputFrames;
+    QAtomicInt inputGap;        // set when input has been dropped
+    qint64 droppedFrames;
+
+    // Analysis state, used only by the analysis thread.
+    QVector<Sample> workBuffer;
+    FilterBank *bandFilter;
+    int decimationPhase;
+    int numTiles;               // lanes are padded to a whole number of tiles
+    int paddedLanes;
+    QVector<Sample> block;      // BlockFrames frames of paddedLanes lanes
+    int blockFill;
+    Sample blockDecay;          // forgetting factor applied once per block
+    QVector<Sample> sums;       // weighted sum of each lane
+    QVector<Sample> products;   // weighted sums of products, stored by tile
+    double weight;              // total weight of the sums
+    double minimumWeight;
+
+    // Results, read by the GUI thread.
+    mutable QMutex resultMutex;
+    QVector<float> correlations;
+    QVector<CorrelatedPair> correlatedPairs;
+    quint64 numUpdates;
+    double load;
+
+    void processInput(const Sample *data, int numFrames);
+    void accumulateBlock();
+    void updateTile(int tileRow, int tileColumn);
+    Sample productSum(int i, int j) const;
+    void updateResults();
+    void resetSums();
+};
+
+#endif // CORRELATIONANALYZER_H
@@ -0,0 +1,291 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+#include <iostream>
+
+#include "globalconstants.h"
+#include "correlationdialog.h"
+#include "correlationanalyzer.h"
+#include "signalprocessor.h"
+#include "signalsources.h"
+#include "signalchannel.h"
+#include "rhs2000datablock.h"
+
+using namespace std;
+
+// Correlation dialog.
+// This dialog lists pairs of amplifier channels whose signals are so strongly
+// correlated that the electrodes are probably bridged or shorted together.
+// The correlation matrix of all amplifier channels is maintained in a
+// background thread (see CorrelationAnalyzer) while the dialog is visible,
+// and can be exported to a CSV file.  Only enabled channels are listed.
+
+CorrelationDialog::CorrelationDialog(SignalProcessor *inSignalProcessor, SignalSources *inSignalSources,
+                                     QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle(tr("Channel Correlation"));
+
+    signalProcessor = inSignalProcessor;
+    signalSources = inSignalSources;
+    sampleRate = 30000.0;
+    lastUpdate = 0;
+
+    analyzer = new CorrelationAnalyzer();
+    refreshTimer = new QTimer(this);
+
+    lowCutoffSpinBox = new QSpinBox();
+    lowCutoffSpinBox->setRange(10, 2000);
+    lowCutoffSpinBox->setSingleStep(50);
+    lowCutoffSpinBox->setValue(300);
+    lowCutoffSpinBox->setSuffix(" Hz");
+
+    decimationComboBox = new QComboBox();
+    decimationComboBox->addItem(tr("None"), 1);
+    decimationComboBox->addItem("2", 2);
+    decimationComboBox->addItem("4", 4);
+    decimationComboBox->addItem("8", 8);
+    decimationComboBox->addItem("16", 16);
+    decimationComboBox->setCurrentIndex(2);
+
+    timeConstantComboBox = new QComboBox();
+    timeConstantComboBox->addItem("1 s", 1.0);
+    timeConstantComboBox->addItem("2 s", 2.0);
+    timeConstantComboBox->addItem("5 s", 5.0);
+    timeConstantComboBox->addItem("10 s", 10.0);
+    timeConstantComboBox->addItem("30 s", 30.0);
+    timeConstantComboBox->setCurrentIndex(1);
+
+    refreshComboBox = new QComboBox();
+    refreshComboBox->addItem("250 ms", 250);
+    refreshComboBox->addItem("500 ms", 500);
+    refreshComboBox->addItem("1 s", 1000);
+    refreshComboBox->addItem("2 s", 2000);
+    refreshComboBox->setCurrentIndex(1);
+
+    thresholdSpinBox = new QDoubleSpinBox();
+    thresholdSpinBox->setRange(0.5, 1.0);
+    thresholdSpinBox->setSingleStep(0.01);
+    thresholdSpinBox->setDecimals(2);
+    thresholdSpinBox->setValue(0.9);
+
+    commonAverageCheckBox = new QCheckBox(tr("Remove common average"));
+    commonAverageCheckBox->setChecked(true);
+
+    exportButton = new QPushButton(tr("Export Matrix..."));
+    statusLabel = new QLabel();
+
+    pairTable = new QTableWidget(this);
+    pairTable->setColumnCount(3);
+    pairTable->setHorizontalHeaderLabels(QStringList() << tr("Channel") << tr("Channel") << tr("Correlation"));
+    pairTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    pairTable->setSelectionMode(QAbstractItemView::NoSelection);
+    pairTable->verticalHeader()->hide();
+
+    connect(lowCutoffSpinBox, SIGNAL(editingFinished()), this, SLOT(reconfigure()));
+    connect(decimationComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(reconfigure()));
+    connect(timeConstantComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(reconfigure()));
+    connect(refreshComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(reconfigure()));
+    connect(thresholdSpinBox, SIGNAL(editingFinished()), this, SLOT(reconfigure()));
+    connect(commonAverageCheckBox, SIGNAL(toggled(bool)), this, SLOT(reconfigure()));
+    connect(exportButton, SIGNAL(clicked()), this, SLOT(exportMatrix()));
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+
+    QFormLayout *analysisLayout = new QFormLayout();
+    analysisLayout->addRow(tr("High-pass cutoff"), lowCutoffSpinBox);
+    analysisLayout->addRow(tr("Decimation"), decimationComboBox);
+    analysisLayout->addRow(tr("Time constant"), timeConstantComboBox);
+    analysisLayout->addRow(tr("Refresh"), refreshComboBox);
+    analysisLayout->addRow(commonAverageCheckBox);
+
+    QGroupBox *analysisGroupBox = new QGroupBox(tr("Analysis"));
+    analysisGroupBox->setLayout(analysisLayout);
+
+    QFormLayout *flagLayout = new QFormLayout();
+    flagLayout->addRow(tr("Correlation threshold"), thresholdSpinBox);
+
+    QGroupBox *flagGroupBox = new QGroupBox(tr("Suspected Bridges"));
+    flagGroupBox->setLayout(flagLayout);
+
+    statusLabel->setWordWrap(true);
+
+    QVBoxLayout *leftLayout = new QVBoxLayout;
+    leftLayout->addWidget(analysisGroupBox);
+    leftLayout->addWidget(flagGroupBox);
+    leftLayout->addWidget(exportButton);
+    leftLayout->addWidget(statusLabel);
+    leftLayout->addStretch(1);
+
+    QHBoxLayout *mainLayout = new QHBoxLayout;
+    mainLayout->addLayout(leftLayout);
+    mainLayout->addWidget(pairTable);
+    mainLayout->setStretch(1, 1);
+
+    setLayout(mainLayout);
+    resize(640, 400);
+
+    analyzer->start(QThread::LowPriority);
+    reconfigure();
+}
+
+CorrelationDialog::~CorrelationDialog()
+{
+    delete analyzer;
+}
+
+void CorrelationDialog::setSampleRate(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reconfigure();
+}
+
+// Restart analysis with the current settings.
+void CorrelationDialog::reconfigure()
+{
+    int refreshMsec = refreshComboBox->itemData(refreshComboBox->currentIndex()).toInt();
+    analyzer->configure(signalProcessor->getNumAmplifierLanes(), sampleRate, lowCutoffSpinBox->value(),
+                        decimationComboBox->itemData(decimationComboBox->currentIndex()).toInt(),
+                        timeConstantComboBox->itemData(timeConstantComboBox->currentIndex()).toDouble(),
+                        thresholdSpinBox->value(), commonAverageCheckBox->isChecked(), refreshMsec);
+    refreshTimer->start(refreshMsec);
+    lastUpdate = 0;
+    pairTable->setRowCount(0);
+}
+
+// Pass new amplifier data to the analyzer.  Called after each call to
+// SignalProcessor::filterData(); does nothing while the dialog is hidden.
+// The analyzer applies its own band-pass filter, so the data are taken from
+// before the notch and high-pass filters.
+void CorrelationDialog::updateData(int numBlocks)
+{
+    if (!isVisible()) return;
+
+    if (analyzer->getNumLanes() != signalProcessor->getNumAmplifierLanes()) {
+        reconfigure();
+    }
+    analyzer->addData(signalProcessor->amplifierPreFilterFast, SAMPLES_PER_DATA_BLOCK * numBlocks);
+}
+
+// Amplifier channel of each lane, or null for lanes with no enabled channel.
+QVector<SignalChannel*> CorrelationDialog::laneChannels() const
+{
+    QVector<SignalChannel*> channels(analyzer->getNumLanes(), nullptr);
+    int numStreams = analyzer->getNumLanes() / CHANNELS_PER_STREAM;
+    for (int stream = 0; stream < numStreams; ++stream) {
+        for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+            SignalChannel *signalChannel = signalSources->findAmplifierChannel(stream, channel);
+            if (signalChannel && signalChannel->enabled) {
+                channels[signalProcessor->amplifierLane(stream, channel)] = signalChannel;
+            }
+        }
+    }
+    return channels;
+}
+
+// Show the latest list of correlated pairs of enabled channels.
+void CorrelationDialog::refresh()
+{
+    quint64 numUpdates = analyzer->getNumUpdates();
+    QString status = tr("Sample rate ") + QString::number(analyzer->getDecimatedSampleRate(), 'f', 0) + " Hz\n" +
+            tr("Analysis load ") + QString::number(100.0 * analyzer->getLoad(), 'f', 1) + "%\n" +
+            tr("Dropped ") + QString::number(analyzer->getDroppedFrames()) + tr(" samples");
+    if (numUpdates == 0) {
+        statusLabel->setText(status + "\n" + tr("Collecting data..."));
+        return;
+    }
+    if (numUpdates == lastUpdate) return;
+    lastUpdate = numUpdates;
+
+    QVector<SignalChannel*> channels = laneChannels();
+    QVector<CorrelatedPair> pairs = analyzer->getCorrelatedPairs();
+
+    pairTable->setRowCount(0);
+    for (int i = 0; i < pairs.size(); ++i) {
+        SignalChannel *channel1 = channels.value(pairs[i].lane1, nullptr);
+        SignalChannel *channel2 = channels.value(pairs[i].lane2, nullptr);
+        if (!channel1 || !channel2) continue;
+
+        int row = pairTable->rowCount();
+        pairTable->insertRow(row);
+        pairTable->setItem(row, 0, new QTableWidgetItem(channel1->nativeChannelName + " (" +
+                                                        channel1->customChannelName + ")"));
+        pairTable->setItem(row, 1, new QTableWidgetItem(channel2->nativeChannelName + " (" +
+                                                        channel2->customChannelName + ")"));
+        QTableWidgetItem *item = new QTableWidgetItem(QString::number(pairs[i].correlation, 'f', 3));
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        pairTable->setItem(row, 2, item);
+    }
+    pairTable->resizeColumnsToContents();
+
+    statusLabel->setText(status + "\n" + QString::number(pairTable->rowCount()) + tr(" suspected bridges"));
+}
+
+// Write the correlation matrix of all enabled amplifier channels to a CSV
+// file, with channel names heading the rows and columns.
+void CorrelationDialog::exportMatrix()
+{
+    QVector<float> matrix;
+    if (!analyzer->getCorrelationMatrix(matrix)) {
+        QMessageBox::warning(this, tr("Export Correlation Matrix"), tr("No correlations have been computed yet."));
+        return;
+    }
+    int numLanes = analyzer->getNumLanes();
+    if (matrix.size() != numLanes * numLanes) return;
+
+    QString csvFileName = QFileDialog::getSaveFileName(this, tr("Export Correlation Matrix As"), ".",
+                                                       tr("CSV (Comma delimited) (*.csv)"));
+    if (csvFileName.isEmpty()) return;
+
+    QVector<SignalChannel*> channels = laneChannels();
+    QVector<int> lanes;
+    for (int lane = 0; lane < numLanes; ++lane) {
+        if (channels[lane]) lanes.append(lane);
+    }
+
+    QFile csvFile(csvFileName);
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        cerr << "Cannot open CSV file for writing: " <<
+                qPrintable(csvFile.errorString()) << endl;
+        return;
+    }
+    QTextStream out(&csvFile);
+
+    out << "Channel";
+    for (int j = 0; j < lanes.size(); ++j) {
+        out << "," << channels[lanes[j]]->nativeChannelName;
+    }
+    out << endl;
+
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(4);
+    for (int i = 0; i < lanes.size(); ++i) {
+        out << channels[lanes[i]]->nativeChannelName;
+        for (int j = 0; j < lanes.size(); ++j) {
+            out << "," << matrix[lanes[i] * numLanes + lanes[j]];
+        }
+        out << endl;
+    }
+    csvFile.close();
+}
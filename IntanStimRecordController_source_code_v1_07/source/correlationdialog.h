@@ -0,0 +1,82 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CORRELATIONDIALOG_H
+#define CORRELATIONDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+class QComboBox;
+class QSpinBox;
+class QDoubleSpinBox;
+class QCheckBox;
+class QPushButton;
+class QLabel;
+class QTableWidget;
+class QTimer;
+class SignalProcessor;
+class SignalSources;
+class SignalChannel;
+class CorrelationAnalyzer;
+
+class CorrelationDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit CorrelationDialog(SignalProcessor *inSignalProcessor, SignalSources *inSignalSources,
+                               QWidget *parent = 0);
+    ~CorrelationDialog();
+
+    void setSampleRate(double newSampleRate);
+    void updateData(int numBlocks);
+
+signals:
+
+public slots:
+
+private slots:
+    void reconfigure();
+    void refresh();
+    void exportMatrix();
+
+private:
+    SignalProcessor *signalProcessor;
+    SignalSources *signalSources;
+    CorrelationAnalyzer *analyzer;
+    QTimer *refreshTimer;
+    double sampleRate;
+    quint64 lastUpdate;
+
+    QSpinBox *lowCutoffSpinBox;
+    QComboBox *decimationComboBox;
+    QComboBox *timeConstantComboBox;
+    QComboBox *refreshComboBox;
+    QDoubleSpinBox *thresholdSpinBox;
+    QCheckBox *commonAverageCheckBox;
+    QPushButton *exportButton;
+    QLabel *statusLabel;
+    QTableWidget *pairTable;
+
+    QVector<SignalChannel*> laneChannels() const;
+};
+
+#endif // CORRELATIONDIALOG_H
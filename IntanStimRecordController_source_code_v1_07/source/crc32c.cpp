@@ -0,0 +1,229 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <QtEndian>
+
+#include "crc32c.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CRC32C_X86
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// CRC-32C is computed with the SSE4.2 crc32 instruction when the processor
+// supports it (checked once at run time), and otherwise with a portable
+// "slicing-by-8" table method that processes eight bytes per step.
+
+// Reflected CRC-32C polynomial
+static const quint32 Crc32cPolynomial = 0x82f63b78;
+
+// Lookup tables for the software implementation, built on first use.
+struct Crc32cTables
+{
+    quint32 table[8][256];
+
+    Crc32cTables() {
+        for (int n = 0; n < 256; ++n) {
+            quint32 c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? ((c >> 1) ^ Crc32cPolynomial) : (c >> 1);
+            }
+            table[0][n] = c;
+        }
+        for (int n = 0; n < 256; ++n) {
+            for (int k = 1; k < 8; ++k) {
+                table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xff];
+            }
+        }
+    }
+};
+
+static const Crc32cTables& crc32cTables()
+{
+    static const Crc32cTables tables;
+    return tables;
+}
+
+// Software CRC-32C on the raw (non-inverted) CRC register c.
+static quint32 crc32cSoftware(quint32 c, const unsigned char *p, qint64 length)
+{
+    const Crc32cTables &t = crc32cTables();
+
+    while (length > 0 && ((quintptr) p & 7)) {
+        c = t.table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+        --length;
+    }
+    while (length >= 8) {
+        quint32 lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+        lo = qFromLittleEndian(lo);
+        hi = qFromLittleEndian(hi);
+#endif
+        lo ^= c;
+        c = t.table[7][lo & 0xff] ^ t.table[6][(lo >> 8) & 0xff] ^
+            t.table[5][(lo >> 16) & 0xff] ^ t.table[4][lo >> 24] ^
+            t.table[3][hi & 0xff] ^ t.table[2][(hi >> 8) & 0xff] ^
+            t.table[1][(hi >> 16) & 0xff] ^ t.table[0][hi >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        c = t.table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+        --length;
+    }
+    return c;
+}
+
+#ifdef CRC32C_X86
+// Hardware CRC-32C on the raw CRC register c, using the SSE4.2 crc32 instruction.
+#if defined(__GNUC__)
+__attribute__((target("sse4.2")))
+#endif
+static quint32 crc32cHardware(quint32 c, const unsigned char *p, qint64 length)
+{
+    while (length > 0 && ((quintptr) p & 7)) {
+        c = _mm_crc32_u8(c, *p++);
+        --length;
+    }
+#if defined(__x86_64__) || defined(_M_X64)
+    quint64 c64 = c;
+    while (length >= 8) {
+        quint64 word;
+        memcpy(&word, p, 8);
+        c64 = _mm_crc32_u64(c64, word);
+        p += 8;
+        length -= 8;
+    }
+    c = (quint32) c64;
+#endif
+    while (length >= 4) {
+        quint32 word;
+        memcpy(&word, p, 4);
+        c = _mm_crc32_u32(c, word);
+        p += 4;
+        length -= 4;
+    }
+    while (length > 0) {
+        c = _mm_crc32_u8(c, *p++);
+        --length;
+    }
+    return c;
+}
+#endif
+
+// Returns true if the SSE4.2 crc32 instruction is used.
+bool crc32cHardwareAvailable()
+{
+#if defined(CRC32C_X86) && defined(__SSE4_2__)
+    return true;
+#elif defined(CRC32C_X86) && defined(_MSC_VER)
+    static const bool available = []() {
+        int info[4];
+        __cpuid(info, 1);
+        return ((info[2] >> 20) & 1) != 0;
+    }();
+    return available;
+#elif defined(CRC32C_X86) && defined(__GNUC__)
+    static const bool available = __builtin_cpu_supports("sse4.2");
+    return available;
+#else
+    return false;
+#endif
+}
+
+// Return the CRC-32C of the concatenation of the data already summarized by crc
+// (0 for none) and length bytes at data.
+quint32 crc32c(quint32 crc, const void *data, qint64 length)
+{
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    quint32 c = ~crc;
+
+#ifdef CRC32C_X86
+    if (crc32cHardwareAvailable()) {
+        return ~crc32cHardware(c, p, length);
+    }
+#endif
+    return ~crc32cSoftware(c, p, length);
+}
+
+// Multiply vector vec by 32x32 GF(2) matrix mat.
+static quint32 gf2MatrixTimes(const quint32 *mat, quint32 vec)
+{
+    quint32 sum = 0;
+    while (vec) {
+        if (vec & 1) sum ^= *mat;
+        vec >>= 1;
+        ++mat;
+    }
+    return sum;
+}
+
+// square = mat * mat
+static void gf2MatrixSquare(quint32 *square, const quint32 *mat)
+{
+    for (int n = 0; n < 32; ++n) {
+        square[n] = gf2MatrixTimes(mat, mat[n]);
+    }
+}
+
+// Return the CRC-32C of data A followed by data B, given the CRC of each and the
+// length of B.  This applies the operator for appending lengthB zero bytes to crcA
+// by repeated squaring, so it takes O(log(lengthB)) time.
+quint32 crc32cCombine(quint32 crcA, quint32 crcB, qint64 lengthB)
+{
+    quint32 even[32];   // operator for an even power of two zero bits
+    quint32 odd[32];    // operator for an odd power of two zero bits
+
+    if (lengthB <= 0) {
+        return crcA;
+    }
+
+    // Operator for one zero bit
+    odd[0] = Crc32cPolynomial;
+    quint32 row = 1;
+    for (int n = 1; n < 32; ++n) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    gf2MatrixSquare(even, odd);     // two zero bits
+    gf2MatrixSquare(odd, even);     // four zero bits
+
+    // Apply lengthB zero bytes to crcA (first squaring gives the operator for one zero byte).
+    do {
+        gf2MatrixSquare(even, odd);
+        if (lengthB & 1) crcA = gf2MatrixTimes(even, crcA);
+        lengthB >>= 1;
+        if (lengthB == 0) break;
+
+        gf2MatrixSquare(odd, even);
+        if (lengthB & 1) crcA = gf2MatrixTimes(odd, crcA);
+        lengthB >>= 1;
+    } while (lengthB != 0);
+
+    return crcA ^ crcB;
+}
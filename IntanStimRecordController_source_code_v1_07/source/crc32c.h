@@ -19,21 +19,20 @@
 //  You should have received a copy of the GNU Lesser General Public License
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#ifndef RANDOMNUMBER_H
-#define RANDOMNUMBER_H
+#ifndef CRC32C_H
+#define CRC32C_H
 
-class RandomNumber
-{
-public:
-    RandomNumber();
-    double randomUniform();
-    double randomUniform(double min, double max);
-    double randomGaussian();
-    void setGaussianAccuracy(int n);
+#include <QtGlobal>
 
-private:
-    int gaussianN;
-    double gaussianScaleFactor;
-};
+// CRC-32C (Castagnoli) checksums, as used by iSCSI, ext4 and SSE4.2.
+//
+// crc32c() extends a finished checksum: start with crc = 0, and call
+// repeatedly with successive pieces of data to obtain the checksum of their
+// concatenation.  crc32cCombine() returns the checksum of two concatenated
+// pieces of data from their individual checksums and the length of the second.
+
+quint32 crc32c(quint32 crc, const void *data, qint64 length);
+quint32 crc32cCombine(quint32 crcA, quint32 crcB, qint64 lengthB);
+bool crc32cHardwareAvailable();
 
-#endif // RANDOMNUMBER_H
+#endif // CRC32C_H
@@ -0,0 +1,145 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cmath>
+
+#include "dacthresholdtracker.h"
+
+// Ratio of the median absolute deviation to the standard deviation of Gaussian noise
+static const double MadPerSigma = 0.6745;
+
+// Ratio of the median to the mean of |x| for Gaussian noise, used to start the
+// median estimate.
+static const double MedianPerMeanAbs = 0.8453;
+
+// Lower limit on the median of |x|, in microvolts, so that the estimate of a
+// silent lane can always grow again.
+static const double MinimumMedianAbs = 0.01;
+
+// Constructor.
+DacThresholdTracker::DacThresholdTracker()
+{
+    enabled = false;
+    numLanes = 0;
+    highpassEnabled = false;
+    aHpf = 0.0;
+    bHpf = 0.0;
+    medianRate = 1.0 / 300000.0;
+}
+
+// Set the number of lanes in the data.  Lanes beyond the new count are no
+// longer tracked.
+void DacThresholdTracker::setNumLanes(int numLanes_)
+{
+    numLanes = numLanes_;
+    for (int dac = 0; dac < lanes.size(); ++dac) {
+        if (lanes[dac] >= numLanes) lanes[dac] = -1;
+    }
+    resetState();
+}
+
+// Track the noise of the given amplifier lanes (one per DAC, -1 for none).
+// highpassCutoff (Hz) is the board's DAC high-pass
+// filter cutoff, or zero if that filter is disabled; timeConstant (s) sets how
+// quickly the estimates follow changes in noise.  Clears all estimates.
+void DacThresholdTracker::setParameters(bool enabled_, const QVector<int> &lanes_, double highpassCutoff,
+                                        double timeConstant, double sampleRate)
+{
+    enabled = enabled_;
+    lanes = lanes_;
+    for (int dac = 0; dac < lanes.size(); ++dac) {
+        if (lanes[dac] >= numLanes) lanes[dac] = -1;
+    }
+    highpassEnabled = highpassCutoff > 0.0;
+    aHpf = highpassEnabled ? exp(-1.0 * TWO_PI * highpassCutoff / sampleRate) : 0.0;
+    bHpf = 1.0 - aHpf;
+    medianRate = 1.0 / qMax(1.0, timeConstant * sampleRate);
+    resetState();
+}
+
+void DacThresholdTracker::resetState()
+{
+    highpassState.fill(0.0, lanes.size());
+    medianAbs.fill(0.0, lanes.size());
+}
+
+bool DacThresholdTracker::isEnabled() const
+{
+    return enabled;
+}
+
+// Update the noise estimates with numFrames frames of time-major raw amplifier
+// data, given as signed ADC codes.
+void DacThresholdTracker::update(const qint16 *codes, int numFrames)
+{
+    if (!enabled || numFrames == 0) return;
+
+    const double down = 1.0 - medianRate;
+    const double up = 1.0 + medianRate;
+
+    for (int dac = 0; dac < lanes.size(); ++dac) {
+        if (lanes[dac] < 0) continue;
+        const qint16 *x = codes + lanes[dac];
+        double s = highpassState[dac];
+
+        // Start the median estimate from the mean of |x| of the first block,
+        // after letting the high-pass filter settle on its first sample.
+        if (medianAbs[dac] == 0.0) {
+            s = highpassEnabled ? AMPLIFIER_MICROVOLTS_PER_BIT * x[0] : 0.0;
+            double sumAbs = 0.0;
+            double si = s;
+            for (int t = 0; t < numFrames; ++t) {
+                double v = AMPLIFIER_MICROVOLTS_PER_BIT * x[t * numLanes];
+                double y = highpassEnabled ? v - si : v;
+                si = aHpf * si + bHpf * v;
+                sumAbs += qAbs(y);
+            }
+            medianAbs[dac] = qMax(MedianPerMeanAbs * sumAbs / numFrames, MinimumMedianAbs);
+        }
+
+        double m = medianAbs[dac];
+        for (int t = 0; t < numFrames; ++t) {
+            double v = AMPLIFIER_MICROVOLTS_PER_BIT * x[t * numLanes];
+            double y = v;
+            if (highpassEnabled) {
+                y = v - s;
+                s = aHpf * s + bHpf * v;
+            }
+            m = qMax(m * ((qAbs(y) > m) ? up : down), MinimumMedianAbs);
+        }
+        highpassState[dac] = s;
+        medianAbs[dac] = m;
+    }
+}
+
+// Is a lane routed to this DAC being tracked?
+bool DacThresholdTracker::isTracking(int dac) const
+{
+    return enabled && dac >= 0 && dac < lanes.size() && lanes[dac] >= 0 && medianAbs[dac] > 0.0;
+}
+
+// Estimated noise standard deviation of the lane routed to a DAC, in microvolts.
+double DacThresholdTracker::getNoiseLevel(int dac) const
+{
+    if (!isTracking(dac)) return 0.0;
+    return medianAbs[dac] / MadPerSigma;
+}
@@ -0,0 +1,69 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DACTHRESHOLDTRACKER_H
+#define DACTHRESHOLDTRACKER_H
+
+#include <QVector>
+
+#include "globalconstants.h"
+
+// Running noise estimate of the amplifier channel routed to each interface
+// board DAC, for setting the DAC threshold comparators (the DIGITAL OUT
+// thresholds) to a multiple of the noise.
+//
+// The comparators see the amplifier data as recorded, high-pass filtered by
+// the board's first-order DAC filter when it is enabled, so each tracked lane
+// is taken from the raw time-major amplifier data and passed through the same
+// filter.  The noise level is the running median of |x| divided by 0.6745,
+// tracked with the stochastic quantile update of SpikeDetector, so spikes
+// crossing the thresholds do not raise them.  Only a few lanes are tracked, so
+// the work is negligible next to the multichannel filters.
+class DacThresholdTracker
+{
+public:
+    DacThresholdTracker();
+
+    void setNumLanes(int numLanes_);
+    void setParameters(bool enabled_, const QVector<int> &lanes_, double highpassCutoff,
+                       double timeConstant, double sampleRate);
+    void resetState();
+    bool isEnabled() const;
+
+    void update(const qint16 *codes, int numFrames);
+
+    bool isTracking(int dac) const;
+    double getNoiseLevel(int dac) const;
+
+private:
+    bool enabled;
+    QVector<int> lanes;         // amplifier lane of each DAC, or -1
+    int numLanes;               // total number of lanes in the data
+    bool highpassEnabled;
+    double aHpf;
+    double bHpf;
+    double medianRate;          // relative step of the median estimate per sample
+
+    QVector<double> highpassState;
+    QVector<double> medianAbs;  // running median of |x| of each DAC, or 0 before initialization
+};
+
+#endif // DACTHRESHOLDTRACKER_H
@@ -0,0 +1,202 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cstring>
+
+#include "displayring.h"
+#include "signalprocessor.h"
+
+// Constructor.
+DisplayRing::DisplayRing()
+{
+    capacity = 1;
+    numStreams = 0;
+    writePosition = 0;
+}
+
+// Set the number of samples held for each signal.  The ring is reallocated,
+// and emptied, by the next write().
+void DisplayRing::setCapacity(int capacity_)
+{
+    if (capacity_ != capacity) {
+        capacity = qMax(1, capacity_);
+        numStreams = -1;
+        writePosition = 0;
+    }
+}
+
+// Empty the ring and restart sample numbering from zero.
+void DisplayRing::reset()
+{
+    writePosition = 0;
+}
+
+void DisplayRing::allocate(int numStreams_)
+{
+    numStreams = numStreams_;
+    int numAmplifiers = numStreams * CHANNELS_PER_STREAM;
+
+    amplifierRing.fill(QVector<Sample>(), numAmplifiers);
+    dcAmplifierRing.fill(QVector<qint16>(), numAmplifiers);
+    amplifierFlagRing.fill(QVector<quint8>(), numAmplifiers);
+    for (int i = 0; i < numAmplifiers; ++i) {
+        amplifierRing[i].fill(0, capacity);
+        dcAmplifierRing[i].fill(0, capacity);
+        amplifierFlagRing[i].fill(0, capacity);
+    }
+    boardAdcRing.fill(QVector<Sample>(capacity, 0), 8);
+    boardDacRing.fill(QVector<Sample>(capacity, 0), 8);
+    boardDigInRing.fill(QVector<quint8>(capacity, 0), 16);
+    boardDigOutRing.fill(QVector<quint8>(capacity, 0), 16);
+    writePosition = 0;
+}
+
+// Append the first numSamples samples of the latest data in signalProcessor.
+// If the ring layout no longer matches the data (e.g., the number of data
+// streams changed), it is reallocated and emptied first.
+void DisplayRing::write(const SignalProcessor *signalProcessor, int numSamples)
+{
+    int stream, channel, i;
+
+    if (signalProcessor->amplifierPostFilter.size() != numStreams) {
+        allocate(signalProcessor->amplifierPostFilter.size());
+    }
+
+    // Only the newest capacity samples can be kept.
+    int skip = qMax(0, numSamples - capacity);
+    writePosition += skip;
+
+    int start = offset(writePosition);
+    int count = numSamples - skip;
+    int first = qMin(count, capacity - start);   // samples before the ring wraps
+
+    for (stream = 0; stream < numStreams; ++stream) {
+        for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+            int ring = stream * CHANNELS_PER_STREAM + channel;
+            const Sample *amplifierData = signalProcessor->amplifierPostFilter[stream][channel].constData() + skip;
+            const qint16 *dcData = signalProcessor->dcAmplifier[stream][channel].constData() + skip;
+            const int *ampSettleData = signalProcessor->ampSettle[stream][channel].constData() + skip;
+            const int *chargeRecovData = signalProcessor->chargeRecov[stream][channel].constData() + skip;
+            const int *stimOnData = signalProcessor->stimOn[stream][channel].constData() + skip;
+            const int *complianceData = signalProcessor->complianceLimit[stream][channel].constData() + skip;
+
+            Sample *amplifierOut = amplifierRing[ring].data();
+            qint16 *dcOut = dcAmplifierRing[ring].data();
+            quint8 *flagOut = amplifierFlagRing[ring].data();
+
+            memcpy(amplifierOut + start, amplifierData, first * sizeof(Sample));
+            memcpy(amplifierOut, amplifierData + first, (count - first) * sizeof(Sample));
+            memcpy(dcOut + start, dcData, first * sizeof(qint16));
+            memcpy(dcOut, dcData + first, (count - first) * sizeof(qint16));
+
+            int t = start;
+            for (i = 0; i < count; ++i) {
+                flagOut[t] = (ampSettleData[i] ? AmpSettleFlag : 0) |
+                        (chargeRecovData[i] ? ChargeRecovFlag : 0) |
+                        (stimOnData[i] ? StimOnFlag : 0) |
+                        (complianceData[i] ? ComplianceLimitFlag : 0);
+                if (++t == capacity) t = 0;
+            }
+        }
+    }
+
+    for (channel = 0; channel < 8; ++channel) {
+        const Sample *adcData = signalProcessor->boardAdc[channel].constData() + skip;
+        const Sample *dacData = signalProcessor->boardDac[channel].constData() + skip;
+        memcpy(boardAdcRing[channel].data() + start, adcData, first * sizeof(Sample));
+        memcpy(boardAdcRing[channel].data(), adcData + first, (count - first) * sizeof(Sample));
+        memcpy(boardDacRing[channel].data() + start, dacData, first * sizeof(Sample));
+        memcpy(boardDacRing[channel].data(), dacData + first, (count - first) * sizeof(Sample));
+    }
+
+    for (channel = 0; channel < 16; ++channel) {
+        const int *digInData = signalProcessor->boardDigIn[channel].constData() + skip;
+        const int *digOutData = signalProcessor->boardDigOut[channel].constData() + skip;
+        quint8 *digInOut = boardDigInRing[channel].data();
+        quint8 *digOutOut = boardDigOutRing[channel].data();
+        int t = start;
+        for (i = 0; i < count; ++i) {
+            digInOut[t] = (quint8) digInData[i];
+            digOutOut[t] = (quint8) digOutData[i];
+            if (++t == capacity) t = 0;
+        }
+    }
+
+    writePosition += count;
+}
+
+// Number of samples held for each signal.
+int DisplayRing::getCapacity() const
+{
+    return capacity;
+}
+
+// Number of samples written since the ring was last reset (i.e., the sample
+// number of the next sample to be written).
+qint64 DisplayRing::getWritePosition() const
+{
+    return writePosition;
+}
+
+// Index into the signal arrays of the given sample number.  Samples with
+// sample numbers from getWritePosition() - getCapacity() onward are held.
+int DisplayRing::offset(qint64 position) const
+{
+    return (int) (position % capacity);
+}
+
+// Return the start of the ring array of each signal.  Use offset() to find
+// a sample; contiguous runs end at getCapacity().
+const Sample* DisplayRing::amplifier(int stream, int channel) const
+{
+    return amplifierRing[stream * CHANNELS_PER_STREAM + channel].constData();
+}
+
+const qint16* DisplayRing::dcAmplifier(int stream, int channel) const
+{
+    return dcAmplifierRing[stream * CHANNELS_PER_STREAM + channel].constData();
+}
+
+const quint8* DisplayRing::amplifierFlags(int stream, int channel) const
+{
+    return amplifierFlagRing[stream * CHANNELS_PER_STREAM + channel].constData();
+}
+
+const Sample* DisplayRing::boardAdc(int channel) const
+{
+    return boardAdcRing[channel].constData();
+}
+
+const Sample* DisplayRing::boardDac(int channel) const
+{
+    return boardDacRing[channel].constData();
+}
+
+const quint8* DisplayRing::boardDigIn(int channel) const
+{
+    return boardDigInRing[channel].constData();
+}
+
+const quint8* DisplayRing::boardDigOut(int channel) const
+{
+    return boardDigOutRing[channel].constData();
+}
@@ -0,0 +1,87 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISPLAYRING_H
+#define DISPLAYRING_H
+
+#include <QVector>
+
+#include "globalconstants.h"
+
+class SignalProcessor;
+
+// Ring buffer of the most recent waveform data shown by WavePlot, indexed by
+// sample number since the start of the run.
+//
+// The run loop writes each batch of filtered data into the ring as soon as it
+// has been processed, and WavePlot reads whatever has arrived since its last
+// refresh on its own timer, so the display rate no longer follows the batch
+// size.  Writes never wait: old data is simply overwritten, and a reader that
+// falls behind skips ahead.  WavePlot copies the data of each batch of frames
+// out of the ring before handing it to its drawing threads, so they never read
+// the ring.  The stimulation and amplifier settle markers of each channel are
+// packed into one byte per sample.  Decimation to the pixel grid is left to
+// WaveformDecimator at drawing time, since it depends on the time scale.
+class DisplayRing
+{
+public:
+    enum AmplifierFlag {
+        AmpSettleFlag = 1,
+        ChargeRecovFlag = 2,
+        StimOnFlag = 4,
+        ComplianceLimitFlag = 8
+    };
+
+    DisplayRing();
+
+    void setCapacity(int capacity_);
+    void reset();
+    void write(const SignalProcessor *signalProcessor, int numSamples);
+
+    int getCapacity() const;
+    qint64 getWritePosition() const;
+    int offset(qint64 position) const;
+
+    const Sample* amplifier(int stream, int channel) const;
+    const qint16* dcAmplifier(int stream, int channel) const;
+    const quint8* amplifierFlags(int stream, int channel) const;
+    const Sample* boardAdc(int channel) const;
+    const Sample* boardDac(int channel) const;
+    const quint8* boardDigIn(int channel) const;
+    const quint8* boardDigOut(int channel) const;
+
+private:
+    int capacity;
+    int numStreams;
+    qint64 writePosition;   // number of samples written since reset()
+
+    QVector<QVector<Sample> > amplifierRing;    // indexed by stream * CHANNELS_PER_STREAM + channel
+    QVector<QVector<qint16> > dcAmplifierRing;
+    QVector<QVector<quint8> > amplifierFlagRing;
+    QVector<QVector<Sample> > boardAdcRing;
+    QVector<QVector<Sample> > boardDacRing;
+    QVector<QVector<quint8> > boardDigInRing;
+    QVector<QVector<quint8> > boardDigOutRing;
+
+    void allocate(int numStreams_);
+};
+
+#endif // DISPLAYRING_H
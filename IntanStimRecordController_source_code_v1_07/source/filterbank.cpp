@@ -0,0 +1,172 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <QtGlobal>
+
+#include "filterbank.h"
+#include "multichannelbiquad.h"
+
+// Constructor.
+FilterBank::FilterBank()
+{
+    numLanes = 0;
+    maxSamples = 0;
+    sampleRate = 0.0;
+}
+
+FilterBank::~FilterBank()
+{
+    freeBands();
+}
+
+void FilterBank::freeBands()
+{
+    for (int band = 0; band < cascades.size(); ++band) {
+        qDeleteAll(cascades[band]);
+        qFreeAligned(outputs[band]);
+    }
+    cascades.clear();
+    outputs.clear();
+}
+
+// Set the number of interleaved lanes, and the maximum number of samples per
+// lane passed to filter().  Filter state is reset.
+void FilterBank::setNumLanes(int numLanes_, int maxSamples_)
+{
+    numLanes = numLanes_;
+    maxSamples = maxSamples_;
+    setBands(QVector<FilterBankBand>(bands), sampleRate);
+}
+
+// Replace all bands and design their filters.  Returns false if any band could
+// not be designed at this sample rate; such bands pass their input unchanged.
+bool FilterBank::setBands(const QVector<FilterBankBand> &bands_, double sampleRate_)
+{
+    freeBands();
+    bands = bands_;
+    sampleRate = sampleRate_;
+
+    bool allValid = true;
+    cascades.resize(bands.size());
+    outputs.resize(bands.size());
+    for (int band = 0; band < bands.size(); ++band) {
+        outputs[band] = (Sample*) qMallocAligned(qMax(numLanes * maxSamples, 1) * sizeof(Sample), 64);
+        memset(outputs[band], 0, qMax(numLanes * maxSamples, 1) * sizeof(Sample));
+        if (!designBand(band, false)) allValid = false;
+    }
+    return allValid;
+}
+
+// Redesign all filters for a new sample rate.  Filter state is kept where the
+// number of sections is unchanged.
+bool FilterBank::setSampleRate(double sampleRate_)
+{
+    sampleRate = sampleRate_;
+    bool allValid = true;
+    for (int band = 0; band < bands.size(); ++band) {
+        if (!designBand(band, true)) allValid = false;
+    }
+    return allValid;
+}
+
+// Design the filter for one band and set up its sections.
+bool FilterBank::designBand(int band, bool keepState)
+{
+    QVector<BiquadSection> sections;
+    bool valid = (sampleRate > 0.0) && FilterDesign::design(bands[band].spec, sampleRate, sections);
+
+    QVector<MultiChannelBiquad*> &cascade = cascades[band];
+    if (!keepState || cascade.size() != sections.size()) {
+        qDeleteAll(cascade);
+        cascade.clear();
+        for (int i = 0; i < sections.size(); ++i) {
+            MultiChannelBiquad *biquad = new MultiChannelBiquad();
+            biquad->setNumLanes(numLanes);
+            cascade.append(biquad);
+        }
+    }
+    for (int i = 0; i < sections.size(); ++i) {
+        const BiquadSection &s = sections[i];
+        cascade[i]->setCoefficients(s.b0, s.b1, s.b2, s.a1, s.a2);
+    }
+    return valid;
+}
+
+void FilterBank::resetState()
+{
+    for (int band = 0; band < cascades.size(); ++band) {
+        for (int i = 0; i < cascades[band].size(); ++i) {
+            cascades[band][i]->resetState();
+        }
+    }
+}
+
+int FilterBank::getNumBands() const
+{
+    return bands.size();
+}
+
+const FilterBankBand& FilterBank::getBand(int band) const
+{
+    return bands[band];
+}
+
+bool FilterBank::bandValid(int band) const
+{
+    return !cascades[band].isEmpty();
+}
+
+int FilterBank::getNumSections(int band) const
+{
+    return cascades[band].size();
+}
+
+// Filtered output of one band, in the same time-major layout as the input.
+const Sample* FilterBank::getOutput(int band) const
+{
+    return outputs[band];
+}
+
+// Filter numSamples time steps of lanes [firstLane, lastLane) through every
+// band.  Lane ranges are independent, so different threads may filter disjoint
+// lane ranges at the same time.  Each band's cascade runs section by section
+// over the lane range; when the range is small, as in SignalProcessor, the data
+// stays in cache from one section (and one band) to the next, so the input is
+// read from memory only once.
+void FilterBank::filter(const Sample *in, int numSamples, int firstLane, int lastLane)
+{
+    for (int band = 0; band < bands.size(); ++band) {
+        const QVector<MultiChannelBiquad*> &cascade = cascades[band];
+        Sample *out = outputs[band];
+        if (cascade.isEmpty()) {
+            for (int t = 0; t < numSamples; ++t) {
+                memcpy(out + t * numLanes + firstLane, in + t * numLanes + firstLane,
+                       (lastLane - firstLane) * sizeof(Sample));
+            }
+            continue;
+        }
+        cascade[0]->filter(in, out, numSamples, firstLane, lastLane);
+        for (int i = 1; i < cascade.size(); ++i) {
+            cascade[i]->filter(out, out, numSamples, firstLane, lastLane);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FILTERBANK_H
+#define FILTERBANK_H
+
+#include <QVector>
+#include <QString>
+
+#include "globalconstants.h"
+#include "filterdesign.h"
+
+// Maximum number of bands that can be configured from the GUI
+#define MAX_FILTER_BANK_BANDS 4
+
+class MultiChannelBiquad;
+
+// One output band of a FilterBank.
+struct FilterBankBand
+{
+    QString name;
+    FilterSpec spec;
+};
+
+// A set of filters applied to the same multichannel input, each producing its
+// own output (e.g., a spike band and an LFP band).  Each filter is a cascade of
+// second-order sections designed by FilterDesign and run on the vectorized
+// MultiChannelBiquad kernel.  Input and outputs use the time-major lane layout
+// of SignalProcessor::amplifierPostFilterFast.
+class FilterBank
+{
+public:
+    FilterBank();
+    ~FilterBank();
+
+    void setNumLanes(int numLanes_, int maxSamples_);
+    bool setBands(const QVector<FilterBankBand> &bands_, double sampleRate_);
+    bool setSampleRate(double sampleRate_);
+    void resetState();
+
+    int getNumBands() const;
+    const FilterBankBand& getBand(int band) const;
+    bool bandValid(int band) const;
+    int getNumSections(int band) const;
+    const Sample* getOutput(int band) const;
+
+    void filter(const Sample *in, int numSamples, int firstLane, int lastLane);
+
+private:
+    int numLanes;
+    int maxSamples;
+    double sampleRate;
+    QVector<FilterBankBand> bands;
+    QVector<QVector<MultiChannelBiquad*> > cascades;
+    QVector<Sample*> outputs;
+
+    bool designBand(int band, bool keepState);
+    void freeBands();
+};
+
+#endif // FILTERBANK_H
@@ -0,0 +1,253 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "filterbankdialog.h"
+
+// Filter bank configuration dialog.
+// This dialog allows users to define up to MAX_FILTER_BANK_BANDS software filters
+// that are applied to every amplifier channel in parallel (e.g., a spike band and
+// an LFP band), and to select one of them for display in place of the standard
+// software high-pass filter.  Each band is designed as it is edited, and bands
+// that cannot be realized at the current sample rate are flagged.
+
+FilterBankDialog::FilterBankDialog(const QVector<FilterBankBand> &bands, int displayBand,
+                                   double sampleRate_, QWidget *parent) :
+    QDialog(parent)
+{
+    sampleRate = sampleRate_;
+
+    QGridLayout *bandLayout = new QGridLayout();
+    bandLayout->addWidget(new QLabel(tr("Name")), 0, 1);
+    bandLayout->addWidget(new QLabel(tr("Type")), 0, 2);
+    bandLayout->addWidget(new QLabel(tr("Response")), 0, 3);
+    bandLayout->addWidget(new QLabel(tr("Order")), 0, 4);
+    bandLayout->addWidget(new QLabel(tr("Low Cutoff")), 0, 5);
+    bandLayout->addWidget(new QLabel(tr("High Cutoff")), 0, 6);
+    bandLayout->addWidget(new QLabel(tr("Ripple")), 0, 7);
+    bandLayout->addWidget(new QLabel(tr("Attenuation")), 0, 8);
+
+    double nyquist = sampleRate / 2.0;
+
+    for (int row = 0; row < MAX_FILTER_BANK_BANDS; ++row) {
+        enableCheckBox[row] = new QCheckBox();
+        nameLineEdit[row] = new QLineEdit();
+
+        prototypeComboBox[row] = new QComboBox();
+        prototypeComboBox[row]->addItem(tr("Butterworth"));
+        prototypeComboBox[row]->addItem(tr("Elliptic"));
+
+        responseComboBox[row] = new QComboBox();
+        responseComboBox[row]->addItem(tr("Low-Pass"));
+        responseComboBox[row]->addItem(tr("High-Pass"));
+        responseComboBox[row]->addItem(tr("Band-Pass"));
+
+        orderSpinBox[row] = new QSpinBox();
+        orderSpinBox[row]->setRange(1, 8);
+
+        lowCutoffSpinBox[row] = new QDoubleSpinBox();
+        lowCutoffSpinBox[row]->setRange(0.1, nyquist);
+        lowCutoffSpinBox[row]->setDecimals(1);
+        lowCutoffSpinBox[row]->setSuffix(" Hz");
+
+        highCutoffSpinBox[row] = new QDoubleSpinBox();
+        highCutoffSpinBox[row]->setRange(0.1, nyquist);
+        highCutoffSpinBox[row]->setDecimals(1);
+        highCutoffSpinBox[row]->setSuffix(" Hz");
+
+        rippleSpinBox[row] = new QDoubleSpinBox();
+        rippleSpinBox[row]->setRange(0.01, 3.0);
+        rippleSpinBox[row]->setSingleStep(0.1);
+        rippleSpinBox[row]->setSuffix(" dB");
+
+        attenuationSpinBox[row] = new QDoubleSpinBox();
+        attenuationSpinBox[row]->setRange(10.0, 120.0);
+        attenuationSpinBox[row]->setDecimals(0);
+        attenuationSpinBox[row]->setSuffix(" dB");
+
+        statusLabel[row] = new QLabel();
+
+        // Defaults: a spike band and an LFP band.
+        FilterBankBand band;
+        if (row < bands.size()) {
+            band = bands[row];
+        } else {
+            band.name = (row == 0) ? "Spike" : ((row == 1) ? "LFP" : QString("Band %1").arg(row + 1));
+            band.spec.prototype = FilterButterworth;
+            band.spec.response = (row == 1) ? FilterLowpass : FilterBandpass;
+            band.spec.order = 4;
+            band.spec.lowCutoff = 300.0;
+            band.spec.highCutoff = (row == 1) ? 250.0 : qMin(5000.0, 0.4 * sampleRate);
+            band.spec.passbandRipple = 0.1;
+            band.spec.stopbandAttenuation = 60.0;
+        }
+        enableCheckBox[row]->setChecked(row < bands.size());
+        nameLineEdit[row]->setText(band.name);
+        prototypeComboBox[row]->setCurrentIndex(band.spec.prototype);
+        responseComboBox[row]->setCurrentIndex(band.spec.response);
+        orderSpinBox[row]->setValue(band.spec.order);
+        lowCutoffSpinBox[row]->setValue(band.spec.lowCutoff);
+        highCutoffSpinBox[row]->setValue(band.spec.highCutoff);
+        rippleSpinBox[row]->setValue(band.spec.passbandRipple);
+        attenuationSpinBox[row]->setValue(band.spec.stopbandAttenuation);
+
+        connect(enableCheckBox[row], SIGNAL(toggled(bool)), this, SLOT(updateBands()));
+        connect(nameLineEdit[row], SIGNAL(textChanged(const QString &)), this, SLOT(updateBands()));
+        connect(prototypeComboBox[row], SIGNAL(currentIndexChanged(int)), this, SLOT(updateBands()));
+        connect(responseComboBox[row], SIGNAL(currentIndexChanged(int)), this, SLOT(updateBands()));
+        connect(orderSpinBox[row], SIGNAL(valueChanged(int)), this, SLOT(updateBands()));
+        connect(lowCutoffSpinBox[row], SIGNAL(valueChanged(double)), this, SLOT(updateBands()));
+        connect(highCutoffSpinBox[row], SIGNAL(valueChanged(double)), this, SLOT(updateBands()));
+        connect(rippleSpinBox[row], SIGNAL(valueChanged(double)), this, SLOT(updateBands()));
+        connect(attenuationSpinBox[row], SIGNAL(valueChanged(double)), this, SLOT(updateBands()));
+
+        bandLayout->addWidget(enableCheckBox[row], row + 1, 0);
+        bandLayout->addWidget(nameLineEdit[row], row + 1, 1);
+        bandLayout->addWidget(prototypeComboBox[row], row + 1, 2);
+        bandLayout->addWidget(responseComboBox[row], row + 1, 3);
+        bandLayout->addWidget(orderSpinBox[row], row + 1, 4);
+        bandLayout->addWidget(lowCutoffSpinBox[row], row + 1, 5);
+        bandLayout->addWidget(highCutoffSpinBox[row], row + 1, 6);
+        bandLayout->addWidget(rippleSpinBox[row], row + 1, 7);
+        bandLayout->addWidget(attenuationSpinBox[row], row + 1, 8);
+        bandLayout->addWidget(statusLabel[row], row + 1, 9);
+    }
+
+    QGroupBox *bandGroupBox = new QGroupBox(tr("Filter Bank Bands"));
+    bandGroupBox->setLayout(bandLayout);
+
+    displayBandComboBox = new QComboBox();
+    displayBandComboBox->addItem(tr("Notch and high-pass filters only"));
+    for (int row = 0; row < MAX_FILTER_BANK_BANDS; ++row) {
+        displayBandComboBox->addItem("");
+    }
+
+    QHBoxLayout *displayLayout = new QHBoxLayout();
+    displayLayout->addWidget(new QLabel(tr("Displayed waveforms")));
+    displayLayout->addWidget(displayBandComboBox);
+    displayLayout->addStretch(1);
+
+    QLabel *noteLabel = new QLabel(tr("Filter bank bands are computed for all amplifier channels from the "
+                                      "notch-filtered data.  The order of a band-pass filter is the order of "
+                                      "each of its edges.  Ripple and attenuation apply to elliptic filters only."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(bandGroupBox);
+    mainLayout->addLayout(displayLayout);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Software Filter Bank"));
+
+    updateBands();
+    displayBandComboBox->setCurrentIndex(displayBand + 1);
+}
+
+// Filter bank band described by one row of the dialog.
+FilterBankBand FilterBankDialog::bandFromRow(int row) const
+{
+    FilterBankBand band;
+    band.name = nameLineEdit[row]->text();
+    band.spec.prototype = (FilterPrototype) prototypeComboBox[row]->currentIndex();
+    band.spec.response = (FilterResponse) responseComboBox[row]->currentIndex();
+    band.spec.order = orderSpinBox[row]->value();
+    band.spec.lowCutoff = lowCutoffSpinBox[row]->value();
+    band.spec.highCutoff = highCutoffSpinBox[row]->value();
+    band.spec.passbandRipple = rippleSpinBox[row]->value();
+    band.spec.stopbandAttenuation = attenuationSpinBox[row]->value();
+    return band;
+}
+
+// Enable the controls that apply to each band, design each enabled band to
+// check that it is valid, and update the list of bands that can be displayed.
+void FilterBankDialog::updateBands()
+{
+    bool allValid = true;
+    int index = 1;
+
+    for (int row = 0; row < MAX_FILTER_BANK_BANDS; ++row) {
+        bool enabled = enableCheckBox[row]->isChecked();
+        FilterBankBand band = bandFromRow(row);
+
+        nameLineEdit[row]->setEnabled(enabled);
+        prototypeComboBox[row]->setEnabled(enabled);
+        responseComboBox[row]->setEnabled(enabled);
+        orderSpinBox[row]->setEnabled(enabled);
+        lowCutoffSpinBox[row]->setEnabled(enabled && band.spec.response != FilterLowpass);
+        highCutoffSpinBox[row]->setEnabled(enabled && band.spec.response != FilterHighpass);
+        rippleSpinBox[row]->setEnabled(enabled && band.spec.prototype == FilterElliptic);
+        attenuationSpinBox[row]->setEnabled(enabled && band.spec.prototype == FilterElliptic);
+
+        if (!enabled) {
+            statusLabel[row]->setText("");
+            continue;
+        }
+
+        QVector<BiquadSection> sections;
+        if (FilterDesign::design(band.spec, sampleRate, sections)) {
+            statusLabel[row]->setText(QString::number(sections.size()) + tr(" sections"));
+            statusLabel[row]->setStyleSheet("");
+        } else {
+            statusLabel[row]->setText(tr("Invalid"));
+            statusLabel[row]->setStyleSheet("color: red");
+            allValid = false;
+        }
+
+        // Combo box entries for enabled bands, in order; unused entries are blank.
+        displayBandComboBox->setItemText(index++, band.name.isEmpty() ? tr("Band %1").arg(row + 1) : band.name);
+    }
+    for (; index <= MAX_FILTER_BANK_BANDS; ++index) {
+        displayBandComboBox->setItemText(index, "");
+    }
+
+    buttonBox->button(QDialogButtonBox::Ok)->setEnabled(allValid);
+}
+
+// Bands that are enabled, in order.
+QVector<FilterBankBand> FilterBankDialog::getBands() const
+{
+    QVector<FilterBankBand> bands;
+    for (int row = 0; row < MAX_FILTER_BANK_BANDS; ++row) {
+        if (enableCheckBox[row]->isChecked()) {
+            bands.append(bandFromRow(row));
+        }
+    }
+    return bands;
+}
+
+// Index (into getBands()) of the band to display, or -1 for the standard filters.
+int FilterBankDialog::getDisplayBand() const
+{
+    int band = displayBandComboBox->currentIndex() - 1;
+    return (band < getBands().size()) ? band : -1;
+}
@@ -0,0 +1,74 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FILTERBANKDIALOG_H
+#define FILTERBANKDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+#include "filterbank.h"
+
+class QDialogButtonBox;
+class QCheckBox;
+class QLineEdit;
+class QComboBox;
+class QSpinBox;
+class QDoubleSpinBox;
+class QLabel;
+
+class FilterBankDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit FilterBankDialog(const QVector<FilterBankBand> &bands, int displayBand, double sampleRate,
+                              QWidget *parent);
+
+    QVector<FilterBankBand> getBands() const;
+    int getDisplayBand() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateBands();
+
+private:
+    double sampleRate;
+
+    QCheckBox *enableCheckBox[MAX_FILTER_BANK_BANDS];
+    QLineEdit *nameLineEdit[MAX_FILTER_BANK_BANDS];
+    QComboBox *prototypeComboBox[MAX_FILTER_BANK_BANDS];
+    QComboBox *responseComboBox[MAX_FILTER_BANK_BANDS];
+    QSpinBox *orderSpinBox[MAX_FILTER_BANK_BANDS];
+    QDoubleSpinBox *lowCutoffSpinBox[MAX_FILTER_BANK_BANDS];
+    QDoubleSpinBox *highCutoffSpinBox[MAX_FILTER_BANK_BANDS];
+    QDoubleSpinBox *rippleSpinBox[MAX_FILTER_BANK_BANDS];
+    QDoubleSpinBox *attenuationSpinBox[MAX_FILTER_BANK_BANDS];
+    QLabel *statusLabel[MAX_FILTER_BANK_BANDS];
+    QComboBox *displayBandComboBox;
+    QDialogButtonBox *buttonBox;
+
+    FilterBankBand bandFromRow(int row) const;
+};
+
+#endif // FILTERBANKDIALOG_H
@@ -0,0 +1,325 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <algorithm>
+
+#include "filterdesign.h"
+#include "globalconstants.h"
+
+using namespace std;
+
+// Number of Landen iterations used to evaluate elliptic functions.  The moduli
+// converge quadratically, so this is far more than double precision needs.
+static const int LandenIterations = 8;
+
+// Descending Landen sequence of elliptic moduli starting from k.
+static void landen(double k, double *v)
+{
+    for (int n = 0; n < LandenIterations; ++n) {
+        k = (k / (1.0 + sqrt(1.0 - k * k)));
+        k *= k;
+        v[n] = k;
+    }
+}
+
+// Jacobi elliptic cd(uK, k), for complex u normalized by the quarter period K.
+static complex<double> cde(complex<double> u, double k)
+{
+    double v[LandenIterations];
+    landen(k, v);
+    complex<double> w = cos(u * (PI / 2.0));
+    for (int n = LandenIterations - 1; n >= 0; --n) {
+        w = (1.0 + v[n]) * w / (1.0 + v[n] * w * w);
+    }
+    return w;
+}
+
+// Jacobi elliptic sn(uK, k), for complex u normalized by the quarter period K.
+static complex<double> sne(complex<double> u, double k)
+{
+    double v[LandenIterations];
+    landen(k, v);
+    complex<double> w = sin(u * (PI / 2.0));
+    for (int n = LandenIterations - 1; n >= 0; --n) {
+        w = (1.0 + v[n]) * w / (1.0 + v[n] * w * w);
+    }
+    return w;
+}
+
+// Inverse of sne(): returns u such that sn(uK, k) = w.
+static complex<double> asne(complex<double> w, double k)
+{
+    double v[LandenIterations];
+    landen(k, v);
+    for (int n = 0; n < LandenIterations; ++n) {
+        double previous = (n == 0) ? k : v[n - 1];
+        w = w / (1.0 + sqrt(1.0 - w * w * previous * previous)) * (2.0 / (1.0 + v[n]));
+    }
+    return 1.0 - acos(w) * (2.0 / PI);
+}
+
+// Solve the elliptic degree equation: the modulus k (ratio of passband to
+// stopband edge) achievable by an order N filter with discrimination k1.
+static double ellipdeg(int order, double k1)
+{
+    double k1p = sqrt(1.0 - k1 * k1);
+    double product = 1.0;
+    for (int i = 1; i <= order / 2; ++i) {
+        product *= sne((2.0 * i - 1.0) / order, k1p).real();
+    }
+    double kp = pow(k1p, order) * pow(product, 4);
+    return sqrt(1.0 - kp * kp);
+}
+
+// Analog Butterworth lowpass prototype with a cutoff of 1 rad/s.
+void FilterDesign::butterworthPrototype(int order, QVector<Complex> &zeros, QVector<Complex> &poles)
+{
+    zeros.clear();
+    poles.clear();
+    for (int k = 0; k < order; ++k) {
+        poles.append(polar(1.0, PI * (2.0 * k + order + 1.0) / (2.0 * order)));
+    }
+}
+
+// Analog elliptic lowpass prototype with a passband edge of 1 rad/s, using the
+// method of S. J. Orfanidis, "Lecture Notes on Elliptic Filter Design" (2006).
+void FilterDesign::ellipticPrototype(int order, double passbandRipple, double stopbandAttenuation,
+                                     QVector<Complex> &zeros, QVector<Complex> &poles)
+{
+    const Complex j(0.0, 1.0);
+
+    double ep = sqrt(pow(10.0, passbandRipple / 10.0) - 1.0);
+    double es = sqrt(pow(10.0, stopbandAttenuation / 10.0) - 1.0);
+    double k1 = ep / es;
+    double k = ellipdeg(order, k1);
+    double v0 = (-j * asne(j / ep, k1) / (double) order).real();
+
+    zeros.clear();
+    poles.clear();
+    for (int i = 1; i <= order / 2; ++i) {
+        double u = (2.0 * i - 1.0) / order;
+        Complex zero = j / (k * cde(u, k));
+        Complex pole = j * cde(u - j * v0, k);
+        zeros.append(zero);
+        zeros.append(conj(zero));
+        poles.append(pole);
+        poles.append(conj(pole));
+    }
+    if (order % 2 == 1) {
+        poles.append(Complex((j * sne(j * v0, k)).real(), 0.0));
+    }
+}
+
+// Pair digital poles and zeros into second-order sections.  Complex roots are
+// kept with their conjugates, and each pole pair is matched with the nearest
+// remaining zeros.  Sections are ordered with the poles nearest the unit circle
+// (highest Q) last, which minimizes the chance of overflow in earlier sections.
+void FilterDesign::pairSections(const QVector<Complex> &zeros, const QVector<Complex> &poles,
+                                QVector<BiquadSection> &sections)
+{
+    const double Tolerance = 1.0e-9;
+
+    // Group roots into conjugate pairs and pairs of real roots.
+    QVector<QVector<Complex> > poleGroups, zeroGroups;
+    for (int g = 0; g < 2; ++g) {
+        const QVector<Complex> &roots = (g == 0) ? poles : zeros;
+        QVector<QVector<Complex> > &groups = (g == 0) ? poleGroups : zeroGroups;
+        QVector<double> realRoots;
+        for (int i = 0; i < roots.size(); ++i) {
+            if (roots[i].imag() > Tolerance) {
+                QVector<Complex> pair;
+                pair.append(roots[i]);
+                pair.append(conj(roots[i]));
+                groups.append(pair);
+            } else if (fabs(roots[i].imag()) <= Tolerance) {
+                realRoots.append(roots[i].real());
+            }
+        }
+        // Pair real roots largest with smallest, so that a bandpass filter's zeros
+        // at +1 and -1 are split evenly between sections.
+        sort(realRoots.begin(), realRoots.end());
+        int low = 0;
+        int high = realRoots.size() - 1;
+        while (low <= high) {
+            QVector<Complex> pair;
+            pair.append(Complex(realRoots[high--], 0.0));
+            if (low <= high) pair.append(Complex(realRoots[low++], 0.0));
+            groups.append(pair);
+        }
+    }
+
+    // Order pole groups from farthest to nearest the unit circle.
+    sort(poleGroups.begin(), poleGroups.end(),
+         [](const QVector<Complex> &a, const QVector<Complex> &b) { return abs(a[0]) < abs(b[0]); });
+
+    QVector<bool> zeroGroupUsed(zeroGroups.size());
+    zeroGroupUsed.fill(false);
+
+    sections.clear();
+    for (int i = 0; i < poleGroups.size(); ++i) {
+        const QVector<Complex> &p = poleGroups[i];
+        int bestZeroGroup = -1;
+        double bestDistance = 0.0;
+        for (int z = 0; z < zeroGroups.size(); ++z) {
+            if (zeroGroupUsed[z] || zeroGroups[z].size() > p.size()) continue;
+            double distance = abs(zeroGroups[z][0] - p[0]);
+            if (bestZeroGroup < 0 || distance < bestDistance) {
+                bestZeroGroup = z;
+                bestDistance = distance;
+            }
+        }
+
+        BiquadSection section;
+        section.b0 = 1.0;
+        section.b1 = 0.0;
+        section.b2 = 0.0;
+        if (bestZeroGroup >= 0) {
+            const QVector<Complex> &z = zeroGroups[bestZeroGroup];
+            zeroGroupUsed[bestZeroGroup] = true;
+            if (z.size() == 2) {
+                section.b1 = -(z[0] + z[1]).real();
+                section.b2 = (z[0] * z[1]).real();
+            } else {
+                section.b1 = -z[0].real();
+            }
+        }
+        if (p.size() == 2) {
+            section.a1 = -(p[0] + p[1]).real();
+            section.a2 = (p[0] * p[1]).real();
+        } else {
+            section.a1 = -p[0].real();
+            section.a2 = 0.0;
+        }
+        sections.append(section);
+    }
+}
+
+// Design the filter described by spec for the given sample rate (in Samples/s).
+// Returns false if the specification is invalid (order out of range, or cutoff
+// frequencies not between zero and the Nyquist frequency).
+bool FilterDesign::design(const FilterSpec &spec, double sampleRate, QVector<BiquadSection> &sections)
+{
+    sections.clear();
+
+    double nyquist = sampleRate / 2.0;
+    bool needLow = (spec.response != FilterLowpass);
+    bool needHigh = (spec.response != FilterHighpass);
+    if (spec.order < 1 || spec.order > 16) return false;
+    if (needLow && (spec.lowCutoff <= 0.0 || spec.lowCutoff >= nyquist)) return false;
+    if (needHigh && (spec.highCutoff <= 0.0 || spec.highCutoff >= nyquist)) return false;
+    if (spec.response == FilterBandpass && spec.lowCutoff >= spec.highCutoff) return false;
+    if (spec.prototype == FilterElliptic &&
+            (spec.passbandRipple <= 0.0 || spec.stopbandAttenuation <= spec.passbandRipple)) return false;
+
+    // Analog prototype
+    QVector<Complex> zeros, poles;
+    if (spec.prototype == FilterElliptic) {
+        ellipticPrototype(spec.order, spec.passbandRipple, spec.stopbandAttenuation, zeros, poles);
+    } else {
+        butterworthPrototype(spec.order, zeros, poles);
+    }
+
+    // Transform to the requested response, with prewarped cutoff frequencies.
+    double fs2 = 2.0 * sampleRate;
+    double wLow = fs2 * tan(PI * spec.lowCutoff / sampleRate);
+    double wHigh = fs2 * tan(PI * spec.highCutoff / sampleRate);
+    int excessPoles = poles.size() - zeros.size();
+    QVector<Complex> *roots[2] = { &zeros, &poles };
+    double referenceFrequency = 0.0;
+
+    switch (spec.response) {
+    case FilterLowpass:
+        for (int r = 0; r < 2; ++r) {
+            for (int i = 0; i < roots[r]->size(); ++i) (*roots[r])[i] *= wHigh;
+        }
+        break;
+    case FilterHighpass:
+        for (int r = 0; r < 2; ++r) {
+            for (int i = 0; i < roots[r]->size(); ++i) (*roots[r])[i] = wLow / (*roots[r])[i];
+        }
+        for (int i = 0; i < excessPoles; ++i) zeros.append(0.0);
+        referenceFrequency = nyquist;
+        break;
+    case FilterBandpass:
+    {
+        double bandwidth = wHigh - wLow;
+        double w0 = sqrt(wLow * wHigh);
+        for (int r = 0; r < 2; ++r) {
+            QVector<Complex> transformed;
+            for (int i = 0; i < roots[r]->size(); ++i) {
+                Complex half = (*roots[r])[i] * (bandwidth / 2.0);
+                Complex offset = sqrt(half * half - w0 * w0);
+                transformed.append(half + offset);
+                transformed.append(half - offset);
+            }
+            *roots[r] = transformed;
+        }
+        for (int i = 0; i < excessPoles; ++i) zeros.append(0.0);
+        referenceFrequency = sampleRate / PI * atan(w0 / fs2);
+    }
+        break;
+    }
+
+    // Bilinear transform; zeros at infinity map to z = -1.
+    for (int r = 0; r < 2; ++r) {
+        for (int i = 0; i < roots[r]->size(); ++i) {
+            Complex s = (*roots[r])[i];
+            (*roots[r])[i] = (fs2 + s) / (fs2 - s);
+        }
+    }
+    while (zeros.size() < poles.size()) zeros.append(-1.0);
+
+    pairSections(zeros, poles, sections);
+
+    // Scale each section to unity gain at the center of the passband, then set
+    // the overall passband gain.  An even-order elliptic filter starts at the
+    // bottom of its passband ripple, like its analog prototype.
+    for (int i = 0; i < sections.size(); ++i) {
+        QVector<BiquadSection> single;
+        single.append(sections[i]);
+        double gain = abs(frequencyResponse(single, referenceFrequency, sampleRate));
+        sections[i].b0 /= gain;
+        sections[i].b1 /= gain;
+        sections[i].b2 /= gain;
+    }
+    if (spec.prototype == FilterElliptic && spec.order % 2 == 0 && !sections.isEmpty()) {
+        double gain = pow(10.0, -spec.passbandRipple / 20.0);
+        sections[0].b0 *= gain;
+        sections[0].b1 *= gain;
+        sections[0].b2 *= gain;
+    }
+    return true;
+}
+
+// Complex frequency response of a cascade of sections at frequency (in Hz).
+complex<double> FilterDesign::frequencyResponse(const QVector<BiquadSection> &sections,
+                                                double frequency, double sampleRate)
+{
+    Complex zInv = polar(1.0, -TWO_PI * frequency / sampleRate);
+    Complex zInv2 = zInv * zInv;
+    Complex h(1.0, 0.0);
+    for (int i = 0; i < sections.size(); ++i) {
+        const BiquadSection &s = sections[i];
+        h *= (s.b0 + s.b1 * zInv + s.b2 * zInv2) / (1.0 + s.a1 * zInv + s.a2 * zInv2);
+    }
+    return h;
+}
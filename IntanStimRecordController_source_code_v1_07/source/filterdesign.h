@@ -0,0 +1,84 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FILTERDESIGN_H
+#define FILTERDESIGN_H
+
+#include <QVector>
+#include <complex>
+
+// Design of digital IIR filters as cascades of second-order sections.
+//
+// Filters are designed from a normalized analog lowpass prototype (Butterworth
+// or elliptic), transformed to the requested response, and mapped to the z
+// domain with the bilinear transform, with cutoff frequencies prewarped so they
+// land exactly where requested.  Poles and zeros are then paired into biquad
+// sections, which are numerically well behaved at high orders where a single
+// direct-form polynomial is not.
+
+enum FilterPrototype {
+    FilterButterworth,
+    FilterElliptic
+};
+
+enum FilterResponse {
+    FilterLowpass,
+    FilterHighpass,
+    FilterBandpass
+};
+
+// Coefficients of one second-order section, with a0 normalized to 1:
+// y[t] = b0 x[t] + b1 x[t-1] + b2 x[t-2] - a1 y[t-1] - a2 y[t-2]
+struct BiquadSection
+{
+    double b0, b1, b2;
+    double a1, a2;
+};
+
+struct FilterSpec
+{
+    FilterPrototype prototype;
+    FilterResponse response;
+    int order;                      // prototype order (a bandpass filter has twice as many poles)
+    double lowCutoff;               // Hz; highpass and bandpass only
+    double highCutoff;              // Hz; lowpass and bandpass only
+    double passbandRipple;          // dB; elliptic only
+    double stopbandAttenuation;     // dB; elliptic only
+};
+
+class FilterDesign
+{
+public:
+    static bool design(const FilterSpec &spec, double sampleRate, QVector<BiquadSection> &sections);
+    static std::complex<double> frequencyResponse(const QVector<BiquadSection> &sections,
+                                                  double frequency, double sampleRate);
+
+private:
+    typedef std::complex<double> Complex;
+
+    static void butterworthPrototype(int order, QVector<Complex> &zeros, QVector<Complex> &poles);
+    static void ellipticPrototype(int order, double passbandRipple, double stopbandAttenuation,
+                                  QVector<Complex> &zeros, QVector<Complex> &poles);
+    static void pairSections(const QVector<Complex> &zeros, const QVector<Complex> &poles,
+                             QVector<BiquadSection> &sections);
+};
+
+#endif // FILTERDESIGN_H
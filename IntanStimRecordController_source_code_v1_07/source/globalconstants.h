@@ -22,12 +22,40 @@
 #ifndef GLOBALCONSTANTS_H
 #define GLOBALCONSTANTS_H
 
+#include <QtGlobal>
+
 // Trigonometric constants
 const double PI = 3.14159265359;
 const double TWO_PI = 6.28318530718;
 const double DEGREES_TO_RADIANS = 0.0174532925199;
 const double RADIANS_TO_DEGREES = 57.2957795132;
 
+// Conversion of raw ADC codes to physical units: RHS2000 amplifier codes (offset
+// binary, mid-scale 32768) to microvolts, RHS2000 DC amplifier codes (mid-scale
+// 512) to volts, and interface board ADC and DAC codes (mid-scale 32768) to volts.
+const double AMPLIFIER_MICROVOLTS_PER_BIT = 0.195;
+const double DC_AMPLIFIER_VOLTS_PER_BIT = -0.01923;
+const double BOARD_ADC_VOLTS_PER_BIT = 0.0003125;
+
+// Length of the manual stimulation trigger pulse fired by phase-locked stimulation
+#define PHASE_TRIGGER_PULSE_MSEC  2
+
+// Adaptive DAC threshold comparators: time constant of the noise estimates,
+// minimum time between updates, and the relative change below which a
+// threshold is left as it is
+#define DAC_NOISE_TIME_CONSTANT_SEC  10.0
+#define DAC_THRESHOLD_UPDATE_MSEC  1000
+#define DAC_THRESHOLD_HYSTERESIS  0.05
+
+// Minimum number of samples per pixel column at which WavePlot draws each
+// column as a min/max span instead of drawing every sample
+#define WAVEPLOT_DECIMATION_SAMPLES_PER_PIXEL  4
+
+// Length of the ring of recent data kept for the waveform display, and the
+// default display refresh rate (Hz)
+#define DISPLAY_RING_MSEC  500
+#define DEFAULT_DISPLAY_REFRESH_RATE  30
+
 // Special Unicode characters, as QString data type
 #define QSTRING_MU_SYMBOL  ((QString)((QChar)0x03bc))
 #define QSTRING_OMEGA_SYMBOL  ((QString)((QChar)0x03a9))
@@ -35,15 +63,51 @@ const double RADIANS_TO_DEGREES = 57.2957795132;
 #define QSTRING_DEGREE_SYMBOL  ((QString)((QChar)0x00b0))
 #define QSTRING_PLUSMINUS_SYMBOL  ((QString)((QChar)0x00b1))
 
+// Type of the waveform samples processed by SignalProcessor (see the
+// SIGNAL_PROCESSOR_FLOAT option in the project file).  Filter coefficients are
+// always designed in double precision.
+#ifdef SIGNAL_PROCESSOR_FLOAT
+typedef float Sample;
+#else
+typedef double Sample;
+#endif
+
+// Signed amplifier ADC code (raw code - 32768) nearest to a voltage in
+// microvolts, saturated to the 16-bit range.  Used where amplifier data are
+// modified in microvolts and stored back as codes.
+inline qint16 amplifierCode(Sample microvolts)
+{
+    double code = microvolts / AMPLIFIER_MICROVOLTS_PER_BIT;
+    if (code >= 32767.0) return 32767;
+    if (code <= -32768.0) return -32768;
+    return (qint16) qRound(code);
+}
+
 // Saved data file constants
 #define DATA_FILE_MAGIC_NUMBER  0xd69127ac
 #define DATA_FILE_MAIN_VERSION_NUMBER  1
 #define DATA_FILE_SECONDARY_VERSION_NUMBER 0
 
+// Save journal (crash recovery checkpoint) file constants
+#define JOURNAL_FILE_MAGIC_NUMBER  0x4a524e4c
+#define JOURNAL_FILE_MAIN_VERSION_NUMBER  2
+#define JOURNAL_FILE_SECONDARY_VERSION_NUMBER  0
+#define JOURNAL_RECORD_MAGIC_NUMBER  0x43484b50
+
+// Data file checksum (CRC-32C sidecar) file constants
+#define CHECKSUM_FILE_MAGIC_NUMBER  0x43524343
+#define CHECKSUM_FILE_MAIN_VERSION_NUMBER  1
+#define CHECKSUM_FILE_SECONDARY_VERSION_NUMBER  0
+
+// Spike event file constants
+#define SPIKE_FILE_MAGIC_NUMBER  0x4b495053
+#define SPIKE_FILE_MAIN_VERSION_NUMBER  2
+#define SPIKE_FILE_SECONDARY_VERSION_NUMBER  0
+
 // Saved settings file constants
 #define SETTINGS_FILE_MAGIC_NUMBER  0x14cd21a3
 #define SETTINGS_FILE_MAIN_VERSION_NUMBER  1
-#define SETTINGS_FILE_SECONDARY_VERSION_NUMBER  0
+#define SETTINGS_FILE_SECONDARY_VERSION_NUMBER  1
 
 // RHS2116 chip ID numbers from ROM register 255
 #define CHIP_ID_RHS2116  32
@@ -52,7 +116,8 @@ const double RADIANS_TO_DEGREES = 57.2957795132;
 enum SaveFormat {
     SaveFormatIntan,
     SaveFormatFilePerSignalType,
-    SaveFormatFilePerChannel
+    SaveFormatFilePerChannel,
+    SaveFormatSpikeSnippets
 };
 
 #endif // GLOBALCONSTANTS_H
@@ -47,6 +47,12 @@ HelpDialogNotchFilter::HelpDialogNotchFilter(QWidget *parent) :
                                    "to the data extracted in MATLAB."));
     label1->setWordWrap(true);
 
+    QLabel *label5 = new QLabel(tr("The Harmonics setting also removes harmonics of the mains frequency (e.g., "
+                                   "120, 180, 240 Hz), which often remain after the fundamental is filtered.  "
+                                   "Data file headers note only the fundamental frequency, so harmonics are not "
+                                   "removed from data extracted in MATLAB."));
+    label5->setWordWrap(true);
+
     QLabel *label2 = new QLabel(tr("The diagram below shows a simplified signal path from the SPI interface cable "
                                    "through the Intan Stimulation / Recording Controller to the host computer running this "
                                    "software."));
@@ -63,6 +69,7 @@ HelpDialogNotchFilter::HelpDialogNotchFilter(QWidget *parent) :
 
     QVBoxLayout *mainLayout = new QVBoxLayout;
     mainLayout->addWidget(label1);
+    mainLayout->addWidget(label5);
     mainLayout->addWidget(label2);
     mainLayout->addWidget(label3);
     mainLayout->addWidget(label4);
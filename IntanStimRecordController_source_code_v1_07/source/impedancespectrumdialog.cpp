@@ -0,0 +1,206 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+#include <iostream>
+
+#include "globalconstants.h"
+#include "impedancespectrumdialog.h"
+#include "signalsources.h"
+#include "signalgroup.h"
+#include "signalchannel.h"
+#include "rhs2000datablock.h"
+
+using namespace std;
+
+// Impedance spectrum dialog.
+// This dialog shows the electrode impedance spectra from the last multi-tone
+// impedance measurement (see MainWindow::runImpedanceSpectrumMeasurement()):
+// one row per amplifier channel and one column per test frequency.  The spectra
+// can be saved to a CSV file.
+
+ImpedanceSpectrumDialog::ImpedanceSpectrumDialog(SignalSources *inSignalSources, QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle(tr("Electrode Impedance Spectrum"));
+
+    signalSources = inSignalSources;
+    numStreams = 0;
+
+    table = new QTableWidget(this);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    table->verticalHeader()->hide();
+
+    infoLabel = new QLabel();
+    saveButton = new QPushButton(tr("Save Impedance Spectra in CSV Format"));
+    saveButton->setEnabled(false);
+    connect(saveButton, SIGNAL(clicked()), this, SLOT(saveSpectra()));
+
+    QPushButton *closeButton = new QPushButton(tr("Close"));
+    connect(closeButton, SIGNAL(clicked()), this, SLOT(close()));
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(saveButton);
+    buttonLayout->addStretch(1);
+    buttonLayout->addWidget(closeButton);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout();
+    mainLayout->addWidget(infoLabel);
+    mainLayout->addWidget(table);
+    mainLayout->addLayout(buttonLayout);
+
+    setLayout(mainLayout);
+    resize(720, 480);
+}
+
+// Show the impedance spectra of all amplifier channels on the first newNumStreams
+// data streams, measured at newFrequencies (in Hz).
+void ImpedanceSpectrumDialog::setSpectra(const QVector<double> &newFrequencies, int newNumStreams)
+{
+    frequencies = newFrequencies;
+    numStreams = newNumStreams;
+
+    QVector<SignalChannel*> channels = measuredChannels();
+
+    QStringList headerLabels;
+    headerLabels << tr("Channel") << tr("Name");
+    for (int f = 0; f < frequencies.size(); ++f) {
+        headerLabels << QString::number(frequencies[f], 'f', 1) + " Hz";
+    }
+
+    table->clear();
+    table->setColumnCount(headerLabels.size());
+    table->setRowCount(channels.size());
+    table->setHorizontalHeaderLabels(headerLabels);
+
+    for (int row = 0; row < channels.size(); ++row) {
+        SignalChannel *signalChannel = channels[row];
+        table->setItem(row, 0, new QTableWidgetItem(signalChannel->nativeChannelName));
+        table->setItem(row, 1, new QTableWidgetItem(signalChannel->customChannelName));
+        for (int f = 0; f < frequencies.size(); ++f) {
+            QTableWidgetItem *item = new QTableWidgetItem(
+                        impedanceText(signalChannel->electrodeImpedanceSpectrumMagnitude[f],
+                                      signalChannel->electrodeImpedanceSpectrumPhase[f]));
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, f + 2, item);
+        }
+    }
+    table->resizeColumnsToContents();
+
+    infoLabel->setText(tr("Impedances of %1 channels measured at %2 frequencies in one pass.")
+                       .arg(channels.size()).arg(frequencies.size()));
+    saveButton->setEnabled(!channels.isEmpty());
+}
+
+// Return the amplifier channels that have a spectrum for the current frequencies.
+QVector<SignalChannel*> ImpedanceSpectrumDialog::measuredChannels() const
+{
+    QVector<SignalChannel*> channels;
+    for (int stream = 0; stream < numStreams; ++stream) {
+        for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+            SignalChannel *signalChannel = signalSources->findAmplifierChannel(stream, channel);
+            if (signalChannel &&
+                    signalChannel->electrodeImpedanceSpectrumMagnitude.size() == frequencies.size()) {
+                channels.append(signalChannel);
+            }
+        }
+    }
+    return channels;
+}
+
+// Format an impedance as it is shown on the waveform display, e.g. "12.3 kOhm <-45 deg".
+QString ImpedanceSpectrumDialog::impedanceText(double magnitude, double phase)
+{
+    QString unitPrefix;
+    int precision;
+    double scale;
+    if (magnitude >= 1.0e6) {
+        scale = 1.0e6;
+        unitPrefix = "M";
+    } else {
+        scale = 1.0e3;
+        unitPrefix = "k";
+    }
+
+    if (magnitude >= 100.0e6) {
+        precision = 0;
+    } else if (magnitude >= 10.0e6) {
+        precision = 1;
+    } else if (magnitude >= 1.0e6) {
+        precision = 2;
+    } else if (magnitude >= 100.0e3) {
+        precision = 0;
+    } else if (magnitude >= 10.0e3) {
+        precision = 1;
+    } else {
+        precision = 2;
+    }
+
+    return QString::number(magnitude / scale, 'f', precision) + " " + unitPrefix + QSTRING_OMEGA_SYMBOL +
+            " " + QSTRING_ANGLE_SYMBOL + QString::number(phase, 'f', 0) + QSTRING_DEGREE_SYMBOL;
+}
+
+// Save impedance spectra in CSV (Comma Separated Values) text file.
+void ImpedanceSpectrumDialog::saveSpectra()
+{
+    QString csvFileName = QFileDialog::getSaveFileName(this, tr("Save Impedance Spectra As"), ".",
+                                                       tr("CSV (Comma delimited) (*.csv)"));
+    if (csvFileName.isEmpty()) return;
+
+    QFile csvFile(csvFileName);
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        cerr << "Cannot open CSV file for writing: " <<
+                qPrintable(csvFile.errorString()) << endl;
+        return;
+    }
+    QTextStream out(&csvFile);
+
+    out << "Channel Number,Channel Name,Port,Enabled";
+    for (int f = 0; f < frequencies.size(); ++f) {
+        out << ",Impedance Magnitude at " << frequencies[f] << " Hz (ohms)";
+        out << ",Impedance Phase at " << frequencies[f] << " Hz (degrees)";
+    }
+    out << endl;
+
+    QVector<SignalChannel*> channels = measuredChannels();
+    for (int i = 0; i < channels.size(); ++i) {
+        SignalChannel *signalChannel = channels[i];
+        out << signalChannel->nativeChannelName << ",";
+        out << signalChannel->customChannelName << ",";
+        out << signalChannel->signalGroup->name << ",";
+        out << signalChannel->enabled;
+        for (int f = 0; f < frequencies.size(); ++f) {
+            out.setRealNumberNotation(QTextStream::ScientificNotation);
+            out.setRealNumberPrecision(2);
+            out << "," << signalChannel->electrodeImpedanceSpectrumMagnitude[f];
+
+            out.setRealNumberNotation(QTextStream::FixedNotation);
+            out.setRealNumberPrecision(0);
+            out << "," << signalChannel->electrodeImpedanceSpectrumPhase[f];
+        }
+        out << endl;
+    }
+    csvFile.close();
+}
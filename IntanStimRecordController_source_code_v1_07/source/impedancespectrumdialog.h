@@ -0,0 +1,62 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef IMPEDANCESPECTRUMDIALOG_H
+#define IMPEDANCESPECTRUMDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+class QTableWidget;
+class QPushButton;
+class QLabel;
+class SignalSources;
+class SignalChannel;
+
+class ImpedanceSpectrumDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit ImpedanceSpectrumDialog(SignalSources *inSignalSources, QWidget *parent = 0);
+
+    void setSpectra(const QVector<double> &newFrequencies, int newNumStreams);
+
+signals:
+
+public slots:
+
+private slots:
+    void saveSpectra();
+
+private:
+    SignalSources *signalSources;
+    QVector<double> frequencies;
+    int numStreams;
+
+    QTableWidget *table;
+    QPushButton *saveButton;
+    QLabel *infoLabel;
+
+    QVector<SignalChannel*> measuredChannels() const;
+    static QString impedanceText(double magnitude, double phase);
+};
+
+#endif // IMPEDANCESPECTRUMDIALOG_H
@@ -0,0 +1,312 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <QtGlobal>
+#include <cmath>
+#include <cstring>
+
+#include "linenoisecanceller.h"
+#include "samplevector.h"
+
+using namespace std;
+
+// For each frame t, with u the reference components and x a channel's sample,
+// each lane computes
+//
+//   e = x - sum_k w[k] * u[k]          (output sample)
+//   w[k] += mu / (delta + |u|^2) * e * u[k]
+//
+// The normalized step size mu / (delta + |u|^2) depends only on the reference,
+// so it is computed once per frame in prepareReference().  The step size mu
+// is set from an adaptation time constant: the synthesized reference has
+// 2 * numHarmonics equal-power components, and a delay line spanning one
+// period of a mains waveform is dominated by the two (equal-power, orthogonal)
+// components of its fundamental, so the
+// weights converge with a time constant of about numComponents / mu and
+// 2 / mu samples, respectively.
+
+// All per-lane weight arrays are aligned to a cache line.
+static const int WeightAlignment = 64;
+
+// Regularization of the normalized step size, relative to the reference power
+// (in volts squared for an ADC reference).
+static const double PowerFloor = 1.0e-12;
+
+// Corner frequency of the DC-blocking filter applied to an ADC reference, in Hz.
+static const double AdcHighpassFrequency = 1.0;
+
+// Scalar kernel for lanes [firstLane, lastLane).
+static void cancelScalar(Sample *data, int numFrames, int numLanes, int firstLane, int lastLane,
+                         const Sample *reference, const Sample *step, int numComponents, Sample *weights)
+{
+    for (int lane = firstLane; lane < lastLane; ++lane) {
+        Sample w[LineNoiseCanceller::MaxComponents];
+        for (int k = 0; k < numComponents; ++k) {
+            w[k] = weights[k * numLanes + lane];
+        }
+
+        Sample *p = data + lane;
+        const Sample *u = reference;
+        for (int t = 0; t < numFrames; ++t) {
+            Sample y = 0;
+            for (int k = 0; k < numComponents; ++k) {
+                y += w[k] * u[k];
+            }
+            Sample e = *p - y;
+            *p = e;
+            Sample g = step[t] * e;
+            for (int k = 0; k < numComponents; ++k) {
+                w[k] += g * u[k];
+            }
+            p += numLanes;
+            u += numComponents;
+        }
+
+        for (int k = 0; k < numComponents; ++k) {
+            weights[k * numLanes + lane] = w[k];
+        }
+    }
+}
+
+#ifdef SAMPLE_VECTOR_SIMD
+// Vector kernel for lanes [firstLane, lastLane).  Returns the first lane not
+// processed, which is lastLane unless the range is not a multiple of the vector width.
+static int cancelVector(Sample *data, int numFrames, int numLanes, int firstLane, int lastLane,
+                        const Sample *reference, const Sample *step, int numComponents, Sample *weights)
+{
+    typedef SampleVector Vec;
+    typedef Vec::V V;
+    const int Width = Vec::Width;
+    const V zero = Vec::set1(0);
+
+    int lane = firstLane;
+    for (; lane + Width <= lastLane; lane += Width) {
+        V w[LineNoiseCanceller::MaxComponents];
+        for (int k = 0; k < numComponents; ++k) {
+            w[k] = Vec::loadu(weights + k * numLanes + lane);
+        }
+
+        Sample *p = data + lane;
+        const Sample *u = reference;
+        for (int t = 0; t < numFrames; ++t) {
+            V y = zero;
+            for (int k = 0; k < numComponents; ++k) {
+                y = Vec::add(y, Vec::mul(w[k], Vec::set1(u[k])));
+            }
+            V e = Vec::sub(Vec::loadu(p), y);
+            Vec::storeu(p, e);
+            V g = Vec::mul(Vec::set1(step[t]), e);
+            for (int k = 0; k < numComponents; ++k) {
+                w[k] = Vec::add(w[k], Vec::mul(g, Vec::set1(u[k])));
+            }
+            p += numLanes;
+            u += numComponents;
+        }
+
+        for (int k = 0; k < numComponents; ++k) {
+            Vec::storeu(weights + k * numLanes + lane, w[k]);
+        }
+    }
+    return lane;
+}
+#endif
+
+// Constructor.
+LineNoiseCanceller::LineNoiseCanceller()
+{
+    reference = ReferenceOff;
+    lineFrequency = 60.0;
+    numHarmonics = 1;
+    adcChannel = 0;
+    numTaps = 1;
+    sampleRate = 30000.0;
+    stepSize = 0.0;
+    numComponents = 0;
+    numLanes = 0;
+    weights = nullptr;
+    phase = 0.0;
+    tapSpacing = 1;
+    adcHistoryIndex = 0;
+    adcLastInput = 0.0;
+    adcLastOutput = 0.0;
+    dcBlockCoefficient = 1.0;
+}
+
+LineNoiseCanceller::~LineNoiseCanceller()
+{
+    qFreeAligned(weights);
+}
+
+// Allocate weights for numLanes_ interleaved channels and reference buffers
+// for blocks of up to maxSamples frames, and reset the weights to zero.
+void LineNoiseCanceller::setNumLanes(int numLanes_, int maxSamples)
+{
+    numLanes = numLanes_;
+    qFreeAligned(weights);
+    weights = static_cast<Sample*>(qMallocAligned(MaxComponents * qMax(numLanes, 1) * sizeof(Sample),
+                                                  WeightAlignment));
+    referenceBlock.resize(MaxComponents * maxSamples);
+    stepBlock.resize(maxSamples);
+    resetState();
+}
+
+// Set the reference and adaptation parameters.  The synthesized reference has
+// a cosine and a sine at lineFrequency_ (in Hz) and each of its next
+// numHarmonics_ - 1 harmonics below the Nyquist frequency; the ADC reference
+// is numTaps_ samples of board ADC channel adcChannel_ (0-7), evenly spaced
+// over the last period of lineFrequency_.  Weights
+// adapt with a time constant of about timeConstant seconds.  The weights are
+// kept if only the frequency or time constant changes, and reset otherwise.
+void LineNoiseCanceller::setParameters(Reference reference_, double lineFrequency_, int numHarmonics_,
+                                       int adcChannel_, int numTaps_, double timeConstant, double sampleRate_)
+{
+    int newNumComponents = 0;
+    if (reference_ == ReferenceSynthesized) {
+        numHarmonics_ = qBound(1, numHarmonics_, MaxComponents / 2);
+        while (numHarmonics_ > 1 && numHarmonics_ * lineFrequency_ >= sampleRate_ / 2.0) {
+            --numHarmonics_;
+        }
+        newNumComponents = 2 * numHarmonics_;
+    } else if (reference_ == ReferenceBoardAdc) {
+        numTaps_ = qBound(1, numTaps_, (int) MaxComponents);
+        newNumComponents = numTaps_;
+    }
+    int newTapSpacing = qMax(1, qRound(sampleRate_ / (lineFrequency_ * numTaps_)));
+
+    bool structureChanged = (reference_ != reference) || (newNumComponents != numComponents) ||
+            (sampleRate_ != sampleRate) ||
+            (reference_ == ReferenceBoardAdc && (adcChannel_ != adcChannel || newTapSpacing != tapSpacing));
+
+    reference = reference_;
+    lineFrequency = lineFrequency_;
+    numHarmonics = numHarmonics_;
+    adcChannel = adcChannel_;
+    numTaps = numTaps_;
+    tapSpacing = newTapSpacing;
+    sampleRate = sampleRate_;
+    numComponents = newNumComponents;
+
+    double effectiveRank = (reference == ReferenceSynthesized) ? numComponents : 2.0;
+    stepSize = qMin(1.0, effectiveRank / qMax(1.0, timeConstant * sampleRate));
+    dcBlockCoefficient = exp(-2.0 * PI * AdcHighpassFrequency / sampleRate);
+
+    if (structureChanged) {
+        resetState();
+    }
+}
+
+// Reset all weights to zero and clear the reference history.
+void LineNoiseCanceller::resetState()
+{
+    if (weights) {
+        memset(weights, 0, MaxComponents * numLanes * sizeof(Sample));
+    }
+    phase = 0.0;
+    adcHistory.fill(0.0, (numTaps - 1) * tapSpacing + 1);
+    adcHistoryIndex = 0;
+    adcLastInput = 0.0;
+    adcLastOutput = 0.0;
+}
+
+LineNoiseCanceller::Reference LineNoiseCanceller::getReference() const
+{
+    return reference;
+}
+
+// Board ADC channel (0-7) used by an ADC reference.
+int LineNoiseCanceller::getAdcChannel() const
+{
+    return adcChannel;
+}
+
+// Compute the reference components and normalized step size for each of the
+// next numFrames frames.  adcData holds the ADC reference channel's samples
+// for these frames (in volts), and is ignored by a synthesized reference.
+// Must be called once per block, before apply() is called on any lanes.
+void LineNoiseCanceller::prepareReference(const Sample *adcData, int numFrames)
+{
+    if (reference == ReferenceOff) return;
+
+    Sample *u = referenceBlock.data();
+    if (reference == ReferenceSynthesized) {
+        // Harmonics are generated from the fundamental by the angle-addition
+        // formulas; the fundamental itself is recomputed each frame from a
+        // phase accumulator, so rounding errors do not build up.
+        const double phaseStep = lineFrequency / sampleRate;
+        const Sample step = (Sample) (stepSize / numHarmonics);
+        for (int t = 0; t < numFrames; ++t) {
+            double c1 = cos(2.0 * PI * phase);
+            double s1 = sin(2.0 * PI * phase);
+            double c = c1, s = s1;
+            for (int h = 0; h < numHarmonics; ++h) {
+                u[2 * h] = (Sample) c;
+                u[2 * h + 1] = (Sample) s;
+                double cNext = c * c1 - s * s1;
+                s = s * c1 + c * s1;
+                c = cNext;
+            }
+            stepBlock[t] = step;
+            u += numComponents;
+            phase += phaseStep;
+            phase -= floor(phase);
+        }
+    } else {
+        // A DC offset on the ADC input would be removed from every channel, so
+        // the reference is first passed through a DC-blocking filter.
+        double *history = adcHistory.data();
+        const int historyLength = adcHistory.size();
+        for (int t = 0; t < numFrames; ++t) {
+            double x = adcData[t];
+            adcLastOutput = x - adcLastInput + dcBlockCoefficient * adcLastOutput;
+            adcLastInput = x;
+            if (++adcHistoryIndex == historyLength) adcHistoryIndex = 0;
+            history[adcHistoryIndex] = adcLastOutput;
+
+            double power = 0.0;
+            int index = adcHistoryIndex;
+            for (int k = 0; k < numTaps; ++k) {
+                u[k] = (Sample) history[index];
+                power += history[index] * history[index];
+                index -= tapSpacing;
+                if (index < 0) index += historyLength;
+            }
+            stepBlock[t] = (power > 0.0) ? (Sample) (stepSize / (PowerFloor + power)) : 0;
+            u += numComponents;
+        }
+    }
+}
+
+// Cancel line noise in numFrames frames of lanes [firstLane, lastLane), using
+// the reference from the last call to prepareReference().  Different threads
+// may process disjoint lane ranges at the same time.
+void LineNoiseCanceller::apply(Sample *data, int numFrames, int firstLane, int lastLane)
+{
+    if (reference == ReferenceOff) return;
+
+    int lane = firstLane;
+#ifdef SAMPLE_VECTOR_SIMD
+    lane = cancelVector(data, numFrames, numLanes, firstLane, lastLane,
+                        referenceBlock.constData(), stepBlock.constData(), numComponents, weights);
+#endif
+    cancelScalar(data, numFrames, numLanes, lane, lastLane,
+                 referenceBlock.constData(), stepBlock.constData(), numComponents, weights);
+}
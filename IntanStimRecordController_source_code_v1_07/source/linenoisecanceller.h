@@ -0,0 +1,103 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef LINENOISECANCELLER_H
+#define LINENOISECANCELLER_H
+
+#include <QVector>
+
+#include "globalconstants.h"
+
+// Adaptive cancellation of mains interference in amplifier data.
+//
+// Each channel subtracts a weighted sum of a few reference components, with
+// its own weights adapted by the normalized least-mean-squares (NLMS)
+// algorithm to minimize the channel's output power.  Only interference that
+// is correlated with the reference is removed, so the canceller follows
+// drifts in the phase and amplitude (and, within its adaptation bandwidth,
+// the frequency) of the mains without notching a fixed band.
+//
+// The reference is either synthesized (a cosine and sine at the nominal mains
+// frequency and each of its harmonics) or taken from a board ADC input wired
+// to a mains pickup, as a tapped delay line of its recent samples.  The taps
+// are spread evenly over one mains period, so that the in-phase and quadrature
+// parts of the interference are equally well represented.  The
+// reference is the same for every channel, so it is prepared once per data
+// block; the per-channel filtering and weight updates are then done for many
+// channels at once with SIMD vectors.
+//
+// Works in place on time-major data (sample t of lane i at data[t * numLanes + i],
+// the layout of SignalProcessor::amplifierPreFilterFast).
+class LineNoiseCanceller
+{
+public:
+    enum Reference {
+        ReferenceOff,
+        ReferenceSynthesized,
+        ReferenceBoardAdc
+    };
+
+    // Largest number of reference components (taps, or two per harmonic)
+    static const int MaxComponents = 16;
+
+    LineNoiseCanceller();
+    ~LineNoiseCanceller();
+
+    void setNumLanes(int numLanes_, int maxSamples);
+    void setParameters(Reference reference_, double lineFrequency_, int numHarmonics_,
+                       int adcChannel_, int numTaps_, double timeConstant, double sampleRate_);
+    void resetState();
+    Reference getReference() const;
+    int getAdcChannel() const;
+
+    void prepareReference(const Sample *adcData, int numFrames);
+    void apply(Sample *data, int numFrames, int firstLane, int lastLane);
+
+private:
+    Reference reference;
+    double lineFrequency;
+    int numHarmonics;
+    int adcChannel;
+    int numTaps;
+    double sampleRate;
+    double stepSize;
+    int numComponents;
+    int numLanes;
+
+    // Per-lane weights, at weights[k * numLanes + lane] for reference component k.
+    Sample *weights;
+
+    // Reference components and normalized step size for each frame of the
+    // current block, at referenceBlock[t * numComponents + k] and stepBlock[t].
+    QVector<Sample> referenceBlock;
+    QVector<Sample> stepBlock;
+
+    double phase;               // phase of the synthesized fundamental, in cycles
+    int tapSpacing;             // samples between ADC reference taps
+    QVector<double> adcHistory; // high-passed ADC samples, as a circular buffer
+    int adcHistoryIndex;        // position of the newest sample in adcHistory
+    double adcLastInput;        // DC-blocking filter state
+    double adcLastOutput;
+    double dcBlockCoefficient;
+};
+
+#endif // LINENOISECANCELLER_H
@@ -0,0 +1,130 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "linenoisedialog.h"
+
+// Adaptive line noise cancellation dialog.
+// This dialog allows users to subtract the part of each amplifier channel that
+// is correlated with a mains reference, either synthesized at the mains
+// frequency and its harmonics or recorded on a board ADC input.
+
+LineNoiseDialog::LineNoiseDialog(const LineNoiseSettings &settings, QWidget *parent) :
+    QDialog(parent)
+{
+    referenceComboBox = new QComboBox();
+    referenceComboBox->addItem(tr("Off"));
+    referenceComboBox->addItem(tr("Synthesized mains reference"));
+    referenceComboBox->addItem(tr("Board ADC input"));
+    referenceComboBox->setCurrentIndex(settings.reference);
+
+    frequencySpinBox = new QDoubleSpinBox();
+    frequencySpinBox->setRange(40.0, 70.0);
+    frequencySpinBox->setDecimals(2);
+    frequencySpinBox->setSingleStep(0.1);
+    frequencySpinBox->setSuffix(" Hz");
+    frequencySpinBox->setValue(settings.lineFrequency);
+
+    harmonicsSpinBox = new QSpinBox();
+    harmonicsSpinBox->setRange(1, LineNoiseCanceller::MaxComponents / 2);
+    harmonicsSpinBox->setValue(settings.numHarmonics);
+
+    adcChannelComboBox = new QComboBox();
+    for (int i = 1; i <= 8; ++i) {
+        adcChannelComboBox->addItem(tr("ANALOG-IN-%1").arg(i));
+    }
+    adcChannelComboBox->setCurrentIndex(settings.adcChannel);
+
+    tapsSpinBox = new QSpinBox();
+    tapsSpinBox->setRange(2, LineNoiseCanceller::MaxComponents);
+    tapsSpinBox->setValue(settings.numTaps);
+
+    timeConstantSpinBox = new QDoubleSpinBox();
+    timeConstantSpinBox->setRange(10.0, 10000.0);
+    timeConstantSpinBox->setDecimals(0);
+    timeConstantSpinBox->setSingleStep(50.0);
+    timeConstantSpinBox->setSuffix(" ms");
+    timeConstantSpinBox->setValue(settings.timeConstantMsec);
+
+    connect(referenceComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateControls()));
+
+    QFormLayout *formLayout = new QFormLayout();
+    formLayout->addRow(tr("Reference"), referenceComboBox);
+    formLayout->addRow(tr("Mains frequency"), frequencySpinBox);
+    formLayout->addRow(tr("Harmonics (synthesized)"), harmonicsSpinBox);
+    formLayout->addRow(tr("Reference input"), adcChannelComboBox);
+    formLayout->addRow(tr("Taps per mains period"), tapsSpinBox);
+    formLayout->addRow(tr("Adaptation time constant"), timeConstantSpinBox);
+
+    QLabel *noteLabel = new QLabel(tr("Line noise cancellation is applied to all amplifier channels after "
+                                      "artifact suppression and re-referencing, and before the notch filter.  "
+                                      "Each channel learns how much of the reference to subtract, so drifts in "
+                                      "the phase and frequency of mains interference are followed.  A shorter "
+                                      "time constant follows faster drifts but removes more signal near the "
+                                      "mains frequency.  An ADC reference should be a pickup of the mains "
+                                      "waveform containing no neural signal.  Saved data are not affected."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Adaptive Line Noise Cancellation"));
+
+    updateControls();
+}
+
+// Enable the controls that apply to the selected reference.
+void LineNoiseDialog::updateControls()
+{
+    LineNoiseCanceller::Reference reference = (LineNoiseCanceller::Reference) referenceComboBox->currentIndex();
+
+    frequencySpinBox->setEnabled(reference != LineNoiseCanceller::ReferenceOff);
+    harmonicsSpinBox->setEnabled(reference == LineNoiseCanceller::ReferenceSynthesized);
+    adcChannelComboBox->setEnabled(reference == LineNoiseCanceller::ReferenceBoardAdc);
+    tapsSpinBox->setEnabled(reference == LineNoiseCanceller::ReferenceBoardAdc);
+    timeConstantSpinBox->setEnabled(reference != LineNoiseCanceller::ReferenceOff);
+}
+
+LineNoiseSettings LineNoiseDialog::getSettings() const
+{
+    LineNoiseSettings settings;
+    settings.reference = (LineNoiseCanceller::Reference) referenceComboBox->currentIndex();
+    settings.lineFrequency = frequencySpinBox->value();
+    settings.numHarmonics = harmonicsSpinBox->value();
+    settings.adcChannel = adcChannelComboBox->currentIndex();
+    settings.numTaps = tapsSpinBox->value();
+    settings.timeConstantMsec = timeConstantSpinBox->value();
+    return settings;
+}
@@ -0,0 +1,72 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef LINENOISEDIALOG_H
+#define LINENOISEDIALOG_H
+
+#include <QDialog>
+
+#include "linenoisecanceller.h"
+
+class QDialogButtonBox;
+class QComboBox;
+class QSpinBox;
+class QDoubleSpinBox;
+
+// Adaptive line noise cancellation settings, with the adaptation time constant
+// in milliseconds so it is independent of the sample rate.
+struct LineNoiseSettings
+{
+    LineNoiseCanceller::Reference reference;
+    double lineFrequency;
+    int numHarmonics;
+    int adcChannel;
+    int numTaps;
+    double timeConstantMsec;
+};
+
+class LineNoiseDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit LineNoiseDialog(const LineNoiseSettings &settings, QWidget *parent);
+
+    LineNoiseSettings getSettings() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateControls();
+
+private:
+    QComboBox *referenceComboBox;
+    QDoubleSpinBox *frequencySpinBox;
+    QSpinBox *harmonicsSpinBox;
+    QComboBox *adcChannelComboBox;
+    QSpinBox *tapsSpinBox;
+    QDoubleSpinBox *timeConstantSpinBox;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // LINENOISEDIALOG_H
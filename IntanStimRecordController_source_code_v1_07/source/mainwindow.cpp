@@ -38,6 +38,7 @@
 #include "mainwindow.h"
 #include "globalconstants.h"
 #include "signalprocessor.h"
+#include "multichannelnotch.h"
 #include "waveplot.h"
 #include "usbdatathread.h"
 #include "datastreamfifo.h"
@@ -57,6 +58,10 @@
 #include "helpdialogreference.h"
 #include "helpdialogioexpander.h"
 #include "spikescopedialog.h"
+#include "spectrumdialog.h"
+#include "correlationdialog.h"
+#include "signalqualitydialog.h"
+#include "impedancespectrumdialog.h"
 #include "triggerrecorddialog.h"
 #include "setsaveformatdialog.h"
 #include "cabledelaydialog.h"
@@ -70,6 +75,10 @@
 #include "anoutdialog.h"
 #include "ampsettledialog.h"
 #include "chargerecoverydialog.h"
+#include "savejournal.h"
+#include "checksummedfile.h"
+#include "spikeeventfile.h"
+#include "filterbankdialog.h"
 
 // Main Window of RHS2000 USB interface application.
 
@@ -146,6 +155,10 @@ MainWindow::MainWindow(int sampleRateIndex_, int stimStepIndex)
 
     // Set dialog pointers to null.
     spikeScopeDialog = nullptr;
+    spectrumDialog = nullptr;
+    correlationDialog = nullptr;
+    signalQualityDialog = nullptr;
+    impedanceSpectrumDialog = nullptr;
     stimParamDialog = nullptr;
     digOutDialog = nullptr;
     anOutDialog = nullptr;
@@ -167,20 +180,86 @@ MainWindow::MainWindow(int sampleRateIndex_, int stimStepIndex)
 
     signalSources = new SignalSources(numSpiPorts);
 
-    channelVisible.resize(MAX_NUM_DATA_STREAMS);
-    for (int i = 0; i < MAX_NUM_DATA_STREAMS; ++i) {
-        channelVisible[i].resize(CHANNELS_PER_STREAM);
-        channelVisible[i].fill(false);
-    }
-
     signalProcessor = new SignalProcessor();
     notchFilterFrequency = 60.0;
     notchFilterBandwidth = 10.0;
     notchFilterEnabled = false;
+    notchFilterHarmonics = 1;
     signalProcessor->setNotchFilterEnabled(notchFilterEnabled);
     highpassFilterFrequency = 250.0;
     highpassFilterEnabled = false;
     signalProcessor->setHighpassFilterEnabled(highpassFilterEnabled);
+    filterBankDisplayBand = -1;
+    spatialReferenceSettings.montage = MontageOff;
+    spatialReferenceSettings.grouping = GroupByHeadstage;
+    spatialReferenceSettings.numNeighbors = 4;
+    artifactSettings.mode = ArtifactSuppressor::ArtifactOff;
+    artifactSettings.scope = ArtifactSuppressor::TriggerChannel;
+    artifactSettings.tailMsec = 1.0;
+    artifactSettings.templateMsec = 3.0;
+    artifactSettings.numAveraged = 16;
+    lineNoiseSettings.reference = LineNoiseCanceller::ReferenceOff;
+    lineNoiseSettings.lineFrequency = 60.0;
+    lineNoiseSettings.numHarmonics = 3;
+    lineNoiseSettings.adcChannel = 0;
+    lineNoiseSettings.numTaps = 8;
+    lineNoiseSettings.timeConstantMsec = 200.0;
+    spikeDetectionSettings.enabled = false;
+    spikeDetectionSettings.polarity = SpikeDetector::DetectNegative;
+    spikeDetectionSettings.thresholdMultiplier = 4.5;
+    spikeDetectionSettings.noiseTimeConstantSec = 2.0;
+    spikeDetectionSettings.refractoryMsec = 1.0;
+    spikeDetectionSettings.peakWindowMsec = 0.5;
+    spikeDetectionSettings.sortSpikes = false;
+    spikeDetectionSettings.maxClusters = 4;
+    spikeDetectionSettings.saveEvents = true;
+    spikeDetectionSettings.saveSnippets = true;
+    spikeDetectionSettings.preMsec = 0.5;
+    spikeDetectionSettings.postMsec = 1.5;
+    bandPowerSettings.enabled = false;
+    bandPowerSettings.lowCutoff = 150.0;
+    bandPowerSettings.highCutoff = 250.0;
+    bandPowerSettings.order = 2;
+    bandPowerSettings.smoothingMsec = 8.0;
+    bandPowerSettings.baselineTimeConstantSec = 10.0;
+    bandPowerSettings.onThreshold = 3.0;
+    bandPowerSettings.offThreshold = 1.0;
+    bandPowerSettings.minChannels = 1;
+    bandPowerSettings.minDurationMsec = 5.0;
+    bandPowerSettings.refractoryMsec = 100.0;
+    bandPowerSettings.triggerEnabled = false;
+    bandPowerSettings.trigger = 0;
+    bandPowerEventCount = 0;
+    bandPowerTriggerOn = false;
+    phaseTrackingSettings.enabled = false;
+    phaseTrackingSettings.lowCutoff = 6.0;
+    phaseTrackingSettings.highCutoff = 10.0;
+    phaseTrackingSettings.targetPhaseDeg = 0.0;
+    phaseTrackingSettings.outputLatencyMsec = 1.0;
+    phaseTrackingSettings.minIntervalMsec = 0.0;
+    phaseTrackingSettings.trigger = 0;
+    phaseClockTimestamp = 0.0;
+    phaseTriggerTimestamp = 0.0;
+    lastPhaseStimTimestamp = 0.0;
+    phaseTriggerOn = false;
+    phaseTriggerTimer = new QTimer(this);
+    phaseTriggerTimer->setSingleShot(true);
+    phaseTriggerTimer->setTimerType(Qt::PreciseTimer);
+    connect(phaseTriggerTimer, SIGNAL(timeout()), this, SLOT(firePhaseTrigger()));
+    syntheticDataSettings.numStreams = 1;
+    syntheticDataSettings.noiseRms = 2.4;
+    syntheticDataSettings.spikeRateScale = 1.0;
+    syntheticDataSettings.lfpAmplitude = 0.0;
+    syntheticDataSettings.lfpFrequency = 8.0;
+    syntheticDataSettings.lineNoiseAmplitude = 0.0;
+    syntheticDataSettings.lineFrequency = 60.0;
+    syntheticDataSettings.artifactAmplitude = 1000.0;
+    syntheticDataSettings.artifactRate = 0.0;
+    applySyntheticData();
+    spikeEventFile = nullptr;
+    phaseLogFile = nullptr;
+    phaseLogStream = nullptr;
+    saveFormat = SaveFormatIntan;   // used by applySpikeDetection() before the default format is set below
 
     running = false;
     recording = false;
@@ -238,6 +317,12 @@ MainWindow::MainWindow(int sampleRateIndex_, int stimStepIndex)
     setSaveFormat(SaveFormatIntan);
     newSaveFilePeriodMinutes = 1;
 
+    // Default crash recovery journal settings.
+    saveJournalEnabled = true;
+    checkpointPeriodSeconds = 5;
+    saveJournal = nullptr;
+    saveChecksums = false;
+
     // Default settings for display scale combo boxes.
     yScaleComboBox->setCurrentIndex(3);
     yScaleDcAmpComboBox->setCurrentIndex(3);
@@ -306,6 +391,19 @@ void MainWindow::scanPorts()
                           "(Demonstration Mode with Synthesized Biopotentials)"));
     }
 
+    // Channel lanes have changed, so rebuild any spatial re-referencing montage.
+    if (spatialReferenceSettings.montage != MontageOff) {
+        QString errorMessage;
+        if (!applySpatialReference(spatialReferenceSettings, errorMessage)) {
+            spatialReferenceSettings.montage = MontageOff;
+            signalProcessor->setSpatialReferenceOff();
+            spatialRefLabel->setText(tr("Spatial re-referencing off"));
+            QMessageBox::warning(this, tr("Spatial Re-Referencing Turned Off"),
+                                 tr("The spatial re-referencing montage no longer matches the connected "
+                                    "headstages: ") + errorMessage);
+        }
+    }
+
     // Turn on appropriate (optional) LEDs for Ports A-D
     if (!synthMode) {
         int ledArray[8] = {0, 0, 0, 0, 0, 0, 0, 0};
@@ -369,11 +467,20 @@ void MainWindow::createLayout()
     setSaveFormatButton = new QPushButton(tr("Select File Format"));
 
     changeBandwidthButton = new QPushButton(tr("Change Bandwidth"));
+    filterBankButton = new QPushButton(tr("Filter Bank..."));
+    artifactButton = new QPushButton(tr("Artifact Suppression..."));
+    lineNoiseButton = new QPushButton(tr("Line Noise Cancellation..."));
+    spikeDetectionButton = new QPushButton(tr("Spike Detection..."));
+    bandPowerButton = new QPushButton(tr("Band Power Events..."));
+    phaseTrackingButton = new QPushButton(tr("Phase-Locked Stimulation..."));
     renameChannelButton = new QPushButton(tr("Rename Channel"));
     enableChannelButton = new QPushButton(tr("Enable/Disable (Space)"));
     enableAllButton = new QPushButton(tr("Enable All on Port"));
     disableAllButton = new QPushButton(tr("Disable All on Port"));
     spikeScopeButton = new QPushButton(tr("Spike Scope"));
+    spectrumButton = new QPushButton(tr("Spectrum"));
+    correlationButton = new QPushButton(tr("Correlation"));
+    signalQualityButton = new QPushButton(tr("Signal Quality"));
 
     helpDialogChipFiltersButton = new QToolButton();
     helpDialogChipFiltersButton->setText(tr("?"));
@@ -463,6 +570,9 @@ void MainWindow::createLayout()
     connect(refSelectButton, SIGNAL(clicked()), this, SLOT(referenceSetSelectedChannel()));
     connect(refHardwareRefButton, SIGNAL(clicked()), this, SLOT(referenceSetHardware()));
 
+    spatialRefButton = new QPushButton(tr("Spatial Re-Referencing..."));
+    connect(spatialRefButton, SIGNAL(clicked()), this, SLOT(spatialReferenceDialog()));
+    spatialRefLabel = new QLabel(tr("Spatial re-referencing off"));
 
     refTypeLabel = new QLabel(tr("Hardware Reference:"));
     refChannelLabel = new QLabel(tr("REF input on headstages"));
@@ -477,6 +587,8 @@ void MainWindow::createLayout()
     referenceLayout->addWidget(refChannelLabel);
     referenceLayout->addWidget(refHardwareRefButton);
     referenceLayout->addLayout(refButtonLayout1);
+    referenceLayout->addWidget(spatialRefButton);
+    referenceLayout->addWidget(spatialRefLabel);
     referenceLayout->addStretch(1);
     referenceGroupBox->setLayout(referenceLayout);
 
@@ -605,12 +717,25 @@ void MainWindow::createLayout()
     notchFilterComboBox->addItem("60 Hz");
     notchFilterComboBox->setCurrentIndex(0);
 
+    // Number of mains harmonics removed by the notch filter (1 = fundamental only).
+    notchFilterHarmonicsSpinBox = new QSpinBox();
+    notchFilterHarmonicsSpinBox->setRange(1, MultiChannelNotch::MaxHarmonics);
+    notchFilterHarmonicsSpinBox->setValue(notchFilterHarmonics);
+    notchFilterHarmonicsSpinBox->setToolTip(tr("Number of mains harmonics removed, including the fundamental"));
+    notchFilterHarmonicsSpinBox->setEnabled(false);
+
     connect(runButton, SIGNAL(clicked()), this, SLOT(runInterfaceBoard()));
     connect(stopButton, SIGNAL(clicked()), this, SLOT(stopInterfaceBoard()));
     connect(recordButton, SIGNAL(clicked()), this, SLOT(recordInterfaceBoard()));
     connect(triggerButton, SIGNAL(clicked()), this, SLOT(triggerRecordInterfaceBoard()));
     connect(baseFilenameButton, SIGNAL(clicked()), this, SLOT(selectBaseFilenameSlot()));
     connect(changeBandwidthButton, SIGNAL(clicked()), this, SLOT(changeBandwidth()));
+    connect(filterBankButton, SIGNAL(clicked()), this, SLOT(filterBankDialog()));
+    connect(artifactButton, SIGNAL(clicked()), this, SLOT(artifactDialog()));
+    connect(lineNoiseButton, SIGNAL(clicked()), this, SLOT(lineNoiseDialog()));
+    connect(spikeDetectionButton, SIGNAL(clicked()), this, SLOT(spikeDetectionDialog()));
+    connect(bandPowerButton, SIGNAL(clicked()), this, SLOT(bandPowerDialog()));
+    connect(phaseTrackingButton, SIGNAL(clicked()), this, SLOT(phaseTrackingDialog()));
     connect(renameChannelButton, SIGNAL(clicked()), this, SLOT(renameChannel()));
     connect(enableChannelButton, SIGNAL(clicked()), this, SLOT(toggleChannelEnable()));
     connect(enableAllButton, SIGNAL(clicked()), this, SLOT(enableAllChannels()));
@@ -631,6 +756,8 @@ void MainWindow::createLayout()
             this, SLOT(changeAmpType(int)));
     connect(notchFilterComboBox, SIGNAL(currentIndexChanged(int)),
             this, SLOT(changeNotchFilter(int)));
+    connect(notchFilterHarmonicsSpinBox, SIGNAL(valueChanged(int)),
+            this, SLOT(changeNotchFilterHarmonics(int)));
     connect(displayButtonGroup, SIGNAL(buttonClicked(int)),
             this, SLOT(changePort(int)));
 
@@ -664,6 +791,17 @@ void MainWindow::createLayout()
     bufferFullLabel->setStyleSheet("color: black");
     bufferFullLabel->setFixedWidth(fontMetrics().width("99%"));
 
+    filterTimeLabel = new QLabel(tr("0.0 ms"));
+    filterTimeLabel->setStyleSheet("color: black");
+    filterTimeLabel->setFixedWidth(fontMetrics().width("999.9 ms"));
+    filterTimeLabel->setToolTip(tr("Time taken to filter each batch of amplifier data (") +
+                                QString::number(signalProcessor->getNumFilterThreads()) + tr(" threads)"));
+
+    displayFramesLabel = new QLabel(tr("0 / 0"));
+    displayFramesLabel->setStyleSheet("color: black");
+    displayFramesLabel->setFixedWidth(fontMetrics().width("9999 / 9999"));
+    displayFramesLabel->setToolTip(tr("Display refreshes that were late / skipped during this run"));
+
     cpuWarningLabel = new QLabel("CPU limit");
     cpuWarningLabel->setStyleSheet("color: red");
     cpuWarningLabel->hide();
@@ -677,6 +815,10 @@ void MainWindow::createLayout()
     runStopLayout->addWidget(fifoFullLabel);
     runStopLayout->addWidget(new QLabel(tr("SW buffer:")));
     runStopLayout->addWidget(bufferFullLabel);
+    runStopLayout->addWidget(new QLabel(tr("Filter:")));
+    runStopLayout->addWidget(filterTimeLabel);
+    runStopLayout->addWidget(new QLabel(tr("Display:")));
+    runStopLayout->addWidget(displayFramesLabel);
 
     QHBoxLayout *recordLayout = new QHBoxLayout;
     recordLayout->addWidget(recordButton);
@@ -727,6 +869,12 @@ void MainWindow::createLayout()
 
     connect(spikeScopeButton, SIGNAL(clicked()),
             this, SLOT(spikeScope()));
+    connect(spectrumButton, SIGNAL(clicked()),
+            this, SLOT(spectrum()));
+    connect(correlationButton, SIGNAL(clicked()),
+            this, SLOT(correlation()));
+    connect(signalQualityButton, SIGNAL(clicked()),
+            this, SLOT(signalQuality()));
 
     QHBoxLayout *scaleLayout = new QHBoxLayout();
     scaleLayout->addWidget(new QLabel(tr("Time Scale (</>)")));
@@ -736,6 +884,9 @@ void MainWindow::createLayout()
     scaleLayout->addWidget(numFramesComboBox);
     scaleLayout->addStretch(1);
     scaleLayout->addWidget(spikeScopeButton);
+    scaleLayout->addWidget(spectrumButton);
+    scaleLayout->addWidget(correlationButton);
+    scaleLayout->addWidget(signalQualityButton);
 
     QVBoxLayout *displayOrderLayout = new QVBoxLayout();
     displayOrderLayout->addLayout(numWaveformsLayout);
@@ -772,6 +923,15 @@ void MainWindow::createLayout()
     connect(showImpedanceCheckBox, SIGNAL(clicked(bool)),
             this, SLOT(showImpedances(bool)));
 
+    runImpedanceSpectrumButton = new QPushButton(tr("Run Impedance Spectrum Measurement"));
+    connect(runImpedanceSpectrumButton, SIGNAL(clicked()),
+            this, SLOT(runImpedanceSpectrumMeasurement()));
+
+    showImpedanceSpectrumButton = new QPushButton(tr("Show Last Impedance Spectrum"));
+    showImpedanceSpectrumButton->setEnabled(false);
+    connect(showImpedanceSpectrumButton, SIGNAL(clicked()),
+            this, SLOT(showImpedanceSpectrum()));
+
     saveImpedancesButton = new QPushButton(tr("Save Impedance Measurements in CSV Format"));
     saveImpedancesButton->setEnabled(false);
     connect(saveImpedancesButton, SIGNAL(clicked()),
@@ -789,6 +949,11 @@ void MainWindow::createLayout()
     saveImpedancesLayout->addWidget(saveImpedancesButton);
     saveImpedancesLayout->addStretch(1);
 
+    QHBoxLayout *impedanceSpectrumLayout = new QHBoxLayout();
+    impedanceSpectrumLayout->addWidget(runImpedanceSpectrumButton);
+    impedanceSpectrumLayout->addWidget(showImpedanceSpectrumButton);
+    impedanceSpectrumLayout->addStretch(1);
+
     desiredImpedanceFreqLabel = new QLabel(tr("Desired Impedance Test Frequency: 1000 Hz"));
     actualImpedanceFreqLabel = new QLabel(tr("Actual Impedance Test Frequency: -"));
 
@@ -799,6 +964,7 @@ void MainWindow::createLayout()
     impedanceLayout->addLayout(runImpedanceTestLayout);
     impedanceLayout->addWidget(showImpedanceCheckBox);
     impedanceLayout->addLayout(saveImpedancesLayout);
+    impedanceLayout->addLayout(impedanceSpectrumLayout);
     impedanceLayout->addWidget(new QLabel(tr("(Impedance measurements are also saved with data.)")));
     impedanceLayout->addStretch(1);
 
@@ -996,6 +1162,25 @@ void MainWindow::createLayout()
     connect(dac7ThresholdEnableCheckBox, SIGNAL(clicked()), this, SLOT(dacThresholdEnable()));
     connect(dac8ThresholdEnableCheckBox, SIGNAL(clicked()), this, SLOT(dacThresholdEnable()));
 
+    dacAdaptiveThresholdCheckBox = new QCheckBox(tr("Track noise: threshold ="));
+    dacAdaptiveMultiplierSpinBox = new QDoubleSpinBox();
+    dacAdaptiveMultiplierSpinBox->setRange(2.0, 20.0);
+    dacAdaptiveMultiplierSpinBox->setSingleStep(0.5);
+    dacAdaptiveMultiplierSpinBox->setDecimals(1);
+    dacAdaptiveMultiplierSpinBox->setValue(4.5);
+    dacAdaptivePolarityComboBox = new QComboBox();
+    dacAdaptivePolarityComboBox->addItem(tr("negative"));
+    dacAdaptivePolarityComboBox->addItem(tr("positive"));
+
+    connect(dacAdaptiveThresholdCheckBox, SIGNAL(clicked()), this, SLOT(updateDacThresholdTracking()));
+
+    QHBoxLayout *dacAdaptiveLayout = new QHBoxLayout;
+    dacAdaptiveLayout->addWidget(dacAdaptiveThresholdCheckBox);
+    dacAdaptiveLayout->addWidget(dacAdaptiveMultiplierSpinBox);
+    dacAdaptiveLayout->addWidget(new QLabel(tr("x noise,")));
+    dacAdaptiveLayout->addWidget(dacAdaptivePolarityComboBox);
+    dacAdaptiveLayout->addStretch(1);
+
     QVBoxLayout *dacMainLayout = new QVBoxLayout;
     dacMainLayout->addLayout(dacGainLayout);
     dacMainLayout->addLayout(dacNoiseSuppressLayout);
@@ -1009,6 +1194,7 @@ void MainWindow::createLayout()
     dacMainLayout->addLayout(dac6Layout);
     dacMainLayout->addLayout(dac7Layout);
     dacMainLayout->addLayout(dac8Layout);
+    dacMainLayout->addLayout(dacAdaptiveLayout);
     dacMainLayout->addStretch(1);
     // dacMainLayout->addWidget(dacLockToSelectedBox);
 
@@ -1090,10 +1276,24 @@ void MainWindow::createLayout()
     v0AxisLineCheckBox = new QCheckBox(tr("Display V = 0 Axis in Amplifier Plots"));
     v0AxisLineCheckBox->setChecked(false);
 
+    displayRefreshRateComboBox = new QComboBox();
+    displayRefreshRateComboBox->addItem(tr("15 Hz"));
+    displayRefreshRateComboBox->addItem(tr("30 Hz"));
+    displayRefreshRateComboBox->addItem(tr("60 Hz"));
+    displayRefreshRateComboBox->setCurrentIndex(1);
+    connect(displayRefreshRateComboBox, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(changeDisplayRefreshRate(int)));
+
+    QHBoxLayout *displayRefreshRateLayout = new QHBoxLayout;
+    displayRefreshRateLayout->addWidget(new QLabel(tr("Display Refresh Rate")));
+    displayRefreshRateLayout->addWidget(displayRefreshRateComboBox);
+    displayRefreshRateLayout->addStretch(1);
+
     QVBoxLayout *displayParamsLayout =  new QVBoxLayout;
     displayParamsLayout->addWidget(markerGroupBox);
     displayParamsLayout->addWidget(v0AxisLineCheckBox);
     displayParamsLayout->addWidget(plotPointsCheckBox);
+    displayParamsLayout->addLayout(displayRefreshRateLayout);
     displayParamsLayout->addStretch(1);
 
     frameTab5->setLayout(displayParamsLayout);
@@ -1148,12 +1348,67 @@ void MainWindow::createLayout()
     QHBoxLayout *notchFilterLayout = new QHBoxLayout;
     notchFilterLayout->addWidget(new QLabel(tr("Notch Filter Setting")));
     notchFilterLayout->addWidget(notchFilterComboBox);
+    notchFilterLayout->addWidget(new QLabel(tr("Harmonics")));
+    notchFilterLayout->addWidget(notchFilterHarmonicsSpinBox);
     notchFilterLayout->addStretch(1);
     notchFilterLayout->addWidget(helpDialogNotchFilterButton);
 
+    filterBankLabel = new QLabel(tr("No filter bank bands"));
+
+    QHBoxLayout *filterBankLayout = new QHBoxLayout;
+    filterBankLayout->addWidget(filterBankButton);
+    filterBankLayout->addWidget(filterBankLabel);
+    filterBankLayout->addStretch(1);
+
+    artifactLabel = new QLabel(tr("Off"));
+
+    QHBoxLayout *artifactLayout = new QHBoxLayout;
+    artifactLayout->addWidget(artifactButton);
+    artifactLayout->addWidget(artifactLabel);
+    artifactLayout->addStretch(1);
+
+    lineNoiseLabel = new QLabel(tr("Off"));
+
+    QHBoxLayout *lineNoiseLayout = new QHBoxLayout;
+    lineNoiseLayout->addWidget(lineNoiseButton);
+    lineNoiseLayout->addWidget(lineNoiseLabel);
+    lineNoiseLayout->addStretch(1);
+
+    spikeDetectionLabel = new QLabel(tr("Off"));
+
+    QHBoxLayout *spikeDetectionLayout = new QHBoxLayout;
+    spikeDetectionLayout->addWidget(spikeDetectionButton);
+    spikeDetectionLayout->addWidget(spikeDetectionLabel);
+    spikeDetectionLayout->addStretch(1);
+
+    bandPowerLabel = new QLabel(tr("Off"));
+    bandPowerLabel->setToolTip(tr("Band power events detected since detection was enabled, and the latency "
+                                  "from the sample at which the last event was detected to the stimulation "
+                                  "trigger (excluding the FIFO lag)."));
+
+    QHBoxLayout *bandPowerLayout = new QHBoxLayout;
+    bandPowerLayout->addWidget(bandPowerButton);
+    bandPowerLayout->addWidget(bandPowerLabel);
+    bandPowerLayout->addStretch(1);
+
+    phaseTrackingLabel = new QLabel(tr("Off"));
+    phaseTrackingLabel->setToolTip(tr("Estimated oscillation frequency, triggers whose phase has been measured, "
+                                      "and the circular mean and standard deviation of their phase error."));
+
+    QHBoxLayout *phaseTrackingLayout = new QHBoxLayout;
+    phaseTrackingLayout->addWidget(phaseTrackingButton);
+    phaseTrackingLayout->addWidget(phaseTrackingLabel);
+    phaseTrackingLayout->addStretch(1);
+
     QVBoxLayout *offchipFilterLayout = new QVBoxLayout;
     offchipFilterLayout->addLayout(highpassFilterLayout);
     offchipFilterLayout->addLayout(notchFilterLayout);
+    offchipFilterLayout->addLayout(filterBankLayout);
+    offchipFilterLayout->addLayout(artifactLayout);
+    offchipFilterLayout->addLayout(lineNoiseLayout);
+    offchipFilterLayout->addLayout(spikeDetectionLayout);
+    offchipFilterLayout->addLayout(bandPowerLayout);
+    offchipFilterLayout->addLayout(phaseTrackingLayout);
 
     QGroupBox *notchFilterGroupBox = new QGroupBox(tr("Software Filters"));
     notchFilterGroupBox->setLayout(offchipFilterLayout);
@@ -1302,6 +1557,11 @@ void MainWindow::createActions()
             new QAction(tr("Charge Recovery Settings"), this);
     connect(chargeRecoverySettingsAction, SIGNAL(triggered()),
             this, SLOT(chargeRecoverySettings()));
+
+    syntheticDataAction =
+            new QAction(tr("Synthesized Data..."), this);
+    connect(syntheticDataAction, SIGNAL(triggered()),
+            this, SLOT(syntheticDataDialog()));
 }
 
 // Create pull-down menus.
@@ -1332,6 +1592,13 @@ void MainWindow::createMenus()
     channelMenu->addAction(originalOrderAction);
     channelMenu->addAction(alphaOrderAction);
 
+    // Demonstration mode settings are only offered without hardware.
+    demoMenu = nullptr;
+    if (synthMode) {
+        demoMenu = menuBar()->addMenu(tr("&Demo"));
+        demoMenu->addAction(syntheticDataAction);
+    }
+
     menuBar()->addSeparator();
 
     helpMenu = menuBar()->addMenu(tr("&Help"));
@@ -1553,6 +1820,597 @@ void MainWindow::changeBandwidth()
     wavePlot->setFocus();
 }
 
+// Launch software filter bank dialog and apply the new filter bank.
+void MainWindow::filterBankDialog()
+{
+    FilterBankDialog dialog(filterBankBands, filterBankDisplayBand, boardSampleRate, this);
+    if (dialog.exec()) {
+        filterBankBands = dialog.getBands();
+        filterBankDisplayBand = dialog.getDisplayBand();
+        signalProcessor->setFilterBank(filterBankBands, boardSampleRate);
+        signalProcessor->setFilterBankDisplayBand(filterBankDisplayBand);
+
+        if (filterBankBands.isEmpty()) {
+            filterBankLabel->setText(tr("No filter bank bands"));
+        } else {
+            QStringList names;
+            for (int i = 0; i < filterBankBands.size(); ++i) {
+                names.append(filterBankBands[i].name + ((i == filterBankDisplayBand) ? tr(" (displayed)") : ""));
+            }
+            filterBankLabel->setText(names.join(", "));
+        }
+    }
+    wavePlot->setFocus();
+}
+
+// Launch stimulation artifact suppression dialog and apply the new settings.
+void MainWindow::artifactDialog()
+{
+    ArtifactDialog dialog(artifactSettings, this);
+    if (dialog.exec()) {
+        artifactSettings = dialog.getSettings();
+        applyArtifactSuppression();
+
+        QString modeNames[] = { tr("Off"), tr("Blanking"), tr("Interpolation"), tr("Template subtraction") };
+        artifactLabel->setText(modeNames[artifactSettings.mode]);
+    }
+    wavePlot->setFocus();
+}
+
+// Configure SignalProcessor for the current artifact suppression settings and
+// sample rate.
+void MainWindow::applyArtifactSuppression()
+{
+    signalProcessor->setArtifactSuppression(artifactSettings.mode, artifactSettings.scope,
+                                            qRound(artifactSettings.tailMsec * boardSampleRate / 1000.0),
+                                            qMax(1, qRound(artifactSettings.templateMsec * boardSampleRate / 1000.0)),
+                                            artifactSettings.numAveraged);
+}
+
+// Launch adaptive line noise cancellation dialog and apply the new settings.
+void MainWindow::lineNoiseDialog()
+{
+    LineNoiseDialog dialog(lineNoiseSettings, this);
+    if (dialog.exec()) {
+        lineNoiseSettings = dialog.getSettings();
+        applyLineNoiseCancellation();
+
+        switch (lineNoiseSettings.reference) {
+        case LineNoiseCanceller::ReferenceOff:
+            lineNoiseLabel->setText(tr("Off"));
+            break;
+        case LineNoiseCanceller::ReferenceSynthesized:
+            lineNoiseLabel->setText(tr("Synthesized %1 Hz reference").arg(lineNoiseSettings.lineFrequency));
+            break;
+        case LineNoiseCanceller::ReferenceBoardAdc:
+            lineNoiseLabel->setText(tr("Reference on ANALOG-IN-%1").arg(lineNoiseSettings.adcChannel + 1));
+            break;
+        }
+    }
+    wavePlot->setFocus();
+}
+
+// Configure SignalProcessor for the current line noise cancellation settings
+// and sample rate.
+void MainWindow::applyLineNoiseCancellation()
+{
+    signalProcessor->setLineNoiseCancellation(lineNoiseSettings.reference, lineNoiseSettings.lineFrequency,
+                                              lineNoiseSettings.numHarmonics, lineNoiseSettings.adcChannel,
+                                              lineNoiseSettings.numTaps, lineNoiseSettings.timeConstantMsec / 1000.0,
+                                              boardSampleRate);
+}
+
+// Launch synthesized data dialog (demonstration mode only) and apply the new
+// settings.  Changing the number of data streams rescans the ports.
+void MainWindow::syntheticDataDialog()
+{
+    SyntheticDataDialog dialog(syntheticDataSettings, this);
+    if (dialog.exec()) {
+        int oldNumStreams = syntheticDataSettings.numStreams;
+        syntheticDataSettings = dialog.getSettings();
+        applySyntheticData();
+        if (syntheticDataSettings.numStreams != oldNumStreams) {
+            scanPorts();
+        }
+    }
+    wavePlot->setFocus();
+}
+
+// Configure SignalProcessor for the current synthesized data settings.
+void MainWindow::applySyntheticData()
+{
+    signalProcessor->setSyntheticDataParameters(syntheticDataSettings.noiseRms, syntheticDataSettings.spikeRateScale,
+                                                syntheticDataSettings.lfpAmplitude, syntheticDataSettings.lfpFrequency,
+                                                syntheticDataSettings.lineNoiseAmplitude, syntheticDataSettings.lineFrequency,
+                                                syntheticDataSettings.artifactAmplitude, syntheticDataSettings.artifactRate);
+}
+
+// Launch spike detection dialog and apply the new settings.
+void MainWindow::spikeDetectionDialog()
+{
+    SpikeDetectionDialog dialog(spikeDetectionSettings, this);
+    if (dialog.exec()) {
+        spikeDetectionSettings = dialog.getSettings();
+        applySpikeDetection();
+    }
+    wavePlot->setFocus();
+}
+
+// Configure SignalProcessor for the current spike detection settings and sample
+// rate.  Detection is always on with the "Spike Events Only" save format.
+void MainWindow::applySpikeDetection()
+{
+    bool enabled = spikeDetectionSettings.enabled || saveFormat == SaveFormatSpikeSnippets;
+    double samplesPerMsec = boardSampleRate / 1000.0;
+
+    signalProcessor->setSpikeDetection(enabled, spikeDetectionSettings.polarity,
+                                       spikeDetectionSettings.thresholdMultiplier,
+                                       qRound(spikeDetectionSettings.noiseTimeConstantSec * boardSampleRate),
+                                       qRound(spikeDetectionSettings.refractoryMsec * samplesPerMsec),
+                                       qMax(1, qRound(spikeDetectionSettings.peakWindowMsec * samplesPerMsec)),
+                                       qRound(spikeDetectionSettings.preMsec * samplesPerMsec),
+                                       qRound(spikeDetectionSettings.postMsec * samplesPerMsec));
+    signalProcessor->setSpikeSorting(enabled && spikeDetectionSettings.sortSpikes,
+                                     spikeDetectionSettings.maxClusters);
+
+    if (enabled) {
+        QString polarityNames[] = { tr("-"), tr("+"), QSTRING_PLUSMINUS_SYMBOL };
+        spikeDetectionLabel->setText(polarityNames[spikeDetectionSettings.polarity] +
+                                     QString::number(spikeDetectionSettings.thresholdMultiplier, 'f', 1) +
+                                     tr(" x noise") +
+                                     (spikeDetectionSettings.sortSpikes ? tr(", sorted") : QString()));
+    } else {
+        spikeDetectionLabel->setText(tr("Off"));
+    }
+}
+
+void MainWindow::bandPowerDialog()
+{
+    BandPowerDialog dialog(bandPowerSettings, this);
+    if (dialog.exec()) {
+        bandPowerSettings = dialog.getSettings();
+        if (!applyBandPowerDetection()) {
+            QMessageBox::warning(this, tr("Band Power Events"),
+                                 tr("The selected band cannot be realized at this sample rate, "
+                                    "so band power event detection is off."));
+        }
+    }
+    wavePlot->setFocus();
+}
+
+// Count only enabled amplifier channels in band power event detection.
+void MainWindow::updateBandPowerLanes()
+{
+    QVector<int> lanes;
+    for (int port = 0; port < signalSources->signalPort.size(); ++port) {
+        for (int i = 0; i < signalSources->signalPort[port].numChannels(); ++i) {
+            const SignalChannel &channel = signalSources->signalPort[port].channel[i];
+            if (channel.signalType == AmplifierSignal && channel.enabled) {
+                lanes.append(signalProcessor->amplifierLane(channel.boardStream, channel.chipChannel));
+            }
+        }
+    }
+    signalProcessor->setBandPowerLanes(lanes);
+}
+
+// Configure SignalProcessor for the current band power event settings and
+// sample rate.  Any stimulation trigger held by an event is released.  Returns
+// false if the band cannot be designed at this sample rate.
+bool MainWindow::applyBandPowerDetection()
+{
+    double samplesPerMsec = boardSampleRate / 1000.0;
+
+    if (bandPowerTriggerOn) {
+        setManualStimTrigger(bandPowerSettings.trigger, false);
+        bandPowerTriggerOn = false;
+    }
+
+    updateBandPowerLanes();
+    bool valid = signalProcessor->setBandPowerDetection(bandPowerSettings.enabled, bandPowerSettings.lowCutoff,
+                                                        bandPowerSettings.highCutoff, bandPowerSettings.order,
+                                                        bandPowerSettings.smoothingMsec / 1000.0,
+                                                        bandPowerSettings.baselineTimeConstantSec,
+                                                        bandPowerSettings.onThreshold,
+                                                        bandPowerSettings.offThreshold,
+                                                        bandPowerSettings.minChannels,
+                                                        qRound(bandPowerSettings.minDurationMsec * samplesPerMsec),
+                                                        qRound(bandPowerSettings.refractoryMsec * samplesPerMsec),
+                                                        boardSampleRate);
+
+    bandPowerEventCount = 0;
+    if (!bandPowerSettings.enabled) {
+        bandPowerLabel->setText(tr("Off"));
+    } else if (!valid) {
+        bandPowerLabel->setText(tr("Band not valid at this sample rate"));
+    } else {
+        bandPowerLabel->setText(QString::number(bandPowerSettings.lowCutoff, 'f', 0) + "-" +
+                                QString::number(bandPowerSettings.highCutoff, 'f', 0) + tr(" Hz, no events"));
+    }
+    return valid;
+}
+
+// Report band power events found in the latest data, and raise the selected
+// manual stimulation trigger when an event is detected, holding it until the
+// event ends.  Latency is the age of the detection sample when processing of
+// its data began, plus processingMsec, the time since then.
+void MainWindow::updateBandPowerEvents(double processingMsec)
+{
+    const BandPowerDetector *detector = signalProcessor->getBandPowerDetector();
+    if (!detector->isEnabled()) return;
+
+    const QVector<BandPowerEvent> &events = detector->getEvents();
+    if (!events.isEmpty()) {
+        if (bandPowerSettings.triggerEnabled && !bandPowerTriggerOn) {
+            setManualStimTrigger(bandPowerSettings.trigger, true);
+            bandPowerTriggerOn = true;
+        }
+
+        qint32 lastTimestamp = signalProcessor->timeStamp[SAMPLES_PER_DATA_BLOCK * numUsbBlocksToRead - 1];
+        double latency = 1000.0 * (lastTimestamp - events.last().detectionTimestamp) / boardSampleRate +
+                processingMsec;
+        bandPowerEventCount += events.size();
+        bandPowerLabel->setText(tr("%1 events, latency %2 ms").arg(bandPowerEventCount)
+                                .arg(QString::number(latency, 'f', 1)));
+    } else if (bandPowerTriggerOn && !detector->isEventActive()) {
+        setManualStimTrigger(bandPowerSettings.trigger, false);
+        bandPowerTriggerOn = false;
+    }
+}
+
+void MainWindow::phaseTrackingDialog()
+{
+    PhaseTrackingSettings settings = phaseTrackingSettings;
+    if (settings.channels.isEmpty() && wavePlot->selectedChannel()->signalType == AmplifierSignal) {
+        settings.channels = wavePlot->selectedChannel()->nativeChannelName;
+    }
+
+    PhaseTrackingDialog dialog(settings, this);
+    if (dialog.exec()) {
+        phaseTrackingSettings = dialog.getSettings();
+        QString errorMessage;
+        if (!applyPhaseTracking(errorMessage)) {
+            QMessageBox::warning(this, tr("Phase-Locked Stimulation"), errorMessage);
+        }
+    }
+    wavePlot->setFocus();
+}
+
+// Configure SignalProcessor for the current phase-locked stimulation settings
+// and sample rate.  Any scheduled trigger is cancelled and accuracy statistics
+// are reset.  Returns false, with tracking off, if the channels are not
+// connected amplifier channels or the band cannot be realized.
+bool MainWindow::applyPhaseTracking(QString &errorMessage)
+{
+    phaseTriggerTimer->stop();
+    releasePhaseTrigger();
+    lastPhaseStimTimestamp = -1.0e12;
+
+    bool valid = true;
+    QVector<int> lanes;
+    if (phaseTrackingSettings.enabled) {
+        QStringList names = phaseTrackingSettings.channels.split(",", QString::SkipEmptyParts);
+        for (int i = 0; i < names.size() && valid; ++i) {
+            SignalChannel *channel = signalSources->findChannelFromName(names[i].trimmed());
+            if (!channel || channel->signalType != AmplifierSignal) {
+                errorMessage = tr("Phase tracking channel is not a connected amplifier channel: ") + names[i].trimmed();
+                valid = false;
+            } else {
+                lanes.append(signalProcessor->amplifierLane(channel->boardStream, channel->chipChannel));
+            }
+        }
+        if (valid && lanes.isEmpty()) {
+            errorMessage = tr("No channels are selected for phase tracking.");
+            valid = false;
+        }
+    }
+
+    if (!signalProcessor->setPhaseTracking(phaseTrackingSettings.enabled && valid, lanes,
+                                           phaseTrackingSettings.lowCutoff, phaseTrackingSettings.highCutoff,
+                                           phaseTrackingSettings.targetPhaseDeg * DEGREES_TO_RADIANS,
+                                           boardSampleRate) && valid && phaseTrackingSettings.enabled) {
+        errorMessage = tr("The selected band cannot be realized at this sample rate.");
+        valid = false;
+    }
+
+    if (!phaseTrackingSettings.enabled) {
+        phaseTrackingLabel->setText(tr("Off"));
+    } else if (!valid) {
+        phaseTrackingLabel->setText(tr("Off (invalid settings)"));
+    } else {
+        phaseTrackingLabel->setText(QString::number(phaseTrackingSettings.lowCutoff, 'f', 0) + "-" +
+                                    QString::number(phaseTrackingSettings.highCutoff, 'f', 0) + tr(" Hz at ") +
+                                    QString::number(phaseTrackingSettings.targetPhaseDeg, 'f', 0) +
+                                    QSTRING_DEGREE_SYMBOL);
+    }
+    return valid || !phaseTrackingSettings.enabled;
+}
+
+// Log and report the achieved phase of earlier triggers, then schedule a
+// trigger at the next predicted target phase if it falls before the next block
+// of data arrives.  The board timestamp at which a trigger sent now would take
+// effect is the last timestamp processed, advanced by the data still in the
+// USB FIFO (fifoLagMsec), the time spent processing the latest data
+// (processingMsec), and the trigger output latency.
+void MainWindow::updatePhaseTracking(double processingMsec, double fifoLagMsec, int timestampOffset)
+{
+    const PhaseTracker *tracker = signalProcessor->getPhaseTracker();
+    if (!tracker->isEnabled()) return;
+
+    const QVector<PhaseStimulation> &results = tracker->getResults();
+    if (phaseLogStream) {
+        for (int i = 0; i < results.size(); ++i) {
+            const PhaseStimulation &stimulation = results[i];
+            *phaseLogStream << QString::number(stimulation.timestamp - timestampOffset, 'f', 1) << "," <<
+                               QString::number(stimulation.targetPhase * RADIANS_TO_DEGREES, 'f', 1) << "," <<
+                               QString::number(stimulation.achievedPhase * RADIANS_TO_DEGREES, 'f', 1) << "," <<
+                               QString::number(stimulation.error * RADIANS_TO_DEGREES, 'f', 1) << "," <<
+                               QString::number(stimulation.frequency, 'f', 2) << "\n";
+        }
+    }
+    if (!results.isEmpty()) {
+        phaseTrackingLabel->setText(QString::number(tracker->getFrequency(), 'f', 1) + tr(" Hz, ") +
+                                    QString::number(tracker->getNumMeasured()) + tr(" triggers, error ") +
+                                    QString::number(tracker->getMeanError() * RADIANS_TO_DEGREES, 'f', 0) +
+                                    QSTRING_PLUSMINUS_SYMBOL +
+                                    QString::number(tracker->getErrorDeviation() * RADIANS_TO_DEGREES, 'f', 0) +
+                                    QSTRING_DEGREE_SYMBOL);
+    }
+
+    if (!tracker->isLocked()) return;
+
+    double blockSamples = SAMPLES_PER_DATA_BLOCK * numUsbBlocksToRead;
+    qint32 lastTimestamp = signalProcessor->timeStamp[SAMPLES_PER_DATA_BLOCK * numUsbBlocksToRead - 1];
+    phaseClock.start();
+    phaseClockTimestamp = lastTimestamp + 1 + (fifoLagMsec + processingMsec + phaseTrackingSettings.outputLatencyMsec) *
+            boardSampleRate / 1000.0;
+
+    // Any trigger already scheduled is replaced using the latest estimate.
+    // Crossings beyond the next block are left for the next estimate.
+    double earliest = qMax(phaseClockTimestamp,
+                           lastPhaseStimTimestamp + phaseTrackingSettings.minIntervalMsec * boardSampleRate / 1000.0);
+    double crossing = tracker->nextCrossing(earliest);
+    if (crossing - phaseClockTimestamp > blockSamples) {
+        phaseTriggerTimer->stop();
+        return;
+    }
+    phaseTriggerTimestamp = crossing;
+    phaseTriggerTimer->start(qRound(1000.0 * (crossing - phaseClockTimestamp) / boardSampleRate));
+}
+
+// Fire the phase-locked stimulation trigger, and record the board timestamp
+// at which it takes effect so that its achieved phase can be measured.
+void MainWindow::firePhaseTrigger()
+{
+    if (!running) return;
+
+    setManualStimTrigger(phaseTrackingSettings.trigger, true);
+    phaseTriggerOn = true;
+    QTimer::singleShot(PHASE_TRIGGER_PULSE_MSEC, this, SLOT(releasePhaseTrigger()));
+
+    double timestamp = phaseClockTimestamp + phaseClock.nsecsElapsed() * 1.0e-9 * boardSampleRate;
+    signalProcessor->addPhaseStimulation(timestamp);
+    lastPhaseStimTimestamp = timestamp;
+}
+
+void MainWindow::releasePhaseTrigger()
+{
+    if (phaseTriggerOn) {
+        setManualStimTrigger(phaseTrackingSettings.trigger, false);
+        phaseTriggerOn = false;
+    }
+}
+
+// Create a log of phase-locked triggers for the current recording, if phase
+// tracking is enabled: one line per trigger with its timestamp, target and
+// achieved phases (in degrees), phase error, and oscillation frequency.
+void MainWindow::openPhaseLog()
+{
+    if (!signalProcessor->getPhaseTracker()->isEnabled()) return;
+
+    phaseLogFile = new QFile(saveSidecarPath + "/" + saveSidecarBaseName + ".phase.csv");
+    if (!phaseLogFile->open(QIODevice::WriteOnly | QIODevice::Text)) {
+        cerr << "Cannot open phase log file for writing: " << qPrintable(phaseLogFile->errorString()) << endl;
+        delete phaseLogFile;
+        phaseLogFile = nullptr;
+        return;
+    }
+    phaseLogStream = new QTextStream(phaseLogFile);
+    *phaseLogStream << "Timestamp,Target Phase (deg),Achieved Phase (deg),Error (deg),Frequency (Hz)\n";
+}
+
+// Close the phase log, ending it with the accuracy statistics of the run.
+void MainWindow::closePhaseLog()
+{
+    if (!phaseLogFile) return;
+
+    const PhaseTracker *tracker = signalProcessor->getPhaseTracker();
+    *phaseLogStream << "# " << tracker->getNumMeasured() << " triggers measured since acquisition started, " <<
+                       "mean error " <<
+                       QString::number(tracker->getMeanError() * RADIANS_TO_DEGREES, 'f', 1) <<
+                       " deg, circular standard deviation " <<
+                       QString::number(tracker->getErrorDeviation() * RADIANS_TO_DEGREES, 'f', 1) << " deg\n";
+    delete phaseLogStream;
+    phaseLogStream = nullptr;
+    phaseLogFile->close();
+    delete phaseLogFile;
+    phaseLogFile = nullptr;
+}
+
+// Launch spatial re-referencing dialog and apply the selected montage.  The
+// montage takes effect with the next data block, so acquisition need not stop.
+void MainWindow::spatialReferenceDialog()
+{
+    SpatialReferenceDialog dialog(spatialReferenceSettings, this);
+    if (dialog.exec()) {
+        SpatialReferenceSettings settings = dialog.getSettings();
+        QString errorMessage;
+        if (applySpatialReference(settings, errorMessage)) {
+            spatialReferenceSettings = settings;
+            QString montageNames[] = { tr("Spatial re-referencing off"), tr("Common average reference"),
+                                       tr("Common median reference"), tr("Bipolar montage"),
+                                       tr("Laplacian montage"), tr("Custom montage") };
+            QString text = montageNames[settings.montage];
+            if (settings.montage == MontageCommonAverage || settings.montage == MontageCommonMedian) {
+                text += (settings.grouping == GroupByHeadstage) ? tr(" per headstage") : tr(" per port");
+            } else if (settings.montage != MontageOff) {
+                text += " (" + QFileInfo(settings.fileName).fileName() + ")";
+            }
+            spatialRefLabel->setText(text);
+        } else {
+            QMessageBox::warning(this, tr("Cannot Apply Spatial Re-Referencing"), errorMessage);
+        }
+    }
+    wavePlot->setFocus();
+}
+
+// Configure SignalProcessor for a spatial re-referencing montage.  Returns false,
+// leaving the current montage in place, if the montage file cannot be read or
+// names channels that are not connected amplifier channels.
+bool MainWindow::applySpatialReference(const SpatialReferenceSettings &settings, QString &errorMessage)
+{
+    int numLanes = signalProcessor->getNumAmplifierLanes();
+    QVector<QStringList> lines;
+
+    switch (settings.montage) {
+    case MontageOff:
+        signalProcessor->setSpatialReferenceOff();
+        return true;
+
+    case MontageCommonAverage:
+    case MontageCommonMedian:
+    {
+        // Group enabled amplifier channels by data stream (one per headstage) or port.
+        QMap<int, QVector<int> > groupMap;
+        for (int port = 0; port < numSpiPorts; ++port) {
+            for (int i = 0; i < signalSources->signalPort[port].numChannels(); ++i) {
+                const SignalChannel &channel = signalSources->signalPort[port].channel[i];
+                if (channel.signalType == AmplifierSignal && channel.enabled) {
+                    int key = (settings.grouping == GroupByHeadstage) ? channel.boardStream : port;
+                    groupMap[key].append(signalProcessor->amplifierLane(channel.boardStream, channel.chipChannel));
+                }
+            }
+        }
+        if (groupMap.isEmpty()) {
+            errorMessage = tr("No amplifier channels are enabled.");
+            return false;
+        }
+        signalProcessor->setSpatialReferenceGroups((settings.montage == MontageCommonAverage) ?
+                                                       SpatialReference::ReferenceCommonAverage :
+                                                       SpatialReference::ReferenceCommonMedian,
+                                                   groupMap.values().toVector());
+        return true;
+    }
+
+    case MontageBipolar:
+    {
+        if (!readMontageFile(settings.fileName, 2, lines, errorMessage)) return false;
+        QVector<QPair<int, int> > pairs;
+        for (int i = 0; i < lines.size(); ++i) {
+            int signalLane, referenceLane;
+            if (!montageChannelLane(lines[i][0], signalLane, errorMessage) ||
+                    !montageChannelLane(lines[i][1], referenceLane, errorMessage)) return false;
+            pairs.append(qMakePair(signalLane, referenceLane));
+        }
+        signalProcessor->setSpatialReferenceMatrix(SpatialReference::bipolarMatrix(numLanes, pairs));
+        return true;
+    }
+
+    case MontageLaplacian:
+    {
+        if (!readMontageFile(settings.fileName, 3, lines, errorMessage)) return false;
+        QVector<int> lanes;
+        QVector<QPointF> positions;
+        for (int i = 0; i < lines.size(); ++i) {
+            int lane;
+            bool xOk, yOk;
+            if (!montageChannelLane(lines[i][0], lane, errorMessage)) return false;
+            QPointF position(lines[i][1].toDouble(&xOk), lines[i][2].toDouble(&yOk));
+            if (!xOk || !yOk) {
+                errorMessage = tr("Invalid electrode position for channel ") + lines[i][0] + ".";
+                return false;
+            }
+            lanes.append(lane);
+            positions.append(position);
+        }
+        if (lanes.size() < 2) {
+            errorMessage = tr("A Laplacian montage needs at least two electrode positions.");
+            return false;
+        }
+        signalProcessor->setSpatialReferenceMatrix(
+                    SpatialReference::laplacianMatrix(numLanes, lanes, positions, settings.numNeighbors));
+        return true;
+    }
+
+    case MontageCustom:
+    {
+        if (!readMontageFile(settings.fileName, 3, lines, errorMessage)) return false;
+        QVector<QVector<SpatialReferenceTerm> > rows(numLanes);
+        for (int i = 0; i < lines.size(); ++i) {
+            int outputLane;
+            SpatialReferenceTerm term;
+            bool ok;
+            if (!montageChannelLane(lines[i][0], outputLane, errorMessage) ||
+                    !montageChannelLane(lines[i][1], term.lane, errorMessage)) return false;
+            term.weight = lines[i][2].toDouble(&ok);
+            if (!ok) {
+                errorMessage = tr("Invalid weight: ") + lines[i][2];
+                return false;
+            }
+            rows[outputLane].append(term);
+        }
+        signalProcessor->setSpatialReferenceMatrix(rows);
+        return true;
+    }
+    }
+    return false;
+}
+
+// Read a montage file with numFields whitespace-separated fields on each line.
+// Text following # is a comment; blank lines are ignored.
+bool MainWindow::readMontageFile(const QString &fileName, int numFields, QVector<QStringList> &lines,
+                                 QString &errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorMessage = tr("Cannot open montage file: ") + file.errorString();
+        return false;
+    }
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    lines.clear();
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        ++lineNumber;
+        line = line.left(line.indexOf('#')).trimmed();
+        if (line.isEmpty()) continue;
+
+        QStringList fields = line.split(QRegExp("\\s+"));
+        if (fields.size() != numFields) {
+            errorMessage = tr("Line %1 of the montage file should have %2 fields.").arg(lineNumber).arg(numFields);
+            return false;
+        }
+        lines.append(fields);
+    }
+    if (lines.isEmpty()) {
+        errorMessage = tr("The montage file lists no channels.");
+        return false;
+    }
+    return true;
+}
+
+// Lane in SignalProcessor of the amplifier channel with native name name.
+bool MainWindow::montageChannelLane(const QString &name, int &lane, QString &errorMessage)
+{
+    SignalChannel *channel = signalSources->findChannelFromName(name);
+    if (!channel || channel->signalType != AmplifierSignal) {
+        errorMessage = tr("The montage file names a channel that is not a connected amplifier channel: ") + name;
+        return false;
+    }
+    lane = signalProcessor->amplifierLane(channel->boardStream, channel->chipChannel);
+    return true;
+}
+
 // Launch electrode impedance measurement frequency selection dialog.
 void MainWindow::changeImpedanceFrequency()
 {
@@ -1574,13 +2432,7 @@ void MainWindow::updateImpedanceFrequency()
     int impedancePeriod;
     double lowerBandwidthLimit, upperBandwidthLimit;
 
-    upperBandwidthLimit = actualUpperBandwidth / 1.5;
-    lowerBandwidthLimit = actualLowerBandwidth * 1.5;
-    if (dspEnabled) {
-        if (actualDspCutoffFreq > actualLowerBandwidth) {
-            lowerBandwidthLimit = actualDspCutoffFreq * 1.5;
-        }
-    }
+    impedanceFrequencyLimits(lowerBandwidthLimit, upperBandwidthLimit);
 
     if (desiredImpedanceFreq > 0.0) {
         desiredImpedanceFreqLabel->setText("Desired Impedance Test Frequency: " +
@@ -1611,6 +2463,19 @@ void MainWindow::updateImpedanceFrequency()
     runImpedanceTestButton->setEnabled(impedanceFreqValid);
 }
 
+// Return the range of valid electrode impedance test frequencies, based on the amplifier
+// bandwidth.
+void MainWindow::impedanceFrequencyLimits(double &lowerBandwidthLimit, double &upperBandwidthLimit) const
+{
+    upperBandwidthLimit = actualUpperBandwidth / 1.5;
+    lowerBandwidthLimit = actualLowerBandwidth * 1.5;
+    if (dspEnabled) {
+        if (actualDspCutoffFreq > actualLowerBandwidth) {
+            lowerBandwidthLimit = actualDspCutoffFreq * 1.5;
+        }
+    }
+}
+
 // Rename selected channel.
 void MainWindow::renameChannel()
 {
@@ -1767,6 +2632,7 @@ void MainWindow::dacEnable(bool enable)
     } else {
         setDacChannelLabel(dacChannel, "n/a", "n/a");
     }
+    updateDacThresholdTracking();
     wavePlot->setFocus();
 }
 
@@ -1789,6 +2655,7 @@ void MainWindow::dacSetChannel()
         }
         setDacChannelLabel(dacChannel, selectedChannel->customChannelName,
                            selectedChannel->nativeChannelName);
+        updateDacThresholdTracking();
     }
     wavePlot->setFocus();
 }
@@ -1857,8 +2724,22 @@ void MainWindow::changeNotchFilter(int notchFilterIndex)
         notchFilterEnabled = true;
         break;
     }
-    signalProcessor->setNotchFilter(notchFilterFrequency, notchFilterBandwidth, boardSampleRate);
+    signalProcessor->setNotchFilter(notchFilterFrequency, notchFilterBandwidth, boardSampleRate,
+                                    notchFilterHarmonics);
     signalProcessor->setNotchFilterEnabled(notchFilterEnabled);
+    notchFilterHarmonicsSpinBox->setEnabled(notchFilterEnabled);
+    if (signalQualityDialog) {
+        signalQualityDialog->setParameters(notchFilterFrequency, boardSampleRate);
+    }
+    wavePlot->setFocus();
+}
+
+// Change the number of mains harmonics removed by the notch filter.
+void MainWindow::changeNotchFilterHarmonics(int numHarmonics)
+{
+    notchFilterHarmonics = numHarmonics;
+    signalProcessor->setNotchFilter(notchFilterFrequency, notchFilterBandwidth, boardSampleRate,
+                                    notchFilterHarmonics);
     wavePlot->setFocus();
 }
 
@@ -1870,6 +2751,7 @@ void MainWindow::enableHighpassFilter(bool enable)
     if (!synthMode) {
         evalBoard->enableDacHighpassFilter(enable);
     }
+    updateDacThresholdTracking();
     wavePlot->setFocus();
 }
 
@@ -1887,6 +2769,7 @@ void MainWindow::setHighpassFilterCutoff(double cutoff)
     if (!synthMode) {
         evalBoard->setDacHighpassFilter(cutoff);
     }
+    updateDacThresholdTracking();
 }
 
 // Change RHS2000 interface board amplifier sample rate.
@@ -1921,8 +2804,6 @@ void MainWindow::changeSampleRate(int sampleRateIndex, bool updateStimParams)
         break;
     }
 
-    wavePlot->setNumUsbBlocksToPlot(numUsbBlocksToRead);
-
     // Set up an RHS2000 register object using this sample rate to
     // optimize MUX-related register settings.
     Rhs2000Registers chipRegisters(boardSampleRate, stimStep);
@@ -2031,8 +2912,21 @@ void MainWindow::changeSampleRate(int sampleRateIndex, bool updateStimParams)
 
     wavePlot->setSampleRate(boardSampleRate);
 
-    signalProcessor->setNotchFilter(notchFilterFrequency, notchFilterBandwidth, boardSampleRate);
+    signalProcessor->setNotchFilter(notchFilterFrequency, notchFilterBandwidth, boardSampleRate,
+                                    notchFilterHarmonics);
     signalProcessor->setHighpassFilter(highpassFilterFrequency, boardSampleRate);
+    applyArtifactSuppression();
+    applyLineNoiseCancellation();
+    applySpikeDetection();
+    applyBandPowerDetection();
+    QString phaseErrorMessage;
+    applyPhaseTracking(phaseErrorMessage);
+    updateDacThresholdTracking();
+    if (!signalProcessor->setFilterBankSampleRate(boardSampleRate)) {
+        QMessageBox::warning(this, tr("Filter Bank"),
+                             tr("One or more filter bank bands cannot be realized at this sample rate "
+                                "and will pass data unfiltered.  Use the Filter Bank dialog to adjust them."));
+    }
 
     if (!synthMode) {
         evalBoard->setDacHighpassFilter(highpassFilterFrequency);
@@ -2041,6 +2935,15 @@ void MainWindow::changeSampleRate(int sampleRateIndex, bool updateStimParams)
     if (spikeScopeDialog) {
         spikeScopeDialog->setSampleRate(boardSampleRate);
     }
+    if (spectrumDialog) {
+        spectrumDialog->setSampleRate(boardSampleRate);
+    }
+    if (correlationDialog) {
+        correlationDialog->setSampleRate(boardSampleRate);
+    }
+    if (signalQualityDialog) {
+        signalQualityDialog->setParameters(notchFilterFrequency, boardSampleRate);
+    }
 
     impedanceFreqValid = false;
     updateImpedanceFrequency();
@@ -2088,7 +2991,9 @@ int MainWindow::openInterfaceBoard(bool& expanderBoardDetected)
                                         "<p>In demonstration mode, the audio output will not work since this "
                                         "requires the line out signal from the interface board.  Also, electrode "
                                         "impedance testing is disabled in this mode.  Stimulation settings can be "
-                                        "configured, but stimulation pulses are not emulated."),
+                                        "configured, but stimulation pulses are not emulated."
+                                        "<p>Use the Demo menu to simulate more headstages or to add local field "
+                                        "potentials, line noise, or stimulation artifacts."),
                                      QMessageBox::Ok);
             synthMode = true;
             delete evalBoard;
@@ -2331,9 +3236,12 @@ void MainWindow::findConnectedAmplifiers()
 
     } else {
         // If we are running with synthetic data (i.e., no interface board), just assume
-        // that one RHS2116 is plugged into Port A.
-        chipIdOld[0] = CHIP_ID_RHS2116;
-        portIndexOld[0] = 0;
+        // that the selected number of RHS2116 chips are plugged in, two per port starting
+        // with Port A.
+        for (stream = 0; stream < syntheticDataSettings.numStreams; ++stream) {
+            chipIdOld[stream] = CHIP_ID_RHS2116;
+            portIndexOld[stream] = stream / 2;
+        }
     }
 
     // Now that we know which RHS2000 amplifier chips are plugged into each SPI port,
@@ -2625,6 +3533,7 @@ void MainWindow::writeSaveFileHeader(QDataStream &outStream, QDataStream &infoSt
 
     case SaveFormatFilePerSignalType:
     case SaveFormatFilePerChannel:
+    case SaveFormatSpikeSnippets:
         infoStream << (quint32) DATA_FILE_MAGIC_NUMBER;
         infoStream << (qint16) DATA_FILE_MAIN_VERSION_NUMBER;
         infoStream << (qint16) DATA_FILE_SECONDARY_VERSION_NUMBER;
@@ -2702,8 +3611,24 @@ void MainWindow::runInterfaceBoard()
     QSound triggerBeep(QDir::tempPath() + "/triggerbeep.wav");
     QSound triggerEndBeep(QDir::tempPath() + "/triggerendbeep.wav");
 
+    // Channels may have been enabled or disabled since band power detection was set up.
+    updateBandPowerLanes();
+
+    // The number of data streams may have changed since the DAC noise tracker was set up.
+    updateDacThresholdTracking();
+
+    // Timestamps restart with each run, so phase tracking starts afresh.
+    if (phaseTrackingSettings.enabled) {
+        QString errorMessage;
+        if (!applyPhaseTracking(errorMessage)) {
+            QMessageBox::warning(this, tr("Phase-Locked Stimulation"), errorMessage);
+        }
+    }
+
     running = true;
     wavePlot->setFocus();
+    wavePlot->startDisplay();
+    displayFramesLabel->setText("0 / 0");
 
     // Enable stop button on GUI while running
     stopButton->setEnabled(true);
@@ -2718,7 +3643,9 @@ void MainWindow::runInterfaceBoard()
     changeBandwidthButton->setEnabled(false);
     impedanceFreqSelectButton->setEnabled(false);
     runImpedanceTestButton->setEnabled(false);
+    runImpedanceSpectrumButton->setEnabled(false);
     scanButton->setEnabled(false);
+    syntheticDataAction->setEnabled(false);
     setCableDelayButton->setEnabled(false);
     setSaveFormatButton->setEnabled(false);
     stimParamButton->setEnabled(false);
@@ -2738,7 +3665,7 @@ void MainWindow::runInterfaceBoard()
     unsigned int sampleSizeInBytes = 2 * dataBlockSize / SAMPLES_PER_DATA_BLOCK;
 
     unsigned int wordsInFifo;
-    double fifoPercentageFull, fifoCapacity, samplePeriod, latency;
+    double fifoPercentageFull, fifoCapacity, samplePeriod, latency = 0.0;
     long long totalBytesWritten = 0;
     double totalRecordTimeSeconds = 0.0;
     double totalElapsedRecordTimeSeconds = 0.0;
@@ -2920,6 +3847,9 @@ void MainWindow::runInterfaceBoard()
                         signalProcessor->loadSyntheticData(numUsbBlocksToRead,
                                                            boardSampleRate, recording,
                                                            *saveStream, saveFormat, saveTtlOut, saveDcAmps, referenceSource);
+                if (recording && saveJournal) {
+                    saveJournal->update(numUsbBlocksToRead, signalProcessor->getLastSavedTimestamp());
+                }
             } else {
                 // Check the number of words stored in the Opal Kelly USB interface FIFO.
                 wordsInFifo = evalBoard->getLastNumWordsInFifo(hasBeenUpdated);
@@ -2955,6 +3885,9 @@ void MainWindow::runInterfaceBoard()
                                                            triggerIndex, triggerSet, bufferQueue,
                                                            recording, *saveStream, saveFormat,
                                                            saveTtlOut, saveDcAmps, timestampOffset, referenceSource);
+                if (recording && saveJournal) {
+                    saveJournal->update(numUsbBlocksToRead, signalProcessor->getLastSavedTimestamp());
+                }
 
                 while (bufferQueue.size() > preTriggerBufferQueueLength) {
                     bufferQueue.pop();
@@ -2983,8 +3916,12 @@ void MainWindow::runInterfaceBoard()
                     totalElapsedRecordTimeSeconds = totalRecordTimeSeconds;
 
                     // Write contents of pre-trigger buffer to file.
+                    int numBufferedBlocks = (int) bufferQueue.size();
                     totalBytesWritten += signalProcessor->saveBufferedData(bufferQueue, *saveStream, saveFormat,
                                                                            saveTtlOut, saveDcAmps, timestampOffset);
+                    if (saveJournal) {
+                        saveJournal->update(numBufferedBlocks, signalProcessor->getLastSavedTimestamp());
+                    }
                 } else if (triggered && (triggerIndex != -1)) { // Episodic triggered recording
                     triggerEndCounter++;
                     if (triggerEndCounter > triggerEndThreshold) {
@@ -3009,16 +3946,48 @@ void MainWindow::runInterfaceBoard()
             }
 
             // Apply notch filter to amplifier data.
-            signalProcessor->filterData(numUsbBlocksToRead, channelVisible);
+            signalProcessor->filterData(numUsbBlocksToRead);
+
+            // Report filter cost; flag it if it takes more than half the real time
+            // spanned by the data.
+            filterTimeLabel->setText(QString::number(signalProcessor->getLastFilterTimeMsec(), 'f', 1) + " ms");
+            if (signalProcessor->getLastFilterTimeMsec() > 500.0 * numUsbBlocksToRead * samplePeriod *
+                    Rhs2000DataBlock::getSamplesPerDataBlock()) {
+                filterTimeLabel->setStyleSheet("color: red");
+            } else {
+                filterTimeLabel->setStyleSheet("color: black");
+            }
 
-            // Trigger WavePlot widget to display new waveform data.
-            wavePlot->passFilteredData();
+            // Fire the stimulation trigger on band power events as soon as possible.
+            updateBandPowerEvents(processingTimer.nsecsElapsed() / 1.0e6);
+            updatePhaseTracking(processingTimer.nsecsElapsed() / 1.0e6, synthMode ? 0.0 : latency, timestampOffset);
+            updateAdaptiveDacThresholds();
+
+            // Save spikes detected in the new data.
+            if (recording && spikeEventFile) {
+                totalBytesWritten += spikeEventFile->write(*signalProcessor->getSpikeDetector(), timestampOffset);
+            }
+
+            // Pass new waveform data to the WavePlot widget, which draws it on its own timer.
+            wavePlot->passFilteredData(numUsbBlocksToRead * Rhs2000DataBlock::getSamplesPerDataBlock());
+            displayFramesLabel->setText(QString::number(wavePlot->getLateFrames()) + " / " +
+                                        QString::number(wavePlot->getDroppedFrames()));
 
             // Trigger Spike Scope to update with new waveform data.
             if (spikeScopeDialog) {
                 spikeScopeDialog->updateWaveform(numUsbBlocksToRead);
             }
 
+            // Pass new data to the background spectrum analyzer.
+            if (spectrumDialog) {
+                spectrumDialog->updateData(numUsbBlocksToRead);
+            }
+
+            // Pass new data to the background correlation analyzer.
+            if (correlationDialog) {
+                correlationDialog->updateData(numUsbBlocksToRead);
+            }
+
             // If we are recording in Intan format and our data file has reached its specified
             // maximum length (e.g., 1 minute), close the current data file and open a new one.
 
@@ -3090,6 +4059,7 @@ void MainWindow::runInterfaceBoard()
         usbStreamFifo->resetBuffer();
         evalBoard->resetSequencers();   // reset sequencers
     }
+    wavePlot->stopDisplay();
 
     // Close save file, if recording.
     if (recording) {
@@ -3101,6 +4071,15 @@ void MainWindow::runInterfaceBoard()
     triggerSet = false;
     triggered = false;
 
+    // Release any stimulation trigger held by a band power event, and cancel
+    // any scheduled phase-locked trigger.
+    if (bandPowerTriggerOn) {
+        setManualStimTrigger(bandPowerSettings.trigger, false);
+        bandPowerTriggerOn = false;
+    }
+    phaseTriggerTimer->stop();
+    releasePhaseTrigger();
+
     totalRecordTimeSeconds = 0.0;
     totalElapsedRecordTimeSeconds = 0.0;
     setStatusBarReady();
@@ -3117,7 +4096,9 @@ void MainWindow::runInterfaceBoard()
     changeBandwidthButton->setEnabled(true);
     impedanceFreqSelectButton->setEnabled(true);
     runImpedanceTestButton->setEnabled(impedanceFreqValid);
+    runImpedanceSpectrumButton->setEnabled(true);
     scanButton->setEnabled(true);
+    syntheticDataAction->setEnabled(true);
     setCableDelayButton->setEnabled(true);
 
     enableChannelButton->setEnabled(true);
@@ -3140,6 +4121,7 @@ void MainWindow::runInterfaceBoard()
 void MainWindow::stopInterfaceBoard()
 {
     running = false;
+    wavePlot->stopDisplay();
     wavePlot->setFocus();
 }
 
@@ -3171,6 +4153,11 @@ void MainWindow::selectBaseFilename(SaveFormat format)
                                                 tr("Select Base Filename"), ".",
                                                 tr("Intan Data Files (*.rhs)"));
         break;
+    case SaveFormatSpikeSnippets:
+        newFileName = QFileDialog::getSaveFileName(this,
+                                                tr("Select Base Filename"), ".",
+                                                tr("Intan Data Files (*.rhs)"));
+        break;
     }
 
     if (!newFileName.isEmpty()) {
@@ -3212,23 +4199,70 @@ void MainWindow::spikeScope()
     wavePlot->setFocus();
 }
 
-// Change selected channel on Spike Scope when user selects a new channel.
-void MainWindow::newSelectedChannel(SignalChannel* newChannel)
+// Open Spectrum dialog and initialize it.
+void MainWindow::spectrum()
 {
-    if (spikeScopeDialog) {
-        spikeScopeDialog->setNewChannel(newChannel);
+    if (!spectrumDialog) {
+        spectrumDialog = new SpectrumDialog(signalProcessor, signalSources,
+                                            wavePlot->selectedChannel(), this);
     }
 
-    if (dacLockToSelectedBox->isChecked()) {
-        if (newChannel->signalType == AmplifierSignal) {
-            // Set DAC 1 to selected channel and label it accordingly.
-            dacSelectedChannel[0] = newChannel;
+    spectrumDialog->show();
+    spectrumDialog->raise();
+    spectrumDialog->activateWindow();
+    spectrumDialog->setSampleRate(boardSampleRate);
+    wavePlot->setFocus();
+}
+
+// Open Correlation dialog and initialize it.
+void MainWindow::correlation()
+{
+    if (!correlationDialog) {
+        correlationDialog = new CorrelationDialog(signalProcessor, signalSources, this);
+    }
+
+    correlationDialog->show();
+    correlationDialog->raise();
+    correlationDialog->activateWindow();
+    correlationDialog->setSampleRate(boardSampleRate);
+    wavePlot->setFocus();
+}
+
+// Open Signal Quality dialog and initialize it.
+void MainWindow::signalQuality()
+{
+    if (!signalQualityDialog) {
+        signalQualityDialog = new SignalQualityDialog(signalProcessor, signalSources, this);
+    }
+
+    signalQualityDialog->setParameters(notchFilterFrequency, boardSampleRate);
+    signalQualityDialog->show();
+    signalQualityDialog->raise();
+    signalQualityDialog->activateWindow();
+    wavePlot->setFocus();
+}
+
+// Change selected channel on Spike Scope and Spectrum dialogs when user selects a new channel.
+void MainWindow::newSelectedChannel(SignalChannel* newChannel)
+{
+    if (spikeScopeDialog) {
+        spikeScopeDialog->setNewChannel(newChannel);
+    }
+    if (spectrumDialog) {
+        spectrumDialog->setNewChannel(newChannel);
+    }
+
+    if (dacLockToSelectedBox->isChecked()) {
+        if (newChannel->signalType == AmplifierSignal) {
+            // Set DAC 1 to selected channel and label it accordingly.
+            dacSelectedChannel[0] = newChannel;
             if (!synthMode) {
                 evalBoard->selectDacDataStream(0, newChannel->boardStream);
                 evalBoard->selectDacDataChannel(0, newChannel->chipChannel);
             }
             setDacChannelLabel(0, newChannel->customChannelName,
                                newChannel->nativeChannelName);
+            updateDacThresholdTracking();
         }
     }
 }
@@ -3472,6 +4506,7 @@ void MainWindow::loadSettings()
     inStream >> tempQint16;
     dac8ThresholdEnableCheckBox->setChecked((bool) tempQint16);
     dacThresholdEnable();
+    updateDacThresholdTracking();
 
     inStream >> tempQint16;
     saveTtlOut = (bool) tempQint16;
@@ -3558,6 +4593,14 @@ void MainWindow::loadSettings()
         setChargeRecoveryParameters(chargeRecoveryMode, chargeRecoveryCurrentLimit, chargeRecoveryTargetVoltage);
     }
 
+    // Settings files from version 1.1 on also store the number of notch filter harmonics.
+    if (versionMain > 1 || versionSecondary >= 1) {
+        inStream >> tempQint16;
+        notchFilterHarmonicsSpinBox->setValue(tempQint16);
+    } else {
+        notchFilterHarmonicsSpinBox->setValue(1);
+    }
+
     settingsFile.close();
 
     wavePlot->refreshScreen();
@@ -3696,6 +4739,8 @@ void MainWindow::saveSettings()
     outStream << (qint16) chargeRecoveryCurrentLimit;
     outStream << chargeRecoveryTargetVoltage;
 
+    outStream << (qint16) notchFilterHarmonics;
+
     settingsFile.close();
 
     statusBar()->clearMessage();
@@ -3721,11 +4766,249 @@ void MainWindow::runImpedanceMeasurement()
     }
 
     Rhs2000Registers chipRegisters(boardSampleRate, stimStep);
-    int commandSequenceLength, stream, channel, capRange;
-    double cSeries;
+    int stream, channel;
+    vector<unsigned int> commandList;
+
+    // Create a command list for the AuxCmd1 slot.
+    chipRegisters.createCommandListZcheckDac(commandList, actualImpedanceFreq, 128.0);
+
+    // Select number of periods to measure impedance over
+    int numPeriods = qRound(0.020 * actualImpedanceFreq); // Test each channel for at least 20 msec...
+    if (numPeriods < 5) numPeriods = 5; // ...but always measure across no fewer than 5 complete periods
+
+    QVector<QVector<QVector<double> > > measuredMagnitude;
+    QVector<QVector<QVector<double> > > measuredPhase;
+    if (!acquireImpedanceData(commandList, QVector<double>(1, actualImpedanceFreq),
+                              qRound(boardSampleRate / actualImpedanceFreq), numPeriods,
+                              tr("Measuring Electrode Impedances"), measuredMagnitude, measuredPhase)) {
+        wavePlot->setFocus();
+        return;
+    }
+
+    SignalChannel *signalChannel;
+    double impedanceMagnitude, impedancePhase;
+
+    const double dacVoltageAmplitude = 128 * (1.225 / 256);  // this assumes the DAC amplitude was set to 128
+
+    int bestAmplitudeIndex;
+    double saturationVoltage = approximateSaturationVoltage(actualImpedanceFreq, actualUpperBandwidth);
+
+    for (stream = 0; stream < evalBoard->getNumEnabledDataStreams(); ++stream) {
+        for (channel = 0; channel < 16; ++channel) {
+            signalChannel = signalSources->findAmplifierChannel(stream, channel);
+            if (signalChannel) {
+
+                // Make sure chosen capacitor is below saturation voltage
+                if (measuredMagnitude[stream][channel][2] < saturationVoltage) {
+                    bestAmplitudeIndex = 2;
+                } else if (measuredMagnitude[stream][channel][1] < saturationVoltage) {
+                    bestAmplitudeIndex = 1;
+                } else {
+                    bestAmplitudeIndex = 0;
+                }
+
+                // If C2 and C3 are too close, C3 is probably saturated. Ignore C3.
+                double capRatio = measuredMagnitude[stream][channel][1] / measuredMagnitude[stream][channel][2];
+                if (capRatio > 0.2) {
+                    if (bestAmplitudeIndex == 2) {
+                        bestAmplitudeIndex = 1;
+                    }
+                }
+
+                impedanceFromVoltage(measuredMagnitude[stream][channel][bestAmplitudeIndex],
+                                     measuredPhase[stream][channel][bestAmplitudeIndex],
+                                     actualImpedanceFreq, dacVoltageAmplitude, bestAmplitudeIndex,
+                                     impedanceMagnitude, impedancePhase);
+
+                signalChannel->electrodeImpedanceMagnitude = impedanceMagnitude;
+                signalChannel->electrodeImpedancePhase = impedancePhase;
+            }
+        }
+    }
+
+    saveImpedancesButton->setEnabled(true);
+    showImpedanceCheckBox->setChecked(true);
+    showImpedances(true);
+    wavePlot->setFocus();
+}
+
+// Measure electrode impedances at several frequencies in one acquisition pass.  The
+// on-chip impedance testing DAC plays a multi-tone waveform (a sum of harmonics of
+// one fundamental frequency) and the magnitude and phase of every tone is extracted
+// from the same samples, so an impedance spectrum takes about as long as a
+// single-frequency measurement.  The price is a smaller test current per tone.
+void MainWindow::runImpedanceSpectrumMeasurement()
+{
+    if (synthMode) {
+        QMessageBox::information(this, tr("Impedance Spectrum"),
+                                 tr("Impedance spectra cannot be measured with synthesized data."));
+        wavePlot->setFocus();
+        return;
+    }
+
+    int period;
+    vector<int> harmonics;
+    if (!impedanceSpectrumTones(period, harmonics)) {
+        QMessageBox::warning(this, tr("Impedance Spectrum"),
+                             tr("The amplifier bandwidth and sampling rate leave too few valid "
+                                "impedance test frequencies for a spectrum measurement."));
+        wavePlot->setFocus();
+        return;
+    }
+
+    Rhs2000Registers chipRegisters(boardSampleRate, stimStep);
+    int stream, channel, capRange, f;
+    vector<unsigned int> commandList;
+    double toneAmplitude;
+    vector<double> tonePhases;
+
+    // Create a multi-tone command list for the AuxCmd1 slot.
+    if (chipRegisters.createCommandListZcheckDac(commandList, period, harmonics, 128.0,
+                                                 toneAmplitude, tonePhases) < 0) {
+        wavePlot->setFocus();
+        return;
+    }
+
+    const int numTones = harmonics.size();
+    QVector<double> frequencies(numTones);
+    for (f = 0; f < numTones; ++f) {
+        frequencies[f] = harmonics[f] * boardSampleRate / period;
+    }
+
+    // Test each channel for at least 20 msec, but always measure across no fewer than 2
+    // complete periods of the fundamental.
+    int numPeriods = qRound(0.020 * boardSampleRate / period);
+    if (numPeriods < 2) numPeriods = 2;
+
+    QVector<QVector<QVector<double> > > measuredMagnitude;
+    QVector<QVector<QVector<double> > > measuredPhase;
+    if (!acquireImpedanceData(commandList, frequencies, period, numPeriods,
+                              tr("Measuring Electrode Impedance Spectra"), measuredMagnitude, measuredPhase)) {
+        wavePlot->setFocus();
+        return;
+    }
+
+    SignalChannel *signalChannel;
+    double impedanceMagnitude, impedancePhase;
+
+    const double dacVoltageAmplitude = toneAmplitude * (1.225 / 256);
+
+    QVector<double> saturationVoltage(numTones);
+    for (f = 0; f < numTones; ++f) {
+        saturationVoltage[f] = approximateSaturationVoltage(frequencies[f], actualUpperBandwidth);
+    }
+
+    for (stream = 0; stream < evalBoard->getNumEnabledDataStreams(); ++stream) {
+        for (channel = 0; channel < 16; ++channel) {
+            signalChannel = signalSources->findAmplifierChannel(stream, channel);
+            if (signalChannel) {
+                const QVector<double> &magnitude = measuredMagnitude[stream][channel];
+                const QVector<double> &phase = measuredPhase[stream][channel];
+
+                // All tones share one Cseries value.  Choose the largest capacitor for which the
+                // tones together stay below the saturation voltage.
+                int bestAmplitudeIndex = 0;
+                for (capRange = 2; capRange >= 1; --capRange) {
+                    double load = 0.0;
+                    for (f = 0; f < numTones; ++f) {
+                        load += magnitude[capRange * numTones + f] / saturationVoltage[f];
+                    }
+                    if (load < 1.0) {
+                        bestAmplitudeIndex = capRange;
+                        break;
+                    }
+                }
+
+                // If C2 and C3 are too close at any tone, C3 is probably saturated. Ignore C3.
+                if (bestAmplitudeIndex == 2) {
+                    for (f = 0; f < numTones; ++f) {
+                        if (magnitude[numTones + f] / magnitude[2 * numTones + f] > 0.2) {
+                            bestAmplitudeIndex = 1;
+                        }
+                    }
+                }
+
+                signalChannel->electrodeImpedanceSpectrumMagnitude.resize(numTones);
+                signalChannel->electrodeImpedanceSpectrumPhase.resize(numTones);
+                for (f = 0; f < numTones; ++f) {
+                    // Refer the phase of each tone to the phase at which the DAC played it.
+                    impedanceFromVoltage(magnitude[bestAmplitudeIndex * numTones + f],
+                                         phase[bestAmplitudeIndex * numTones + f] - RADIANS_TO_DEGREES * tonePhases[f],
+                                         frequencies[f], dacVoltageAmplitude, bestAmplitudeIndex,
+                                         impedanceMagnitude, impedancePhase);
+                    if (impedancePhase > 180.0) impedancePhase -= 360.0;
+                    if (impedancePhase <= -180.0) impedancePhase += 360.0;
+
+                    signalChannel->electrodeImpedanceSpectrumMagnitude[f] = impedanceMagnitude;
+                    signalChannel->electrodeImpedanceSpectrumPhase[f] = impedancePhase;
+                }
+            }
+        }
+    }
+
+    impedanceSpectrumFrequencies = frequencies;
+    showImpedanceSpectrumButton->setEnabled(true);
+    showImpedanceSpectrum();
+}
+
+// Open the Impedance Spectrum dialog showing the results of the last impedance spectrum measurement.
+void MainWindow::showImpedanceSpectrum()
+{
+    if (!impedanceSpectrumDialog) {
+        impedanceSpectrumDialog = new ImpedanceSpectrumDialog(signalSources, this);
+    }
+    impedanceSpectrumDialog->setSpectra(impedanceSpectrumFrequencies, evalBoard->getNumEnabledDataStreams());
+
+    impedanceSpectrumDialog->show();
+    impedanceSpectrumDialog->raise();
+    impedanceSpectrumDialog->activateWindow();
+    wavePlot->setFocus();
+}
+
+// Choose the tones of an impedance spectrum measurement: harmonics of sampleRate / period
+// close to a 1-2-5 series of frequencies from 100 Hz to 5 kHz, keeping only those within the
+// valid impedance test range (see updateImpedanceFrequency()).  Returns false if fewer than
+// two tones are valid.
+bool MainWindow::impedanceSpectrumTones(int &period, vector<int> &harmonics)
+{
+    const double nominalFrequencies[] = { 100.0, 200.0, 500.0, 1000.0, 2000.0, 5000.0 };
+    double lowerBandwidthLimit, upperBandwidthLimit;
+    impedanceFrequencyLimits(lowerBandwidthLimit, upperBandwidthLimit);
+
+    period = qRound(boardSampleRate / nominalFrequencies[0]);
+    harmonics.clear();
+    for (unsigned int i = 0; i < sizeof(nominalFrequencies) / sizeof(double); ++i) {
+        int harmonic = qRound(nominalFrequencies[i] * period / boardSampleRate);
+        double frequency = harmonic * boardSampleRate / period;
+        if (harmonic < 1 || 4 * harmonic > period ||
+                frequency < lowerBandwidthLimit || frequency > upperBandwidthLimit) {
+            continue;
+        }
+        if (harmonics.empty() || harmonic > harmonics.back()) {
+            harmonics.push_back(harmonic);
+        }
+    }
+    return harmonics.size() >= 2;
+}
+
+// Run one complete electrode impedance measurement: play dacCommandList (a Zcheck DAC waveform
+// that repeats every period samples) into each amplifier channel in turn with each of the three
+// Cseries values, and measure the magnitude and phase of the electrode voltage at each of the
+// listed frequencies over numPeriods periods.  Results are returned in measuredMagnitude and
+// measuredPhase, indexed by [stream][channel][capRange * frequencies.size() + frequency index].
+// Returns false if the user aborted the measurement.
+bool MainWindow::acquireImpedanceData(const vector<unsigned int> &dacCommandList, const QVector<double> &frequencies,
+                                      int period, int numPeriods, const QString &progressText,
+                                      QVector<QVector<QVector<double> > > &measuredMagnitude,
+                                      QVector<QVector<QVector<double> > > &measuredPhase)
+{
+    Rhs2000Registers chipRegisters(boardSampleRate, stimStep);
+    int commandSequenceLength, channel, capRange;
     vector<unsigned int> commandList;
     int triggerIndex;                       // dummy reference variable; not used
     queue<Rhs2000DataBlock> bufferQueue;    // dummy reference variable; not used
+    const int numFrequencies = frequencies.size();
+    bool canceled = false;
 
     // Disable DACs
     for (int i = 0; i < 8; i++) {
@@ -3735,24 +5018,18 @@ void MainWindow::runImpedanceMeasurement()
     statusBar()->showMessage("Measuring electrode impedances...");
 
     // Create a progress bar to let user know how long this will take.
-    QProgressDialog progress("Measuring Electrode Impedances", "Abort", 0, 50, this);
+    QProgressDialog progress(progressText, "Abort", 0, 50, this);
     progress.setWindowTitle("Progress");
     progress.setMinimumDuration(0);
     progress.setModal(true);
     progress.setValue(0);
 
-    // Create a command list for the AuxCmd1 slot.
-    commandSequenceLength =
-            chipRegisters.createCommandListZcheckDac(commandList, actualImpedanceFreq, 128.0);
-    evalBoard->uploadCommandList(commandList, Rhs2000EvalBoard::AuxCmd1);
-    evalBoard->selectAuxCommandLength(Rhs2000EvalBoard::AuxCmd1, 0, commandSequenceLength - 1);
+    // Upload the DAC waveform to the AuxCmd1 slot.
+    evalBoard->uploadCommandList(dacCommandList, Rhs2000EvalBoard::AuxCmd1);
+    evalBoard->selectAuxCommandLength(Rhs2000EvalBoard::AuxCmd1, 0, dacCommandList.size() - 1);
 
     progress.setValue(1);
 
-    // Select number of periods to measure impedance over
-    int numPeriods = qRound(0.020 * actualImpedanceFreq); // Test each channel for at least 20 msec...
-    if (numPeriods < 5) numPeriods = 5; // ...but always measure across no fewer than 5 complete periods
-    double period = boardSampleRate / actualImpedanceFreq;
     int numBlocks = qCeil((numPeriods + 2.0) * period / SAMPLES_PER_DATA_BLOCK);  // + 2 periods to give time to settle initially
     if (numBlocks < 2) numBlocks = 2;   // need first block for command to switch channels to take effect.
 
@@ -3769,53 +5046,51 @@ void MainWindow::runImpedanceMeasurement()
     evalBoard->setContinuousRunMode(false);
     evalBoard->setMaxTimeStep(SAMPLES_PER_DATA_BLOCK * numBlocks);
 
-    // Create matrices of doubles of size (numStreams x 16 x 3) to store complex amplitudes
-    // of all amplifier channels (16 on each data stream) at three different Cseries values.
-    QVector<QVector<QVector<double> > > measuredMagnitude;
-    QVector<QVector<QVector<double> > > measuredPhase;
+    // Create matrices of doubles of size (numStreams x 16 x 3 * numFrequencies) to store complex
+    // amplitudes of all amplifier channels (16 on each data stream) at three different Cseries values.
     measuredMagnitude.resize(evalBoard->getNumEnabledDataStreams());
     measuredPhase.resize(evalBoard->getNumEnabledDataStreams());
     for (int i = 0; i < evalBoard->getNumEnabledDataStreams(); ++i) {
         measuredMagnitude[i].resize(16);
         measuredPhase[i].resize(16);
         for (int j = 0; j < 16; ++j) {
-            measuredMagnitude[i][j].resize(3);
-            measuredPhase[i][j].resize(3);
+            measuredMagnitude[i][j].resize(3 * numFrequencies);
+            measuredPhase[i][j].resize(3 * numFrequencies);
         }
     }
 
     // We execute three complete electrode impedance measurements: one each with
     // Cseries set to 0.1 pF, 1 pF, and 10 pF.  Then we select the best measurement
     // for each channel so that we achieve a wide impedance measurement range.
-    for (capRange = 0; capRange < 3; ++ capRange) {
-        switch (capRange) {
-        case 0:
-            chipRegisters.setZcheckScale(Rhs2000Registers::ZcheckCs100fF);
-            cSeries = 0.1e-12;
-            break;
-        case 1:
-            chipRegisters.setZcheckScale(Rhs2000Registers::ZcheckCs1pF);
-            cSeries = 1.0e-12;
-            break;
-        case 2:
-            chipRegisters.setZcheckScale(Rhs2000Registers::ZcheckCs10pF);
-            cSeries = 10.0e-12;
-            break;
-        }
-
-        // Check all 16 channels across all active data streams.
-        for (channel = 0; channel < 16; ++channel) {
-
-            progress.setValue(16 * capRange + channel + 2);
+    // Each measurement checks all 16 channels across all active data streams, one
+    // channel per step.  Steps are pipelined: while the board acquires data for
+    // one step, the data from the previous step are analyzed.
+    const int numSteps = 3 * 16;
+    queue<Rhs2000DataBlock> stepQueue;
+    QVector<double> stepMagnitude, stepPhase;
+    int analysisStep = -1;
+    for (int step = 0; step <= numSteps; ++step) {
+        if (step < numSteps) {
+            capRange = step / 16;
+            channel = step % 16;
+
+            progress.setValue(step + 2);
             if (progress.wasCanceled()) {
-                evalBoard->setContinuousRunMode(false);
-                evalBoard->setMaxTimeStep(0);
-                evalBoard->flush();
-                statusBar()->clearMessage();
-                wavePlot->setFocus();
-                return;
+                canceled = true;
+                break;
             }
 
+            switch (capRange) {
+            case 0:
+                chipRegisters.setZcheckScale(Rhs2000Registers::ZcheckCs100fF);
+                break;
+            case 1:
+                chipRegisters.setZcheckScale(Rhs2000Registers::ZcheckCs1pF);
+                break;
+            case 2:
+                chipRegisters.setZcheckScale(Rhs2000Registers::ZcheckCs10pF);
+                break;
+            }
             chipRegisters.setZcheckChannel(channel);
             commandSequenceLength =
                     chipRegisters.createCommandListRegisterConfig(commandList, false);
@@ -3823,95 +5098,30 @@ void MainWindow::runImpedanceMeasurement()
             evalBoard->uploadCommandList(commandList, Rhs2000EvalBoard::AuxCmd3);
 
             evalBoard->run();
-            while (evalBoard->isRunning() ) {
-                qApp->processEvents();
-            }
-            evalBoard->readDataBlocks(numBlocks, dataQueue);
+        }
 
-            signalProcessor->loadAmplifierData(dataQueue, numBlocks, false, 0, 0, triggerIndex, false, bufferQueue,
+        // Analyze the previous step while the board runs.
+        if (analysisStep >= 0) {
+            signalProcessor->loadAmplifierData(stepQueue, numBlocks, false, 0, 0, triggerIndex, false, bufferQueue,
                                                false, *saveStream, saveFormat, false, false, 0, ReferenceSource{0, 0, false});
-            for (stream = 0; stream < evalBoard->getNumEnabledDataStreams(); ++stream) {
-                signalProcessor->measureComplexAmplitude(measuredMagnitude, measuredPhase,
-                                                    capRange, stream, channel,  numBlocks, boardSampleRate,
-                                                    actualImpedanceFreq, numPeriods);
+            signalProcessor->measureComplexAmplitudes(stepMagnitude, stepPhase, analysisStep % 16, numBlocks,
+                                                      boardSampleRate, frequencies, period, numPeriods);
+            for (int stream = 0; stream < evalBoard->getNumEnabledDataStreams(); ++stream) {
+                for (int f = 0; f < numFrequencies; ++f) {
+                    int index = (analysisStep / 16) * numFrequencies + f;
+                    measuredMagnitude[stream][analysisStep % 16][index] = stepMagnitude[stream * numFrequencies + f];
+                    measuredPhase[stream][analysisStep % 16][index] = stepPhase[stream * numFrequencies + f];
+                }
             }
-
+            analysisStep = -1;
         }
-    }
-
-    SignalChannel *signalChannel;
-    double current, Cseries;
-    double impedanceMagnitude, impedancePhase;
-
-    const double dacVoltageAmplitude = 128 * (1.225 / 256);  // this assumes the DAC amplitude was set to 128
-    const double parasiticCapacitance = 12.0e-12;  // 12 pF: an estimate of on-chip parasitic capacitance,
-                                                   // including effective amplifier input capacitance.
-    double relativeFreq = actualImpedanceFreq / boardSampleRate;
-
-    int bestAmplitudeIndex;
-    double saturationVoltage = approximateSaturationVoltage(actualImpedanceFreq, actualUpperBandwidth);
-
-    for (stream = 0; stream < evalBoard->getNumEnabledDataStreams(); ++stream) {
-        for (channel = 0; channel < 16; ++channel) {
-            signalChannel = signalSources->findAmplifierChannel(stream, channel);
-            if (signalChannel) {
-
-                // Make sure chosen capacitor is below saturation voltage
-                if (measuredMagnitude[stream][channel][2] < saturationVoltage) {
-                    bestAmplitudeIndex = 2;
-                } else if (measuredMagnitude[stream][channel][1] < saturationVoltage) {
-                    bestAmplitudeIndex = 1;
-                } else {
-                    bestAmplitudeIndex = 0;
-                }
-
-                // If C2 and C3 are too close, C3 is probably saturated. Ignore C3.
-                double capRatio = measuredMagnitude[stream][channel][1] / measuredMagnitude[stream][channel][2];
-                if (capRatio > 0.2) {
-                    if (bestAmplitudeIndex == 2) {
-                        bestAmplitudeIndex = 1;
-                    }
-                }
-
-                switch (bestAmplitudeIndex) {
-                case 0:
-                    Cseries = 0.1e-12;
-                    break;
-                case 1:
-                    Cseries = 1.0e-12;
-                    break;
-                case 2:
-                    Cseries = 10.0e-12;
-                    break;
-                }
-
-                // Calculate current amplitude produced by on-chip voltage DAC
-                current = TWO_PI * actualImpedanceFreq * dacVoltageAmplitude * Cseries;
-
-                // Calculate impedance magnitude from calculated current and measured voltage.
-                impedanceMagnitude = 1.0e-6 * (measuredMagnitude[stream][channel][bestAmplitudeIndex] / current) *
-                        (18.0 * relativeFreq * relativeFreq + 1.0);
-
-                // Calculate impedance phase, with small correction factor accounting for the
-                // 3-command SPI pipeline delay.
-                impedancePhase = measuredPhase[stream][channel][bestAmplitudeIndex] + (360.0 * (3.0 / period));
 
-                // Factor out on-chip parasitic capacitance from impedance measurement.
-                factorOutParallelCapacitance(impedanceMagnitude, impedancePhase, actualImpedanceFreq,
-                                             parasiticCapacitance);
-
-                // Perform empirical resistance correction to improve accuracy at sample rates below
-                // 15 kS/s.
-                // NOTE: After refining the impedance measurement algorithm, Intan has determined this empirical correction is no longer necessary for accurate measurements
-                //empiricalResistanceCorrection(impedanceMagnitude, impedancePhase,
-                                              //boardSampleRate);
-
-                // Multiply by a factor of 10%: empirical tests indicate that RHS chips usually underestimate impedance by about 10%
-                impedanceMagnitude *= 1.1;
-
-                signalChannel->electrodeImpedanceMagnitude = impedanceMagnitude;
-                signalChannel->electrodeImpedancePhase = impedancePhase;
+        if (step < numSteps) {
+            while (evalBoard->isRunning() ) {
+                qApp->processEvents();
             }
+            evalBoard->readDataBlocks(numBlocks, stepQueue);
+            analysisStep = step;
         }
     }
 
@@ -3929,13 +5139,60 @@ void MainWindow::runImpedanceMeasurement()
         evalBoard->enableDac(i, dacEnabled[i]);
     }
 
-    saveImpedancesButton->setEnabled(true);
     statusBar()->clearMessage();
-    showImpedanceCheckBox->setChecked(true);
-    showImpedances(true);
-    wavePlot->setFocus();
+    return !canceled;
 }
 
+// Calculate an electrode impedance from the measured magnitude (in microvolts) and phase
+// (in degrees) of the electrode voltage at one frequency, given the amplitude (in volts) of
+// that frequency in the Zcheck DAC waveform and the Cseries value used (0 = 0.1 pF,
+// 1 = 1 pF, 2 = 10 pF).
+void MainWindow::impedanceFromVoltage(double measuredMagnitude, double measuredPhase, double frequency,
+                                      double dacVoltageAmplitude, int capRange,
+                                      double &impedanceMagnitude, double &impedancePhase)
+{
+    double current, Cseries;
+    const double parasiticCapacitance = 12.0e-12;  // 12 pF: an estimate of on-chip parasitic capacitance,
+                                                   // including effective amplifier input capacitance.
+    double relativeFreq = frequency / boardSampleRate;
+    double period = boardSampleRate / frequency;
+
+    switch (capRange) {
+    case 0:
+        Cseries = 0.1e-12;
+        break;
+    case 1:
+        Cseries = 1.0e-12;
+        break;
+    default:
+        Cseries = 10.0e-12;
+        break;
+    }
+
+    // Calculate current amplitude produced by on-chip voltage DAC
+    current = TWO_PI * frequency * dacVoltageAmplitude * Cseries;
+
+    // Calculate impedance magnitude from calculated current and measured voltage.
+    impedanceMagnitude = 1.0e-6 * (measuredMagnitude / current) *
+            (18.0 * relativeFreq * relativeFreq + 1.0);
+
+    // Calculate impedance phase, with small correction factor accounting for the
+    // 3-command SPI pipeline delay.
+    impedancePhase = measuredPhase + (360.0 * (3.0 / period));
+
+    // Factor out on-chip parasitic capacitance from impedance measurement.
+    factorOutParallelCapacitance(impedanceMagnitude, impedancePhase, frequency,
+                                 parasiticCapacitance);
+
+    // Perform empirical resistance correction to improve accuracy at sample rates below
+    // 15 kS/s.
+    // NOTE: After refining the impedance measurement algorithm, Intan has determined this empirical correction is no longer necessary for accurate measurements
+    //empiricalResistanceCorrection(impedanceMagnitude, impedancePhase,
+                                  //boardSampleRate);
+
+    // Multiply by a factor of 10%: empirical tests indicate that RHS chips usually underestimate impedance by about 10%
+    impedanceMagnitude *= 1.1;
+}
 
 // Use a 2nd order Low Pass Filter to model the approximate voltage at which the amplifiers saturate
 // which depends on the impedance frequency and the amplifier bandwidth.
@@ -4060,6 +5317,14 @@ void MainWindow::plotPointsMode(bool enabled)
     wavePlot->setFocus();
 }
 
+// Set the rate at which the waveform display is refreshed during a run,
+// independently of the amount of data processed at a time.
+void MainWindow::changeDisplayRefreshRate(int index)
+{
+    const double rates[3] = { 15.0, 30.0, 60.0 };
+    wavePlot->setRefreshRate(rates[index]);
+}
+
 void MainWindow::setStatusBarReady()
 {
     if (!synthMode) {
@@ -4083,7 +5348,10 @@ void MainWindow::setStatusBarRecording(double bytesPerMinute, double totalElapse
     QTime recordTime(0, 0, 0, 0);
     QString timeString = recordTime.addSecs((int)totalElapsedRecordTimeSeconds).toString("hh:mm:ss");
 
-    if (!synthMode) {
+    if (saveFormat == SaveFormatSpikeSnippets) {
+        statusBarLabel->setText("<b>" + timeString + "</b>  Saving spike events to " + saveFileName +
+                                ".  (Continuous waveforms are not saved.)");
+    } else if (!synthMode) {
         statusBarLabel->setText("<b>" + timeString + "</b>  Saving data to file " + saveFileName + ".  (" +
                                 QString::number(bytesPerMinute / (1024.0 * 1024.0), 'f', 1) +
                                 " MB/minute.  File size may be reduced by disabling unused inputs.)");
@@ -4109,6 +5377,7 @@ void MainWindow::setStatusBarWaitForTrigger()
 void MainWindow::setSaveFormat(SaveFormat format)
 {
     saveFormat = format;
+    applySpikeDetection();
 }
 
 // Create and open a new save file for data (saveFile), and create a new
@@ -4129,7 +5398,7 @@ bool MainWindow::startNewSaveFile(SaveFormat format)
         saveFileName += dateTime.toString("HHmmss");    // time stamp
         saveFileName += ".rhs";
 
-        saveFile = new QFile(saveFileName);
+        saveFile = new ChecksummedFile(saveFileName, saveChecksums);
 
         if (!saveFile->open(QIODevice::WriteOnly)) {
             QMessageBox::critical(this, tr("File Open Error"),
@@ -4149,6 +5418,14 @@ bool MainWindow::startNewSaveFile(SaveFormat format)
         // to save disk space.
         saveStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
 
+        saveSidecarPath = fileInfo.path();
+        saveSidecarBaseName = QFileInfo(saveFileName).completeBaseName();
+        if (!openSpikeEventFile(format)) {
+            return false;
+        }
+        openSaveJournal(format);
+        openPhaseLog();
+
     } else if (format == SaveFormatFilePerSignalType) {
         // Create 'save file' name for status bar display.
         saveFileName = fileInfo.path();
@@ -4200,6 +5477,14 @@ bool MainWindow::startNewSaveFile(SaveFormat format)
         // to save disk space.
         infoStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
 
+        saveSidecarPath = subdir.path();
+        saveSidecarBaseName = "session";
+        if (!openSpikeEventFile(format)) {
+            return false;
+        }
+        openSaveJournal(format);
+        openPhaseLog();
+
     } else if (format == SaveFormatFilePerChannel) {
         // Create 'save file' name for status bar display.
         saveFileName = fileInfo.path();
@@ -4253,11 +5538,83 @@ bool MainWindow::startNewSaveFile(SaveFormat format)
         // Write 4-byte floating-point numbers (instead of the default 8-byte numbers)
         // to save disk space.
         infoStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        saveSidecarPath = subdir.path();
+        saveSidecarBaseName = "session";
+        if (!openSpikeEventFile(format)) {
+            return false;
+        }
+        openSaveJournal(format);
+        openPhaseLog();
+
+    } else if (format == SaveFormatSpikeSnippets) {
+        // Create 'save file' name for status bar display.
+        saveFileName = fileInfo.path();
+        saveFileName += "/";
+        saveFileName += fileInfo.baseName();
+        saveFileName += "_";
+        saveFileName += dateTime.toString("yyMMdd");    // date stamp
+        saveFileName += "_";
+        saveFileName += dateTime.toString("HHmmss");    // time stamp
+
+        // Create subdirectory for spike event and info files.
+        QString subdirName;
+        subdirName = fileInfo.baseName();
+        subdirName += "_";
+        subdirName += dateTime.toString("yyMMdd");    // date stamp
+        subdirName += "_";
+        subdirName += dateTime.toString("HHmmss");    // time stamp
+
+        QDir dir(fileInfo.path());
+        dir.mkdir(subdirName);
+
+        QDir subdir(fileInfo.path() + "/" + subdirName);
+
+        infoFileName = subdir.path() + "/" + "info.rhs";
+
+        infoFile = new QFile(infoFileName);
+
+        if (!infoFile->open(QIODevice::WriteOnly)) {
+            QMessageBox::critical(this, tr("File Open Error"),
+                                  tr("Cannot open file for writing. Please ensure the data file can be created in "
+                                     "the selected directory before recording."));
+            return false;
+        }
+
+        infoStream = new QDataStream(infoFile);
+        infoStream->setVersion(QDataStream::Qt_4_8);
+
+        // Set to little endian mode for compatibilty with MATLAB,
+        // which is little endian on all platforms
+        infoStream->setByteOrder(QDataStream::LittleEndian);
+
+        // Write 4-byte floating-point numbers (instead of the default 8-byte numbers)
+        // to save disk space.
+        infoStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        saveSidecarPath = subdir.path();
+        saveSidecarBaseName = "session";
+        if (!openSpikeEventFile(format)) {
+            return false;
+        }
+        openSaveJournal(format);
+        openPhaseLog();
     }
     return true;
 }
 
 void MainWindow::closeSaveFile(SaveFormat format) {
+    // Write the final journal checkpoint and data file checksums while the data files are still open.
+    if (saveJournal) {
+        saveJournal->close();
+        delete saveJournal;
+        saveJournal = nullptr;
+    }
+    if (saveChecksums) {
+        ChecksummedFile::writeChecksumFile(ChecksummedFile::checksumFileName(saveSidecarPath, saveSidecarBaseName),
+                                           saveDataFileList(format));
+    }
+
     switch (format) {
     case SaveFormatIntan:
         saveFile->close();
@@ -4280,19 +5637,101 @@ void MainWindow::closeSaveFile(SaveFormat format) {
         delete infoStream;
         delete infoFile;
         break;
+
+    case SaveFormatSpikeSnippets:
+        infoFile->close();
+        delete infoStream;
+        delete infoFile;
+        break;
+    }
+
+    if (spikeEventFile) {
+        spikeEventFile->close();
+        delete spikeEventFile;
+        spikeEventFile = nullptr;
+    }
+    closePhaseLog();
+}
+
+// Return a list of all open data files for the current recording.
+QVector<ChecksummedFile*> MainWindow::saveDataFileList(SaveFormat format)
+{
+    QVector<ChecksummedFile*> dataFiles;
+    if (format == SaveFormatIntan) {
+        dataFiles.append(saveFile);
+    } else {
+        dataFiles = signalProcessor->openSaveFileList(signalSources, format, saveDcAmps);
+    }
+    if (spikeEventFile) {
+        dataFiles.append(spikeEventFile->getFile());
+    }
+    return dataFiles;
+}
+
+// Create a spike event file for the current recording if spike events are
+// saved, listing all enabled amplifier channels.  Returns false if the file
+// cannot be created.
+bool MainWindow::openSpikeEventFile(SaveFormat format)
+{
+    if (format != SaveFormatSpikeSnippets && !(spikeDetectionSettings.enabled && spikeDetectionSettings.saveEvents)) {
+        return true;
+    }
+
+    QVector<SignalChannel*> channels;
+    QVector<int> channelLanes;
+    for (int port = 0; port < signalSources->signalPort.size(); ++port) {
+        for (int index = 0; index < signalSources->signalPort[port].numChannels(); ++index) {
+            SignalChannel *channel = signalSources->signalPort[port].channelByNativeOrder(index);
+            if (channel->enabled && channel->signalType == AmplifierSignal) {
+                channels.append(channel);
+                channelLanes.append(signalProcessor->amplifierLane(channel->boardStream, channel->chipChannel));
+            }
+        }
+    }
+
+    spikeEventFile = new SpikeEventFile();
+    if (!spikeEventFile->open(SpikeEventFile::spikeFileName(saveSidecarPath, saveSidecarBaseName), saveChecksums,
+                              boardSampleRate, *signalProcessor->getSpikeDetector(),
+                              spikeDetectionSettings.saveSnippets, channels, channelLanes)) {
+        delete spikeEventFile;
+        spikeEventFile = nullptr;
+        QMessageBox::critical(this, tr("File Open Error"),
+                              tr("Cannot open spike event file for writing. Please ensure the file can be created in "
+                                 "the selected directory before recording."));
+        return false;
+    }
+    return true;
+}
+
+// Create a crash recovery journal listing all open data files, if enabled.
+// Failure to create the journal is reported but does not stop recording.
+void MainWindow::openSaveJournal(SaveFormat format)
+{
+    if (!saveJournalEnabled) return;
+
+    saveJournal = new SaveJournal();
+    if (!saveJournal->open(SaveJournal::journalFileName(saveSidecarPath, saveSidecarBaseName), format, boardSampleRate,
+                           saveDataFileList(format), checkpointPeriodSeconds)) {
+        delete saveJournal;
+        saveJournal = nullptr;
     }
 }
 
 // Launch save file format selection dialog.
 void MainWindow::setSaveFormatDialog()
 {
-    SetSaveFormatDialog saveFormatDialog(saveFormat, saveTtlOut, saveDcAmps, newSaveFilePeriodMinutes, this);
+    SetSaveFormatDialog saveFormatDialog(saveFormat, saveTtlOut, saveDcAmps, newSaveFilePeriodMinutes,
+                                         saveJournalEnabled, checkpointPeriodSeconds, saveChecksums, this);
 
     if (saveFormatDialog.exec()) {
         saveFormat = (SaveFormat) saveFormatDialog.buttonGroup->checkedId();
         saveTtlOut = (saveFormatDialog.saveTtlOutCheckBox->checkState() == Qt::Checked);
         saveDcAmps = (saveFormatDialog.saveDcAmpsCheckBox->checkState() == Qt::Checked);
         newSaveFilePeriodMinutes = saveFormatDialog.recordTimeSpinBox->value();
+        saveJournalEnabled = (saveFormatDialog.saveJournalCheckBox->checkState() == Qt::Checked);
+        checkpointPeriodSeconds = saveFormatDialog.checkpointPeriodSpinBox->value();
+        saveChecksums = (saveFormatDialog.saveChecksumsCheckBox->checkState() == Qt::Checked);
+        signalProcessor->setSaveChecksumsEnabled(saveChecksums);
 
         setSaveFormat(saveFormat);
     }
@@ -4357,6 +5796,84 @@ void MainWindow::dacThresholdEnable()
     }
 }
 
+// Track the noise of the channels routed to the DACs if adaptive DAC thresholds
+// are enabled.  The tracker filters the data like the DAC high-pass filter, so
+// it is updated whenever DAC routing or that filter changes.
+void MainWindow::updateDacThresholdTracking()
+{
+    bool adaptive = dacAdaptiveThresholdCheckBox->isChecked();
+    QVector<int> lanes(8, -1);
+    for (int dac = 0; dac < 8; ++dac) {
+        SignalChannel *channel = dacSelectedChannel[dac];
+        if (dacEnabled[dac] && channel && channel->signalType == AmplifierSignal) {
+            lanes[dac] = signalProcessor->amplifierLane(channel->boardStream, channel->chipChannel);
+        }
+    }
+    signalProcessor->setDacThresholdTracking(adaptive, lanes, highpassFilterEnabled ? highpassFilterFrequency : 0.0,
+                                             DAC_NOISE_TIME_CONSTANT_SEC, boardSampleRate);
+    dacThresholdUpdateTimer.invalidate();
+
+    // Thresholds are set automatically while tracking.
+    dac1ThresholdSpinBox->setEnabled(!adaptive);
+    dac2ThresholdSpinBox->setEnabled(!adaptive);
+    dac3ThresholdSpinBox->setEnabled(!adaptive);
+    dac4ThresholdSpinBox->setEnabled(!adaptive);
+    dac5ThresholdSpinBox->setEnabled(!adaptive);
+    dac6ThresholdSpinBox->setEnabled(!adaptive);
+    dac7ThresholdSpinBox->setEnabled(!adaptive);
+    dac8ThresholdSpinBox->setEnabled(!adaptive);
+}
+
+// Set the threshold of each enabled DAC comparator to a multiple of the noise
+// of its channel.  Called after each call to SignalProcessor::filterData(), but
+// acts at most once every DAC_THRESHOLD_UPDATE_MSEC, and only reprograms
+// thresholds that have moved by more than DAC_THRESHOLD_HYSTERESIS of their
+// value.  All changes are sent to the board in one batch.
+void MainWindow::updateAdaptiveDacThresholds()
+{
+    if (!dacAdaptiveThresholdCheckBox->isChecked()) return;
+    if (dacThresholdUpdateTimer.isValid() && dacThresholdUpdateTimer.elapsed() < DAC_THRESHOLD_UPDATE_MSEC) return;
+    dacThresholdUpdateTimer.start();
+
+    QSpinBox *thresholdSpinBoxes[8] = {
+        dac1ThresholdSpinBox, dac2ThresholdSpinBox, dac3ThresholdSpinBox, dac4ThresholdSpinBox,
+        dac5ThresholdSpinBox, dac6ThresholdSpinBox, dac7ThresholdSpinBox, dac8ThresholdSpinBox
+    };
+    QCheckBox *thresholdEnableCheckBoxes[8] = {
+        dac1ThresholdEnableCheckBox, dac2ThresholdEnableCheckBox, dac3ThresholdEnableCheckBox,
+        dac4ThresholdEnableCheckBox, dac5ThresholdEnableCheckBox, dac6ThresholdEnableCheckBox,
+        dac7ThresholdEnableCheckBox, dac8ThresholdEnableCheckBox
+    };
+
+    const DacThresholdTracker *tracker = signalProcessor->getDacThresholdTracker();
+    double scale = dacAdaptiveMultiplierSpinBox->value() * (dacAdaptivePolarityComboBox->currentIndex() == 0 ? -1.0 : 1.0);
+    vector<int> dacChannels, thresholdLevels;
+    vector<bool> polarities;
+
+    for (int dac = 0; dac < 8; ++dac) {
+        if (!thresholdEnableCheckBoxes[dac]->isChecked() || !tracker->isTracking(dac)) continue;
+
+        int threshold = qBound(thresholdSpinBoxes[dac]->minimum(), qRound(scale * tracker->getNoiseLevel(dac)),
+                               thresholdSpinBoxes[dac]->maximum());
+        int current = thresholdSpinBoxes[dac]->value();
+        bool samePolarity = (threshold >= 0) == (current >= 0);
+        if (samePolarity && qAbs(threshold - current) <= DAC_THRESHOLD_HYSTERESIS * qAbs(current)) continue;
+
+        // Show the new threshold without triggering a separate write to the board.
+        thresholdSpinBoxes[dac]->blockSignals(true);
+        thresholdSpinBoxes[dac]->setValue(threshold);
+        thresholdSpinBoxes[dac]->blockSignals(false);
+
+        dacChannels.push_back(dac);
+        thresholdLevels.push_back(qRound((double) threshold / AMPLIFIER_MICROVOLTS_PER_BIT) + 32768);
+        polarities.push_back(threshold >= 0);
+    }
+
+    if (!dacChannels.empty() && !synthMode) {
+        evalBoard->setDacThresholds(dacChannels, thresholdLevels, polarities);
+    }
+}
+
 int MainWindow::getEvalBoardMode()
 {
     return evalBoardMode;
@@ -4971,7 +6488,9 @@ void MainWindow::loadStimSettings()
     changeBandwidthButton->setEnabled(false);
     impedanceFreqSelectButton->setEnabled(false);
     runImpedanceTestButton->setEnabled(false);
+    runImpedanceSpectrumButton->setEnabled(false);
     scanButton->setEnabled(false);
+    syntheticDataAction->setEnabled(false);
     setCableDelayButton->setEnabled(false);
 
     enableChannelButton->setEnabled(false);
@@ -5100,7 +6619,9 @@ void MainWindow::loadStimSettings()
     changeBandwidthButton->setEnabled(true);
     impedanceFreqSelectButton->setEnabled(true);
     runImpedanceTestButton->setEnabled(impedanceFreqValid);
+    runImpedanceSpectrumButton->setEnabled(true);
     scanButton->setEnabled(true);
+    syntheticDataAction->setEnabled(true);
     setCableDelayButton->setEnabled(true);
 
     enableChannelButton->setEnabled(true);
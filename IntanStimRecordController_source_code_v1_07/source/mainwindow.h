@@ -23,12 +23,21 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QElapsedTimer>
 #include <queue>
 #include "rhs2000datablock.h"
 #include "rhs2000evalboard.h"
 #include "rhs2000registers.h"
 #include "globalconstants.h"
 #include "stimparameters.h"
+#include "filterbank.h"
+#include "spatialreferencedialog.h"
+#include "artifactdialog.h"
+#include "linenoisedialog.h"
+#include "spikedetectiondialog.h"
+#include "bandpowerdialog.h"
+#include "phasetrackingdialog.h"
+#include "syntheticdatadialog.h"
 
 class QAction;
 class QPushButton;
@@ -37,11 +46,14 @@ class QButtonGroup;
 class QRadioButton;
 class QCheckBox;
 class QSpinBox;
+class QDoubleSpinBox;
 class QComboBox;
 class QSlider;
 class QLineEdit;
 class QLabel;
 class QFile;
+class QTextStream;
+class QTimer;
 class WavePlot;
 class SignalProcessor;
 class Rhs2000EvalBoard;
@@ -49,6 +61,11 @@ class SignalSources;
 class SignalGroup;
 class SignalChannel;
 class SpikeScopeDialog;
+class SpectrumDialog;
+class CorrelationDialog;
+class SignalQualityDialog;
+class ImpedanceSpectrumDialog;
+class SpikeEventFile;
 class KeyboardShortcutDialog;
 class HelpDialogChipFilters;
 class HelpDialogComparators;
@@ -66,6 +83,8 @@ class DigOutDialog;
 class AnOutDialog;
 class AmpSettleDialog;
 class ChargeRecoveryDialog;
+class SaveJournal;
+class ChecksummedFile;
 
 using namespace std;
 
@@ -95,7 +114,6 @@ public:
     QVector<int> yScaleDcAmpList;
     QVector<int> yScaleAdcList;
     QVector<int> tScaleList;
-    QVector<QVector<bool> > channelVisible;
 
     int getEvalBoardMode();
     bool isRecording();
@@ -141,6 +159,7 @@ private slots:
     void changeTScale(int index);
     void changeSampleRate(int sampleRateIndex, bool updateStimParams);
     void changeNotchFilter(int notchFilterIndex);
+    void changeNotchFilterHarmonics(int numHarmonics);
     void enableHighpassFilter(bool enable);
     void highpassFilterLineEditChanged();
     void changeBandwidth();
@@ -160,6 +179,9 @@ private slots:
     void enableAllChannels();
     void disableAllChannels();
     void spikeScope();
+    void spectrum();
+    void correlation();
+    void signalQuality();
     void newSelectedChannel(SignalChannel* newChannel);
     void scanPorts();
     void loadSettings();
@@ -169,9 +191,22 @@ private slots:
     void showImpedances(bool enabled);
     void saveImpedances();
     void runImpedanceMeasurement();
+    void runImpedanceSpectrumMeasurement();
+    void showImpedanceSpectrum();
     void manualCableDelayControl();
     void plotPointsMode(bool enabled);
+    void changeDisplayRefreshRate(int index);
     void setSaveFormatDialog();
+    void filterBankDialog();
+    void spatialReferenceDialog();
+    void artifactDialog();
+    void lineNoiseDialog();
+    void syntheticDataDialog();
+    void spikeDetectionDialog();
+    void bandPowerDialog();
+    void phaseTrackingDialog();
+    void firePhaseTrigger();
+    void releasePhaseTrigger();
     void setDacThreshold1(int threshold);
     void setDacThreshold2(int threshold);
     void setDacThreshold3(int threshold);
@@ -181,6 +216,7 @@ private slots:
     void setDacThreshold7(int threshold);
     void setDacThreshold8(int threshold);
     void dacThresholdEnable();
+    void updateDacThresholdTracking();
     void referenceSetSelectedChannel();
     void referenceSetHardware();
     void referenceHelp();
@@ -204,6 +240,15 @@ private:
 
     void selectBaseFilename(SaveFormat format);
     void updateImpedanceFrequency();
+    void impedanceFrequencyLimits(double &lowerBandwidthLimit, double &upperBandwidthLimit) const;
+    bool impedanceSpectrumTones(int &period, vector<int> &harmonics);
+    bool acquireImpedanceData(const vector<unsigned int> &dacCommandList, const QVector<double> &frequencies,
+                              int period, int numPeriods, const QString &progressText,
+                              QVector<QVector<QVector<double> > > &measuredMagnitude,
+                              QVector<QVector<QVector<double> > > &measuredPhase);
+    void impedanceFromVoltage(double measuredMagnitude, double measuredPhase, double frequency,
+                              double dacVoltageAmplitude, int capRange,
+                              double &impedanceMagnitude, double &impedancePhase);
     void setDacGainLabel(int gain);
     void setDacNoiseSuppressLabel(int noiseSuppress);
     void setDacChannelLabel(int dacChannel, QString channel, QString name);
@@ -222,10 +267,28 @@ private:
     void setSaveFormat(SaveFormat format);
     bool startNewSaveFile(SaveFormat format);
     void closeSaveFile(SaveFormat format);
+    QVector<ChecksummedFile*> saveDataFileList(SaveFormat format);
+    void openSaveJournal(SaveFormat format);
+    bool openSpikeEventFile(SaveFormat format);
 
     void setHighpassFilterCutoff(double cutoff);
 
     void referenceSetChannel();
+    void applyArtifactSuppression();
+    void applyLineNoiseCancellation();
+    void applySyntheticData();
+    void applySpikeDetection();
+    bool applyBandPowerDetection();
+    void updateBandPowerLanes();
+    void updateBandPowerEvents(double processingMsec);
+    bool applyPhaseTracking(QString &errorMessage);
+    void updatePhaseTracking(double processingMsec, double fifoLagMsec, int timestampOffset);
+    void updateAdaptiveDacThresholds();
+    void openPhaseLog();
+    void closePhaseLog();
+    bool applySpatialReference(const SpatialReferenceSettings &settings, QString &errorMessage);
+    bool readMontageFile(const QString &fileName, int numFields, QVector<QStringList> &lines, QString &errorMessage);
+    bool montageChannelLane(const QString &name, int &lane, QString &errorMessage);
 
     void setChargeRecoveryParameters(bool mode,
                                      Rhs2000Registers::ChargeRecoveryCurrentLimit currentLimit,
@@ -258,7 +321,7 @@ private:
 
     QString saveBaseFileName;
     QString saveFileName;
-    QFile *saveFile;
+    ChecksummedFile *saveFile;
     QDataStream *saveStream;
 
     QString infoFileName;
@@ -268,6 +331,16 @@ private:
     SaveFormat saveFormat;
     int newSaveFilePeriodMinutes;
 
+    bool saveJournalEnabled;
+    int checkpointPeriodSeconds;
+    SaveJournal *saveJournal;
+    SpikeEventFile *spikeEventFile;
+    QFile *phaseLogFile;
+    QTextStream *phaseLogStream;
+    bool saveChecksums;
+    QString saveSidecarPath;
+    QString saveSidecarBaseName;
+
     unsigned int numUsbBlocksToRead;
 
     Rhs2000EvalBoard *evalBoard;
@@ -290,11 +363,31 @@ private:
     double notchFilterFrequency;
     double notchFilterBandwidth;
     bool notchFilterEnabled;
+    int notchFilterHarmonics;
     double highpassFilterFrequency;
     bool highpassFilterEnabled;
+    QVector<FilterBankBand> filterBankBands;
+    int filterBankDisplayBand;
+    SpatialReferenceSettings spatialReferenceSettings;
+    ArtifactSettings artifactSettings;
+    LineNoiseSettings lineNoiseSettings;
+    SyntheticDataSettings syntheticDataSettings;
+    SpikeDetectionSettings spikeDetectionSettings;
+    BandPowerSettings bandPowerSettings;
+    int bandPowerEventCount;
+    bool bandPowerTriggerOn;
+    PhaseTrackingSettings phaseTrackingSettings;
+    QTimer *phaseTriggerTimer;
+    QElapsedTimer phaseClock;       // started when the latest phase estimate was made
+    double phaseClockTimestamp;     // board timestamp at which a trigger sent then would take effect
+    double phaseTriggerTimestamp;   // predicted timestamp of the scheduled trigger
+    double lastPhaseStimTimestamp;
+    bool phaseTriggerOn;
+    QElapsedTimer dacThresholdUpdateTimer;  // started when adaptive DAC thresholds were last checked
     double desiredImpedanceFreq;
     double actualImpedanceFreq;
     bool impedanceFreqValid;
+    QVector<double> impedanceSpectrumFrequencies;
     bool useFastSettle;
     bool headstageGlobalSettle;
     bool chargeRecoveryMode;
@@ -328,6 +421,10 @@ private:
     unsigned char* usbReadBuffer;
 
     SpikeScopeDialog *spikeScopeDialog;
+    SpectrumDialog *spectrumDialog;
+    CorrelationDialog *correlationDialog;
+    SignalQualityDialog *signalQualityDialog;
+    ImpedanceSpectrumDialog *impedanceSpectrumDialog;
     StimParamDialog *stimParamDialog;
     DigOutDialog *digOutDialog;
     AnOutDialog *anOutDialog;
@@ -362,10 +459,12 @@ private:
     QAction *pasteStimParametersAction;
     QAction *ampSettleSettingsAction;
     QAction *chargeRecoverySettingsAction;
+    QAction *syntheticDataAction;
 
     QMenu *fileMenu;
     QMenu *editMenu;
     QMenu *stimMenu;
+    QMenu *demoMenu;
     QMenu *channelMenu;
     QMenu *optionsMenu;
     QMenu *helpMenu;
@@ -380,16 +479,28 @@ private:
     QPushButton *enableAllButton;
     QPushButton *disableAllButton;
     QPushButton *spikeScopeButton;
+    QPushButton *spectrumButton;
+    QPushButton *correlationButton;
+    QPushButton *signalQualityButton;
     QPushButton *changeBandwidthButton;
+    QPushButton *filterBankButton;
+    QPushButton *artifactButton;
+    QPushButton *lineNoiseButton;
+    QPushButton *spikeDetectionButton;
+    QPushButton *bandPowerButton;
+    QPushButton *phaseTrackingButton;
     QPushButton *impedanceFreqSelectButton;
     QPushButton *runImpedanceTestButton;
     QPushButton *dacSetButton;
     QPushButton *scanButton;
     QPushButton *saveImpedancesButton;
+    QPushButton *runImpedanceSpectrumButton;
+    QPushButton *showImpedanceSpectrumButton;
     QPushButton *setSaveFormatButton;
     QPushButton *setCableDelayButton;
     QPushButton *refSelectButton;
     QPushButton *refHardwareRefButton;
+    QPushButton *spatialRefButton;
     QPushButton *stimParamButton;
 
     QToolButton *helpDialogChipFiltersButton;
@@ -417,6 +528,9 @@ private:
     QCheckBox *dac6ThresholdEnableCheckBox;
     QCheckBox *dac7ThresholdEnableCheckBox;
     QCheckBox *dac8ThresholdEnableCheckBox;
+    QCheckBox *dacAdaptiveThresholdCheckBox;
+    QDoubleSpinBox *dacAdaptiveMultiplierSpinBox;
+    QComboBox *dacAdaptivePolarityComboBox;
 
     QRadioButton *displayPortAButton;
     QRadioButton *displayPortBButton;
@@ -440,6 +554,7 @@ private:
     QComboBox *numFramesComboBox;
     QComboBox *sampleRateComboBox;
     QComboBox *notchFilterComboBox;
+    QSpinBox *notchFilterHarmonicsSpinBox;
     QComboBox *chargeRecoveryModeComboBox;
 
     QSpinBox *dac1ThresholdSpinBox;
@@ -467,6 +582,16 @@ private:
     QLabel *fifoLagLabel;
     QLabel *fifoFullLabel;
     QLabel *bufferFullLabel;
+    QLabel *filterTimeLabel;
+    QLabel *displayFramesLabel;
+    QComboBox *displayRefreshRateComboBox;
+    QLabel *filterBankLabel;
+    QLabel *artifactLabel;
+    QLabel *lineNoiseLabel;
+    QLabel *spikeDetectionLabel;
+    QLabel *bandPowerLabel;
+    QLabel *phaseTrackingLabel;
+    QLabel *spatialRefLabel;
     QLabel *cpuWarningLabel;
     QLabel *dspCutoffFreqLabel;
     QLabel *upperBandwidthLabel;
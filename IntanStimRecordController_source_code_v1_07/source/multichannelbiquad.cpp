@@ -0,0 +1,260 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cstring>
+
+#include "multichannelbiquad.h"
+#include "samplevector.h"
+
+// The vector kernel uses the SIMD instruction set chosen at compile time (see
+// samplevector.h), with one channel per vector element.  Other processors use
+// the scalar kernel, which compilers can usually auto-vectorize across lanes.
+//
+// Each kernel runs the difference equation
+//
+//   y[t] = b2*x[t-2] + b1*x[t-1] + b0*x[t] - a2*y[t-2] - a1*y[t-1]
+//
+// in the same order of operations as the original scalar notch filter, so
+// results match it to within floating-point rounding (and exactly, unless the
+// compiler contracts multiply-adds into FMA instructions).
+
+// All per-lane state arrays are aligned to a cache line.
+static const int StateAlignment = 64;
+
+// Vector kernels process this many vectors of lanes per time step, giving the
+// processor independent recursions to overlap.
+static const int VectorsPerStep = 2;
+
+// Scalar kernel for lanes [firstLane, lastLane).
+static void biquadScalar(const Sample *in, Sample *out, int numSamples, int stride,
+                         int firstLane, int lastLane,
+                         Sample b0, Sample b1, Sample b2, Sample a1, Sample a2,
+                         Sample *x1, Sample *x2, Sample *y1, Sample *y2)
+{
+    for (int lane = firstLane; lane < lastLane; ++lane) {
+        Sample xm1 = x1[lane], xm2 = x2[lane], ym1 = y1[lane], ym2 = y2[lane];
+        const Sample *pIn = in + lane;
+        Sample *pOut = out + lane;
+        for (int t = 0; t < numSamples; ++t) {
+            Sample x = *pIn;
+            Sample y = b2 * xm2 + b1 * xm1 + b0 * x - a2 * ym2 - a1 * ym1;
+            *pOut = y;
+            xm2 = xm1;
+            xm1 = x;
+            ym2 = ym1;
+            ym1 = y;
+            pIn += stride;
+            pOut += stride;
+        }
+        x1[lane] = xm1;
+        x2[lane] = xm2;
+        y1[lane] = ym1;
+        y2[lane] = ym2;
+    }
+}
+
+#ifdef SAMPLE_VECTOR_SIMD
+// Vector kernel for lanes [firstLane, lastLane).  Returns the first lane not
+// processed, which is lastLane unless the range is not a multiple of the step size.
+static int biquadVector(const Sample *in, Sample *out, int numSamples, int stride,
+                        int firstLane, int lastLane,
+                        Sample b0, Sample b1, Sample b2, Sample a1, Sample a2,
+                        Sample *x1, Sample *x2, Sample *y1, Sample *y2)
+{
+    typedef SampleVector Vec;
+    typedef Vec::V V;
+    const int Width = Vec::Width;
+    const int Step = Width * VectorsPerStep;
+
+    const V vb0 = Vec::set1(b0);
+    const V vb1 = Vec::set1(b1);
+    const V vb2 = Vec::set1(b2);
+    const V va1 = Vec::set1(a1);
+    const V va2 = Vec::set1(a2);
+
+    int lane = firstLane;
+    for (; lane + Step <= lastLane; lane += Step) {
+        V xm1[VectorsPerStep], xm2[VectorsPerStep], ym1[VectorsPerStep], ym2[VectorsPerStep];
+        for (int v = 0; v < VectorsPerStep; ++v) {
+            xm1[v] = Vec::loadu(x1 + lane + v * Width);
+            xm2[v] = Vec::loadu(x2 + lane + v * Width);
+            ym1[v] = Vec::loadu(y1 + lane + v * Width);
+            ym2[v] = Vec::loadu(y2 + lane + v * Width);
+        }
+
+        const Sample *pIn = in + lane;
+        Sample *pOut = out + lane;
+        for (int t = 0; t < numSamples; ++t) {
+            for (int v = 0; v < VectorsPerStep; ++v) {
+                V x = Vec::loadu(pIn + v * Width);
+                V y = Vec::add(Vec::mul(vb2, xm2[v]), Vec::mul(vb1, xm1[v]));
+                y = Vec::add(y, Vec::mul(vb0, x));
+                y = Vec::sub(y, Vec::mul(va2, ym2[v]));
+                y = Vec::sub(y, Vec::mul(va1, ym1[v]));
+                Vec::storeu(pOut + v * Width, y);
+                xm2[v] = xm1[v];
+                xm1[v] = x;
+                ym2[v] = ym1[v];
+                ym1[v] = y;
+            }
+            pIn += stride;
+            pOut += stride;
+        }
+
+        for (int v = 0; v < VectorsPerStep; ++v) {
+            Vec::storeu(x1 + lane + v * Width, xm1[v]);
+            Vec::storeu(x2 + lane + v * Width, xm2[v]);
+            Vec::storeu(y1 + lane + v * Width, ym1[v]);
+            Vec::storeu(y2 + lane + v * Width, ym2[v]);
+        }
+    }
+    return lane;
+}
+#endif
+
+// Constructor.
+MultiChannelBiquad::MultiChannelBiquad()
+{
+    numLanes = 0;
+    b0 = 1.0;
+    b1 = 0.0;
+    b2 = 0.0;
+    a1 = 0.0;
+    a2 = 0.0;
+    x1 = nullptr;
+    x2 = nullptr;
+    y1 = nullptr;
+    y2 = nullptr;
+}
+
+MultiChannelBiquad::~MultiChannelBiquad()
+{
+    freeState();
+}
+
+void MultiChannelBiquad::freeState()
+{
+    qFreeAligned(x1);
+    qFreeAligned(x2);
+    qFreeAligned(y1);
+    qFreeAligned(y2);
+    x1 = nullptr;
+    x2 = nullptr;
+    y1 = nullptr;
+    y2 = nullptr;
+}
+
+// Allocate filter state for numLanes_ interleaved channels, and reset it to zero.
+void MultiChannelBiquad::setNumLanes(int numLanes_)
+{
+    freeState();
+    numLanes = numLanes_;
+
+    size_t bytes = qMax(numLanes, 1) * sizeof(Sample);
+    x1 = static_cast<Sample*>(qMallocAligned(bytes, StateAlignment));
+    x2 = static_cast<Sample*>(qMallocAligned(bytes, StateAlignment));
+    y1 = static_cast<Sample*>(qMallocAligned(bytes, StateAlignment));
+    y2 = static_cast<Sample*>(qMallocAligned(bytes, StateAlignment));
+    resetState();
+}
+
+int MultiChannelBiquad::getNumLanes() const
+{
+    return numLanes;
+}
+
+// Set filter coefficients (with a0 normalized to 1).  Filter state is preserved,
+// so coefficients may be changed while data is streaming.
+void MultiChannelBiquad::setCoefficients(double b0_, double b1_, double b2_, double a1_, double a2_)
+{
+    b0 = b0_;
+    b1 = b1_;
+    b2 = b2_;
+    a1 = a1_;
+    a2 = a2_;
+}
+
+void MultiChannelBiquad::resetState()
+{
+    size_t bytes = numLanes * sizeof(Sample);
+    memset(x1, 0, bytes);
+    memset(x2, 0, bytes);
+    memset(y1, 0, bytes);
+    memset(y2, 0, bytes);
+}
+
+// Filter numSamples time steps of all lanes.  in and out may be the same buffer.
+void MultiChannelBiquad::filter(const Sample *in, Sample *out, int numSamples)
+{
+    filter(in, out, numSamples, 0, numLanes);
+}
+
+// Filter numSamples time steps of lanes [firstLane, lastLane) only; other lanes
+// of out are not touched.  Lane ranges that are a multiple of 128 bytes long
+// are processed entirely by the vector kernel.
+void MultiChannelBiquad::filter(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane)
+{
+    int lane = firstLane;
+#ifdef SAMPLE_VECTOR_SIMD
+    lane = biquadVector(in, out, numSamples, numLanes, firstLane, lastLane,
+                        (Sample) b0, (Sample) b1, (Sample) b2, (Sample) a1, (Sample) a2,
+                        x1, x2, y1, y2);
+#endif
+    biquadScalar(in, out, numSamples, numLanes, lane, lastLane,
+                 (Sample) b0, (Sample) b1, (Sample) b2, (Sample) a1, (Sample) a2,
+                 x1, x2, y1, y2);
+}
+
+// Copy lanes [firstLane, lastLane) from in to out without filtering, and set the
+// filter state as if the last two samples had passed through the filter unchanged.
+// This keeps the filter settled if it is later re-enabled.
+void MultiChannelBiquad::passThrough(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane)
+{
+    if (numSamples < 2) return;
+
+    if (in != out) {
+        for (int t = 0; t < numSamples; ++t) {
+            memcpy(out + t * numLanes + firstLane, in + t * numLanes + firstLane,
+                   (lastLane - firstLane) * sizeof(Sample));
+        }
+    }
+    const Sample *last = in + (numSamples - 1) * numLanes;
+    const Sample *secondLast = in + (numSamples - 2) * numLanes;
+    for (int lane = firstLane; lane < lastLane; ++lane) {
+        x1[lane] = y1[lane] = last[lane];
+        x2[lane] = y2[lane] = secondLast[lane];
+    }
+}
+
+// Name of the instruction set used by the filter kernel (for diagnostics).
+const char* MultiChannelBiquad::instructionSet()
+{
+#if defined(SAMPLE_VECTOR_AVX512)
+    return "AVX-512";
+#elif defined(SAMPLE_VECTOR_AVX)
+    return "AVX";
+#elif defined(SAMPLE_VECTOR_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,65 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MULTICHANNELBIQUAD_H
+#define MULTICHANNELBIQUAD_H
+
+#include "globalconstants.h"
+
+// Biquad IIR filter applied to many channels at once.
+//
+// Data is time-major: sample t of lane i is at data[t * numLanes + i], which is
+// the layout of SignalProcessor::amplifierPreFilterFast.  Because the filter
+// recursion only runs along time, adjacent lanes are independent and are
+// processed together as SIMD vectors, with filter state kept in aligned
+// per-lane arrays.  Samples, state and arithmetic use the Sample type;
+// coefficients are given in double precision.
+class MultiChannelBiquad
+{
+public:
+    MultiChannelBiquad();
+    ~MultiChannelBiquad();
+
+    void setNumLanes(int numLanes_);
+    int getNumLanes() const;
+    void setCoefficients(double b0_, double b1_, double b2_, double a1_, double a2_);
+    void resetState();
+
+    void filter(const Sample *in, Sample *out, int numSamples);
+    void filter(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane);
+    void passThrough(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane);
+
+    static const char* instructionSet();
+
+private:
+    int numLanes;
+    double b0, b1, b2, a1, a2;
+
+    // Per-lane filter state: the previous two inputs (x1, x2) and outputs (y1, y2).
+    Sample *x1;
+    Sample *x2;
+    Sample *y1;
+    Sample *y2;
+
+    void freeState();
+};
+
+#endif // MULTICHANNELBIQUAD_H
@@ -0,0 +1,222 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <cstring>
+
+#include "multichannelfixedbiquad.h"
+
+// The kernel runs the difference equation
+//
+//   y[t] = b2*x[t-2] + b1*x[t-1] + b0*x[t] - a2*y[t-2] - a1*y[t-1]
+//
+// with Q30 coefficients and 64-bit products.  The sum, plus the remainder
+// carried from the previous output, is shifted down by CoefficientBits
+// (rounding toward minus infinity), and the bits shifted out become the new
+// remainder.
+
+// Fractional bits of the filter coefficients
+static const int CoefficientBits = 30;
+static const qint64 RemainderMask = (Q_INT64_C(1) << CoefficientBits) - 1;
+
+// All per-lane state arrays are aligned to a cache line.
+static const int StateAlignment = 64;
+
+// Lanes processed together by the main kernel.  The lane loop is innermost, so
+// compilers can evaluate it with SIMD 32 x 32 -> 64-bit multiplies.
+static const int GroupLanes = 16;
+
+// Kernel for the G lanes starting at firstLane.
+template <int G>
+static void biquadGroup(const qint32 *in, qint32 *out, int numSamples, int stride, int firstLane,
+                        qint32 b0, qint32 b1, qint32 b2, qint32 a1, qint32 a2,
+                        qint32 *x1, qint32 *x2, qint32 *y1, qint32 *y2, qint32 *remainder)
+{
+    qint32 xm1[G], xm2[G], ym1[G], ym2[G], r[G];
+    for (int i = 0; i < G; ++i) {
+        xm1[i] = x1[firstLane + i];
+        xm2[i] = x2[firstLane + i];
+        ym1[i] = y1[firstLane + i];
+        ym2[i] = y2[firstLane + i];
+        r[i] = remainder[firstLane + i];
+    }
+
+    const qint32 *pIn = in + firstLane;
+    qint32 *pOut = out + firstLane;
+    for (int t = 0; t < numSamples; ++t) {
+        for (int i = 0; i < G; ++i) {
+            qint32 x = pIn[i];
+            qint64 acc = (qint64) b2 * xm2[i] + (qint64) b1 * xm1[i] + (qint64) b0 * x
+                    - (qint64) a2 * ym2[i] - (qint64) a1 * ym1[i] + r[i];
+            qint32 y = (qint32) (acc >> CoefficientBits);
+            r[i] = (qint32) (acc & RemainderMask);
+            pOut[i] = y;
+            xm2[i] = xm1[i];
+            xm1[i] = x;
+            ym2[i] = ym1[i];
+            ym1[i] = y;
+        }
+        pIn += stride;
+        pOut += stride;
+    }
+
+    for (int i = 0; i < G; ++i) {
+        x1[firstLane + i] = xm1[i];
+        x2[firstLane + i] = xm2[i];
+        y1[firstLane + i] = ym1[i];
+        y2[firstLane + i] = ym2[i];
+        remainder[firstLane + i] = r[i];
+    }
+}
+
+// Coefficient rounded to Q30, saturated to [-2, 2).
+static qint32 toQ30(double c)
+{
+    return (qint32) qBound(-2147483648.0, floor(c * (1 << CoefficientBits) + 0.5), 2147483647.0);
+}
+
+// Constructor.
+MultiChannelFixedBiquad::MultiChannelFixedBiquad()
+{
+    numLanes = 0;
+    x1 = nullptr;
+    x2 = nullptr;
+    y1 = nullptr;
+    y2 = nullptr;
+    remainder = nullptr;
+    setCoefficients(1.0, 0.0, 0.0, 0.0, 0.0);
+}
+
+MultiChannelFixedBiquad::~MultiChannelFixedBiquad()
+{
+    freeState();
+}
+
+void MultiChannelFixedBiquad::freeState()
+{
+    qFreeAligned(x1);
+    qFreeAligned(x2);
+    qFreeAligned(y1);
+    qFreeAligned(y2);
+    qFreeAligned(remainder);
+    x1 = nullptr;
+    x2 = nullptr;
+    y1 = nullptr;
+    y2 = nullptr;
+    remainder = nullptr;
+}
+
+// Allocate filter state for numLanes_ interleaved channels, and reset it to zero.
+void MultiChannelFixedBiquad::setNumLanes(int numLanes_)
+{
+    freeState();
+    numLanes = numLanes_;
+
+    size_t bytes = qMax(numLanes, 1) * sizeof(qint32);
+    x1 = static_cast<qint32*>(qMallocAligned(bytes, StateAlignment));
+    x2 = static_cast<qint32*>(qMallocAligned(bytes, StateAlignment));
+    y1 = static_cast<qint32*>(qMallocAligned(bytes, StateAlignment));
+    y2 = static_cast<qint32*>(qMallocAligned(bytes, StateAlignment));
+    remainder = static_cast<qint32*>(qMallocAligned(bytes, StateAlignment));
+    resetState();
+}
+
+int MultiChannelFixedBiquad::getNumLanes() const
+{
+    return numLanes;
+}
+
+// Set filter coefficients (with a0 normalized to 1).  Filter state is preserved,
+// so coefficients may be changed while data is streaming.
+void MultiChannelFixedBiquad::setCoefficients(double b0_, double b1_, double b2_, double a1_, double a2_)
+{
+    b0 = b0_;
+    b1 = b1_;
+    b2 = b2_;
+    a1 = a1_;
+    a2 = a2_;
+    b0Q30 = toQ30(b0);
+    b1Q30 = toQ30(b1);
+    b2Q30 = toQ30(b2);
+    a1Q30 = toQ30(a1);
+    a2Q30 = toQ30(a2);
+}
+
+void MultiChannelFixedBiquad::resetState()
+{
+    size_t bytes = numLanes * sizeof(qint32);
+    memset(x1, 0, bytes);
+    memset(x2, 0, bytes);
+    memset(y1, 0, bytes);
+    memset(y2, 0, bytes);
+    memset(remainder, 0, bytes);
+}
+
+// Largest possible difference, in LSBs of the data format, between the output of
+// the filter and that of exact filtering with unrounded coefficients, for any
+// input no larger than inputPeak LSBs: ||(1 - 1/z) / A||_1 for truncation (see
+// MultiChannelNotch::errorBound()), plus ||h - h_Q30||_1 * inputPeak for
+// coefficient rounding.  Impulse responses are summed until they have decayed
+// below 1e-12 of their peak.
+double MultiChannelFixedBiquad::errorBound(double inputPeak) const
+{
+    const double q = 1.0 / (1 << CoefficientBits);
+    const double r = sqrt(qMax(fabs(a2), a1 * a1 / 4.0));
+    const int length = qMin((int) (log(1.0e-12) / log(qBound(1.0e-3, r, 1.0 - 1.0e-9))) + 16, 1 << 22);
+
+    double e1 = 0.0, e2 = 0.0;
+    double hx1 = 0.0, hx2 = 0.0, h1 = 0.0, h2 = 0.0, hq1 = 0.0, hq2 = 0.0;
+    double errorNorm = 0.0, coefficientNorm = 0.0;
+    for (int t = 0; t < length; ++t) {
+        double u = (t == 0) ? 1.0 : ((t == 1) ? -1.0 : 0.0);
+        double e = u - a1 * e1 - a2 * e2;
+        e2 = e1;
+        e1 = e;
+        errorNorm += fabs(e);
+
+        double x = (t == 0) ? 1.0 : 0.0;
+        double h = b2 * hx2 + b1 * hx1 + b0 * x - a2 * h2 - a1 * h1;
+        double hq = (b2Q30 * hx2 + b1Q30 * hx1 + b0Q30 * x - a2Q30 * hq2 - a1Q30 * hq1) * q;
+        hx2 = hx1;
+        hx1 = x;
+        h2 = h1;
+        h1 = h;
+        hq2 = hq1;
+        hq1 = hq;
+        coefficientNorm += fabs(h - hq);
+    }
+    return errorNorm + coefficientNorm * inputPeak;
+}
+
+// Filter numSamples time steps of lanes [firstLane, lastLane) only; other lanes
+// of out are not touched.  in and out may be the same buffer.
+void MultiChannelFixedBiquad::filter(const qint32 *in, qint32 *out, int numSamples, int firstLane, int lastLane)
+{
+    int lane = firstLane;
+    for (; lane + GroupLanes <= lastLane; lane += GroupLanes) {
+        biquadGroup<GroupLanes>(in, out, numSamples, numLanes, lane, b0Q30, b1Q30, b2Q30, a1Q30, a2Q30,
+                                x1, x2, y1, y2, remainder);
+    }
+    for (; lane < lastLane; ++lane) {
+        biquadGroup<1>(in, out, numSamples, numLanes, lane, b0Q30, b1Q30, b2Q30, a1Q30, a2Q30,
+                       x1, x2, y1, y2, remainder);
+    }
+}
@@ -0,0 +1,70 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MULTICHANNELFIXEDBIQUAD_H
+#define MULTICHANNELFIXEDBIQUAD_H
+
+#include <QtGlobal>
+#include "globalconstants.h"
+
+// Fixed-point biquad IIR filter applied to many channels at once.
+//
+// The fixed-point counterpart of MultiChannelBiquad, used for the amplifier
+// highpass filter on the output of MultiChannelNotch.  Data use the same
+// time-major lane layout, as 32-bit integers in any fixed-point format; the
+// output has the format of the input.  Coefficients are rounded to Q30 (so each
+// must lie in [-2, 2)), products are accumulated in 64 bits, and the bits of
+// each output below its least significant bit are carried into the next output
+// (first-order error feedback), so the truncation error reaches the output
+// through (1 - 1/z) / A(z).  For the first-order highpass filter this has an L1
+// norm of 2: the output stays within two LSBs, plus the effect of coefficient
+// rounding, of exact filtering (see errorBound()).
+class MultiChannelFixedBiquad
+{
+public:
+    MultiChannelFixedBiquad();
+    ~MultiChannelFixedBiquad();
+
+    void setNumLanes(int numLanes_);
+    int getNumLanes() const;
+    void setCoefficients(double b0_, double b1_, double b2_, double a1_, double a2_);
+    void resetState();
+    double errorBound(double inputPeak) const;
+
+    void filter(const qint32 *in, qint32 *out, int numSamples, int firstLane, int lastLane);
+
+private:
+    int numLanes;
+    double b0, b1, b2, a1, a2;
+    qint32 b0Q30, b1Q30, b2Q30, a1Q30, a2Q30;
+
+    // Per-lane filter state: the previous two inputs (x1, x2) and outputs
+    // (y1, y2), and the truncated part of the last output.
+    qint32 *x1;
+    qint32 *x2;
+    qint32 *y1;
+    qint32 *y2;
+    qint32 *remainder;
+
+    void freeState();
+};
+
+#endif // MULTICHANNELFIXEDBIQUAD_H
@@ -0,0 +1,370 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <QtGlobal>
+#include <QVector>
+#include <cmath>
+#include <cstring>
+
+#include "multichannelfixednotch.h"
+
+using namespace std;
+
+// Each section is the notch biquad previously used by SignalProcessor,
+//
+//   y[t] = g*x[t] + a1*x[t-1] + g*x[t-2] - a1*y[t-1] - a2*y[t-2]
+//
+// with g = (1 + a2) / 2, rewritten as
+//
+//   y[t] = g*(x[t] + x[t-2]) + a1*(x[t-1] - y[t-1]) - a2*y[t-2].
+//
+// The output of one section is the input of the next, so a section's input
+// history is the previous section's output history and only one pair of state
+// values per section (plus one pair for the input) is kept.  The kernels are
+// instantiated for each number of sections so that the state of a whole
+// cascade stays in registers for the length of a data block.
+//
+// Signals are 32-bit integers with MultiChannelFixedNotch::FractionBits fractional
+// bits; their sums and differences above stay well within 32 bits, and only the
+// products are formed in 64 bits.  The sum of products is shifted down by
+// CoefficientBits (rounding toward minus infinity), and the bits shifted out
+// are kept as the remainder of that output.  Twice the remainder of the
+// section's previous output, less that of the one before, is added to the sum
+// first (second-order error feedback).
+
+// Fractional bits of the filter coefficients
+static const int CoefficientBits = 30;
+static const qint64 RemainderMask = (Q_INT64_C(1) << CoefficientBits) - 1;
+
+// All per-lane state arrays are aligned to a cache line.
+static const int StateAlignment = 64;
+
+// Lanes processed together by the main kernel.  The lane loop is innermost, so
+// compilers can evaluate it with SIMD 32 x 32 -> 64-bit multiplies.
+static const int GroupLanes = 16;
+
+// Kernel for the G lanes starting at firstLane.
+template <int K, int G>
+static void notchGroup(const qint32 *in, qint32 *out, int numSamples, int numLanes, int firstLane,
+                       qint32 g, qint32 a2, const qint32 *a1, qint32 *state, qint32 *remainder)
+{
+    qint32 z1[K + 1][G], z2[K + 1][G], r1[K][G], r2[K][G];
+    for (int s = 0; s <= K; ++s) {
+        for (int i = 0; i < G; ++i) {
+            z1[s][i] = state[(2 * s) * numLanes + firstLane + i];
+            z2[s][i] = state[(2 * s + 1) * numLanes + firstLane + i];
+        }
+    }
+    for (int s = 0; s < K; ++s) {
+        for (int i = 0; i < G; ++i) {
+            r1[s][i] = remainder[(2 * s) * numLanes + firstLane + i];
+            r2[s][i] = remainder[(2 * s + 1) * numLanes + firstLane + i];
+        }
+    }
+
+    const qint32 *pIn = in + firstLane;
+    qint32 *pOut = out + firstLane;
+    for (int t = 0; t < numSamples; ++t) {
+        qint32 x[G];
+        for (int i = 0; i < G; ++i) {
+            x[i] = pIn[i];
+        }
+        for (int s = 0; s < K; ++s) {
+            for (int i = 0; i < G; ++i) {
+                qint64 acc = (qint64) g * (x[i] + z2[s][i]) + (qint64) a1[s] * (z1[s][i] - z1[s + 1][i])
+                        - (qint64) a2 * z2[s + 1][i] + 2 * (qint64) r1[s][i] - r2[s][i];
+                qint32 y = (qint32) (acc >> CoefficientBits);
+                r2[s][i] = r1[s][i];
+                r1[s][i] = (qint32) (acc & RemainderMask);
+                z2[s][i] = z1[s][i];
+                z1[s][i] = x[i];
+                x[i] = y;
+            }
+        }
+        for (int i = 0; i < G; ++i) {
+            z2[K][i] = z1[K][i];
+            z1[K][i] = x[i];
+            pOut[i] = x[i];
+        }
+        pIn += numLanes;
+        pOut += numLanes;
+    }
+
+    for (int s = 0; s <= K; ++s) {
+        for (int i = 0; i < G; ++i) {
+            state[(2 * s) * numLanes + firstLane + i] = z1[s][i];
+            state[(2 * s + 1) * numLanes + firstLane + i] = z2[s][i];
+        }
+    }
+    for (int s = 0; s < K; ++s) {
+        for (int i = 0; i < G; ++i) {
+            remainder[(2 * s) * numLanes + firstLane + i] = r1[s][i];
+            remainder[(2 * s + 1) * numLanes + firstLane + i] = r2[s][i];
+        }
+    }
+}
+
+// Kernel for lanes [firstLane, lastLane): groups of GroupLanes lanes, then
+// single lanes.
+template <int K>
+static void notchLanes(const qint32 *in, qint32 *out, int numSamples, int numLanes,
+                       int firstLane, int lastLane, qint32 g, qint32 a2, const qint32 *a1,
+                       qint32 *state, qint32 *remainder)
+{
+    int lane = firstLane;
+    for (; lane + GroupLanes <= lastLane; lane += GroupLanes) {
+        notchGroup<K, GroupLanes>(in, out, numSamples, numLanes, lane, g, a2, a1, state, remainder);
+    }
+    for (; lane < lastLane; ++lane) {
+        notchGroup<K, 1>(in, out, numSamples, numLanes, lane, g, a2, a1, state, remainder);
+    }
+}
+
+typedef void (*NotchKernel)(const qint32*, qint32*, int, int, int, int, qint32, qint32,
+                            const qint32*, qint32*, qint32*);
+
+// Kernel for each number of sections, 1 to MultiChannelFixedNotch::MaxHarmonics.
+static const NotchKernel NotchKernels[MultiChannelFixedNotch::MaxHarmonics] = {
+    notchLanes<1>, notchLanes<2>, notchLanes<3>, notchLanes<4>,
+    notchLanes<5>, notchLanes<6>, notchLanes<7>, notchLanes<8>
+};
+
+// Coefficient rounded to Q30.  All coefficients of a stable notch lie in (-2, 2).
+static qint32 toQ30(double c)
+{
+    return (qint32) qBound(-2147483648.0, floor(c * (1 << CoefficientBits) + 0.5), 2147483647.0);
+}
+
+// Constructor.
+MultiChannelFixedNotch::MultiChannelFixedNotch()
+{
+    numLanes = 0;
+    numSections = 0;
+    gain = 1.0;
+    a2 = 0.0;
+    gainQ30 = toQ30(gain);
+    a2Q30 = 0;
+    for (int s = 0; s < MaxHarmonics; ++s) {
+        a1[s] = 0.0;
+        a1Q30[s] = 0;
+    }
+    state = nullptr;
+    remainder = nullptr;
+}
+
+MultiChannelFixedNotch::~MultiChannelFixedNotch()
+{
+    qFreeAligned(state);
+    qFreeAligned(remainder);
+}
+
+// Allocate filter state for numLanes_ interleaved channels, and reset it to zero.
+void MultiChannelFixedNotch::setNumLanes(int numLanes_)
+{
+    numLanes = numLanes_;
+    qFreeAligned(state);
+    qFreeAligned(remainder);
+    state = nullptr;
+    remainder = nullptr;
+    allocateState(numSections);
+}
+
+int MultiChannelFixedNotch::getNumLanes() const
+{
+    return numLanes;
+}
+
+// Allocate state for newNumSections sections.  The state of existing sections
+// is kept, and new sections start as if the signal had passed through them
+// unchanged, so the number of harmonics may be changed while data is streaming.
+void MultiChannelFixedNotch::allocateState(int newNumSections)
+{
+    size_t bytes = 2 * (newNumSections + 1) * qMax(numLanes, 1) * sizeof(qint32);
+    size_t remainderBytes = qMax(2 * newNumSections * numLanes, 1) * sizeof(qint32);
+    qint32 *newState = static_cast<qint32*>(qMallocAligned(bytes, StateAlignment));
+    qint32 *newRemainder = static_cast<qint32*>(qMallocAligned(remainderBytes, StateAlignment));
+    memset(newRemainder, 0, remainderBytes);
+    if (state) {
+        int numKept = qMin(numSections, newNumSections);
+        memcpy(newState, state, 2 * (numKept + 1) * numLanes * sizeof(qint32));
+        for (int s = numKept + 1; s <= newNumSections; ++s) {
+            memcpy(newState + 2 * s * numLanes, state + 2 * numKept * numLanes,
+                   2 * numLanes * sizeof(qint32));
+        }
+        memcpy(newRemainder, remainder, 2 * numKept * numLanes * sizeof(qint32));
+    } else {
+        memset(newState, 0, bytes);
+    }
+    qFreeAligned(state);
+    qFreeAligned(remainder);
+    state = newState;
+    remainder = newRemainder;
+    numSections = newNumSections;
+}
+
+// Set notch filter parameters.  All filter parameters are given in Hz (or in
+// Samples/s).  One notch of the given bandwidth is placed at notchFreq and at
+// each of its next numHarmonics - 1 harmonics below the Nyquist frequency.
+// Filter state is preserved, so parameters may be changed while data is streaming.
+void MultiChannelFixedNotch::setNotch(double notchFreq, double bandwidth, double sampleFreq, int numHarmonics)
+{
+    numHarmonics = qBound(1, numHarmonics, (int) MaxHarmonics);
+
+    int newNumSections = 0;
+    double d = exp(-PI * bandwidth / sampleFreq);
+    gain = (1.0 + d * d) / 2.0;
+    a2 = d * d;
+    gainQ30 = toQ30(gain);
+    a2Q30 = toQ30(a2);
+    for (int h = 1; h <= numHarmonics && h * notchFreq < sampleFreq / 2.0; ++h) {
+        a1[newNumSections] = -(1.0 + d * d) * cos(2.0 * PI * h * notchFreq / sampleFreq);
+        a1Q30[newNumSections] = toQ30(a1[newNumSections]);
+        ++newNumSections;
+    }
+
+    if (newNumSections != numSections) {
+        allocateState(newNumSections);
+    }
+}
+
+// Number of notch sections in the cascade (the number of harmonics removed).
+int MultiChannelFixedNotch::getNumSections() const
+{
+    return numSections;
+}
+
+void MultiChannelFixedNotch::resetState()
+{
+    memset(state, 0, 2 * (numSections + 1) * numLanes * sizeof(qint32));
+    memset(remainder, 0, 2 * numSections * numLanes * sizeof(qint32));
+}
+
+// Filter a response in place through one notch section, with zero initial state.
+static void notchResponse(QVector<double> &x, double g, double a1, double a2)
+{
+    double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+    for (int t = 0; t < x.size(); ++t) {
+        double y = g * (x[t] + x2) + a1 * (x1 - y1) - a2 * y2;
+        x2 = x1;
+        x1 = x[t];
+        y2 = y1;
+        y1 = y;
+        x[t] = y;
+    }
+}
+
+static double l1Norm(const QVector<double> &x)
+{
+    double sum = 0.0;
+    for (int t = 0; t < x.size(); ++t) {
+        sum += fabs(x[t]);
+    }
+    return sum;
+}
+
+// Largest possible difference, in microvolts, between the output of the filter
+// and that of the same cascade computed exactly with unrounded coefficients,
+// for any input no larger than inputPeak amplifier codes in magnitude.  It is
+// the sum of two terms:
+//
+// - Truncation.  The error added by section s is the second difference of its
+//   remainders, each below one output LSB, so it reaches the cascade output
+//   through (1 - 1/z)^2 / A_s(z) and the later sections.  Each section
+//   contributes the L1 norm of that impulse response, in LSBs.
+// - Coefficient rounding: ||h - h_Q30||_1 * inputPeak, with h the impulse
+//   response of the whole cascade.
+//
+// Impulse responses are computed in double precision until they have decayed
+// below about 1e-12 of their peak.
+double MultiChannelFixedNotch::errorBound(double inputPeak) const
+{
+    if (numSections == 0) return 0.0;
+
+    const double q = 1.0 / (1 << CoefficientBits);
+    const int length = qMin((int) (log(1.0e-12) / log(qMax(sqrt(a2), 1.0e-3))) + 16, 1 << 22);
+
+    double truncationLsb = 0.0;
+    for (int s = 0; s < numSections; ++s) {
+        QVector<double> e(length, 0.0);
+        double e1 = 0.0, e2 = 0.0;
+        for (int t = 0; t < length; ++t) {
+            double u = (t == 0) ? 1.0 : ((t == 1) ? -2.0 : ((t == 2) ? 1.0 : 0.0));
+            e[t] = u - a1[s] * e1 - a2 * e2;
+            e2 = e1;
+            e1 = e[t];
+        }
+        for (int k = s + 1; k < numSections; ++k) {
+            notchResponse(e, gain, a1[k], a2);
+        }
+        truncationLsb += l1Norm(e);
+    }
+
+    QVector<double> h(length, 0.0), hQ30(length, 0.0);
+    h[0] = hQ30[0] = 1.0;
+    for (int s = 0; s < numSections; ++s) {
+        notchResponse(h, gain, a1[s], a2);
+        notchResponse(hQ30, gainQ30 * q, a1Q30[s] * q, a2Q30 * q);
+    }
+    for (int t = 0; t < length; ++t) {
+        h[t] -= hQ30[t];
+    }
+
+    return AMPLIFIER_MICROVOLTS_PER_BIT * (truncationLsb / (1 << FractionBits) + l1Norm(h) * inputPeak);
+}
+
+// Filter numSamples time steps of lanes [firstLane, lastLane) only; other lanes
+// of out are not touched.  in and out may be the same buffer.
+void MultiChannelFixedNotch::filter(const qint32 *in, qint32 *out, int numSamples, int firstLane, int lastLane)
+{
+    if (numSections == 0) {
+        passThrough(in, out, numSamples, firstLane, lastLane);
+        return;
+    }
+
+    NotchKernels[numSections - 1](in, out, numSamples, numLanes, firstLane, lastLane,
+                                  gainQ30, a2Q30, a1Q30, state, remainder);
+}
+
+// Copy lanes [firstLane, lastLane) from in to out without filtering, and set the
+// filter state as if the last two samples had passed through every section
+// unchanged.  This keeps the filter settled if it is later re-enabled.
+void MultiChannelFixedNotch::passThrough(const qint32 *in, qint32 *out, int numSamples, int firstLane, int lastLane)
+{
+    if (numSamples < 2) return;
+
+    if (in != out) {
+        for (int t = 0; t < numSamples; ++t) {
+            memcpy(out + t * numLanes + firstLane, in + t * numLanes + firstLane,
+                   (lastLane - firstLane) * sizeof(qint32));
+        }
+    }
+    const qint32 *last = in + (numSamples - 1) * numLanes;
+    const qint32 *secondLast = in + (numSamples - 2) * numLanes;
+    for (int s = 0; s <= numSections; ++s) {
+        qint32 *z1 = state + (2 * s) * numLanes;
+        qint32 *z2 = state + (2 * s + 1) * numLanes;
+        for (int lane = firstLane; lane < lastLane; ++lane) {
+            z1[lane] = last[lane];
+            z2[lane] = secondLast[lane];
+        }
+    }
+}
@@ -0,0 +1,97 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef MULTICHANNELFIXEDNOTCH_H
+#define MULTICHANNELFIXEDNOTCH_H
+
+#include <QtGlobal>
+#include "globalconstants.h"
+
+// Fixed-point notch filter for mains interference applied to many channels at
+// once, removing the mains fundamental and optionally its harmonics.
+//
+// The fixed-point counterpart of MultiChannelNotch: the same cascade of one
+// second-order notch section per harmonic, evaluated in a single pass over the
+// data with adjacent lanes processed together.  Data are amplifier codes as
+// 32-bit integers with FractionBits fractional bits (SignalProcessor::
+// amplifierFixedPointFast), which leaves 8 times the range of a re-referenced
+// channel (twice the amplifier range) as headroom.  Coefficients are Q30 (the
+// center frequency term approaches -2 at low frequencies), and products are
+// accumulated in 64 bits.  The part of each section's output below its least
+// significant bit is fed back into that section's next two outputs
+// (second-order error feedback), so the truncation error reaches the output
+// through (1 - 1/z)^2 / A(z) instead of 1 / A(z), whose gain is very large for
+// poles this close to the unit circle.
+//
+// errorBound() gives the worst-case difference from exact filtering of the
+// same input.  It is dominated by coefficient rounding: for inputs within the
+// amplifier range, 0.027 uV for a 60 Hz notch of 10 Hz bandwidth at 30 kS/s,
+// and 0.067 uV with eight harmonics of 50 Hz at 20 kS/s, against an amplifier
+// LSB of 0.195 uV (tools/kerneltest checks both the bound and the error
+// actually seen).  Without 64-bit SIMD multiplies (before AVX2), this filter
+// is slower than MultiChannelNotch in either precision.
+class MultiChannelFixedNotch
+{
+public:
+    MultiChannelFixedNotch();
+    ~MultiChannelFixedNotch();
+
+    // Largest number of harmonics (including the fundamental) that can be removed
+    static const int MaxHarmonics = 8;
+
+    // Fractional bits of the filter input and output
+    static const int FractionBits = 12;
+
+    void setNumLanes(int numLanes_);
+    int getNumLanes() const;
+    void setNotch(double notchFreq, double bandwidth, double sampleFreq, int numHarmonics);
+    int getNumSections() const;
+    void resetState();
+    double errorBound(double inputPeak) const;
+
+    void filter(const qint32 *in, qint32 *out, int numSamples, int firstLane, int lastLane);
+    void passThrough(const qint32 *in, qint32 *out, int numSamples, int firstLane, int lastLane);
+private:
+    int numLanes;
+    int numSections;
+
+    // Coefficients shared by all sections (b0 = b2 = gain, a2) and the center
+    // frequency term of each section (a1 = b1), in double precision and as
+    // rounded to Q30.
+    double gain;
+    double a2;
+    double a1[MaxHarmonics];
+    qint32 gainQ30;
+    qint32 a2Q30;
+    qint32 a1Q30[MaxHarmonics];
+
+    // Per-lane filter state: the previous two values (z1, z2) of the input and
+    // of the output of each section, at state[(2 * signal + k) * numLanes + lane]
+    // with signal 0 the input and k = 0 for z1, 1 for z2, and the truncated parts
+    // of the last two outputs of each section, in the same layout in remainder.
+    qint32 *state;
+    qint32 *remainder;
+
+    void allocateState(int newNumSections);
+};
+
+#endif // MULTICHANNELFIXEDNOTCH_H
@@ -0,0 +1,289 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <QtGlobal>
+#include <cmath>
+#include <cstring>
+
+#include "multichannelnotch.h"
+#include "samplevector.h"
+
+using namespace std;
+
+// Each section is the notch biquad previously used by SignalProcessor,
+//
+//   y[t] = g*x[t] + a1*x[t-1] + g*x[t-2] - a1*y[t-1] - a2*y[t-2]
+//
+// with g = (1 + a2) / 2, rewritten as
+//
+//   y[t] = g*(x[t] + x[t-2]) + a1*(x[t-1] - y[t-1]) - a2*y[t-2].
+//
+// The output of one section is the input of the next, so a section's input
+// history is the previous section's output history and only one pair of state
+// values per section (plus one pair for the input) is kept.  The kernels are
+// instantiated for each number of sections so that the state of a whole
+// cascade stays in registers for the length of a data block.
+
+// All per-lane state arrays are aligned to a cache line.
+static const int StateAlignment = 64;
+
+// Scalar kernel for lanes [firstLane, lastLane).
+template <int K>
+static void notchScalar(const Sample *in, Sample *out, int numSamples, int numLanes,
+                        int firstLane, int lastLane, Sample g, Sample a2, const Sample *a1,
+                        Sample *state)
+{
+    for (int lane = firstLane; lane < lastLane; ++lane) {
+        Sample z1[K + 1], z2[K + 1];
+        for (int s = 0; s <= K; ++s) {
+            z1[s] = state[(2 * s) * numLanes + lane];
+            z2[s] = state[(2 * s + 1) * numLanes + lane];
+        }
+
+        const Sample *pIn = in + lane;
+        Sample *pOut = out + lane;
+        for (int t = 0; t < numSamples; ++t) {
+            Sample x = *pIn;
+            for (int s = 0; s < K; ++s) {
+                Sample y = g * (x + z2[s]) + a1[s] * (z1[s] - z1[s + 1]) - a2 * z2[s + 1];
+                z2[s] = z1[s];
+                z1[s] = x;
+                x = y;
+            }
+            z2[K] = z1[K];
+            z1[K] = x;
+            *pOut = x;
+            pIn += numLanes;
+            pOut += numLanes;
+        }
+
+        for (int s = 0; s <= K; ++s) {
+            state[(2 * s) * numLanes + lane] = z1[s];
+            state[(2 * s + 1) * numLanes + lane] = z2[s];
+        }
+    }
+}
+
+#ifdef SAMPLE_VECTOR_SIMD
+// Vector kernel for lanes [firstLane, lastLane).  Returns the first lane not
+// processed, which is lastLane unless the range is not a multiple of the vector width.
+template <int K>
+static int notchVector(const Sample *in, Sample *out, int numSamples, int numLanes,
+                       int firstLane, int lastLane, Sample g, Sample a2, const Sample *a1,
+                       Sample *state)
+{
+    typedef SampleVector Vec;
+    typedef Vec::V V;
+    const int Width = Vec::Width;
+
+    const V vg = Vec::set1(g);
+    const V va2 = Vec::set1(a2);
+    V va1[K];
+    for (int s = 0; s < K; ++s) {
+        va1[s] = Vec::set1(a1[s]);
+    }
+
+    int lane = firstLane;
+    for (; lane + Width <= lastLane; lane += Width) {
+        V z1[K + 1], z2[K + 1];
+        for (int s = 0; s <= K; ++s) {
+            z1[s] = Vec::loadu(state + (2 * s) * numLanes + lane);
+            z2[s] = Vec::loadu(state + (2 * s + 1) * numLanes + lane);
+        }
+
+        const Sample *pIn = in + lane;
+        Sample *pOut = out + lane;
+        for (int t = 0; t < numSamples; ++t) {
+            V x = Vec::loadu(pIn);
+            for (int s = 0; s < K; ++s) {
+                V y = Vec::mul(vg, Vec::add(x, z2[s]));
+                y = Vec::add(y, Vec::mul(va1[s], Vec::sub(z1[s], z1[s + 1])));
+                y = Vec::sub(y, Vec::mul(va2, z2[s + 1]));
+                z2[s] = z1[s];
+                z1[s] = x;
+                x = y;
+            }
+            z2[K] = z1[K];
+            z1[K] = x;
+            Vec::storeu(pOut, x);
+            pIn += numLanes;
+            pOut += numLanes;
+        }
+
+        for (int s = 0; s <= K; ++s) {
+            Vec::storeu(state + (2 * s) * numLanes + lane, z1[s]);
+            Vec::storeu(state + (2 * s + 1) * numLanes + lane, z2[s]);
+        }
+    }
+    return lane;
+}
+#endif
+
+// Vector kernel followed by the scalar kernel for any remaining lanes.
+template <int K>
+static void notchLanes(const Sample *in, Sample *out, int numSamples, int numLanes,
+                       int firstLane, int lastLane, Sample g, Sample a2, const Sample *a1,
+                       Sample *state)
+{
+    int lane = firstLane;
+#ifdef SAMPLE_VECTOR_SIMD
+    lane = notchVector<K>(in, out, numSamples, numLanes, firstLane, lastLane, g, a2, a1, state);
+#endif
+    notchScalar<K>(in, out, numSamples, numLanes, lane, lastLane, g, a2, a1, state);
+}
+
+typedef void (*NotchKernel)(const Sample*, Sample*, int, int, int, int, Sample, Sample,
+                            const Sample*, Sample*);
+
+// Kernel for each number of sections, 1 to MultiChannelNotch::MaxHarmonics.
+static const NotchKernel NotchKernels[MultiChannelNotch::MaxHarmonics] = {
+    notchLanes<1>, notchLanes<2>, notchLanes<3>, notchLanes<4>,
+    notchLanes<5>, notchLanes<6>, notchLanes<7>, notchLanes<8>
+};
+
+// Constructor.
+MultiChannelNotch::MultiChannelNotch()
+{
+    numLanes = 0;
+    numSections = 0;
+    gain = 1.0;
+    a2 = 0.0;
+    for (int s = 0; s < MaxHarmonics; ++s) {
+        a1[s] = 0.0;
+    }
+    state = nullptr;
+}
+
+MultiChannelNotch::~MultiChannelNotch()
+{
+    qFreeAligned(state);
+}
+
+// Allocate filter state for numLanes_ interleaved channels, and reset it to zero.
+void MultiChannelNotch::setNumLanes(int numLanes_)
+{
+    numLanes = numLanes_;
+    qFreeAligned(state);
+    state = nullptr;
+    allocateState(numSections);
+}
+
+int MultiChannelNotch::getNumLanes() const
+{
+    return numLanes;
+}
+
+// Allocate state for newNumSections sections.  The state of existing sections
+// is kept, and new sections start as if the signal had passed through them
+// unchanged, so the number of harmonics may be changed while data is streaming.
+void MultiChannelNotch::allocateState(int newNumSections)
+{
+    size_t bytes = 2 * (newNumSections + 1) * qMax(numLanes, 1) * sizeof(Sample);
+    Sample *newState = static_cast<Sample*>(qMallocAligned(bytes, StateAlignment));
+    if (state) {
+        int numKept = qMin(numSections, newNumSections);
+        memcpy(newState, state, 2 * (numKept + 1) * numLanes * sizeof(Sample));
+        for (int s = numKept + 1; s <= newNumSections; ++s) {
+            memcpy(newState + 2 * s * numLanes, state + 2 * numKept * numLanes,
+                   2 * numLanes * sizeof(Sample));
+        }
+    } else {
+        memset(newState, 0, bytes);
+    }
+    qFreeAligned(state);
+    state = newState;
+    numSections = newNumSections;
+}
+
+// Set notch filter parameters.  All filter parameters are given in Hz (or in
+// Samples/s).  One notch of the given bandwidth is placed at notchFreq and at
+// each of its next numHarmonics - 1 harmonics below the Nyquist frequency.
+// Filter state is preserved, so parameters may be changed while data is streaming.
+void MultiChannelNotch::setNotch(double notchFreq, double bandwidth, double sampleFreq, int numHarmonics)
+{
+    numHarmonics = qBound(1, numHarmonics, (int) MaxHarmonics);
+
+    int newNumSections = 0;
+    double d = exp(-PI * bandwidth / sampleFreq);
+    gain = (1.0 + d * d) / 2.0;
+    a2 = d * d;
+    for (int h = 1; h <= numHarmonics && h * notchFreq < sampleFreq / 2.0; ++h) {
+        a1[newNumSections++] = -(1.0 + d * d) * cos(2.0 * PI * h * notchFreq / sampleFreq);
+    }
+
+    if (newNumSections != numSections) {
+        allocateState(newNumSections);
+    }
+}
+
+// Number of notch sections in the cascade (the number of harmonics removed).
+int MultiChannelNotch::getNumSections() const
+{
+    return numSections;
+}
+
+void MultiChannelNotch::resetState()
+{
+    memset(state, 0, 2 * (numSections + 1) * numLanes * sizeof(Sample));
+}
+
+// Filter numSamples time steps of lanes [firstLane, lastLane) only; other lanes
+// of out are not touched.  in and out may be the same buffer.
+void MultiChannelNotch::filter(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane)
+{
+    if (numSections == 0) {
+        passThrough(in, out, numSamples, firstLane, lastLane);
+        return;
+    }
+
+    Sample sectionA1[MaxHarmonics];
+    for (int s = 0; s < numSections; ++s) {
+        sectionA1[s] = (Sample) a1[s];
+    }
+    NotchKernels[numSections - 1](in, out, numSamples, numLanes, firstLane, lastLane,
+                                  (Sample) gain, (Sample) a2, sectionA1, state);
+}
+
+// Copy lanes [firstLane, lastLane) from in to out without filtering, and set the
+// filter state as if the last two samples had passed through every section
+// unchanged.  This keeps the filter settled if it is later re-enabled.
+void MultiChannelNotch::passThrough(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane)
+{
+    if (numSamples < 2) return;
+
+    if (in != out) {
+        for (int t = 0; t < numSamples; ++t) {
+            memcpy(out + t * numLanes + firstLane, in + t * numLanes + firstLane,
+                   (lastLane - firstLane) * sizeof(Sample));
+        }
+    }
+    const Sample *last = in + (numSamples - 1) * numLanes;
+    const Sample *secondLast = in + (numSamples - 2) * numLanes;
+    for (int s = 0; s <= numSections; ++s) {
+        Sample *z1 = state + (2 * s) * numLanes;
+        Sample *z2 = state + (2 * s + 1) * numLanes;
+        for (int lane = firstLane; lane < lastLane; ++lane) {
+            z1[lane] = last[lane];
+            z2[lane] = secondLast[lane];
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef MULTICHANNELNOTCH_H
+#define MULTICHANNELNOTCH_H
+
+#include "globalconstants.h"
+
+// Notch filter for mains interference applied to many channels at once,
+// removing the mains fundamental and optionally its harmonics.
+//
+// The filter is a cascade of one second-order notch section per harmonic.  All
+// sections share the same bandwidth, so each needs only three multiplies per
+// sample, and the whole cascade is evaluated in a single pass over the data:
+// each sample passes through every section before the next one is read.  Data
+// uses the same time-major lane layout as MultiChannelBiquad, and adjacent
+// lanes are processed together as SIMD vectors.  MultiChannelFixedNotch is the
+// fixed-point counterpart.
+class MultiChannelNotch
+{
+public:
+    MultiChannelNotch();
+    ~MultiChannelNotch();
+
+    // Largest number of harmonics (including the fundamental) that can be removed
+    static const int MaxHarmonics = 8;
+
+    void setNumLanes(int numLanes_);
+    int getNumLanes() const;
+    void setNotch(double notchFreq, double bandwidth, double sampleFreq, int numHarmonics);
+    int getNumSections() const;
+    void resetState();
+
+    void filter(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane);
+    void passThrough(const Sample *in, Sample *out, int numSamples, int firstLane, int lastLane);
+
+private:
+    int numLanes;
+    int numSections;
+
+    // Coefficients shared by all sections (b0 = b2 = gain, a2) and the center
+    // frequency term of each section (a1 = b1).
+    double gain;
+    double a2;
+    double a1[MaxHarmonics];
+
+    // Per-lane filter state: the previous two values (z1, z2) of the input and
+    // of the output of each section, at state[(2 * signal + k) * numLanes + lane]
+    // with signal 0 the input and k = 0 for z1, 1 for z2.
+    Sample *state;
+
+    void allocateState(int newNumSections);
+};
+
+#endif // MULTICHANNELNOTCH_H
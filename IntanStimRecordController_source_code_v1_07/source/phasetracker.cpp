@@ -0,0 +1,363 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cmath>
+
+#include "phasetracker.h"
+#include "filterdesign.h"
+#include "realfft.h"
+
+using namespace std;
+
+// Approximate rate of the decimated signal, in Hz.
+static const double DecimatedRate = 1000.0;
+
+// Length of the estimation window, in cycles of the low cutoff frequency.
+static const double WindowCycles = 3.0;
+
+// Shortest estimation window, in decimated samples.
+static const int MinWindowLength = 64;
+
+// Wrap an angle to [-pi, pi).
+static double wrapPhase(double angle)
+{
+    return angle - TWO_PI * floor((angle + PI) / TWO_PI);
+}
+
+// Constructor.
+PhaseTracker::PhaseTracker()
+{
+    enabled = false;
+    lowCutoff = 6.0;
+    highCutoff = 10.0;
+    targetPhase = 0.0;
+    sampleRate = 30000.0;
+    numLanes = 0;
+    decimation = 1;
+    windowLength = 0;
+    fft = nullptr;
+    resetState();
+}
+
+PhaseTracker::~PhaseTracker()
+{
+    delete fft;
+}
+
+// Set the number of interleaved lanes in the data passed to update().
+void PhaseTracker::setNumLanes(int numLanes_)
+{
+    numLanes = numLanes_;
+    resetState();
+}
+
+// Track the oscillation between lowCutoff_ and highCutoff_ (in Hz) in the
+// average of lanes_, aiming for targetPhase_ (in radians).  Returns false,
+// disabling tracking, if no lanes are given or the band cannot be designed at
+// this sample rate.  The tracker is reset.
+bool PhaseTracker::setParameters(bool enabled_, const QVector<int> &lanes_, double lowCutoff_, double highCutoff_,
+                                 double targetPhase_, double sampleRate_)
+{
+    lanes.clear();
+    for (int i = 0; i < lanes_.size(); ++i) {
+        if (lanes_[i] >= 0 && lanes_[i] < numLanes) lanes.append(lanes_[i]);
+    }
+    lowCutoff = lowCutoff_;
+    highCutoff = highCutoff_;
+    targetPhase = targetPhase_;
+    sampleRate = sampleRate_;
+
+    decimation = qMax(1, qRound(sampleRate / DecimatedRate));
+    double decimatedRate = sampleRate / decimation;
+    windowLength = MinWindowLength;
+    while (windowLength < WindowCycles * decimatedRate / lowCutoff) {
+        windowLength *= 2;
+    }
+
+    // Two-pole Butterworth band-pass filter, as in the original ecHT.
+    FilterSpec spec;
+    spec.prototype = FilterButterworth;
+    spec.response = FilterBandpass;
+    spec.order = 1;
+    spec.lowCutoff = lowCutoff;
+    spec.highCutoff = highCutoff;
+    spec.passbandRipple = 0.0;
+    spec.stopbandAttenuation = 0.0;
+    QVector<BiquadSection> sections;
+    bool valid = !lanes.isEmpty() && FilterDesign::design(spec, decimatedRate, sections);
+
+    delete fft;
+    fft = new RealFft(windowLength);
+    int numBins = fft->numBins();
+    endpointWeights.fill(Complex(0.0, 0.0), numBins);
+    centerWeights.fill(0.0, numBins);
+    bandPower.fill(0.0, numBins);
+    if (valid) {
+        // Bins 1 to n/2 - 1 are doubled to form the analytic signal; DC and the
+        // Nyquist bin are removed by the band-pass filter.
+        for (int k = 1; k < numBins - 1; ++k) {
+            Complex h = FilterDesign::frequencyResponse(sections, k * decimatedRate / windowLength, decimatedRate);
+            endpointWeights[k] = 2.0 * h * polar(1.0, -TWO_PI * k / windowLength) / (double) windowLength;
+            centerWeights[k] = 2.0 * abs(h) * ((k % 2) ? -1.0 : 1.0) / windowLength;
+            bandPower[k] = norm(h);
+        }
+    }
+    window.resize(windowLength);
+    binRe.resize(numBins);
+    binIm.resize(numBins);
+    history.resize(2 * windowLength);
+
+    enabled = enabled_ && valid;
+    resetState();
+    return valid;
+}
+
+// Clear the signal history, pending stimulations, and accuracy statistics.
+void PhaseTracker::resetState()
+{
+    history.fill(0.0);
+    numDecimated = 0;
+    accumulator = 0.0;
+    accumulated = 0;
+    firstTimestamp = 0;
+    nextTimestamp = -1;
+    locked = false;
+    phase = 0.0;
+    phaseTimestamp = 0.0;
+    frequency = sqrt(lowCutoff * highCutoff);
+    pending.clear();
+    results.clear();
+    numMeasured = 0;
+    sumCos = 0.0;
+    sumSin = 0.0;
+}
+
+bool PhaseTracker::isEnabled() const
+{
+    return enabled;
+}
+
+// Board timestamp at the center of the group of samples averaged into
+// decimated sample index.
+double PhaseTracker::decimatedTimestamp(qint64 index) const
+{
+    return firstTimestamp + index * decimation + 0.5 * (decimation - 1);
+}
+
+// Add numFrames frames of time-major amplifier data, given as signed ADC codes,
+// with board timestamps, then update the phase estimate and measure the phase
+// at earlier stimulations whose surrounding data is now complete.  A gap in the
+// timestamps resets the tracker.
+void PhaseTracker::update(const qint16 *codes, int numFrames, const qint32 *timestamps)
+{
+    results.clear();
+    if (!enabled || numFrames == 0) return;
+
+    if (nextTimestamp >= 0 && timestamps[0] != nextTimestamp) {
+        resetState();
+    }
+    if (nextTimestamp < 0) {
+        firstTimestamp = timestamps[0];
+    }
+    nextTimestamp = (qint64) timestamps[numFrames - 1] + 1;
+
+    const int numSelected = lanes.size();
+    const int historyMask = history.size() - 1;
+    for (int t = 0; t < numFrames; ++t) {
+        const qint16 *frame = codes + t * numLanes;
+        double sum = 0.0;
+        for (int i = 0; i < numSelected; ++i) {
+            sum += frame[lanes[i]];
+        }
+        accumulator += sum;
+        if (++accumulated == decimation) {
+            history[numDecimated & historyMask] = AMPLIFIER_MICROVOLTS_PER_BIT * accumulator / (decimation * numSelected);
+            ++numDecimated;
+            accumulator = 0.0;
+            accumulated = 0;
+        }
+    }
+
+    if (numDecimated >= windowLength) {
+        estimatePhase();
+        measureStimulations();
+    }
+}
+
+// Copy the windowLength decimated samples ending at lastIndex into window,
+// removing their mean.
+void PhaseTracker::loadWindow(qint64 lastIndex)
+{
+    const int historyMask = history.size() - 1;
+    qint64 first = lastIndex - windowLength + 1;
+    double mean = 0.0;
+    for (int i = 0; i < windowLength; ++i) {
+        window[i] = history[(first + i) & historyMask];
+        mean += window[i];
+    }
+    mean /= windowLength;
+    for (int i = 0; i < windowLength; ++i) {
+        window[i] -= mean;
+    }
+}
+
+// Endpoint-corrected Hilbert transform of the most recent window.
+void PhaseTracker::estimatePhase()
+{
+    loadWindow(numDecimated - 1);
+    fft->transform(window.constData(), binRe.data(), binIm.data());
+
+    Complex z(0.0, 0.0);
+    double weightedFrequency = 0.0, totalPower = 0.0;
+    for (int k = 1; k < binRe.size() - 1; ++k) {
+        Complex x(binRe[k], binIm[k]);
+        z += x * endpointWeights[k];
+        double p = norm(x) * bandPower[k];
+        weightedFrequency += p * k;
+        totalPower += p;
+    }
+
+    phase = arg(z);
+    phaseTimestamp = decimatedTimestamp(numDecimated - 1);
+    if (totalPower > 0.0) {
+        double f = weightedFrequency / totalPower * sampleRate / (decimation * windowLength);
+        frequency = qBound(lowCutoff, f, highCutoff);
+        locked = true;
+    }
+}
+
+// Measure the achieved phase of pending stimulations that are now at least
+// half a window in the past.  Stimulations that are too old to measure are dropped.
+void PhaseTracker::measureStimulations()
+{
+    const int half = windowLength / 2;
+    int i = 0;
+    while (i < pending.size()) {
+        double position = (pending[i] - firstTimestamp - 0.5 * (decimation - 1)) / decimation;
+        qint64 center = qRound64(position);
+        if (center + half > numDecimated - 1) {
+            ++i;
+            continue;
+        }
+        if (center - half >= numDecimated - history.size()) {
+            loadWindow(center + half - 1);
+            fft->transform(window.constData(), binRe.data(), binIm.data());
+            Complex z(0.0, 0.0);
+            for (int k = 1; k < binRe.size() - 1; ++k) {
+                z += Complex(binRe[k], binIm[k]) * centerWeights[k];
+            }
+
+            // Advance from the window center to the exact stimulation time.
+            double offsetSeconds = (position - center) * decimation / sampleRate;
+            PhaseStimulation stimulation;
+            stimulation.timestamp = pending[i];
+            stimulation.targetPhase = targetPhase;
+            stimulation.achievedPhase = wrapPhase(arg(z) + TWO_PI * frequency * offsetSeconds);
+            stimulation.error = wrapPhase(stimulation.achievedPhase - targetPhase);
+            stimulation.frequency = frequency;
+            results.append(stimulation);
+
+            ++numMeasured;
+            sumCos += cos(stimulation.error);
+            sumSin += sin(stimulation.error);
+        }
+        pending.remove(i);
+    }
+}
+
+// True once enough data has arrived for a phase estimate.
+bool PhaseTracker::isLocked() const
+{
+    return locked;
+}
+
+// Estimated phase, in radians, at getPhaseTimestamp().
+double PhaseTracker::getPhase() const
+{
+    return phase;
+}
+
+double PhaseTracker::getPhaseTimestamp() const
+{
+    return phaseTimestamp;
+}
+
+// Estimated oscillation frequency, in Hz.
+double PhaseTracker::getFrequency() const
+{
+    return frequency;
+}
+
+double PhaseTracker::getTargetPhase() const
+{
+    return targetPhase;
+}
+
+// Predicted board timestamp (in samples, with a fractional part) of the first
+// occurrence of the target phase at or after afterTimestamp, extrapolating
+// from the latest estimate at its frequency.
+double PhaseTracker::nextCrossing(double afterTimestamp) const
+{
+    double period = sampleRate / frequency;
+    double cycles = (targetPhase - phase) / TWO_PI;
+    cycles -= floor(cycles);
+    double crossing = phaseTimestamp + cycles * period;
+    if (crossing < afterTimestamp) {
+        crossing += ceil((afterTimestamp - crossing) / period) * period;
+    }
+    return crossing;
+}
+
+// Record a stimulation at the given board timestamp, so that its achieved
+// phase is measured once later data arrives.
+void PhaseTracker::addStimulation(double timestamp)
+{
+    if (enabled) {
+        pending.append(timestamp);
+    }
+}
+
+// Stimulations measured during the last call to update().
+const QVector<PhaseStimulation>& PhaseTracker::getResults() const
+{
+    return results;
+}
+
+// Number of stimulations measured since reset.
+int PhaseTracker::getNumMeasured() const
+{
+    return numMeasured;
+}
+
+// Circular mean of the phase error, in radians.
+double PhaseTracker::getMeanError() const
+{
+    return atan2(sumSin, sumCos);
+}
+
+// Circular standard deviation of the phase error, in radians.
+double PhaseTracker::getErrorDeviation() const
+{
+    if (numMeasured == 0) return 0.0;
+    double resultant = sqrt(sumCos * sumCos + sumSin * sumSin) / numMeasured;
+    return sqrt(-2.0 * log(qMax(resultant, 1.0e-12)));
+}
@@ -0,0 +1,137 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PHASETRACKER_H
+#define PHASETRACKER_H
+
+#include <QVector>
+#include <complex>
+
+#include "globalconstants.h"
+
+class RealFft;
+
+// One stimulation delivered at a target phase, and the phase it achieved.
+// Phases are in radians, with 0 at the peak and pi at the trough of the
+// oscillation; timestamps are in board samples.
+struct PhaseStimulation
+{
+    double timestamp;           // estimated board timestamp at which the trigger took effect
+    double targetPhase;
+    double achievedPhase;       // from a zero-phase estimate centered on the timestamp
+    double error;               // achieved - target, wrapped to [-pi, pi)
+    double frequency;           // oscillation frequency at the time, in Hz
+};
+
+// Causal estimate of the phase of an ongoing oscillation (e.g., theta or beta)
+// in one amplifier channel or the average of several, for stimulation locked
+// to a target phase.
+//
+// The signal is averaged over the selected lanes and decimated to about 1 kHz
+// by averaging groups of samples.  After each block, the phase at the newest
+// sample is estimated with the endpoint-corrected Hilbert transform (ecHT):
+// the last few cycles are Fourier transformed, negative frequencies are
+// dropped, the spectrum is weighted by the frequency response of a causal
+// two-pole band-pass filter, and the analytic signal is evaluated at the last
+// sample only.  The causal filter suppresses the distortion that a plain FFT
+// Hilbert transform has at the end of the window.  The frequency is the
+// centroid of the weighted spectrum.  nextCrossing() extrapolates the phase
+// at this frequency to predict when the target phase will next occur.
+//
+// Stimulation times passed to addStimulation() are checked once half a window
+// of later data has arrived: the phase there is measured with the same band
+// weighting but centered on the stimulation (a zero-phase, non-causal
+// estimate), and the error from the target is accumulated into circular
+// statistics.
+class PhaseTracker
+{
+public:
+    PhaseTracker();
+    ~PhaseTracker();
+
+    void setNumLanes(int numLanes_);
+    bool setParameters(bool enabled_, const QVector<int> &lanes_, double lowCutoff_, double highCutoff_,
+                       double targetPhase_, double sampleRate_);
+    void resetState();
+    bool isEnabled() const;
+
+    void update(const qint16 *codes, int numFrames, const qint32 *timestamps);
+
+    bool isLocked() const;
+    double getPhase() const;
+    double getPhaseTimestamp() const;
+    double getFrequency() const;
+    double getTargetPhase() const;
+    double nextCrossing(double afterTimestamp) const;
+
+    void addStimulation(double timestamp);
+    const QVector<PhaseStimulation>& getResults() const;
+    int getNumMeasured() const;
+    double getMeanError() const;
+    double getErrorDeviation() const;
+
+private:
+    typedef std::complex<double> Complex;
+
+    bool enabled;
+    QVector<int> lanes;
+    double lowCutoff;
+    double highCutoff;
+    double targetPhase;
+    double sampleRate;
+    int numLanes;
+
+    int decimation;             // input samples averaged into each decimated sample
+    int windowLength;           // decimated samples transformed per estimate (a power of two)
+    RealFft *fft;
+    QVector<Complex> endpointWeights;   // causal band weighting and evaluation at the last sample
+    QVector<double> centerWeights;      // zero-phase band weighting at the window center (real)
+    QVector<double> bandPower;          // squared causal response, for the frequency centroid
+
+    QVector<double> history;    // decimated samples, as a circular buffer of twice windowLength
+    qint64 numDecimated;        // decimated samples produced since reset
+    double accumulator;         // sum of the current partial group of samples
+    int accumulated;
+    qint64 firstTimestamp;
+    qint64 nextTimestamp;       // expected timestamp of the next frame, or -1 after reset
+
+    bool locked;
+    double phase;
+    double phaseTimestamp;
+    double frequency;
+
+    QVector<double> pending;    // stimulation timestamps awaiting measurement
+    QVector<PhaseStimulation> results;
+    int numMeasured;
+    double sumCos;
+    double sumSin;
+
+    QVector<double> window;
+    QVector<double> binRe;
+    QVector<double> binIm;
+
+    double decimatedTimestamp(qint64 index) const;
+    void loadWindow(qint64 lastIndex);
+    void estimatePhase();
+    void measureStimulations();
+};
+
+#endif // PHASETRACKER_H
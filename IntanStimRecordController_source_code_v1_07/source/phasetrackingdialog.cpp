@@ -0,0 +1,153 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "phasetrackingdialog.h"
+#include "globalconstants.h"
+
+// Phase-locked stimulation dialog.
+// This dialog allows users to track the phase of an ongoing oscillation (e.g.,
+// theta or beta) in one channel or the average of several, and to fire a
+// manual stimulation trigger each time a target phase is predicted.
+
+PhaseTrackingDialog::PhaseTrackingDialog(const PhaseTrackingSettings &settings, QWidget *parent) :
+    QDialog(parent)
+{
+    enableCheckBox = new QCheckBox(tr("Enable phase-locked stimulation"));
+    enableCheckBox->setChecked(settings.enabled);
+
+    channelsLineEdit = new QLineEdit(settings.channels);
+    channelsLineEdit->setToolTip(tr("Native channel names (e.g., A-012), separated by commas.  "
+                                    "Several channels are averaged."));
+
+    lowCutoffSpinBox = new QDoubleSpinBox();
+    lowCutoffSpinBox->setRange(1.0, 100.0);
+    lowCutoffSpinBox->setDecimals(1);
+    lowCutoffSpinBox->setSuffix(" Hz");
+    lowCutoffSpinBox->setValue(settings.lowCutoff);
+
+    highCutoffSpinBox = new QDoubleSpinBox();
+    highCutoffSpinBox->setRange(2.0, 200.0);
+    highCutoffSpinBox->setDecimals(1);
+    highCutoffSpinBox->setSuffix(" Hz");
+    highCutoffSpinBox->setValue(settings.highCutoff);
+
+    targetPhaseSpinBox = new QDoubleSpinBox();
+    targetPhaseSpinBox->setRange(-180.0, 360.0);
+    targetPhaseSpinBox->setDecimals(0);
+    targetPhaseSpinBox->setSingleStep(15.0);
+    targetPhaseSpinBox->setSuffix(QSTRING_DEGREE_SYMBOL);
+    targetPhaseSpinBox->setValue(settings.targetPhaseDeg);
+
+    outputLatencySpinBox = new QDoubleSpinBox();
+    outputLatencySpinBox->setRange(0.0, 50.0);
+    outputLatencySpinBox->setDecimals(1);
+    outputLatencySpinBox->setSingleStep(0.5);
+    outputLatencySpinBox->setSuffix(" ms");
+    outputLatencySpinBox->setValue(settings.outputLatencyMsec);
+
+    minIntervalSpinBox = new QDoubleSpinBox();
+    minIntervalSpinBox->setRange(0.0, 10000.0);
+    minIntervalSpinBox->setDecimals(0);
+    minIntervalSpinBox->setSingleStep(50.0);
+    minIntervalSpinBox->setSuffix(" ms");
+    minIntervalSpinBox->setValue(settings.minIntervalMsec);
+
+    triggerComboBox = new QComboBox();
+    for (int i = 1; i <= 8; ++i) {
+        triggerComboBox->addItem(tr("KEYPRESS: %1").arg(i));
+    }
+    triggerComboBox->setCurrentIndex(settings.trigger);
+
+    connect(enableCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateControls()));
+
+    QFormLayout *formLayout = new QFormLayout();
+    formLayout->addRow(tr("Channels"), channelsLineEdit);
+    formLayout->addRow(tr("Low cutoff frequency"), lowCutoffSpinBox);
+    formLayout->addRow(tr("High cutoff frequency"), highCutoffSpinBox);
+    formLayout->addRow(tr("Target phase"), targetPhaseSpinBox);
+    formLayout->addRow(tr("Trigger output latency"), outputLatencySpinBox);
+    formLayout->addRow(tr("Minimum interval"), minIntervalSpinBox);
+    formLayout->addRow(tr("Trigger source"), triggerComboBox);
+
+    QLabel *noteLabel = new QLabel(tr("The phase of the selected band is estimated causally at the end of each "
+                                      "block of data, and the next time the target phase will occur is "
+                                      "predicted.  A target phase of 0") + QSTRING_DEGREE_SYMBOL +
+                                   tr(" is the peak of the oscillation and 180") + QSTRING_DEGREE_SYMBOL +
+                                   tr(" the trough.  The trigger is scheduled allowing for the data still in "
+                                      "the USB FIFO, the processing time, and the trigger output latency (the "
+                                      "delay between sending the trigger and its effect on the board).  The "
+                                      "trigger source is the same as pressing the corresponding number key, "
+                                      "so stimulation or digital outputs must be set to use it.  The phase "
+                                      "actually achieved by each trigger is measured from later data; the "
+                                      "statistics are shown next to the Phase-Locked Stimulation button, and "
+                                      "each trigger is logged to a .phase.csv file while recording."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(enableCheckBox);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Phase-Locked Stimulation"));
+
+    updateControls();
+}
+
+// Enable the controls if phase tracking is enabled.
+void PhaseTrackingDialog::updateControls()
+{
+    bool enabled = enableCheckBox->isChecked();
+
+    channelsLineEdit->setEnabled(enabled);
+    lowCutoffSpinBox->setEnabled(enabled);
+    highCutoffSpinBox->setEnabled(enabled);
+    targetPhaseSpinBox->setEnabled(enabled);
+    outputLatencySpinBox->setEnabled(enabled);
+    minIntervalSpinBox->setEnabled(enabled);
+    triggerComboBox->setEnabled(enabled);
+}
+
+PhaseTrackingSettings PhaseTrackingDialog::getSettings() const
+{
+    PhaseTrackingSettings settings;
+    settings.enabled = enableCheckBox->isChecked();
+    settings.channels = channelsLineEdit->text().trimmed();
+    settings.lowCutoff = qMin(lowCutoffSpinBox->value(), highCutoffSpinBox->value());
+    settings.highCutoff = qMax(lowCutoffSpinBox->value(), highCutoffSpinBox->value());
+    settings.targetPhaseDeg = targetPhaseSpinBox->value();
+    settings.outputLatencyMsec = outputLatencySpinBox->value();
+    settings.minIntervalMsec = minIntervalSpinBox->value();
+    settings.trigger = triggerComboBox->currentIndex();
+    return settings;
+}
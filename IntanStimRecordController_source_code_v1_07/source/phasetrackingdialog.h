@@ -0,0 +1,76 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PHASETRACKINGDIALOG_H
+#define PHASETRACKINGDIALOG_H
+
+#include <QDialog>
+
+class QDialogButtonBox;
+class QCheckBox;
+class QComboBox;
+class QLineEdit;
+class QDoubleSpinBox;
+
+// Phase-locked stimulation settings.  channels lists the native names of the
+// amplifier channels averaged for phase estimation, separated by commas.
+// Phases are in degrees (0 = peak, 180 = trough) and times in milliseconds,
+// so they are independent of the sample rate.
+struct PhaseTrackingSettings
+{
+    bool enabled;
+    QString channels;
+    double lowCutoff;
+    double highCutoff;
+    double targetPhaseDeg;
+    double outputLatencyMsec;
+    double minIntervalMsec;
+    int trigger;
+};
+
+class PhaseTrackingDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit PhaseTrackingDialog(const PhaseTrackingSettings &settings, QWidget *parent);
+
+    PhaseTrackingSettings getSettings() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateControls();
+
+private:
+    QCheckBox *enableCheckBox;
+    QLineEdit *channelsLineEdit;
+    QDoubleSpinBox *lowCutoffSpinBox;
+    QDoubleSpinBox *highCutoffSpinBox;
+    QDoubleSpinBox *targetPhaseSpinBox;
+    QDoubleSpinBox *outputLatencySpinBox;
+    QDoubleSpinBox *minIntervalSpinBox;
+    QComboBox *triggerComboBox;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // PHASETRACKINGDIALOG_H
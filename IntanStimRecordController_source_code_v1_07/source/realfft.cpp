@@ -0,0 +1,134 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+
+#include "realfft.h"
+#include "globalconstants.h"
+
+// Make a plan for real transforms of length n (a power of two, at least 4).
+RealFft::RealFft(int n_)
+{
+    n = n_;
+    half = n / 2;
+
+    int bits = 0;
+    while ((1 << bits) < half) ++bits;
+    bitReverse.resize(half);
+    for (int i = 0; i < half; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        bitReverse[i] = r;
+    }
+
+    cosTable.resize(half / 2);
+    sinTable.resize(half / 2);
+    for (int j = 0; j < half / 2; ++j) {
+        cosTable[j] = cos(TWO_PI * j / half);
+        sinTable[j] = -sin(TWO_PI * j / half);
+    }
+
+    splitCos.resize(half + 1);
+    splitSin.resize(half + 1);
+    for (int k = 0; k <= half; ++k) {
+        splitCos[k] = cos(TWO_PI * k / n);
+        splitSin[k] = -sin(TWO_PI * k / n);
+    }
+
+    zRe.resize(half);
+    zIm.resize(half);
+    binRe.resize(half + 1);
+    binIm.resize(half + 1);
+}
+
+int RealFft::size() const
+{
+    return n;
+}
+
+// Number of non-redundant frequency bins (DC to Nyquist).
+int RealFft::numBins() const
+{
+    return half + 1;
+}
+
+bool RealFft::isPowerOfTwo(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// In-place radix-2 decimation-in-time FFT of zRe, zIm (already bit-reversed).
+void RealFft::complexFft()
+{
+    for (int length = 2; length <= half; length <<= 1) {
+        int halfLength = length / 2;
+        int tableStep = half / length;
+        for (int start = 0; start < half; start += length) {
+            for (int j = 0; j < halfLength; ++j) {
+                double wRe = cosTable[j * tableStep];
+                double wIm = sinTable[j * tableStep];
+                int a = start + j;
+                int b = a + halfLength;
+                double tRe = zRe[b] * wRe - zIm[b] * wIm;
+                double tIm = zRe[b] * wIm + zIm[b] * wRe;
+                zRe[b] = zRe[a] - tRe;
+                zIm[b] = zIm[a] - tIm;
+                zRe[a] += tRe;
+                zIm[a] += tIm;
+            }
+        }
+    }
+}
+
+// Transform n real samples to numBins() complex bins.
+void RealFft::transform(const double *in, double *re, double *im)
+{
+    // Pack even samples as real parts and odd samples as imaginary parts.
+    for (int m = 0; m < half; ++m) {
+        int r = bitReverse[m];
+        zRe[r] = in[2 * m];
+        zIm[r] = in[2 * m + 1];
+    }
+    complexFft();
+
+    // Separate the transforms of the even and odd samples, and combine them.
+    for (int k = 0; k <= half; ++k) {
+        int a = (k == half) ? 0 : k;
+        int b = (k == 0) ? 0 : half - k;
+        double evenRe = 0.5 * (zRe[a] + zRe[b]);
+        double evenIm = 0.5 * (zIm[a] - zIm[b]);
+        double oddRe = 0.5 * (zIm[a] + zIm[b]);
+        double oddIm = -0.5 * (zRe[a] - zRe[b]);
+        re[k] = evenRe + oddRe * splitCos[k] - oddIm * splitSin[k];
+        im[k] = evenIm + oddRe * splitSin[k] + oddIm * splitCos[k];
+    }
+}
+
+// Squared magnitude of each of the numBins() bins of the transform of n real samples.
+void RealFft::powerSpectrum(const double *in, double *power)
+{
+    transform(in, binRe.data(), binIm.data());
+    for (int k = 0; k <= half; ++k) {
+        power[k] = binRe[k] * binRe[k] + binIm[k] * binIm[k];
+    }
+}
@@ -0,0 +1,63 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <QVector>
+
+// Fast Fourier transform of real data whose length is a power of two.
+//
+// Constructing a RealFft makes a plan (bit-reversal permutation and twiddle
+// factors) that is reused for every transform of that length.  A length n
+// real sequence is transformed as a length n/2 complex sequence by an
+// iterative radix-2 FFT, then split into the n/2 + 1 non-redundant bins of
+// the real transform.  Transforms use scratch space in the plan, so a plan
+// must not be shared between threads.
+class RealFft
+{
+public:
+    explicit RealFft(int n_);
+
+    int size() const;
+    int numBins() const;
+    void transform(const double *in, double *re, double *im);
+    void powerSpectrum(const double *in, double *power);
+
+    static bool isPowerOfTwo(int n);
+
+private:
+    int n;
+    int half;
+    QVector<int> bitReverse;
+    QVector<double> cosTable;       // exp(-2 pi i j / half), j < half / 2
+    QVector<double> sinTable;
+    QVector<double> splitCos;       // exp(-2 pi i k / n), k <= half
+    QVector<double> splitSin;
+    QVector<double> zRe;
+    QVector<double> zIm;
+    QVector<double> binRe;
+    QVector<double> binIm;
+
+    void complexFft();
+};
+
+#endif // REALFFT_H
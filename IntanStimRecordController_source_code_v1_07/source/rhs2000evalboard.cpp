@@ -53,6 +53,9 @@ Rhs2000EvalBoard::Rhs2000EvalBoard()
 	}
 
     cableDelay.resize(MAX_NUM_SPI_PORTS, -1);
+    for (i = 0; i < 8; ++i) {
+        dacThresholdPolarity[i] = -1;
+    }
     lastNumWordsInFifo = 0;
     numWordsHasBeenUpdated = false;
 }
@@ -1202,6 +1205,40 @@ void Rhs2000EvalBoard::setDacThreshold(int dacChannel, int threshold, bool trigP
 	dev->SetWireInValue(WireInMultiUse, (trigPolarity ? 1 : 0));
 	dev->UpdateWireIns();
     dev->ActivateTriggerIn(TrigInDacThresh, dacChannel + 8);
+    dacThresholdPolarity[dacChannel] = trigPolarity ? 1 : 0;
+}
+
+// Set the thresholds of several DAC threshold comparators in one batch, so that
+// the USB interface is claimed only once while data acquisition is running.
+// Polarities are only sent when they differ from the last polarity set.
+void Rhs2000EvalBoard::setDacThresholds(const vector<int> &dacChannels, const vector<int> &thresholds,
+                                        const vector<bool> &trigPolarities)
+{
+    lock_guard<mutex> lockOk(okMutex);
+
+    for (unsigned int i = 0; i < dacChannels.size(); ++i) {
+        int dacChannel = dacChannels[i];
+        if (dacChannel < 0 || dacChannel > 7) {
+            cerr << "Error in Rhs2000EvalBoard::setDacThresholds: dacChannel out of range." << endl;
+            continue;
+        }
+        if (thresholds[i] < 0 || thresholds[i] > 65535) {
+            cerr << "Error in Rhs2000EvalBoard::setDacThresholds: threshold out of range." << endl;
+            continue;
+        }
+
+        dev->SetWireInValue(WireInMultiUse, thresholds[i]);
+        dev->UpdateWireIns();
+        dev->ActivateTriggerIn(TrigInDacThresh, dacChannel);
+
+        int polarity = trigPolarities[i] ? 1 : 0;
+        if (polarity != dacThresholdPolarity[dacChannel]) {
+            dev->SetWireInValue(WireInMultiUse, polarity);
+            dev->UpdateWireIns();
+            dev->ActivateTriggerIn(TrigInDacThresh, dacChannel + 8);
+            dacThresholdPolarity[dacChannel] = polarity;
+        }
+    }
 }
 
 // Is variable-frequency clock DCM programming done?
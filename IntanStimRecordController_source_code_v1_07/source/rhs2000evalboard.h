@@ -145,6 +145,8 @@ public:
     void enableDacHighpassFilter(bool enable);
     void setDacHighpassFilter(double cutoff);
     void setDacThreshold(int dacChannel, int threshold, bool trigPolarity);
+    void setDacThresholds(const vector<int> &dacChannels, const vector<int> &thresholds,
+                          const vector<bool> &trigPolarities);
 
 	void flush();
 	bool readDataBlock(Rhs2000DataBlock *dataBlock);
@@ -224,6 +226,7 @@ private:
 	int numDataStreams; // total number of data streams currently enabled
 	int dataStreamEnabled[MAX_NUM_DATA_STREAMS]; // 0 (disabled) or 1 (enabled)
 	vector<int> cableDelay;
+    int dacThresholdPolarity[8]; // last polarity sent to each DAC threshold comparator, or -1
 
     // Methods in this class are designed to be thread-safe.  This variable is used to ensure that.
     std::mutex okMutex;
@@ -1562,6 +1562,81 @@ int Rhs2000Registers::createCommandListZcheckDac(vector<unsigned int> &commandLi
 	return commandList.size();
 }
 
+// Create a list of period commands to generate a multi-tone waveform using the on-chip impedance
+// testing voltage DAC.  The waveform is a sum of equal-amplitude sine waves at the listed harmonics
+// of sampleRate / period, so every tone completes a whole number of cycles in one pass through the
+// command list.  Tone phases follow Schroeder's rule to keep the crest factor low, and the sum is
+// scaled so that its peak is amplitude (in DAC steps, 0-128).  The amplitude of each tone (in DAC
+// steps) is returned in toneAmplitude and the phase of each tone (in radians, relative to a sine
+// wave starting at the first command) in tonePhases.
+// Returns the length of the command list.
+int Rhs2000Registers::createCommandListZcheckDac(vector<unsigned int> &commandList, int period,
+												 const vector<int> &harmonics, double amplitude,
+												 double &toneAmplitude, vector<double> &tonePhases)
+{
+	int i, k, value;
+	double peak;
+	const double Pi = 2 * acos(0.0);
+	const int numTones = harmonics.size();
+
+	commandList.clear();    // if command list already exists, erase it and start a new one
+	tonePhases.clear();
+	toneAmplitude = 0.0;
+
+	if (amplitude < 0.0 || amplitude > 128.0) {
+		cerr << "Error in Rhs2000Registers::createCommandListZcheckDac: Amplitude out of range." << endl;
+		return -1;
+	}
+	if (period < 4 || period > MaxCommandLength) {
+		cerr << "Error in Rhs2000Registers::createCommandListZcheckDac: Period out of range." << endl;
+		return -1;
+	}
+	if (numTones == 0) {
+		cerr << "Error in Rhs2000Registers::createCommandListZcheckDac: No tones specified." << endl;
+		return -1;
+	}
+	for (k = 0; k < numTones; ++k) {
+		if (harmonics[k] < 1) {
+			cerr << "Error in Rhs2000Registers::createCommandListZcheckDac: Harmonic out of range." << endl;
+			return -1;
+		}
+		else if (4 * harmonics[k] > period) {
+			cerr << "Error in Rhs2000Registers::createCommandListZcheckDac: " <<
+				"Frequency too high relative to sampling rate." << endl;
+			return -1;
+		}
+	}
+
+	for (k = 0; k < numTones; ++k) {
+		tonePhases.push_back(-Pi * k * (k + 1) / numTones);
+	}
+
+	vector<double> waveform(period, 0.0);
+	peak = 0.0;
+	for (i = 0; i < period; ++i) {
+		for (k = 0; k < numTones; ++k) {
+			waveform[i] += sin(2 * Pi * harmonics[k] * i / period + tonePhases[k]);
+		}
+		if (fabs(waveform[i]) > peak) {
+			peak = fabs(waveform[i]);
+		}
+	}
+	toneAmplitude = amplitude / peak;
+
+	for (i = 0; i < period; ++i) {
+		value = (int)floor(toneAmplitude * waveform[i] + 128.0 + 0.5);
+		if (value < 0) {
+			value = 0;
+		}
+		else if (value > 255) {
+			value = 255;
+		}
+		commandList.push_back(createRhs2000Command(Rhs2000CommandRegWrite, 3, value));
+	}
+
+	return commandList.size();
+}
+
 // Create a list of dummy commands for the RHS2116 chip.
 // Returns the length of the command list (which should be n).
 int Rhs2000Registers::createCommandListDummy(vector <unsigned int> &commandList, int n)
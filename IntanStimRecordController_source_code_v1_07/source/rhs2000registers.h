@@ -118,6 +118,8 @@ public:
     int createCommandListRegisterConfig(vector<unsigned int> &commandList, bool updateStimParams);
     int createCommandListRegisterRead(vector<unsigned int> &commandList);
 	int createCommandListZcheckDac(vector<unsigned int> &commandList, double frequency, double amplitude);
+	int createCommandListZcheckDac(vector<unsigned int> &commandList, int period, const vector<int> &harmonics,
+								   double amplitude, double &toneAmplitude, vector<double> &tonePhases);
 	int createCommandListDummy(vector <unsigned int> &commandList, int n);
 	int createCommandListDummy(vector <unsigned int> &commandList, int n, unsigned int cmd);
 	int createCommandListSingleRegisterConfig(vector<unsigned int> &commandList, int reg);
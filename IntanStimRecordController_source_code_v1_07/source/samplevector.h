@@ -0,0 +1,180 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SAMPLEVECTOR_H
+#define SAMPLEVECTOR_H
+
+#include <QtGlobal>
+#include <cstring>
+#include "globalconstants.h"
+
+// SIMD vector of waveform samples (see Sample in globalconstants.h), used by
+// the multichannel signal processing kernels.
+//
+// The instruction set is chosen at compile time from those the compiler is
+// allowed to use: AVX-512 (8 doubles per vector), AVX/AVX2 (4 doubles) or SSE2
+// (2 doubles, always available on x86-64).  Vectors hold twice as many samples
+// when Sample is float.  SAMPLE_VECTOR_SIMD is defined if any of these is
+// available; otherwise SampleVector holds a single sample.  loadCodes() loads
+// Width signed 16-bit ADC codes (see SignalProcessor::amplifierPreFilterFast)
+// as samples, unscaled.
+
+#if defined(__AVX512F__)
+#define SAMPLE_VECTOR_AVX512
+#include <immintrin.h>
+#elif defined(__AVX__)
+#define SAMPLE_VECTOR_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAMPLE_VECTOR_SSE2
+#include <emmintrin.h>
+#elif defined(__i386__)
+#warning "SSE2 is not enabled; the multichannel filter kernels will not be vectorized (see the .pro file)"
+#endif
+
+#if defined(SAMPLE_VECTOR_AVX512) || defined(SAMPLE_VECTOR_AVX) || defined(SAMPLE_VECTOR_SSE2)
+#define SAMPLE_VECTOR_SIMD
+#endif
+
+#if defined(SAMPLE_VECTOR_AVX512) && defined(SIGNAL_PROCESSOR_FLOAT)
+struct SampleVector
+{
+    typedef __m512 V;
+    enum { Width = 16 };
+    static V set1(float a) { return _mm512_set1_ps(a); }
+    static V loadu(const float *p) { return _mm512_loadu_ps(p); }
+    static V loadCodes(const qint16 *p) { return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*) p))); }
+    static void storeu(float *p, V a) { _mm512_storeu_ps(p, a); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm512_min_ps(a, b); }
+    static V max(V a, V b) { return _mm512_max_ps(a, b); }
+};
+#elif defined(SAMPLE_VECTOR_AVX512)
+struct SampleVector
+{
+    typedef __m512d V;
+    enum { Width = 8 };
+    static V set1(double a) { return _mm512_set1_pd(a); }
+    static V loadu(const double *p) { return _mm512_loadu_pd(p); }
+    static V loadCodes(const qint16 *p) { return _mm512_cvtepi32_pd(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*) p))); }
+    static void storeu(double *p, V a) { _mm512_storeu_pd(p, a); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm512_min_pd(a, b); }
+    static V max(V a, V b) { return _mm512_max_pd(a, b); }
+};
+#elif defined(SAMPLE_VECTOR_AVX) && defined(SIGNAL_PROCESSOR_FLOAT)
+struct SampleVector
+{
+    typedef __m256 V;
+    enum { Width = 8 };
+    static V set1(float a) { return _mm256_set1_ps(a); }
+    static V loadu(const float *p) { return _mm256_loadu_ps(p); }
+    static V loadCodes(const qint16 *p)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i*) p);
+        __m256i w = _mm256_insertf128_si256(_mm256_castsi128_si256(_mm_cvtepi16_epi32(c)),
+                                            _mm_cvtepi16_epi32(_mm_unpackhi_epi64(c, c)), 1);
+        return _mm256_cvtepi32_ps(w);
+    }
+    static void storeu(float *p, V a) { _mm256_storeu_ps(p, a); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+};
+#elif defined(SAMPLE_VECTOR_AVX)
+struct SampleVector
+{
+    typedef __m256d V;
+    enum { Width = 4 };
+    static V set1(double a) { return _mm256_set1_pd(a); }
+    static V loadu(const double *p) { return _mm256_loadu_pd(p); }
+    static V loadCodes(const qint16 *p) { return _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*) p))); }
+    static void storeu(double *p, V a) { _mm256_storeu_pd(p, a); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm256_min_pd(a, b); }
+    static V max(V a, V b) { return _mm256_max_pd(a, b); }
+};
+#elif defined(SAMPLE_VECTOR_SSE2) && defined(SIGNAL_PROCESSOR_FLOAT)
+struct SampleVector
+{
+    typedef __m128 V;
+    enum { Width = 4 };
+    static V set1(float a) { return _mm_set1_ps(a); }
+    static V loadu(const float *p) { return _mm_loadu_ps(p); }
+    static V loadCodes(const qint16 *p)
+    {
+        __m128i c = _mm_loadl_epi64((const __m128i*) p);
+        return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16));
+    }
+    static void storeu(float *p, V a) { _mm_storeu_ps(p, a); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+};
+#elif defined(SAMPLE_VECTOR_SSE2)
+struct SampleVector
+{
+    typedef __m128d V;
+    enum { Width = 2 };
+    static V set1(double a) { return _mm_set1_pd(a); }
+    static V loadu(const double *p) { return _mm_loadu_pd(p); }
+    static V loadCodes(const qint16 *p)
+    {
+        int bits;
+        memcpy(&bits, p, sizeof(bits));
+        __m128i c = _mm_cvtsi32_si128(bits);
+        return _mm_cvtepi32_pd(_mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16));
+    }
+    static void storeu(double *p, V a) { _mm_storeu_pd(p, a); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm_min_pd(a, b); }
+    static V max(V a, V b) { return _mm_max_pd(a, b); }
+};
+#else
+struct SampleVector
+{
+    typedef Sample V;
+    enum { Width = 1 };
+    static V set1(Sample a) { return a; }
+    static V loadu(const Sample *p) { return *p; }
+    static V loadCodes(const qint16 *p) { return (Sample) *p; }
+    static void storeu(Sample *p, V a) { *p = a; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V min(V a, V b) { return (b < a) ? b : a; }
+    static V max(V a, V b) { return (a < b) ? b : a; }
+};
+#endif
+
+#endif // SAMPLEVECTOR_H
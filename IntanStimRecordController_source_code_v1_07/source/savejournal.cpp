@@ -0,0 +1,326 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QDateTime>
+#include <iostream>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "savejournal.h"
+#include "checksummedfile.h"
+#include "crc32c.h"
+
+using namespace std;
+
+// Crash recovery journal for data files being recorded to disk.
+//
+// The journal is a small sidecar file written next to the data files.  Its
+// header lists the data files belonging to the recording; it is followed by a
+// sequence of fixed-size checkpoint records.  Each checkpoint first flushes
+// and syncs all data files to disk, and only then appends a record giving the
+// number of data blocks written, the last timestamp written, and the byte
+// length of each data file.  A record therefore never describes data that
+// has not reached the disk, and a crash loses at most one checkpoint period
+// of data.  Data writes between checkpoints are not synced, so the cost of
+// journaling is a few small writes and one sync per period.
+//
+// If the data files compute CRC-32C checksums, each record also stores the
+// checksum of each file up to its recorded length, so that a recording trimmed
+// back to a checkpoint can still be verified.  Each record ends with its own
+// CRC-32C so that a record torn by a crash can be recognized and ignored.
+// The last record of a recording that was closed normally is marked as a
+// clean close.
+
+// Constructor.
+SaveJournal::SaveJournal()
+{
+    journalFile = nullptr;
+    checksumsEnabled = false;
+    checkpointPeriodMSecs = 5000;
+    sequence = 0;
+    blocksWritten = 0;
+    lastTimestamp = 0;
+}
+
+SaveJournal::~SaveJournal()
+{
+    if (journalFile) {
+        close();
+    }
+}
+
+// Return the journal filename for a recording with the specified base name.
+QString SaveJournal::journalFileName(const QString &path, const QString &baseName)
+{
+    return path + "/" + baseName + ".journal";
+}
+
+// Create a new journal file listing dataFiles and write its header.  Data files
+// must already be open for writing.  Returns false if the journal cannot be created.
+bool SaveJournal::open(const QString &journalFileName, SaveFormat format, double sampleRate,
+                       const QVector<ChecksummedFile*> &dataFiles, int checkpointPeriodSeconds)
+{
+    files = dataFiles;
+    checksumsEnabled = !files.isEmpty();
+    for (int i = 0; i < files.size(); ++i) {
+        if (!files[i]->checksumsEnabled()) checksumsEnabled = false;
+    }
+    checkpointPeriodMSecs = 1000 * (qint64) checkpointPeriodSeconds;
+    sequence = 0;
+    blocksWritten = 0;
+    lastTimestamp = 0;
+    checkpointTimer.invalidate();
+
+    journalFile = new QFile(journalFileName);
+    if (!journalFile->open(QIODevice::WriteOnly)) {
+        cerr << "Cannot open journal file for writing: " <<
+                qPrintable(journalFile->errorString()) << endl;
+        delete journalFile;
+        journalFile = nullptr;
+        return false;
+    }
+
+    QDir journalDir = QFileInfo(journalFileName).absoluteDir();
+
+    QDataStream out(journalFile);
+    out.setVersion(QDataStream::Qt_4_8);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << (quint32) JOURNAL_FILE_MAGIC_NUMBER;
+    out << (qint16) JOURNAL_FILE_MAIN_VERSION_NUMBER;
+    out << (qint16) JOURNAL_FILE_SECONDARY_VERSION_NUMBER;
+    out << (qint16) format;
+    out << (float) sampleRate;
+    out << (qint16) checksumsEnabled;
+    out << (qint16) files.size();
+    for (int i = 0; i < files.size(); ++i) {
+        out << journalDir.relativeFilePath(QFileInfo(files[i]->fileName()).absoluteFilePath());
+    }
+
+    syncToDisk(journalFile);
+    return true;
+}
+
+// Account for newBlocks data blocks just written to the data files, and write
+// a checkpoint if the checkpoint period has elapsed.  The first call always
+// writes a checkpoint.
+void SaveJournal::update(int newBlocks, qint32 lastTimestamp_)
+{
+    if (!journalFile) return;
+
+    blocksWritten += newBlocks;
+    lastTimestamp = lastTimestamp_;
+
+    if (!checkpointTimer.isValid() || checkpointTimer.elapsed() >= checkpointPeriodMSecs) {
+        checkpoint();
+    }
+}
+
+// Sync all data files to disk, then append a checkpoint record describing them.
+void SaveJournal::checkpoint()
+{
+    if (!journalFile) return;
+
+    for (int i = 0; i < files.size(); ++i) {
+        if (!syncToDisk(files[i])) {
+            cerr << "SaveJournal: could not sync " << qPrintable(files[i]->fileName()) << " to disk." << endl;
+        }
+    }
+    writeRecord(false);
+    checkpointTimer.start();
+}
+
+// Write a final checkpoint marked as a clean close, and close the journal.
+// Must be called before the data files are closed.
+void SaveJournal::close()
+{
+    if (!journalFile) return;
+
+    for (int i = 0; i < files.size(); ++i) {
+        syncToDisk(files[i]);
+    }
+    writeRecord(true);
+
+    journalFile->close();
+    delete journalFile;
+    journalFile = nullptr;
+    files.clear();
+}
+
+// Size of one checkpoint record, in bytes.
+int SaveJournal::recordSizeInBytes(int numFiles)
+{
+    // magic (4) + sequence (4) + clean flag (1) + blocks (8) + timestamp (4) +
+    // wall clock (8) + offsets (8 each) + file CRCs (4 each) + record CRC (4)
+    return 33 + 12 * numFiles;
+}
+
+// Append one checkpoint record to the journal and sync it to disk.
+void SaveJournal::writeRecord(bool closedCleanly)
+{
+    QByteArray record;
+    record.reserve(recordSizeInBytes(files.size()));
+
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_8);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out << (quint32) JOURNAL_RECORD_MAGIC_NUMBER;
+    out << (quint32) sequence++;
+    out << (quint8) closedCleanly;
+    out << (quint64) blocksWritten;
+    out << (qint32) lastTimestamp;
+    out << (qint64) QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < files.size(); ++i) {
+        out << (qint64) files[i]->pos();
+    }
+    for (int i = 0; i < files.size(); ++i) {
+        out << (quint32) (checksumsEnabled ? files[i]->fileCrc() : 0);
+    }
+    out << (quint32) crc32c(0, record.constData(), record.size());
+
+    journalFile->write(record);
+    if (!syncToDisk(journalFile)) {
+        cerr << "SaveJournal: could not sync journal to disk." << endl;
+    }
+}
+
+// Flush Qt's write buffer for file and force its contents to the storage device.
+bool SaveJournal::syncToDisk(QFile *file)
+{
+    if (!file->flush()) {
+        return false;
+    }
+#if defined(Q_OS_WIN)
+    return (_commit(file->handle()) == 0);
+#elif defined(Q_OS_MAC)
+    return (fsync(file->handle()) == 0);
+#else
+    return (fdatasync(file->handle()) == 0);
+#endif
+}
+
+// Read a journal file.  Records are read in order until the end of the file or
+// the first record that is incomplete or fails its checksum.  Returns false
+// (with errorMessage set) if the journal header cannot be read.
+bool SaveJournal::readJournal(const QString &fileName, SaveJournalContents &contents, QString &errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorMessage = "Cannot open journal file: " + file.errorString();
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_8);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 tempQuint32;
+    qint16 tempQint16;
+    float tempFloat;
+
+    in >> tempQuint32;
+    if (tempQuint32 != JOURNAL_FILE_MAGIC_NUMBER) {
+        errorMessage = "Not a valid journal file.";
+        return false;
+    }
+    in >> tempQint16;
+    contents.versionMain = tempQint16;
+    in >> tempQint16;
+    contents.versionSecondary = tempQint16;
+    if (contents.versionMain > JOURNAL_FILE_MAIN_VERSION_NUMBER) {
+        errorMessage = "Journal file version is newer than this program supports.";
+        return false;
+    }
+    in >> tempQint16;
+    contents.saveFormat = (SaveFormat) tempQint16;
+    in >> tempFloat;
+    contents.sampleRate = tempFloat;
+    in >> tempQint16;
+    contents.hasChecksums = (tempQint16 != 0);
+    in >> tempQint16;
+    int numFiles = tempQint16;
+    contents.fileNames.clear();
+    for (int i = 0; i < numFiles; ++i) {
+        QString name;
+        in >> name;
+        contents.fileNames.append(name);
+    }
+    if (in.status() != QDataStream::Ok) {
+        errorMessage = "Journal file header is incomplete.";
+        return false;
+    }
+
+    contents.records.clear();
+    contents.truncatedRecord = false;
+
+    int recordSize = recordSizeInBytes(numFiles);
+    while (!file.atEnd()) {
+        QByteArray record = file.read(recordSize);
+        if (record.size() < recordSize) {
+            contents.truncatedRecord = true;
+            break;
+        }
+
+        QDataStream recordIn(record);
+        recordIn.setVersion(QDataStream::Qt_4_8);
+        recordIn.setByteOrder(QDataStream::LittleEndian);
+
+        quint32 magic, fileCrc, checksum;
+        quint8 clean;
+        SaveJournalRecord r;
+
+        recordIn >> magic;
+        recordIn >> r.sequence;
+        recordIn >> clean;
+        recordIn >> r.blocksWritten;
+        recordIn >> r.lastTimestamp;
+        recordIn >> r.wallClockMSecs;
+        r.offsets.resize(numFiles);
+        for (int i = 0; i < numFiles; ++i) {
+            recordIn >> r.offsets[i];
+        }
+        for (int i = 0; i < numFiles; ++i) {
+            recordIn >> fileCrc;
+            if (contents.hasChecksums) r.crcs.append(fileCrc);
+        }
+        recordIn >> checksum;
+        r.closedCleanly = (clean != 0);
+
+        if (magic != JOURNAL_RECORD_MAGIC_NUMBER ||
+                checksum != crc32c(0, record.constData(), recordSize - 4)) {
+            contents.truncatedRecord = true;
+            break;
+        }
+        contents.records.append(r);
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SAVEJOURNAL_H
+#define SAVEJOURNAL_H
+
+#include <QVector>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "globalconstants.h"
+
+class QFile;
+class ChecksummedFile;
+
+// One checkpoint record.  Offsets are listed in the same order as the file
+// names in the journal header.
+struct SaveJournalRecord
+{
+    quint32 sequence;
+    bool closedCleanly;
+    quint64 blocksWritten;
+    qint32 lastTimestamp;
+    qint64 wallClockMSecs;
+    QVector<qint64> offsets;
+    QVector<quint32> crcs;      // CRC-32C of each file up to its offset (empty if checksums were disabled)
+};
+
+// Contents of a journal file, as read back by SaveJournal::readJournal().
+struct SaveJournalContents
+{
+    int versionMain;
+    int versionSecondary;
+    SaveFormat saveFormat;
+    double sampleRate;
+    bool hasChecksums;
+    QStringList fileNames;      // relative to the directory containing the journal
+    QVector<SaveJournalRecord> records;
+    bool truncatedRecord;       // true if a partial or damaged record was found after the last valid one
+};
+
+class SaveJournal
+{
+public:
+    SaveJournal();
+    ~SaveJournal();
+
+    bool open(const QString &journalFileName, SaveFormat format, double sampleRate,
+              const QVector<ChecksummedFile*> &dataFiles, int checkpointPeriodSeconds);
+    void update(int newBlocks, qint32 lastTimestamp);
+    void checkpoint();
+    void close();
+
+    static QString journalFileName(const QString &path, const QString &baseName);
+    static bool readJournal(const QString &fileName, SaveJournalContents &contents, QString &errorMessage);
+    static bool syncToDisk(QFile *file);
+
+private:
+    QFile *journalFile;
+    QVector<ChecksummedFile*> files;
+    bool checksumsEnabled;
+    QElapsedTimer checkpointTimer;
+    qint64 checkpointPeriodMSecs;
+    quint32 sequence;
+    quint64 blocksWritten;
+    qint32 lastTimestamp;
+
+    void writeRecord(bool closedCleanly);
+    static int recordSizeInBytes(int numFiles);
+};
+
+#endif // SAVEJOURNAL_H
@@ -33,6 +33,7 @@
 
 SetSaveFormatDialog::SetSaveFormatDialog(SaveFormat initSaveFormat,
                                          bool initSaveTtlOut, bool initSaveDcAmps, int initNewSaveFilePeriodMinutes,
+                                         bool initSaveJournal, int initCheckpointPeriodSeconds, bool initSaveChecksums,
                                          QWidget *parent) :
     QDialog(parent)
 { 
@@ -41,14 +42,17 @@ SetSaveFormatDialog::SetSaveFormatDialog(SaveFormat initSaveFormat,
     saveFormatIntanButton = new QRadioButton(tr("Traditional Intan File Format"));
     saveFormatNeuroScopeButton = new QRadioButton(tr("\"One File Per Signal Type\" Format"));
     saveFormatOpenEphysButton = new QRadioButton(tr("\"One File Per Channel\" Format"));
+    saveFormatSpikeSnippetsButton = new QRadioButton(tr("Spike Events Only"));
 
     buttonGroup = new QButtonGroup();
     buttonGroup->addButton(saveFormatIntanButton);
     buttonGroup->addButton(saveFormatNeuroScopeButton);
     buttonGroup->addButton(saveFormatOpenEphysButton);
+    buttonGroup->addButton(saveFormatSpikeSnippetsButton);
     buttonGroup->setId(saveFormatIntanButton, (int) SaveFormatIntan);
     buttonGroup->setId(saveFormatNeuroScopeButton, (int) SaveFormatFilePerSignalType);
     buttonGroup->setId(saveFormatOpenEphysButton, (int) SaveFormatFilePerChannel);
+    buttonGroup->setId(saveFormatSpikeSnippetsButton, (int) SaveFormatSpikeSnippets);
 
     switch (initSaveFormat) {
     case SaveFormatIntan:
@@ -60,6 +64,9 @@ SetSaveFormatDialog::SetSaveFormatDialog(SaveFormat initSaveFormat,
     case SaveFormatFilePerChannel:
         saveFormatOpenEphysButton->setChecked(true);
         break;
+    case SaveFormatSpikeSnippets:
+        saveFormatSpikeSnippetsButton->setChecked(true);
+        break;
     }
 
     recordTimeSpinBox = new QSpinBox();
@@ -72,6 +79,19 @@ SetSaveFormatDialog::SetSaveFormatDialog(SaveFormat initSaveFormat,
     saveDcAmpsCheckBox = new QCheckBox(tr("Save DC Amplifier Waveforms"));
     saveDcAmpsCheckBox->setChecked(initSaveDcAmps);
 
+    saveJournalCheckBox = new QCheckBox(tr("Write Crash Recovery Journal"));
+    saveJournalCheckBox->setChecked(initSaveJournal);
+
+    checkpointPeriodSpinBox = new QSpinBox();
+    checkpointPeriodSpinBox->setRange(1, 600);
+    checkpointPeriodSpinBox->setValue(initCheckpointPeriodSeconds);
+    checkpointPeriodSpinBox->setEnabled(initSaveJournal);
+
+    connect(saveJournalCheckBox, SIGNAL(toggled(bool)), checkpointPeriodSpinBox, SLOT(setEnabled(bool)));
+
+    saveChecksumsCheckBox = new QCheckBox(tr("Save CRC32C Checksums of Data Files"));
+    saveChecksumsCheckBox->setChecked(initSaveChecksums);
+
     buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
 
     connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
@@ -107,6 +127,14 @@ SetSaveFormatDialog::SetSaveFormatDialog(SaveFormat initSaveFormat,
                                    "records of sampling rate, amplifier bandwidth, channel names, etc."));
     label3->setWordWrap(true);
 
+    QLabel *labelSpikes = new QLabel(tr("This option creates a subdirectory and saves no continuous waveforms.  "
+                                        "Spikes detected on enabled amplifier channels are saved in a *.spikes "
+                                        "file, with their timestamps, peak values, and (optionally) waveform "
+                                        "snippets, and an info.rhs file contains records of sampling rate, "
+                                        "amplifier bandwidth, channel names, etc.  Detection thresholds and "
+                                        "snippet lengths are set in the Spike Detection dialog."));
+    labelSpikes->setWordWrap(true);
+
     QVBoxLayout *boxLayout1 = new QVBoxLayout;
     boxLayout1->addWidget(saveFormatIntanButton);
     boxLayout1->addWidget(label1);
@@ -121,12 +149,37 @@ SetSaveFormatDialog::SetSaveFormatDialog(SaveFormat initSaveFormat,
     boxLayout3->addWidget(saveFormatOpenEphysButton);
     boxLayout3->addWidget(label3);
 
+    QVBoxLayout *boxLayoutSpikes = new QVBoxLayout;
+    boxLayoutSpikes->addWidget(saveFormatSpikeSnippetsButton);
+    boxLayoutSpikes->addWidget(labelSpikes);
+
     QGroupBox *mainGroupBox1 = new QGroupBox();
     mainGroupBox1->setLayout(boxLayout1);
     QGroupBox *mainGroupBox2 = new QGroupBox();
     mainGroupBox2->setLayout(boxLayout2);
     QGroupBox *mainGroupBox3 = new QGroupBox();
     mainGroupBox3->setLayout(boxLayout3);
+    QGroupBox *mainGroupBoxSpikes = new QGroupBox();
+    mainGroupBoxSpikes->setLayout(boxLayoutSpikes);
+
+    QHBoxLayout *checkpointLayout = new QHBoxLayout;
+    checkpointLayout->addWidget(saveJournalCheckBox);
+    checkpointLayout->addWidget(new QLabel(tr("with checkpoint every")));
+    checkpointLayout->addWidget(checkpointPeriodSpinBox);
+    checkpointLayout->addWidget(new QLabel(tr("seconds")));
+    checkpointLayout->addStretch(1);
+
+    QLabel *labelJournal = new QLabel(tr("The recovery journal is a small *.journal file saved with the data "
+                                         "files.  At each checkpoint, all data is flushed to disk and the amount "
+                                         "of valid data is recorded.  If the computer or this program stops "
+                                         "unexpectedly, at most one checkpoint period of data is lost, and the "
+                                         "rhsrecover tool can trim the damaged files to the last checkpoint."));
+    labelJournal->setWordWrap(true);
+
+    QLabel *labelChecksums = new QLabel(tr("Checksums are saved in a *.crc32c file with the data files, and "
+                                           "may be checked with the rhsverify tool to detect data corrupted "
+                                           "during storage or copying."));
+    labelChecksums->setWordWrap(true);
 
     QLabel *label4 = new QLabel(tr("To minimize the disk space required for data files, remember to "
                                    "disable all unused channels, including auxiliary input and supply "
@@ -145,8 +198,13 @@ SetSaveFormatDialog::SetSaveFormatDialog(SaveFormat initSaveFormat,
     mainLayout->addWidget(mainGroupBox1);
     mainLayout->addWidget(mainGroupBox2);
     mainLayout->addWidget(mainGroupBox3);
+    mainLayout->addWidget(mainGroupBoxSpikes);
     mainLayout->addWidget(saveDcAmpsCheckBox);
     mainLayout->addWidget(saveTtlOutCheckBox);
+    mainLayout->addLayout(checkpointLayout);
+    mainLayout->addWidget(labelJournal);
+    mainLayout->addWidget(saveChecksumsCheckBox);
+    mainLayout->addWidget(labelChecksums);
     mainLayout->addWidget(label4);
     mainLayout->addWidget(label5);
     mainLayout->addWidget(buttonBox);
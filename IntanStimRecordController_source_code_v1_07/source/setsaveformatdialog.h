@@ -38,11 +38,15 @@ class SetSaveFormatDialog : public QDialog
 public:
     explicit SetSaveFormatDialog(SaveFormat initSaveFormat,
                                  bool initSaveTtlOut, bool initSaveDcAmps, int initNewSaveFilePeriodMinutes,
+                                 bool initSaveJournal, int initCheckpointPeriodSeconds, bool initSaveChecksums,
                                  QWidget *parent);
 
     QSpinBox *recordTimeSpinBox;
     QCheckBox *saveTtlOutCheckBox;
     QCheckBox *saveDcAmpsCheckBox;
+    QCheckBox *saveJournalCheckBox;
+    QSpinBox *checkpointPeriodSpinBox;
+    QCheckBox *saveChecksumsCheckBox;
     QDialogButtonBox *buttonBox;
     QButtonGroup *buttonGroup;
 
@@ -59,6 +63,7 @@ private:
     QRadioButton *saveFormatIntanButton;
     QRadioButton *saveFormatNeuroScopeButton;
     QRadioButton *saveFormatOpenEphysButton;
+    QRadioButton *saveFormatSpikeSnippetsButton;
 
 };
 
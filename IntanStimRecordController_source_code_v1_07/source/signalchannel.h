@@ -23,6 +23,7 @@
 #define SIGNALCHANNEL_H
 
 #include <QString>
+#include <QVector>
 
 class SignalGroup;
 class QDataStream;
@@ -30,6 +31,7 @@ class QFile;
 //class QString;
 class QXmlStreamWriter;
 class StimParameters;
+class ChecksummedFile;
 
 using namespace std;
 
@@ -80,16 +82,21 @@ public:
     double electrodeImpedanceMagnitude;
     double electrodeImpedancePhase;
 
+    // Impedance spectrum from the last multi-tone impedance measurement (not saved
+    // with settings); frequencies are held by MainWindow.
+    QVector<double> electrodeImpedanceSpectrumMagnitude;
+    QVector<double> electrodeImpedanceSpectrumPhase;
+
     QString saveFileName;
-    QFile *saveFile;
+    ChecksummedFile *saveFile;
     QDataStream *saveStream;
 
     QString dcSaveFileName;
-    QFile *dcSaveFile;
+    ChecksummedFile *dcSaveFile;
     QDataStream *dcSaveStream;
 
     QString stimSaveFileName;
-    QFile *stimSaveFile;
+    ChecksummedFile *stimSaveFile;
     QDataStream *stimSaveStream;
 
     StimParameters* stimParameters;
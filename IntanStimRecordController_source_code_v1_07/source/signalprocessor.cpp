@@ -26,19 +26,48 @@
 #include <qmath.h>
 #include <iostream>
 #include <QElapsedTimer>
+#include <QThread>
+#include <QRunnable>
 
 #include "mainwindow.h"
 #include "signalprocessor.h"
 #include "globalconstants.h"
-#include "randomnumber.h"
+#include "syntheticdatagenerator.h"
 #include "signalsources.h"
 #include "signalgroup.h"
 #include "signalchannel.h"
 #include "rhs2000datablock.h"
 #include "stimparameters.h"
+#include "checksummedfile.h"
+#include "multichannelbiquad.h"
+#include "multichannelnotch.h"
+#include "multichannelfixedbiquad.h"
+#include "multichannelfixednotch.h"
 
 using namespace std;
 
+// Number of amplifier lanes (see MultiChannelBiquad) filtered as one unit of
+// work by filterData().  A chunk spans two full cache lines of samples and at
+// least one of fixed-point filter data, so worker threads never write to the
+// same cache line.
+#define FILTER_LANES_PER_CHUNK ((int) (128 / sizeof(Sample)))
+
+// Worker thread task for SignalProcessor::filterData().
+class FilterTask : public QRunnable
+{
+public:
+    FilterTask(SignalProcessor *signalProcessor_) : signalProcessor(signalProcessor_) { setAutoDelete(true); }
+
+    void run() override
+    {
+        signalProcessor->filterLaneChunks();
+        signalProcessor->filterTasksDone.release();
+    }
+
+private:
+    SignalProcessor *signalProcessor;
+};
+
 // This class stores and processes short segments of waveform data
 // acquired from the USB interface board.  The primary purpose of the
 // class is to read from a queue of Rhs2000DataBlock objects and scale
@@ -55,31 +84,72 @@ SignalProcessor::SignalProcessor()
 {
     // Notch filter initial parameters.
     notchFilterEnabled = false;
-    a1 = 0.0;
-    a2 = 0.0;
-    b0 = 0.0;
-    b1 = 0.0;
-    b2 = 0.0;
 
     // Highpass filter initial parameters.
     highpassFilterEnabled = false;
-    aHpf = 0.0;
-    bHpf = 0.0;
-
-    // Set up random number generator in case we are asked to generate synthetic data.
-    random = new RandomNumber();
-    random->setGaussianAccuracy(6);
 
-    // Other synthetic waveform variables.
-    tPulse = 0.0;
+    // Set up synthetic data generator in case we are asked to generate synthetic data.
+    syntheticDataGenerator = new SyntheticDataGenerator();
     synthTimeStamp = 0;
+    lastSavedTimestamp = 0;
+    saveChecksumsEnabled = false;
 
     amplifierPreFilterFast = nullptr;
+    amplifierPostFilterFast = nullptr;
+    softwareReferenceLane = -1;
+    preFilterInMicrovolts = false;
+
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+    amplifierFixedPointFast = nullptr;
+    notchFilter = new MultiChannelFixedNotch();
+    highpassFilter = new MultiChannelFixedBiquad();
+#else
+    notchFilter = new MultiChannelNotch();
+    highpassFilter = new MultiChannelBiquad();
+#endif
+    filterBank = new FilterBank();
+    filterBankDisplayBand = -1;
+    spatialReference = new SpatialReference();
+    artifactSuppressor = new ArtifactSuppressor();
+    lineNoiseCanceller = new LineNoiseCanceller();
+    spikeDetector = new SpikeDetector();
+    spikeSorter = new SpikeSorter();
+    bandPowerDetector = new BandPowerDetector();
+    phaseTracker = new PhaseTracker();
+    signalQualityMonitor = new SignalQualityMonitor();
+    dacThresholdTracker = new DacThresholdTracker();
+
+    // Filter worker threads.  The thread calling filterData() also does its share
+    // of the work, and one core is left free for the GUI and USB threads.
+    filterThreadPool = new QThreadPool();
+    filterThreadPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 2));
+    filterThreadPool->setExpiryTimeout(-1);
+    numFilterChunks = 0;
+    filterLength = 0;
+    lastFilterTimeNsec = 0;
 }
 
 SignalProcessor::~SignalProcessor()
 {
+    delete filterThreadPool;
     delete [] amplifierPreFilterFast;
+    qFreeAligned(amplifierPostFilterFast);
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+    qFreeAligned(amplifierFixedPointFast);
+#endif
+    delete notchFilter;
+    delete highpassFilter;
+    delete filterBank;
+    delete spatialReference;
+    delete artifactSuppressor;
+    delete lineNoiseCanceller;
+    delete spikeDetector;
+    delete spikeSorter;
+    delete bandPowerDetector;
+    delete phaseTracker;
+    delete signalQualityMonitor;
+    delete dacThresholdTracker;
+    delete syntheticDataGenerator;
 }
 
 inline int SignalProcessor::fastIndex(int stream, int channel, int t) const
@@ -91,59 +161,63 @@ inline int SignalProcessor::fastIndex(int stream, int channel, int t) const
 void SignalProcessor::allocateMemory(int numStreams)
 {
     delete [] amplifierPreFilterFast;
+    qFreeAligned(amplifierPostFilterFast);
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+    qFreeAligned(amplifierFixedPointFast);
+#endif
 
     numDataStreams = numStreams;
+    softwareReferenceLane = -1;
 
     // Allocate vector memory for waveforms from USB interface board and notch filter.
-    // allocateDoubleArray3D(amplifierPreFilter, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * maxNumBlocks);
-    amplifierPreFilterFast = new double [numStreams * CHANNELS_PER_STREAM * SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS];
-    allocateDoubleArray3D(amplifierPostFilter, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
-    allocateDoubleArray2D(highpassFilterState, numStreams, CHANNELS_PER_STREAM);
-    allocateDoubleArray3D(prevAmplifierPreFilter, numStreams, CHANNELS_PER_STREAM, 2);
-    allocateDoubleArray3D(prevAmplifierPostFilter, numStreams, CHANNELS_PER_STREAM, 2);
-    allocateDoubleArray3D(dcAmplifier, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    amplifierPreFilterFast = new qint16 [numStreams * CHANNELS_PER_STREAM * SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS];
+    amplifierPostFilterFast = (Sample*) qMallocAligned(numStreams * CHANNELS_PER_STREAM * SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS * sizeof(Sample), 64);
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+    amplifierFixedPointFast = (qint32*) qMallocAligned(numStreams * CHANNELS_PER_STREAM * SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS * sizeof(qint32), 64);
+#endif
+    allocateSampleArray3D(amplifierPostFilter, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    notchFilter->setNumLanes(numStreams * CHANNELS_PER_STREAM);
+    highpassFilter->setNumLanes(numStreams * CHANNELS_PER_STREAM);
+    filterBank->setNumLanes(numStreams * CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    spatialReference->setNumLanes(numStreams * CHANNELS_PER_STREAM);
+    artifactSuppressor->setNumStreams(numStreams, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    lineNoiseCanceller->setNumLanes(numStreams * CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    spikeDetector->setNumLanes(numStreams * CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    spikeSorter->setNumLanes(numStreams * CHANNELS_PER_STREAM);
+    bandPowerDetector->setNumLanes(numStreams * CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    phaseTracker->setNumLanes(numStreams * CHANNELS_PER_STREAM);
+    signalQualityMonitor->setNumLanes(numStreams * CHANNELS_PER_STREAM);
+    dacThresholdTracker->setNumLanes(numStreams * CHANNELS_PER_STREAM);
+    allocateInt16Array3D(dcAmplifier, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
     allocateIntArray3D(complianceLimit, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
     allocateIntArray3D(stimOn, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
     allocateIntArray3D(stimPol, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
     allocateIntArray3D(ampSettle, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
     allocateIntArray3D(chargeRecov, numStreams, CHANNELS_PER_STREAM, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
-    allocateDoubleArray2D(boardDac, 8, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
-    allocateDoubleArray2D(boardAdc, 8, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    allocateSampleArray2D(boardDac, 8, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    allocateSampleArray2D(boardAdc, 8, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
     allocateIntArray2D(boardDigIn, 16, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
     allocateIntArray2D(boardDigOut, 16, SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
+    timeStamp.resize(SAMPLES_PER_DATA_BLOCK * MAX_NUM_BLOCKS);
 
     // Initialize vector memory used in notch filter state.
-    fillZerosDoubleArray3D(amplifierPostFilter);
-    fillZerosDoubleArray3D(prevAmplifierPreFilter);
-    fillZerosDoubleArray3D(prevAmplifierPostFilter);
-    fillZerosDoubleArray2D(highpassFilterState);
-
-    // Allocate vector memory for generating synthetic neural and ECG waveforms.
-    allocateDoubleArray3D(synthSpikeAmplitude, numStreams, CHANNELS_PER_STREAM, 2);
-    allocateDoubleArray3D(synthSpikeDuration, numStreams, CHANNELS_PER_STREAM, 2);
-    allocateDoubleArray2D(synthRelativeSpikeRate, numStreams, CHANNELS_PER_STREAM);
-    allocateDoubleArray2D(synthEcgAmplitude, numStreams, CHANNELS_PER_STREAM);
+    fillZerosSampleArray3D(amplifierPostFilter);
 
-    // Assign random parameters for synthetic waveforms.
+    // Row pointers into amplifierPostFilter, indexed by lane, for filterData().
+    amplifierPostFilterRows.resize(numStreams * CHANNELS_PER_STREAM);
     for (int stream = 0; stream < numStreams; ++stream) {
         for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-            synthEcgAmplitude[stream][channel] =
-                    random->randomUniform(0.5, 3.0);
-            for (int spikeNum = 0; spikeNum < 2; ++spikeNum) {
-                synthSpikeAmplitude[stream][channel][spikeNum] =
-                        random->randomUniform(-400.0, 100.0);
-                synthSpikeDuration[stream][channel][spikeNum] =
-                        random->randomUniform(0.3, 1.7);
-                synthRelativeSpikeRate[stream][channel] =
-                        random->randomUniform(0.1, 5.0);
-            }
+            amplifierPostFilterRows[channel * numStreams + stream] = amplifierPostFilter[stream][channel].data();
         }
     }
+
+    // Assign random parameters for synthetic waveforms.
+    syntheticDataGenerator->setNumStreams(numStreams);
 }
 
-// Allocates memory for a 3-D array of doubles.
-void SignalProcessor::allocateDoubleArray3D(QVector<QVector<QVector<double> > > &array3D,
-                                            int xSize, int ySize, int zSize)
+// Allocates memory for a 3-D array of ints.
+void SignalProcessor::allocateIntArray3D(QVector<QVector<QVector<int> > > &array3D,
+                                         int xSize, int ySize, int zSize)
 {
     int i, j;
 
@@ -157,9 +231,9 @@ void SignalProcessor::allocateDoubleArray3D(QVector<QVector<QVector<double> > >
     }
 }
 
-// Allocates memory for a 3-D array of ints.
-void SignalProcessor::allocateIntArray3D(QVector<QVector<QVector<int> > > &array3D,
-                                         int xSize, int ySize, int zSize)
+// Allocates memory for a 3-D array of 16-bit integers.
+void SignalProcessor::allocateInt16Array3D(QVector<QVector<QVector<qint16> > > &array3D,
+                                           int xSize, int ySize, int zSize)
 {
     int i, j;
 
@@ -237,6 +311,53 @@ void SignalProcessor::fillZerosDoubleArray2D(
     }
 }
 
+// Allocates memory for a 3-D array of waveform samples.
+void SignalProcessor::allocateSampleArray3D(QVector<QVector<QVector<Sample> > > &array3D,
+                                            int xSize, int ySize, int zSize)
+{
+    int i, j;
+
+    if (xSize == 0) return;
+    array3D.resize(xSize);
+    for (i = 0; i < xSize; ++i) {
+        array3D[i].resize(ySize);
+        for (j = 0; j < ySize; ++j) {
+            array3D[i][j].resize(zSize);
+        }
+    }
+}
+
+// Allocates memory for a 2-D array of waveform samples.
+void SignalProcessor::allocateSampleArray2D(QVector<QVector<Sample> > &array2D,
+                                            int xSize, int ySize)
+{
+    int i;
+
+    if (xSize == 0) return;
+    array2D.resize(xSize);
+    for (i = 0; i < xSize; ++i) {
+        array2D[i].resize(ySize);
+    }
+}
+
+// Fill a 3-D array of waveform samples with zero.
+void SignalProcessor::fillZerosSampleArray3D(
+        QVector<QVector<QVector<Sample> > > &array3D)
+{
+    int x, y;
+    int xSize = array3D.size();
+
+    if (xSize == 0) return;
+
+    int ySize = array3D[0].size();
+
+    for (x = 0; x < xSize; ++x) {
+        for (y = 0; y < ySize; ++y) {
+            array3D[x][y].fill(0.0);
+        }
+    }
+}
+
 // Creates lists (vectors, actually) of all enabled waveforms to expedite
 // save-to-disk operations.
 void SignalProcessor::createSaveList(SignalSources *signalSources, bool addTriggerChannel, int triggerChannel, double stimStepSize)
@@ -332,7 +453,7 @@ void SignalProcessor::createSignalTypeFilenames(QString path)
 // Open timestamp save file.
 void SignalProcessor::openTimestampFile()
 {
-    timestampFile = new QFile(timestampFileName);
+    timestampFile = new ChecksummedFile(timestampFileName, saveChecksumsEnabled);
 
     if (!timestampFile->open(QIODevice::WriteOnly)) {
         cerr << "Cannot open file for writing: " <<
@@ -358,6 +479,7 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
     dcAmplifierFile = nullptr;
     stimFile = nullptr;
     adcInputFile = nullptr;
+    dacOutputFile = nullptr;
     digitalInputFile = nullptr;
     digitalOutputFile = nullptr;
 
@@ -365,11 +487,12 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
     dcAmplifierStream = nullptr;
     stimStream = nullptr;
     adcInputStream = nullptr;
+    dacOutputStream = nullptr;
     digitalInputStream = nullptr;
     digitalOutputStream = nullptr;
 
     if (saveListAmplifier.size() > 0) {
-        amplifierFile = new QFile(amplifierFileName);
+        amplifierFile = new ChecksummedFile(amplifierFileName, saveChecksumsEnabled);
         if (!amplifierFile->open(QIODevice::WriteOnly))
             cerr << "Cannot open file for writing: " <<
                     qPrintable(amplifierFile->errorString()) << endl;
@@ -379,7 +502,7 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
         amplifierStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
     }
     if (saveListAmplifier.size() > 0 && saveDcAmps) {
-        dcAmplifierFile = new QFile(dcAmplifierFileName);
+        dcAmplifierFile = new ChecksummedFile(dcAmplifierFileName, saveChecksumsEnabled);
         if (!dcAmplifierFile->open(QIODevice::WriteOnly))
             cerr << "Cannot open file for writing: " <<
                     qPrintable(dcAmplifierFile->errorString()) << endl;
@@ -389,7 +512,7 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
         dcAmplifierStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
     }
     if (saveListAmplifier.size() > 0) {
-        stimFile = new QFile(stimFileName);
+        stimFile = new ChecksummedFile(stimFileName, saveChecksumsEnabled);
         if (!stimFile->open(QIODevice::WriteOnly))
             cerr << "Cannot open file for writing: " <<
                     qPrintable(stimFile->errorString()) << endl;
@@ -399,7 +522,7 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
         stimStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
     }
     if (saveListBoardAdc.size() > 0) {
-        adcInputFile = new QFile(adcInputFileName);
+        adcInputFile = new ChecksummedFile(adcInputFileName, saveChecksumsEnabled);
         if (!adcInputFile->open(QIODevice::WriteOnly))
             cerr << "Cannot open file for writing: " <<
                     qPrintable(adcInputFile->errorString()) << endl;
@@ -409,7 +532,7 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
         adcInputStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
     }
     if (saveListBoardDac.size() > 0) {
-        dacOutputFile = new QFile(dacOutputFileName);
+        dacOutputFile = new ChecksummedFile(dacOutputFileName, saveChecksumsEnabled);
         if (!dacOutputFile->open(QIODevice::WriteOnly))
             cerr << "Cannot open file for writing: " <<
                     qPrintable(dacOutputFile->errorString()) << endl;
@@ -419,7 +542,7 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
         dacOutputStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
     }
     if (saveListBoardDigitalIn.size() > 0) {
-        digitalInputFile = new QFile(digitalInputFileName);
+        digitalInputFile = new ChecksummedFile(digitalInputFileName, saveChecksumsEnabled);
         if (!digitalInputFile->open(QIODevice::WriteOnly))
             cerr << "Cannot open file for writing: " <<
                     qPrintable(digitalInputFile->errorString()) << endl;
@@ -429,7 +552,7 @@ void SignalProcessor::openSignalTypeFiles(bool saveTtlOut, bool saveDcAmps)
         digitalInputStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
     }
     if (saveTtlOut) {
-        digitalOutputFile = new QFile(digitalOutputFileName);
+        digitalOutputFile = new ChecksummedFile(digitalOutputFileName, saveChecksumsEnabled);
         if (!digitalOutputFile->open(QIODevice::WriteOnly))
             cerr << "Cannot open file for writing: " <<
                     qPrintable(digitalOutputFile->errorString()) << endl;
@@ -471,6 +594,11 @@ void SignalProcessor::closeSignalTypeFiles()
         delete adcInputStream;
         delete adcInputFile;
     }
+    if (dacOutputFile) {
+        dacOutputFile->close();
+        delete dacOutputStream;
+        delete dacOutputFile;
+    }
     if (digitalInputFile) {
         digitalInputFile->close();
         delete digitalInputStream;
@@ -543,7 +671,7 @@ void SignalProcessor::openSaveFiles(SignalSources *signalSources, bool saveDcAmp
             currentChannel = signalSources->signalPort[port].channelByNativeOrder(index);
             // Only open files for enabled channels.
             if (currentChannel->enabled) {
-                currentChannel->saveFile = new QFile(currentChannel->saveFileName);
+                currentChannel->saveFile = new ChecksummedFile(currentChannel->saveFileName, saveChecksumsEnabled);
 
                 if (!currentChannel->saveFile->open(QIODevice::WriteOnly)) {
                     cerr << "Cannot open file for writing: " <<
@@ -562,7 +690,7 @@ void SignalProcessor::openSaveFiles(SignalSources *signalSources, bool saveDcAmp
                 currentChannel->saveStream->setFloatingPointPrecision(QDataStream::SinglePrecision);
 
                 if (saveDcAmps && currentChannel->signalType == AmplifierSignal) {
-                    currentChannel->dcSaveFile = new QFile(currentChannel->dcSaveFileName);
+                    currentChannel->dcSaveFile = new ChecksummedFile(currentChannel->dcSaveFileName, saveChecksumsEnabled);
                     if (!currentChannel->dcSaveFile->open(QIODevice::WriteOnly)) {
                         cerr << "Cannot open file for writing: " <<
                                 qPrintable(currentChannel->dcSaveFile->errorString()) << endl;
@@ -574,7 +702,7 @@ void SignalProcessor::openSaveFiles(SignalSources *signalSources, bool saveDcAmp
                 }
 
                 if (currentChannel->signalType == AmplifierSignal && currentChannel->stimParameters->enabled == true) {
-                    currentChannel->stimSaveFile = new QFile(currentChannel->stimSaveFileName);
+                    currentChannel->stimSaveFile = new ChecksummedFile(currentChannel->stimSaveFileName, saveChecksumsEnabled);
                     if (!currentChannel->stimSaveFile->open(QIODevice::WriteOnly)) {
                         cerr << "Cannot open file for writing: " <<
                                 qPrintable(currentChannel->stimSaveFile->errorString()) << endl;
@@ -618,6 +746,67 @@ void SignalProcessor::closeSaveFiles(SignalSources *signalSources, bool saveDcAm
     }
 }
 
+// Return a list of all open data files for the "One File Per Signal Type" or
+// "One File Per Channel" formats, including the timestamp file.  (In the Intan
+// format, the single save file is owned by MainWindow.)
+QVector<ChecksummedFile*> SignalProcessor::openSaveFileList(SignalSources *signalSources, SaveFormat format, bool saveDcAmps) const
+{
+    QVector<ChecksummedFile*> fileList;
+    int port, index;
+    SignalChannel *currentChannel;
+
+    switch (format) {
+    case SaveFormatIntan:
+        break;
+
+    case SaveFormatFilePerSignalType:
+        fileList.append(timestampFile);
+        if (amplifierFile) fileList.append(amplifierFile);
+        if (dcAmplifierFile) fileList.append(dcAmplifierFile);
+        if (stimFile) fileList.append(stimFile);
+        if (adcInputFile) fileList.append(adcInputFile);
+        if (dacOutputFile) fileList.append(dacOutputFile);
+        if (digitalInputFile) fileList.append(digitalInputFile);
+        if (digitalOutputFile) fileList.append(digitalOutputFile);
+        break;
+
+    case SaveFormatFilePerChannel:
+        fileList.append(timestampFile);
+        for (port = 0; port < signalSources->signalPort.size(); ++port) {
+            for (index = 0; index < signalSources->signalPort[port].numChannels(); ++index) {
+                currentChannel = signalSources->signalPort[port].channelByNativeOrder(index);
+                if (currentChannel->enabled) {
+                    fileList.append(currentChannel->saveFile);
+                    if (saveDcAmps && currentChannel->signalType == AmplifierSignal) {
+                        fileList.append(currentChannel->dcSaveFile);
+                    }
+                    if (currentChannel->signalType == AmplifierSignal && currentChannel->stimParameters->enabled == true) {
+                        fileList.append(currentChannel->stimSaveFile);
+                    }
+                }
+            }
+        }
+        break;
+
+    case SaveFormatSpikeSnippets:
+        break;
+    }
+
+    return fileList;
+}
+
+// Enable or disable CRC-32C checksums for data files opened from now on.
+void SignalProcessor::setSaveChecksumsEnabled(bool enable)
+{
+    saveChecksumsEnabled = enable;
+}
+
+// Return the (offset-corrected) timestamp of the last sample written to disk.
+qint32 SignalProcessor::getLastSavedTimestamp() const
+{
+    return lastSavedTimestamp;
+}
+
 // Reads numBlocks blocks of raw USB data stored in a queue of Rhs2000DataBlock
 // objects, loads this data into this SignalProcessor object, scaling the raw
 // data to generate waveforms with units of volts or microvolts.
@@ -666,64 +855,46 @@ int SignalProcessor::loadAmplifierData(queue<Rhs2000DataBlock> &dataQueue,
         triggerTimeIndex = -1;
     }
 
-    double* pIndex = amplifierPreFilterFast;
+    // Optional software re-referencing: the user-selected reference channel is
+    // subtracted from the others as the data enter the filters (see filterData()).
+    softwareReferenceLane = referenceSource.softwareMode ?
+                amplifierLane(referenceSource.stream, referenceSource.channel) : -1;
+
+    qint16* pIndex = amplifierPreFilterFast;
     for (block = 0; block < numBlocks; ++block) {
 
+        // Save board timestamps, which are used to time spike events
+        for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
+            timeStamp[SAMPLES_PER_DATA_BLOCK * block + t] = (qint32) dataQueue.front().timeStamp[t];
+        }
+
         // Load and scale RHS2000 amplifier waveforms
         // (sampled at amplifier sampling rate)
-
-        // Old, slow method:
-//        for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
-//            for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-//                for (stream = 0; stream < numDataStreams; ++stream) {
-//                    // Amplifier waveform units = microvolts
-//                    amplifierPreFilter[stream][channel][indexAmp] = 0.195 *
-//                           (dataQueue.front().amplifierData[stream][channel][t] - 32768);
-//                }
-//            }
-//            ++indexAmp;
-//        }
-
-        // New, faster method:
+        // The data are kept as signed ADC codes, and converted to microvolts
+        // (AMPLIFIER_MICROVOLTS_PER_BIT) as they are filtered (see filterData()).
         int* pIndex2 = dataQueue.front().amplifierDataFast;
         for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
             for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
                 for (stream = 0; stream < numDataStreams; ++stream) {
-                    // Amplifier waveform units = microvolts
-                    (*pIndex++) =  0.195 * ((*pIndex2++) - 32768); // units = uV
-                }
-            }
-        }
-
-        // Optional software re-referencing
-        if (referenceSource.softwareMode) {
-            pIndex -= SAMPLES_PER_DATA_BLOCK * CHANNELS_PER_STREAM * numDataStreams;  // jump back to beginning of data block
-            // Point to user-selected software reference channel
-            double* refIndex = pIndex + referenceSource.channel * numDataStreams + referenceSource.stream;
-            for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
-                for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                    for (stream = 0; stream < numDataStreams; ++stream) {
-                        if (pIndex != refIndex) {
-                            *pIndex -=  *refIndex;  // subtract reference channel
-                        }
-                        pIndex++;
-                    }
+                    (*pIndex++) = (qint16) ((*pIndex2++) - 32768);
                 }
-                refIndex += (CHANNELS_PER_STREAM * numDataStreams);
             }
         }
 
         // Load DC amplifier waveforms
         // (sampled at amplifier sampling rate)
-        for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
+        // These are only displayed, so they are kept as signed ADC codes and
+        // converted to volts by the display.
+        for (stream = 0; stream < numDataStreams; ++stream) {
             for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                for (stream = 0; stream < numDataStreams; ++stream) {
-                    dcAmplifier[stream][channel][indexDcAmp] = -0.01923 *
-                           (dataQueue.front().dcAmplifierData[stream][channel][t] - 512); // units = V
+                const vector<int> &dcRaw = dataQueue.front().dcAmplifierData[stream][channel];
+                qint16 *dcCode = dcAmplifier[stream][channel].data() + indexDcAmp;
+                for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
+                    dcCode[t] = (qint16) (dcRaw[t] - 512);
                 }
             }
-            ++indexDcAmp;
         }
+        indexDcAmp += SAMPLES_PER_DATA_BLOCK;
 
         // Load compliance limit markers
         for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
@@ -776,10 +947,10 @@ int SignalProcessor::loadAmplifierData(queue<Rhs2000DataBlock> &dataQueue,
             for (channel = 0; channel < 8; ++channel) {
                 // DAC waveform units = volts
                 boardDac[channel][indexAdc] =
-                        0.0003125 * (dataQueue.front().boardDacData[channel][t] - 32768);
+                        BOARD_ADC_VOLTS_PER_BIT * (dataQueue.front().boardDacData[channel][t] - 32768);
                 // ADC waveform units = volts
                 boardAdc[channel][indexAdc] =
-                        0.0003125 * (dataQueue.front().boardAdcData[channel][t] - 32768);
+                        BOARD_ADC_VOLTS_PER_BIT * (dataQueue.front().boardAdcData[channel][t] - 32768);
             }
             if (lookForTrigger && !triggerFound && triggerChannel >= 16) {
                 if (triggerPolarity) {
@@ -1178,8 +1349,15 @@ int SignalProcessor::loadAmplifierData(queue<Rhs2000DataBlock> &dataQueue,
                 }
 
                 break;
+
+            case SaveFormatSpikeSnippets:
+                // No continuous data is saved; MainWindow saves detected spikes.
+                break;
             }
         }
+        if (saveToDisk) {
+            lastSavedTimestamp = ((qint32) dataQueue.front().timeStamp[SAMPLES_PER_DATA_BLOCK - 1]) - ((qint32) timestampOffset);
+        }
         if (addToBuffer) {
             bufferQueue.push(dataQueue.front());
         }
@@ -1218,6 +1396,10 @@ int SignalProcessor::saveBufferedData(queue<Rhs2000DataBlock> &bufferQueue, QDat
     quint16 tempQuint16;
     qint32 tempQint32;
 
+    if (bufferQueue.empty() == false) {
+        lastSavedTimestamp = ((qint32) bufferQueue.back().timeStamp[SAMPLES_PER_DATA_BLOCK - 1]) - ((qint32) timestampOffset);
+    }
+
     switch (format) {
     case SaveFormatIntan:
         while (bufferQueue.empty() == false) {
@@ -1582,6 +1764,13 @@ int SignalProcessor::saveBufferedData(queue<Rhs2000DataBlock> &bufferQueue, QDat
             bufferQueue.pop();
         }
         break;
+
+    case SaveFormatSpikeSnippets:
+        // No continuous data is saved, and spikes are not detected in buffered data.
+        while (bufferQueue.empty() == false) {
+            bufferQueue.pop();
+        }
+        break;
     }
 
     // Return total number of bytes written to binary output stream
@@ -1603,92 +1792,12 @@ int SignalProcessor::loadSyntheticData(int numBlocks, double sampleRate,
     int indexDig = 0;
     int numWordsWritten = 0;
 
-    double tStepMsec = 1000.0 / sampleRate;
-    double spikeDelay, ecgValue;
-    bool spikePresent;
-    int spikeNum;
-
-    // If the sample rate is 5 kS/s or higher, generate synthetic neural data;
-    // otherwise, generate synthetic ECG data.
-    if (sampleRate > 4999.9) {
-        // Generate synthetic neural data.
-        for (block = 0; block < numBlocks; ++block) {
-            for (stream = 0; stream < numDataStreams; ++stream) {
-                for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                    spikePresent = false;
-                    spikeNum = 0;
-                    if (random->randomUniform() < synthRelativeSpikeRate.at(stream).at(channel) * tStepMsec) {
-                        spikePresent = true;
-                        spikeDelay = random->randomUniform(0.0, 0.3);  // add some random time jitter
-                        if (random->randomUniform() < 0.3) spikeNum = 1;  // choose between one of two spike types
-                    }
-                    for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
-                        // Create realistic background Gaussian noise of 2.4 uVrms (would be more in cortex)
-                        //amplifierPreFilter[stream][channel][SAMPLES_PER_DATA_BLOCK * block + t] =
-                        amplifierPreFilterFast[fastIndex(stream, channel, SAMPLES_PER_DATA_BLOCK * block + t)] =
-                                2.4 * random->randomGaussian();
-                        if (spikePresent) {
-                            // Create synthetic spike
-                            if (t * tStepMsec > spikeDelay &&
-                                t * tStepMsec < synthSpikeDuration[stream][channel][spikeNum] + spikeDelay) {
-                                //amplifierPreFilter[stream][channel][SAMPLES_PER_DATA_BLOCK * block + t] +=
-                                amplifierPreFilterFast[fastIndex(stream, channel, SAMPLES_PER_DATA_BLOCK * block + t)] +=
-                                        synthSpikeAmplitude.at(stream).at(channel).at(spikeNum) *
-                                        qExp(-2.0 * (t * tStepMsec - spikeDelay)) *
-                                        qSin(TWO_PI * (t * tStepMsec - spikeDelay) /
-                                             synthSpikeDuration.at(stream).at(channel).at(spikeNum));
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    } else {
-        // Generate synthetic ECG data.
-        for (t = 0; t < SAMPLES_PER_DATA_BLOCK * numBlocks; ++t) {
-            // Piece together half sine waves to model QRS complex, P wave, and T wave
-            if (tPulse < 80.0) {
-                ecgValue = 40.0 * qSin(TWO_PI * tPulse / 160.0); // P wave
-            } else if (tPulse > 100.0 && tPulse < 120.0) {
-                ecgValue = -250.0 * qSin(TWO_PI * (tPulse - 100.0) / 40.0); // Q
-            } else if (tPulse > 120.0 && tPulse < 180.0) {
-                ecgValue = 1000.0 * qSin(TWO_PI * (tPulse - 120.0) / 120.0); // R
-            } else if (tPulse > 180.0 && tPulse < 260.0) {
-                ecgValue = -120.0 * qSin(TWO_PI * (tPulse - 180.0) / 160.0); // S
-            } else if (tPulse > 340.0 && tPulse < 400.0) {
-                ecgValue = 60.0 * qSin(TWO_PI * (tPulse - 340.0) / 120.0); // T wave
-            } else {
-                ecgValue = 0.0;
-            }
-            for (stream = 0; stream < numDataStreams; ++stream) {
-                for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                    // Multiply basic ECG waveform by channel-specific amplitude, and
-                    // add 2.4 uVrms noise.
-                    // amplifierPreFilter[stream][channel][t] =
-                    amplifierPreFilterFast[fastIndex(stream, channel, t)] =
-                            synthEcgAmplitude[stream][channel] * ecgValue +
-                            2.4 * random->randomGaussian();
-                }
-            }
-            tPulse += tStepMsec;
-        }
-    }
-
-    if (referenceSource.softwareMode) {
-        for (stream = 0; stream < numDataStreams; ++stream) {
-            for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                if (!(stream == referenceSource.stream && channel == referenceSource.channel)) {
-                    for (t = 0; t < SAMPLES_PER_DATA_BLOCK * numBlocks; ++t) {
-                        amplifierPreFilterFast[fastIndex(stream, channel, t)] -=
-                                amplifierPreFilterFast[fastIndex(referenceSource.stream, referenceSource.channel, t)];
-                    }
-                }
-            }
-        }
-    }
+    // Generate synthetic neural or ECG data, using the filter worker threads.
+    syntheticDataGenerator->generate(amplifierPreFilterFast, numBlocks, sampleRate, filterThreadPool);
 
-    // Repeat ECG waveform with regular period.
-    if (tPulse > 840.0) tPulse = 0.0;
+    // Optional software re-referencing, as in loadAmplifierData().
+    softwareReferenceLane = referenceSource.softwareMode ?
+                amplifierLane(referenceSource.stream, referenceSource.channel) : -1;
 
     for (block = 0; block < numBlocks; ++block) {
         // Generate synthetic compliance limit data.
@@ -1720,6 +1829,11 @@ int SignalProcessor::loadSyntheticData(int numBlocks, double sampleRate,
         }
     }
 
+    // Synthetic timestamps count the samples saved to disk.
+    for (t = 0; t < SAMPLES_PER_DATA_BLOCK * numBlocks; ++t) {
+        timeStamp[t] = (qint32) synthTimeStamp + t;
+    }
+
     // Optionally send binary data to binary output stream
     if (saveToDisk) {
         switch (format) {
@@ -1733,9 +1847,7 @@ int SignalProcessor::loadSyntheticData(int numBlocks, double sampleRate,
                 // Save amplifier data
                 for (i = 0; i < saveListAmplifier.size(); ++i) {
                     for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
-                        out << (quint16)
-                               // ((amplifierPreFilter[saveListAmplifier.at(i)->boardStream][saveListAmplifier.at(i)->chipChannel][SAMPLES_PER_DATA_BLOCK * block + t] / 0.195) + 32768);
-                               ((amplifierPreFilterFast[fastIndex(saveListAmplifier.at(i)->boardStream, saveListAmplifier.at(i)->chipChannel, SAMPLES_PER_DATA_BLOCK * block + t)] / 0.195) + 32768);
+                        out << (quint16) (amplifierPreFilterFast[fastIndex(saveListAmplifier.at(i)->boardStream, saveListAmplifier.at(i)->chipChannel, SAMPLES_PER_DATA_BLOCK * block + t)] + 32768);
                         ++numWordsWritten;
                     }
                 }
@@ -1801,9 +1913,8 @@ int SignalProcessor::loadSyntheticData(int numBlocks, double sampleRate,
                 for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
                     // Save amplifier data
                     for (i = 0; i < saveListAmplifier.size(); ++i) {
-                        *(amplifierStream) << (qint16)
-                               // (amplifierPreFilter[saveListAmplifier.at(i)->boardStream][saveListAmplifier.at(i)->chipChannel][SAMPLES_PER_DATA_BLOCK * block + t] / 0.195);
-                               (amplifierPreFilterFast[fastIndex(saveListAmplifier.at(i)->boardStream, saveListAmplifier.at(i)->chipChannel, SAMPLES_PER_DATA_BLOCK * block + t)] / 0.195);
+                        *(amplifierStream) <<
+                               amplifierPreFilterFast[fastIndex(saveListAmplifier.at(i)->boardStream, saveListAmplifier.at(i)->chipChannel, SAMPLES_PER_DATA_BLOCK * block + t)];
                         ++numWordsWritten;
                     }
 
@@ -1850,9 +1961,8 @@ int SignalProcessor::loadSyntheticData(int numBlocks, double sampleRate,
                 // Save amplifier data
                 for (i = 0; i < saveListAmplifier.size(); ++i) {
                     for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
-                        *(saveListAmplifier.at(i)->saveStream) << (qint16)
-                            // (amplifierPreFilter[saveListAmplifier.at(i)->boardStream][saveListAmplifier.at(i)->chipChannel][SAMPLES_PER_DATA_BLOCK * block + t] / 0.195);
-                            (amplifierPreFilterFast[fastIndex(saveListAmplifier.at(i)->boardStream, saveListAmplifier.at(i)->chipChannel, SAMPLES_PER_DATA_BLOCK * block + t)] / 0.195);
+                        *(saveListAmplifier.at(i)->saveStream) <<
+                            amplifierPreFilterFast[fastIndex(saveListAmplifier.at(i)->boardStream, saveListAmplifier.at(i)->chipChannel, SAMPLES_PER_DATA_BLOCK * block + t)];
                         ++numWordsWritten;
                     }
                 }
@@ -1897,17 +2007,26 @@ int SignalProcessor::loadSyntheticData(int numBlocks, double sampleRate,
                 }
             }
             break;
+
+        case SaveFormatSpikeSnippets:
+            // No continuous data is saved; MainWindow saves detected spikes.
+            synthTimeStamp += SAMPLES_PER_DATA_BLOCK * numBlocks;
+            break;
         }
+        lastSavedTimestamp = (qint32) synthTimeStamp - 1;
     }
 
     // Return total number of bytes written to binary output stream
     return (2 * numWordsWritten);
 }
 
-// Returns the total number of bytes saved to disk per data block.
+// Returns the total number of bytes of continuous data saved to disk per data block.
 int SignalProcessor::bytesPerBlock(SaveFormat saveFormat, bool saveTtlOut)
 {
     int bytes = 0;
+    if (saveFormat == SaveFormatSpikeSnippets) {
+        return 0;   // spike events only
+    }
     bytes += 4 * SAMPLES_PER_DATA_BLOCK;  // timestamps
     bytes += 2 * SAMPLES_PER_DATA_BLOCK * saveListAmplifier.size();
     bytes += 2 * SAMPLES_PER_DATA_BLOCK * saveListBoardAdc.size();
@@ -1932,20 +2051,13 @@ int SignalProcessor::bytesPerBlock(SaveFormat saveFormat, bool saveTtlOut)
 // Set notch filter parameters.  All filter parameters are given in Hz (or
 // in Samples/s).  A bandwidth of 10 Hz is recommended for 50 or 60 Hz notch
 // filters.  Narrower bandwidths will produce extended ringing in the time
-// domain in response to large transients.
+// domain in response to large transients.  If numHarmonics is greater than
+// one, notches of the same bandwidth are also placed at the harmonics of
+// notchFreq (2 * notchFreq, 3 * notchFreq, ...) up to the Nyquist frequency.
 void SignalProcessor::setNotchFilter(double notchFreq, double bandwidth,
-                                     double sampleFreq)
+                                     double sampleFreq, int numHarmonics)
 {
-    double d;
-
-    d = exp(-PI * bandwidth / sampleFreq);
-
-    // Calculate biquad IIR filter coefficients.
-    a1 = -(1.0 + d * d) * cos(2.0 * PI * notchFreq / sampleFreq);
-    a2 = d * d;
-    b0 = (1 + d * d) / 2.0;
-    b1 = a1;
-    b2 = b0;
+    notchFilter->setNotch(notchFreq, bandwidth, sampleFreq, numHarmonics);
 }
 
 // Enables or disables amplifier waveform notch filter.
@@ -1958,8 +2070,11 @@ void SignalProcessor::setNotchFilterEnabled(bool enable)
 // in Samples/s).
 void SignalProcessor::setHighpassFilter(double cutoffFreq, double sampleFreq)
 {
-    aHpf = exp(-1.0 * TWO_PI * cutoffFreq / sampleFreq);
-    bHpf = 1.0 - aHpf;
+    double aHpf = exp(-1.0 * TWO_PI * cutoffFreq / sampleFreq);
+
+    // The first-order filter y = x - s, s' = aHpf * s + (1 - aHpf) * x is equivalent
+    // to y[t] = x[t] - x[t-1] + aHpf * y[t-1], which runs on the biquad kernel.
+    highpassFilter->setCoefficients(1.0, -1.0, 0.0, -aHpf, 0.0);
 }
 
 // Enables or disables amplifier waveform highpass filter.
@@ -1968,123 +2083,511 @@ void SignalProcessor::setHighpassFilterEnabled(bool enable)
     highpassFilterEnabled = enable;
 }
 
-// Runs notch filter only on amplifier channels that are visible
-// on the display (according to channelVisible).
-void SignalProcessor::filterData(int numBlocks,
-                                 const QVector<QVector<bool> > &channelVisible)
-{
-    int t, channel, stream;
-    int length = SAMPLES_PER_DATA_BLOCK * numBlocks;
-
-    // Note: Throughout this function, and elsewhere in this source code, we access
-    // multidimensional 'QVector' containers using the at() function, so instead of
-    // writing:
-    //            x = my3dQVector[i][j][k];
-    // we write:
-    //            x = my3dQVector.at(i).at(j).at(k);
-    //
-    // Web research suggests that using at() instead of [] to access the contents
-    // of a multidimensional QVector results in faster code, and some preliminary
-    // experiments at Intan bear this out.  Web research also suggests that the
-    // opposite could be true of C++ STL (non-Qt) 'vector' containers, so some
-    // experimentation may be needed to optimize the runtime performance of code.
-
-    if (notchFilterEnabled) {
-        for (stream = 0; stream < numDataStreams; ++stream) {
-            for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                if (channelVisible.at(stream).at(channel)) {
-                    // Execute biquad IIR notch filter.  The filter "looks backwards" two timesteps,
-                    // so we must use the prevAmplifierPreFilter and prevAmplifierPostFilter
-                    // variables to store the last two samples from the previous block of
-                    // waveform data so that the filter works smoothly across the "seams".
-                    amplifierPostFilter[stream][channel][0] =
-                            b2 * prevAmplifierPreFilter.at(stream).at(channel).at(0) +
-                            b1 * prevAmplifierPreFilter.at(stream).at(channel).at(1) +
-                            // b0 * amplifierPreFilter.at(stream).at(channel).at(0) -
-                            b0 * amplifierPreFilterFast[fastIndex(stream, channel, 0)] -
-                            a2 * prevAmplifierPostFilter.at(stream).at(channel).at(0) -
-                            a1 * prevAmplifierPostFilter.at(stream).at(channel).at(1);
-                    amplifierPostFilter[stream][channel][1] =
-                            b2 * prevAmplifierPreFilter.at(stream).at(channel).at(1) +
-                            // b1 * amplifierPreFilter.at(stream).at(channel).at(0) +
-                            b1 * amplifierPreFilterFast[fastIndex(stream, channel, 0)] +
-                            // b0 * amplifierPreFilter.at(stream).at(channel).at(1) -
-                            b0 * amplifierPreFilterFast[fastIndex(stream, channel, 1)] -
-                            a2 * prevAmplifierPostFilter.at(stream).at(channel).at(1) -
-                            a1 * amplifierPostFilter.at(stream).at(channel).at(0);
-                    for (t = 2; t < length; ++t) {
-                        amplifierPostFilter[stream][channel][t] =
-                                // b2 * amplifierPreFilter.at(stream).at(channel).at(t - 2) +
-                                b2 * amplifierPreFilterFast[fastIndex(stream, channel, t - 2)] +
-                                // b1 * amplifierPreFilter.at(stream).at(channel).at(t - 1) +
-                                b1 * amplifierPreFilterFast[fastIndex(stream, channel, t - 1)] +
-                                // b0 * amplifierPreFilter.at(stream).at(channel).at(t) -
-                                b0 * amplifierPreFilterFast[fastIndex(stream, channel, t)] -
-                                a2 * amplifierPostFilter.at(stream).at(channel).at(t - 2) -
-                                a1 * amplifierPostFilter.at(stream).at(channel).at(t - 1);
-                    }
-                }
+// Replace the software filter bank with a new set of bands, designed for the
+// given sample rate.  Returns false if any band could not be designed.
+bool SignalProcessor::setFilterBank(const QVector<FilterBankBand> &bands, double sampleFreq)
+{
+    if (filterBankDisplayBand >= bands.size()) {
+        filterBankDisplayBand = -1;
+    }
+    return filterBank->setBands(bands, sampleFreq);
+}
+
+// Redesign the filter bank for a new sample rate.  Returns false if any band
+// could not be designed (e.g., its cutoff is now above the Nyquist frequency).
+bool SignalProcessor::setFilterBankSampleRate(double sampleFreq)
+{
+    return filterBank->setSampleRate(sampleFreq);
+}
+
+// Select a filter bank band to be copied to amplifierPostFilter for display in
+// place of the highpass filter output, or -1 for the highpass filter output.
+void SignalProcessor::setFilterBankDisplayBand(int band)
+{
+    filterBankDisplayBand = (band < filterBank->getNumBands()) ? band : -1;
+}
+
+int SignalProcessor::getNumFilterBankBands() const
+{
+    return filterBank->getNumBands();
+}
+
+// Output of a filter bank band for the most recent call to filterData(), in the
+// time-major layout of amplifierPostFilterFast.
+const Sample* SignalProcessor::getFilterBankOutput(int band) const
+{
+    return filterBank->getOutput(band);
+}
+
+// Filtered amplifier data for the most recent call to filterData(), as copied to
+// amplifierPostFilter, in the time-major layout of amplifierPostFilterFast.
+const Sample* SignalProcessor::getFilteredDataFast() const
+{
+    return (filterBankDisplayBand >= 0) ? filterBank->getOutput(filterBankDisplayBand) : amplifierPostFilterFast;
+}
+
+// Turn off spatial re-referencing.
+void SignalProcessor::setSpatialReferenceOff()
+{
+    spatialReference->setOff();
+}
+
+// Reference each group of amplifier lanes (see amplifierLane()) to its common
+// average or common median.  Takes effect from the next call to filterData().
+void SignalProcessor::setSpatialReferenceGroups(SpatialReference::Mode mode, const QVector<QVector<int> > &groups)
+{
+    spatialReference->setGroups(mode, groups);
+}
+
+// Replace amplifier lanes by linear combinations of lanes (bipolar, Laplacian,
+// or custom montages).  Takes effect from the next call to filterData().
+void SignalProcessor::setSpatialReferenceMatrix(const QVector<QVector<SpatialReferenceTerm> > &rows)
+{
+    spatialReference->setMatrix(rows);
+}
+
+SpatialReference::Mode SignalProcessor::getSpatialReferenceMode() const
+{
+    return spatialReference->getMode();
+}
+
+int SignalProcessor::getNumAmplifierLanes() const
+{
+    return numDataStreams * CHANNELS_PER_STREAM;
+}
+
+// Lane of an amplifier channel in the time-major amplifierPreFilterFast and
+// amplifierPostFilterFast arrays.
+int SignalProcessor::amplifierLane(int stream, int channel) const
+{
+    return channel * numDataStreams + stream;
+}
+
+// Suppress stimulation artifacts in amplifier data before filtering, using the
+// stimOn, ampSettle and chargeRecov markers.  Lengths are in samples.
+void SignalProcessor::setArtifactSuppression(ArtifactSuppressor::Mode mode, ArtifactSuppressor::TriggerScope scope,
+                                             int tailSamples, int templateLength, int numAveraged)
+{
+    artifactSuppressor->setParameters(mode, scope, tailSamples, templateLength, numAveraged);
+}
+
+// Cancel mains interference in amplifier data with an adaptive filter driven by
+// a synthesized reference or a board ADC input (see LineNoiseCanceller).  The
+// time constant is in seconds.
+void SignalProcessor::setLineNoiseCancellation(LineNoiseCanceller::Reference reference, double lineFrequency,
+                                               int numHarmonics, int adcChannel, int numTaps,
+                                               double timeConstant, double sampleFreq)
+{
+    lineNoiseCanceller->setParameters(reference, lineFrequency, numHarmonics, adcChannel, numTaps,
+                                      timeConstant, sampleFreq);
+}
+
+// Detect spikes on all amplifier channels in the filtered data (see
+// getFilteredDataFast()).  Lengths are in samples.
+void SignalProcessor::setSpikeDetection(bool enabled, SpikeDetector::Polarity polarity, double thresholdMultiplier,
+                                        int noiseTimeConstant, int refractorySamples, int peakWindow,
+                                        int preSamples, int postSamples)
+{
+    spikeDetector->setParameters(enabled, polarity, thresholdMultiplier, noiseTimeConstant, refractorySamples,
+                                 peakWindow, preSamples, postSamples);
+    spikeSorter->setParameters(spikeSorter->isEnabled(), spikeSorter->getMaxClusters(),
+                               spikeDetector->getPreSamples(), spikeDetector->getSnippetLength());
+}
+
+// Spike detector, whose events are updated by each call to filterData().
+const SpikeDetector* SignalProcessor::getSpikeDetector() const
+{
+    return spikeDetector;
+}
+
+// Enable or disable online sorting of detected spikes into up to maxClusters
+// clusters per channel.  The sorter uses the detector's snippets.
+void SignalProcessor::setSpikeSorting(bool enabled, int maxClusters)
+{
+    spikeSorter->setParameters(enabled, maxClusters, spikeDetector->getPreSamples(),
+                               spikeDetector->getSnippetLength());
+}
+
+// Spike sorter, which labels the detector's events with cluster IDs.
+const SpikeSorter* SignalProcessor::getSpikeSorter() const
+{
+    return spikeSorter;
+}
+
+// Detect events of high power in a frequency band (e.g., ripples) on the notch
+// filter output of all amplifier channels (see BandPowerDetector).  Times are
+// in seconds, and minDuration and refractoryPeriod in samples.  Returns false,
+// disabling detection, if the band cannot be designed at this sample rate.
+bool SignalProcessor::setBandPowerDetection(bool enabled, double lowCutoff, double highCutoff, int order,
+                                            double smoothingTime, double baselineTimeConstant,
+                                            double onThreshold, double offThreshold, int minChannels,
+                                            int minDuration, int refractoryPeriod, double sampleFreq)
+{
+    return bandPowerDetector->setParameters(enabled, lowCutoff, highCutoff, order, smoothingTime,
+                                            baselineTimeConstant, onThreshold, offThreshold, minChannels,
+                                            minDuration, refractoryPeriod, sampleFreq);
+}
+
+// Amplifier lanes (see amplifierLane()) counted by band power event detection.
+void SignalProcessor::setBandPowerLanes(const QVector<int> &lanes)
+{
+    bandPowerDetector->setActiveLanes(lanes);
+}
+
+// Band power event detector, whose events are updated by each call to filterData().
+const BandPowerDetector* SignalProcessor::getBandPowerDetector() const
+{
+    return bandPowerDetector;
+}
+
+// Track the phase of the oscillation between lowCutoff and highCutoff (in Hz)
+// in the average of the given amplifier lanes, for stimulation at targetPhase
+// (in radians; see PhaseTracker).  Returns false, disabling tracking, if no
+// lanes are given or the band cannot be designed at this sample rate.
+bool SignalProcessor::setPhaseTracking(bool enabled, const QVector<int> &lanes, double lowCutoff,
+                                       double highCutoff, double targetPhase, double sampleFreq)
+{
+    return phaseTracker->setParameters(enabled, lanes, lowCutoff, highCutoff, targetPhase, sampleFreq);
+}
+
+// Record a phase-locked stimulation at the given (fractional) board timestamp,
+// so that the phase it achieved is measured from later data.
+void SignalProcessor::addPhaseStimulation(double timestamp)
+{
+    phaseTracker->addStimulation(timestamp);
+}
+
+// Phase tracker, whose estimate is updated by each call to filterData().
+const PhaseTracker* SignalProcessor::getPhaseTracker() const
+{
+    return phaseTracker;
+}
+
+// Gather per-channel signal quality statistics (see SignalQualityMonitor),
+// measuring mains pickup at lineFrequency (in Hz).  Clears all statistics.
+void SignalProcessor::setSignalQualityMonitoring(bool enabled, double lineFrequency, double sampleFreq)
+{
+    signalQualityMonitor->setParameters(enabled, lineFrequency, sampleFreq);
+}
+
+// Clear the rail and compliance limit hit counts of all channels.
+void SignalProcessor::resetSignalQualityCounts()
+{
+    signalQualityMonitor->resetCounts();
+}
+
+// Signal quality monitor, whose statistics are updated by calls to filterData().
+const SignalQualityMonitor* SignalProcessor::getSignalQualityMonitor() const
+{
+    return signalQualityMonitor;
+}
+
+// Track the noise of the amplifier lanes routed to each DAC (-1 for none; see
+// DacThresholdTracker), for adaptive DAC threshold comparators.  highpassCutoff
+// (Hz) is the DAC high-pass filter cutoff, or zero if it is disabled, and
+// timeConstant (s) sets how quickly the estimates follow changes in noise.
+void SignalProcessor::setDacThresholdTracking(bool enabled, const QVector<int> &lanes, double highpassCutoff,
+                                              double timeConstant, double sampleFreq)
+{
+    dacThresholdTracker->setParameters(enabled, lanes, highpassCutoff, timeConstant, sampleFreq);
+}
+
+// DAC noise tracker, whose estimates are updated by each call to filterData().
+const DacThresholdTracker* SignalProcessor::getDacThresholdTracker() const
+{
+    return dacThresholdTracker;
+}
+
+// Set the content of synthetic data generated by loadSyntheticData() (see
+// SyntheticDataGenerator::setParameters()).
+void SignalProcessor::setSyntheticDataParameters(double noiseRms, double spikeRateScale,
+                                                 double lfpAmplitude, double lfpFrequency,
+                                                 double lineNoiseAmplitude, double lineFrequency,
+                                                 double artifactAmplitude, double artifactRate)
+{
+    syntheticDataGenerator->setParameters(noiseRms, spikeRateScale, lfpAmplitude, lfpFrequency,
+                                          lineNoiseAmplitude, lineFrequency, artifactAmplitude, artifactRate);
+}
+
+// Runs artifact suppression, spatial re-referencing, line noise cancellation,
+// and notch and highpass filters on all amplifier channels, and copies the
+// results to amplifierPostFilter.  Band power events are detected on the notch
+// filter output.  Every channel is filtered whether or not it is
+// displayed, so filter state stays continuous and amplifierPostFilter is valid
+// for all channels.  The work is divided into chunks of lanes that are claimed
+// one at a time by this thread and by the filter worker threads, so a thread
+// that finishes early simply takes more chunks.  Spikes are then detected in
+// the filtered data and sorted, if enabled.  The software reference is
+// subtracted from the amplifier codes, in full precision, as they are converted
+// for filtering: to microvolts, or in the fixed-point build (see
+// SIGNAL_PROCESSOR_FIXED_POINT) to 32-bit fixed point for the notch and
+// highpass filters.  amplifierPreFilterFast is left as recorded.
+void SignalProcessor::filterData(int numBlocks)
+{
+    QElapsedTimer filterTimer;
+    filterTimer.start();
+
+    int numLanes = numDataStreams * CHANNELS_PER_STREAM;
+    filterLength = SAMPLES_PER_DATA_BLOCK * numBlocks;
+    numFilterChunks = (numLanes + FILTER_LANES_PER_CHUNK - 1) / FILTER_LANES_PER_CHUNK;
+    nextFilterChunk.store(0);
+
+    // Rail hits, mains pickup, and the noise seen by the DAC threshold
+    // comparators are measured on the data as recorded.
+    signalQualityMonitor->measureRaw(amplifierPreFilterFast, filterLength);
+    dacThresholdTracker->update(amplifierPreFilterFast, filterLength);
+
+    // Artifact suppression precedes re-referencing, so artifacts are not spread
+    // to other channels.  Re-referencing mixes lanes, so both are done before
+    // the lanes are divided among threads.  Both work in microvolts, in
+    // amplifierPostFilterFast.
+    preFilterInMicrovolts = artifactSuppressor->getMode() != ArtifactSuppressor::ArtifactOff ||
+            spatialReference->getMode() != SpatialReference::ReferenceOff;
+    if (preFilterInMicrovolts) {
+        codesToMicrovolts(0, numLanes);
+        artifactSuppressor->apply(amplifierPostFilterFast, filterLength, stimOn, ampSettle, chargeRecov);
+        spatialReference->apply(amplifierPostFilterFast, filterLength);
+    }
+
+    // The line noise reference is shared by all lanes, so it is prepared here.
+    lineNoiseCanceller->prepareReference(boardAdc[lineNoiseCanceller->getAdcChannel()].constData(), filterLength);
+
+    int numWorkers = qMin(numFilterChunks - 1, filterThreadPool->maxThreadCount());
+    for (int i = 0; i < numWorkers; ++i) {
+        filterThreadPool->start(new FilterTask(this));
+    }
+    filterLaneChunks();
+    filterTasksDone.acquire(numWorkers);
+
+    // Band power events need the active channel count across all lanes, and
+    // spike detection screens all lanes at once, so both follow filtering.
+    bandPowerDetector->vote(filterLength, timeStamp.constData());
+
+    // The phase tracker averages a few lanes before the notch and highpass filters,
+    // which would distort or remove its low frequency band.
+    phaseTracker->update(amplifierPreFilterFast, filterLength, timeStamp.constData());
+    spikeDetector->detect(getFilteredDataFast(), filterLength, timeStamp.constData());
+    spikeSorter->sort(*spikeDetector);
+
+    if (signalQualityMonitor->isEnabled()) {
+        for (int stream = 0; stream < numDataStreams; ++stream) {
+            for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+                signalQualityMonitor->measureAuxiliary(amplifierLane(stream, channel),
+                                                       dcAmplifier[stream][channel].constData(),
+                                                       complianceLimit[stream][channel].constData(), filterLength);
             }
         }
-    } else {
-        // If the notch filter is disabled, simply copy the data without filtering.
-        for (stream = 0; stream < numDataStreams; ++stream) {
-            for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                if (channelVisible.at(stream).at(channel)) {
-                    for (t = 0; t < length; ++t) {
-                        amplifierPostFilter[stream][channel][t] =
-                                // amplifierPreFilter.at(stream).at(channel).at(t);
-                                amplifierPreFilterFast[fastIndex(stream, channel, t)];
-                    }
-                }
+        signalQualityMonitor->finishBlock(filterLength);
+    }
+
+    lastFilterTimeNsec = filterTimer.nsecsElapsed();
+}
+
+// Filter chunks of lanes until none are left.  Called concurrently by
+// filterData() and the filter worker threads; chunks never share filter state
+// or output cache lines, so no locking is needed.
+void SignalProcessor::filterLaneChunks()
+{
+    int numLanes = numDataStreams * CHANNELS_PER_STREAM;
+    int chunk;
+
+    while ((chunk = nextFilterChunk.fetchAndAddRelaxed(1)) < numFilterChunks) {
+        int firstLane = chunk * FILTER_LANES_PER_CHUNK;
+        int lastLane = qMin(firstLane + FILTER_LANES_PER_CHUNK, numLanes);
+        bool inMicrovolts = preFilterInMicrovolts;
+
+        // Subtract the component of each channel correlated with the line noise
+        // reference, if enabled.  The canceller works in microvolts.
+        if (lineNoiseCanceller->getReference() != LineNoiseCanceller::ReferenceOff) {
+            if (!inMicrovolts) {
+                codesToMicrovolts(firstLane, lastLane);
+                inMicrovolts = true;
+            }
+            lineNoiseCanceller->apply(amplifierPostFilterFast, filterLength, firstLane, lastLane);
+        }
+
+        // Execute IIR notch filter (one biquad section per mains harmonic).  The filter
+        // works in place on a time-major array, treating adjacent channels as SIMD lanes,
+        // and keeps the last two samples of each section as filter state so that it works
+        // smoothly across the "seams" between blocks.  If the notch filter is disabled,
+        // the data is passed through, keeping the filter state up to date.
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+        // In the fixed-point build, the notch and highpass filters work on
+        // amplifierFixedPointFast, and the band power detector and filter bank
+        // on the notch filter output in microvolts, as does the display if the
+        // highpass filter is disabled.
+        if (inMicrovolts) {
+            microvoltsToFixedPoint(firstLane, lastLane);
+        } else {
+            codesToFixedPoint(firstLane, lastLane);
+        }
+        if (notchFilterEnabled) {
+            notchFilter->filter(amplifierFixedPointFast, amplifierFixedPointFast, filterLength, firstLane, lastLane);
+        } else {
+            notchFilter->passThrough(amplifierFixedPointFast, amplifierFixedPointFast, filterLength, firstLane, lastLane);
+        }
+        if (bandPowerDetector->isEnabled() || filterBank->getNumBands() > 0 || !highpassFilterEnabled) {
+            fixedPointToMicrovolts(firstLane, lastLane);
+        }
+#else
+        if (!inMicrovolts) {
+            codesToMicrovolts(firstLane, lastLane);
+        }
+        if (notchFilterEnabled) {
+            notchFilter->filter(amplifierPostFilterFast, amplifierPostFilterFast, filterLength, firstLane, lastLane);
+        } else {
+            notchFilter->passThrough(amplifierPostFilterFast, amplifierPostFilterFast, filterLength, firstLane, lastLane);
+        }
+#endif
+
+        // Band-pass filter the notch filter output for band power event detection,
+        // if enabled.  This precedes the highpass filter, which would remove low bands.
+        bandPowerDetector->filter(amplifierPostFilterFast, filterLength, firstLane, lastLane);
+
+        // Run the filter bank on the notch filter output.  All bands are computed
+        // from this chunk while it is still in cache.
+        if (filterBank->getNumBands() > 0) {
+            filterBank->filter(amplifierPostFilterFast, filterLength, firstLane, lastLane);
+        }
+
+        // Apply first-order high-pass filter, if selected.  It runs even while a
+        // filter bank band is displayed instead, so that its state stays current.
+        if (highpassFilterEnabled) {
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+            highpassFilter->filter(amplifierFixedPointFast, amplifierFixedPointFast, filterLength, firstLane, lastLane);
+            fixedPointToMicrovolts(firstLane, lastLane);
+#else
+            highpassFilter->filter(amplifierPostFilterFast, amplifierPostFilterFast, filterLength, firstLane, lastLane);
+#endif
+        }
+        const Sample *displayData = (filterBankDisplayBand >= 0) ?
+                    filterBank->getOutput(filterBankDisplayBand) : amplifierPostFilterFast;
+
+        // Noise statistics of the displayed data, while this chunk is in cache.
+        signalQualityMonitor->measureFiltered(displayData, filterLength, firstLane, lastLane);
+
+        // Copy filtered data to amplifierPostFilter.
+        for (int t = 0; t < filterLength; ++t) {
+            const Sample *src = displayData + t * numLanes;
+            for (int lane = firstLane; lane < lastLane; ++lane) {
+                amplifierPostFilterRows[lane][t] = src[lane];
             }
         }
     }
+}
 
-    // Save the last two data points from each waveform to use in successive IIR filter
-    // calculations.
-    for (stream = 0; stream < numDataStreams; ++stream) {
-        for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-            prevAmplifierPreFilter[stream][channel][0] =
-                    // amplifierPreFilter.at(stream).at(channel).at(length - 2);
-                    amplifierPreFilterFast[fastIndex(stream, channel, length - 2)];
-            prevAmplifierPreFilter[stream][channel][1] =
-                    // amplifierPreFilter.at(stream).at(channel).at(length - 1);
-                    amplifierPreFilterFast[fastIndex(stream, channel, length - 1)];
-            prevAmplifierPostFilter[stream][channel][0] =
-                    amplifierPostFilter.at(stream).at(channel).at(length - 2);
-            prevAmplifierPostFilter[stream][channel][1] =
-                    amplifierPostFilter.at(stream).at(channel).at(length - 1);
+// Convert lanes [firstLane, lastLane) of amplifierPreFilterFast to microvolts in
+// amplifierPostFilterFast, subtracting the software reference channel, if any,
+// from all but itself.
+void SignalProcessor::codesToMicrovolts(int firstLane, int lastLane)
+{
+    const int numLanes = numDataStreams * CHANNELS_PER_STREAM;
+    const Sample scale = (Sample) AMPLIFIER_MICROVOLTS_PER_BIT;
+    for (int t = 0; t < filterLength; ++t) {
+        const qint16 *src = amplifierPreFilterFast + t * numLanes;
+        Sample *dst = amplifierPostFilterFast + t * numLanes;
+        int reference = (softwareReferenceLane >= 0) ? src[softwareReferenceLane] : 0;
+        for (int lane = firstLane; lane < lastLane; ++lane) {
+            dst[lane] = scale * (src[lane] - reference);
+        }
+        if (softwareReferenceLane >= firstLane && softwareReferenceLane < lastLane) {
+            dst[softwareReferenceLane] = scale * src[softwareReferenceLane];
         }
     }
+}
 
-    // Apply first-order high-pass filter, if selected
-    if (highpassFilterEnabled) {
-        double temp;
-        for (stream = 0; stream < numDataStreams; ++stream) {
-            for (channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
-                if (channelVisible.at(stream).at(channel)) {
-                    for (t = 0; t < length; ++t) {
-                        temp = amplifierPostFilter[stream][channel][t];
-                        amplifierPostFilter[stream][channel][t] -= highpassFilterState[stream][channel];
-                        highpassFilterState[stream][channel] =
-                                aHpf * highpassFilterState[stream][channel] + bHpf * temp;
-                    }
-                }
-            }
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+// Convert lanes [firstLane, lastLane) of amplifierPreFilterFast to fixed point in
+// amplifierFixedPointFast, subtracting the software reference channel, if any,
+// from all but itself.  The difference of two codes needs 17 bits, so this is exact.
+void SignalProcessor::codesToFixedPoint(int firstLane, int lastLane)
+{
+    const int numLanes = numDataStreams * CHANNELS_PER_STREAM;
+    const int one = 1 << MultiChannelFixedNotch::FractionBits;
+    for (int t = 0; t < filterLength; ++t) {
+        const qint16 *src = amplifierPreFilterFast + t * numLanes;
+        qint32 *dst = amplifierFixedPointFast + t * numLanes;
+        int reference = (softwareReferenceLane >= 0) ? src[softwareReferenceLane] : 0;
+        for (int lane = firstLane; lane < lastLane; ++lane) {
+            dst[lane] = (src[lane] - reference) * one;
+        }
+        if (softwareReferenceLane >= firstLane && softwareReferenceLane < lastLane) {
+            dst[softwareReferenceLane] = src[softwareReferenceLane] * one;
+        }
+    }
+}
+
+// Round lanes [firstLane, lastLane) of amplifierPostFilterFast to fixed point in
+// amplifierFixedPointFast, after the stages that work in microvolts.  Rounding
+// adds at most half of 2^-FractionBits LSB.
+void SignalProcessor::microvoltsToFixedPoint(int firstLane, int lastLane)
+{
+    const int numLanes = numDataStreams * CHANNELS_PER_STREAM;
+    const double scale = (1 << MultiChannelFixedNotch::FractionBits) / AMPLIFIER_MICROVOLTS_PER_BIT;
+    for (int t = 0; t < filterLength; ++t) {
+        const Sample *src = amplifierPostFilterFast + t * numLanes;
+        qint32 *dst = amplifierFixedPointFast + t * numLanes;
+        for (int lane = firstLane; lane < lastLane; ++lane) {
+            dst[lane] = (qint32) qRound(qBound(-2147483647.0, scale * src[lane], 2147483647.0));
+        }
+    }
+}
+
+// Convert lanes [firstLane, lastLane) of amplifierFixedPointFast to microvolts in
+// amplifierPostFilterFast.
+void SignalProcessor::fixedPointToMicrovolts(int firstLane, int lastLane)
+{
+    const int numLanes = numDataStreams * CHANNELS_PER_STREAM;
+    const Sample scale = (Sample) (AMPLIFIER_MICROVOLTS_PER_BIT / (1 << MultiChannelFixedNotch::FractionBits));
+    for (int t = 0; t < filterLength; ++t) {
+        const qint32 *src = amplifierFixedPointFast + t * numLanes;
+        Sample *dst = amplifierPostFilterFast + t * numLanes;
+        for (int lane = firstLane; lane < lastLane; ++lane) {
+            dst[lane] = scale * src[lane];
         }
     }
+}
+#endif
+
+// Returns the time taken by the most recent call to filterData(), in milliseconds.
+double SignalProcessor::getLastFilterTimeMsec() const
+{
+    return lastFilterTimeNsec / 1.0e6;
+}
 
+// Returns the number of threads (including the calling thread) used by filterData().
+int SignalProcessor::getNumFilterThreads() const
+{
+    return filterThreadPool->maxThreadCount() + 1;
 }
 
 // Return the magnitude and phase (in degrees) of a selected frequency component (in Hz)
-// for a selected amplifier channel on the selected USB data stream.
-void SignalProcessor::measureComplexAmplitude(QVector<QVector<QVector<double> > > &measuredMagnitude,
-                                              QVector<QVector<QVector<double> > > &measuredPhase,
-                                              int capIndex, int stream, int chipChannel, int numBlocks,
-                                              double sampleRate, double frequency, int numPeriods)
+// for a selected amplifier channel on all USB data streams.
+void SignalProcessor::measureComplexAmplitudes(QVector<QVector<QVector<double> > > &measuredMagnitude,
+                                               QVector<QVector<QVector<double> > > &measuredPhase,
+                                               int capIndex, int chipChannel, int numBlocks,
+                                               double sampleRate, double frequency, int numPeriods)
+{
+    QVector<double> magnitude, phase;
+    measureComplexAmplitudes(magnitude, phase, chipChannel, numBlocks, sampleRate,
+                             QVector<double>(1, frequency), qRound(sampleRate / frequency), numPeriods);
+    for (int stream = 0; stream < numDataStreams; ++stream) {
+        measuredMagnitude[stream][chipChannel][capIndex] = magnitude[stream];
+        measuredPhase[stream][chipChannel][capIndex] = phase[stream];
+    }
+}
+
+// Return the magnitude and phase (in degrees) of several frequency components (in Hz) for
+// a selected amplifier channel on all USB data streams, measured from the same samples.
+// The measurement window is numPeriods periods of period samples long; for the components
+// to be measured independently, every frequency should complete a whole number of cycles
+// in one period.  Results are returned in magnitude and phase, indexed by
+// stream * frequencies.size() + frequency index.
+void SignalProcessor::measureComplexAmplitudes(QVector<double> &magnitude, QVector<double> &phase,
+                                               int chipChannel, int numBlocks, double sampleRate,
+                                               const QVector<double> &frequencies, int period, int numPeriods)
 {
-    int period = qRound(sampleRate / frequency);
+    const int numFrequencies = frequencies.size();
     int startIndex = 0;
     int endIndex = startIndex + numPeriods * period - 1;
 
@@ -2094,38 +2597,83 @@ void SignalProcessor::measureComplexAmplitude(QVector<QVector<QVector<double> >
         endIndex += period;
     }
 
-    double iComponent, qComponent;
-
-    // Measure real (iComponent) and imaginary (qComponent) amplitude of frequency component.
-    amplitudeOfFreqComponent(iComponent, qComponent, amplifierPreFilterFast, stream, chipChannel,
-                             startIndex, endIndex, sampleRate, frequency);
-    // Calculate magnitude and phase from real (I) and imaginary (Q) components.
-    measuredMagnitude[stream][chipChannel][capIndex] =
-            qSqrt(iComponent * iComponent + qComponent * qComponent);
-    measuredPhase[stream][chipChannel][capIndex] =
-            RADIANS_TO_DEGREES *qAtan2(qComponent, iComponent);
+    // The lanes of one channel on all data streams are adjacent (see amplifierLane()).
+    QVector<double> iComponent(numFrequencies * numDataStreams);
+    QVector<double> qComponent(numFrequencies * numDataStreams);
+
+    // Measure real (iComponent) and imaginary (qComponent) amplitudes of the frequency components.
+    amplitudesOfFreqComponents(iComponent.data(), qComponent.data(), amplifierPreFilterFast,
+                               amplifierLane(0, chipChannel), numDataStreams,
+                               startIndex, endIndex, sampleRate, frequencies);
+
+    magnitude.resize(numDataStreams * numFrequencies);
+    phase.resize(numDataStreams * numFrequencies);
+    for (int stream = 0; stream < numDataStreams; ++stream) {
+        for (int f = 0; f < numFrequencies; ++f) {
+            // Calculate magnitude and phase from real (I) and imaginary (Q) components.
+            double i = iComponent[f * numDataStreams + stream];
+            double q = qComponent[f * numDataStreams + stream];
+            magnitude[stream * numFrequencies + f] = qSqrt(i * i + q * q);
+            phase[stream * numFrequencies + f] = RADIANS_TO_DEGREES * qAtan2(q, i);
+        }
+    }
 }
 
-// Returns the real and imaginary amplitudes of a selected frequency component in the vector
-// data, between a start index and end index.
-void SignalProcessor::amplitudeOfFreqComponent(double &realComponent, double &imagComponent,
-                                               double* data, int stream, int channel, int startIndex,
-                                               int endIndex, double sampleRate, double frequency)
+// Returns the real and imaginary amplitudes of selected frequency components in
+// numLanes adjacent lanes of time-major amplifier codes starting at firstLane,
+// between a start index and end index, in microvolts.  The amplitudes are those of a correlation with
+// cos(kt) and -sin(kt), where t is the sample index; they are computed with a bank
+// of Goertzel resonators, each needing one multiply-add per sample, and all lanes
+// and frequencies are updated in a single pass through the data.  Results are
+// indexed by frequency index * numLanes + lane.
+void SignalProcessor::amplitudesOfFreqComponents(double *realComponent, double *imagComponent,
+                                                 const qint16 *codes, int firstLane, int numLanes,
+                                                 int startIndex, int endIndex,
+                                                 double sampleRate, const QVector<double> &frequencies)
 {
+    const int laneStride = numDataStreams * CHANNELS_PER_STREAM;
+    const int numFrequencies = frequencies.size();
+    const int numStates = numFrequencies * numLanes;
     int length = endIndex - startIndex + 1;
-    const double k = TWO_PI * frequency / sampleRate;  // precalculate for speed
 
-    // Perform correlation with sine and cosine waveforms.
-    double meanI = 0.0;
-    double meanQ = 0.0;
+    QVector<double> coefficient(numFrequencies);
+    for (int f = 0; f < numFrequencies; ++f) {
+        coefficient[f] = 2.0 * qCos(TWO_PI * frequencies[f] / sampleRate);
+    }
+
+    // Resonator states s[t - 1] and s[t - 2] of each frequency and lane
+    QVector<double> state(2 * numStates, 0.0);
+    double *s1 = state.data();
+    double *s2 = s1 + numStates;
+
     for (int t = startIndex; t <= endIndex; ++t) {
-        meanI += data[fastIndex(stream, channel, t)] * qCos(k * t);
-        meanQ += data[fastIndex(stream, channel, t)] * -1.0 * qSin(k * t);
+        const qint16 *x = codes + t * laneStride + firstLane;
+        for (int f = 0; f < numFrequencies; ++f) {
+            const double c = coefficient[f];
+            double *s1f = s1 + f * numLanes;
+            double *s2f = s2 + f * numLanes;
+            for (int i = 0; i < numLanes; ++i) {
+                double s0 = x[i] + c * s1f[i] - s2f[i];
+                s2f[i] = s1f[i];
+                s1f[i] = s0;
+            }
+        }
     }
-    meanI /= (double) length;
-    meanQ /= (double) length;
 
-    realComponent = 2.0 * meanI;
-    imagComponent = 2.0 * meanQ;
+    // s1 - exp(-jk) s2 is the sum of x(t) exp(jk(endIndex - t)), so rotate it
+    // by exp(-jk endIndex) to refer the phase to t = 0, and scale codes to microvolts.
+    for (int f = 0; f < numFrequencies; ++f) {
+        const double k = TWO_PI * frequencies[f] / sampleRate;
+        const double cosK = qCos(k);
+        const double sinK = qSin(k);
+        const double cosEnd = qCos(k * endIndex);
+        const double sinEnd = -qSin(k * endIndex);
+        for (int i = f * numLanes; i < (f + 1) * numLanes; ++i) {
+            double yReal = s1[i] - cosK * s2[i];
+            double yImag = sinK * s2[i];
+            realComponent[i] = 2.0 * AMPLIFIER_MICROVOLTS_PER_BIT * (yReal * cosEnd - yImag * sinEnd) / length;
+            imagComponent[i] = 2.0 * AMPLIFIER_MICROVOLTS_PER_BIT * (yReal * sinEnd + yImag * cosEnd) / length;
+        }
+    }
 }
 
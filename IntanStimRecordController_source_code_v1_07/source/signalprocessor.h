@@ -23,8 +23,21 @@
 #define SIGNALPROCESSOR_H
 
 #include <queue>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QAtomicInt>
 #include "mainwindow.h"
 #include "rhs2000datablock.h"
+#include "filterbank.h"
+#include "spatialreference.h"
+#include "artifactsuppressor.h"
+#include "linenoisecanceller.h"
+#include "spikedetector.h"
+#include "bandpowerdetector.h"
+#include "phasetracker.h"
+#include "signalqualitymonitor.h"
+#include "dacthresholdtracker.h"
+#include "spikesorter.h"
 
 // The maximum number of Rhs2000DataBlock objects needed during normal data acquisition.
 // (Used in MainWindow::changeSampleRate(), maximum sample rate case.)
@@ -35,7 +48,13 @@ using namespace std;
 class QDataStream;
 class SignalSources;
 class Rhs2000DataBlock;
-class RandomNumber;
+class SyntheticDataGenerator;
+class ChecksummedFile;
+class MultiChannelBiquad;
+class MultiChannelNotch;
+class MultiChannelFixedBiquad;
+class MultiChannelFixedNotch;
+class FilterTask;
 
 class SignalProcessor
 {
@@ -44,10 +63,51 @@ public:
     ~SignalProcessor();
 
     void allocateMemory(int numStreams);
-    void setNotchFilter(double notchFreq, double bandwidth, double sampleFreq);
+    void setNotchFilter(double notchFreq, double bandwidth, double sampleFreq, int numHarmonics = 1);
     void setNotchFilterEnabled(bool enable);
     void setHighpassFilter(double cutoffFreq, double sampleFreq);
     void setHighpassFilterEnabled(bool enable);
+    bool setFilterBank(const QVector<FilterBankBand> &bands, double sampleFreq);
+    bool setFilterBankSampleRate(double sampleFreq);
+    void setFilterBankDisplayBand(int band);
+    int getNumFilterBankBands() const;
+    const Sample* getFilterBankOutput(int band) const;
+    const Sample* getFilteredDataFast() const;
+    void setSpatialReferenceOff();
+    void setSpatialReferenceGroups(SpatialReference::Mode mode, const QVector<QVector<int> > &groups);
+    void setSpatialReferenceMatrix(const QVector<QVector<SpatialReferenceTerm> > &rows);
+    SpatialReference::Mode getSpatialReferenceMode() const;
+    int getNumAmplifierLanes() const;
+    int amplifierLane(int stream, int channel) const;
+    void setArtifactSuppression(ArtifactSuppressor::Mode mode, ArtifactSuppressor::TriggerScope scope,
+                                int tailSamples, int templateLength, int numAveraged);
+    void setLineNoiseCancellation(LineNoiseCanceller::Reference reference, double lineFrequency, int numHarmonics,
+                                  int adcChannel, int numTaps, double timeConstant, double sampleFreq);
+    void setSpikeDetection(bool enabled, SpikeDetector::Polarity polarity, double thresholdMultiplier,
+                           int noiseTimeConstant, int refractorySamples, int peakWindow,
+                           int preSamples, int postSamples);
+    const SpikeDetector* getSpikeDetector() const;
+    void setSpikeSorting(bool enabled, int maxClusters);
+    bool setBandPowerDetection(bool enabled, double lowCutoff, double highCutoff, int order,
+                               double smoothingTime, double baselineTimeConstant,
+                               double onThreshold, double offThreshold, int minChannels,
+                               int minDuration, int refractoryPeriod, double sampleFreq);
+    void setBandPowerLanes(const QVector<int> &lanes);
+    const BandPowerDetector* getBandPowerDetector() const;
+    bool setPhaseTracking(bool enabled, const QVector<int> &lanes, double lowCutoff, double highCutoff,
+                          double targetPhase, double sampleFreq);
+    void addPhaseStimulation(double timestamp);
+    const PhaseTracker* getPhaseTracker() const;
+    void setSignalQualityMonitoring(bool enabled, double lineFrequency, double sampleFreq);
+    void resetSignalQualityCounts();
+    const SignalQualityMonitor* getSignalQualityMonitor() const;
+    void setDacThresholdTracking(bool enabled, const QVector<int> &lanes, double highpassCutoff,
+                                 double timeConstant, double sampleFreq);
+    const DacThresholdTracker* getDacThresholdTracker() const;
+    void setSyntheticDataParameters(double noiseRms, double spikeRateScale, double lfpAmplitude, double lfpFrequency,
+                                    double lineNoiseAmplitude, double lineFrequency,
+                                    double artifactAmplitude, double artifactRate);
+    const SpikeSorter* getSpikeSorter() const;
     int loadAmplifierData(queue<Rhs2000DataBlock> &dataQueue, int numBlocks,
                           bool lookForTrigger, int triggerChannel, int triggerPolarity,
                           int &triggerIndex, bool addToBuffer,
@@ -66,41 +126,94 @@ public:
     void createFilenames(SignalSources *signalSources, QString path);
     void openSaveFiles(SignalSources *signalSources, bool saveDcAmps);
     void closeSaveFiles(SignalSources *signalSources, bool saveDcAmps);
+    QVector<ChecksummedFile*> openSaveFileList(SignalSources *signalSources, SaveFormat format, bool saveDcAmps) const;
+    void setSaveChecksumsEnabled(bool enable);
+    qint32 getLastSavedTimestamp() const;
     int bytesPerBlock(SaveFormat saveFormat, bool saveTtlOut);
-    void filterData(int numBlocks, const QVector<QVector<bool> > &channelVisible);
-    void measureComplexAmplitude(QVector<QVector<QVector<double> > > &measuredMagnitude,
-                           QVector<QVector<QVector<double> > > &measuredPhase,
-                           int capIndex, int stream, int chipChannel,
-                           int numBlocks, double sampleRate, double frequency, int numPeriods);
-
-    // QVector<QVector<QVector<double> > > amplifierPreFilter;
-    double* amplifierPreFilterFast;
-    QVector<QVector<QVector<double> > > amplifierPostFilter;
-    QVector<QVector<QVector<double> > > dcAmplifier;
+    void filterData(int numBlocks);
+    double getLastFilterTimeMsec() const;
+    int getNumFilterThreads() const;
+    void measureComplexAmplitudes(QVector<QVector<QVector<double> > > &measuredMagnitude,
+                                  QVector<QVector<QVector<double> > > &measuredPhase,
+                                  int capIndex, int chipChannel,
+                                  int numBlocks, double sampleRate, double frequency, int numPeriods);
+    void measureComplexAmplitudes(QVector<double> &magnitude, QVector<double> &phase,
+                                  int chipChannel, int numBlocks, double sampleRate,
+                                  const QVector<double> &frequencies, int period, int numPeriods);
+
+    // Amplifier waveforms as recorded, as signed ADC codes (raw code - 32768),
+    // time-major; multiply by AMPLIFIER_MICROVOLTS_PER_BIT for microvolts.  The
+    // software reference is subtracted only as the data enter the filters.
+    qint16* amplifierPreFilterFast;
+    Sample* amplifierPostFilterFast;
+    QVector<QVector<QVector<Sample> > > amplifierPostFilter;
+    // DC amplifier waveforms as signed ADC codes (raw code - 512); multiply by
+    // DC_AMPLIFIER_VOLTS_PER_BIT for volts.
+    QVector<QVector<QVector<qint16> > > dcAmplifier;
     QVector<QVector<QVector<int> > > complianceLimit;
     QVector<QVector<QVector<int> > > stimOn;
     QVector<QVector<QVector<int> > > stimPol;
     QVector<QVector<QVector<int> > > ampSettle;
     QVector<QVector<QVector<int> > > chargeRecov;
-    QVector<QVector<double> > boardDac;
-    QVector<QVector<double> > boardAdc;
+    QVector<QVector<Sample> > boardDac;
+    QVector<QVector<Sample> > boardAdc;
     QVector<QVector<int> > boardDigIn;
     QVector<QVector<int> > boardDigOut;
+    QVector<qint32> timeStamp;
 
 private:
-    QVector<QVector<QVector<double> > > prevAmplifierPreFilter;
-    QVector<QVector<QVector<double> > > prevAmplifierPostFilter;
-    QVector<QVector<double> > highpassFilterState;
+    friend class FilterTask;
+
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+    MultiChannelFixedNotch *notchFilter;
+    MultiChannelFixedBiquad *highpassFilter;
+#else
+    MultiChannelNotch *notchFilter;
+    MultiChannelBiquad *highpassFilter;
+#endif
+    FilterBank *filterBank;
+    int filterBankDisplayBand;
+    SpatialReference *spatialReference;
+    ArtifactSuppressor *artifactSuppressor;
+    LineNoiseCanceller *lineNoiseCanceller;
+    SpikeDetector *spikeDetector;
+    SpikeSorter *spikeSorter;
+    BandPowerDetector *bandPowerDetector;
+    PhaseTracker *phaseTracker;
+    SignalQualityMonitor *signalQualityMonitor;
+    DacThresholdTracker *dacThresholdTracker;
+
+    // Worker threads for filterData().  Lanes are handed out in chunks through
+    // nextFilterChunk; filterTasksDone counts worker threads that have finished.
+    QThreadPool *filterThreadPool;
+    QAtomicInt nextFilterChunk;
+    QSemaphore filterTasksDone;
+    int numFilterChunks;
+    int filterLength;
+    QVector<Sample*> amplifierPostFilterRows;
+    qint64 lastFilterTimeNsec;
+
+    // Lane of the software reference channel subtracted from the others, or -1,
+    // and whether filterData() has already converted all lanes to microvolts in
+    // amplifierPostFilterFast.
+    int softwareReferenceLane;
+    bool preFilterInMicrovolts;
+
+    void filterLaneChunks();
+    void codesToMicrovolts(int firstLane, int lastLane);
+
+#ifdef SIGNAL_PROCESSOR_FIXED_POINT
+    // Input and output of the notch and highpass filters, in amplifier codes
+    // with MultiChannelFixedNotch::FractionBits fraction bits, time-major.
+    qint32* amplifierFixedPointFast;
+
+    void codesToFixedPoint(int firstLane, int lastLane);
+    void microvoltsToFixedPoint(int firstLane, int lastLane);
+    void fixedPointToMicrovolts(int firstLane, int lastLane);
+#endif
 
     int numDataStreams;
-    double a1;
-    double a2;
-    double b0;
-    double b1;
-    double b2;
     bool notchFilterEnabled;
-    double aHpf;
-    double bHpf;
     bool highpassFilterEnabled;
 
     bool saveListBoardDigIn;
@@ -111,43 +224,44 @@ private:
     QVector<SignalChannel*> saveListBoardDigitalOut;
     QVector<int> posStimAmplitudeList;
     QVector<int> negStimAmplitudeList;
+    bool saveChecksumsEnabled;
 
     QString timestampFileName;
-    QFile *timestampFile;
+    ChecksummedFile *timestampFile;
     QDataStream *timestampStream;
 
     QString amplifierFileName;
-    QFile *amplifierFile;
+    ChecksummedFile *amplifierFile;
     QDataStream *amplifierStream;
 
     QString dcAmplifierFileName;
-    QFile *dcAmplifierFile;
+    ChecksummedFile *dcAmplifierFile;
     QDataStream *dcAmplifierStream;
 
     QString stimFileName;
-    QFile *stimFile;
+    ChecksummedFile *stimFile;
     QDataStream *stimStream;
 
     QString adcInputFileName;
-    QFile *adcInputFile;
+    ChecksummedFile *adcInputFile;
     QDataStream *adcInputStream;
 
     QString dacOutputFileName;
-    QFile *dacOutputFile;
+    ChecksummedFile *dacOutputFile;
     QDataStream *dacOutputStream;
 
     QString digitalInputFileName;
-    QFile *digitalInputFile;
+    ChecksummedFile *digitalInputFile;
     QDataStream *digitalInputStream;
 
     QString digitalOutputFileName;
-    QFile *digitalOutputFile;
+    ChecksummedFile *digitalOutputFile;
     QDataStream *digitalOutputStream;
 
-    void allocateDoubleArray3D(QVector<QVector<QVector<double> > > &array3D,
-                               int xSize, int ySize, int zSize);
     void allocateIntArray3D(QVector<QVector<QVector<int> > > &array3D,
                             int xSize, int ySize, int zSize);
+    void allocateInt16Array3D(QVector<QVector<QVector<qint16> > > &array3D,
+                              int xSize, int ySize, int zSize);
     void allocateDoubleArray2D(QVector<QVector<double> > &array2D,
                                int xSize, int ySize);
     void allocateIntArray2D(QVector<QVector<int> > &array2D,
@@ -155,20 +269,21 @@ private:
     void allocateDoubleArray1D(QVector<double> &array1D, int xSize);
     void fillZerosDoubleArray3D(QVector<QVector<QVector<double> > > &array3D);
     void fillZerosDoubleArray2D(QVector<QVector<double> > &array2D);
-    void amplitudeOfFreqComponent(double &realComponent, double &imagComponent,
-                                  double *data, int stream, int channel,
-                                  int startIndex, int endIndex,
-                                  double sampleRate, double frequency);
+    void allocateSampleArray3D(QVector<QVector<QVector<Sample> > > &array3D,
+                               int xSize, int ySize, int zSize);
+    void allocateSampleArray2D(QVector<QVector<Sample> > &array2D,
+                               int xSize, int ySize);
+    void fillZerosSampleArray3D(QVector<QVector<QVector<Sample> > > &array3D);
+    void amplitudesOfFreqComponents(double *realComponent, double *imagComponent,
+                                    const qint16 *codes, int firstLane, int numLanes,
+                                    int startIndex, int endIndex,
+                                    double sampleRate, const QVector<double> &frequencies);
 
     inline int fastIndex(int stream, int channel, int t) const;
 
-    RandomNumber *random;
-    QVector<QVector<QVector<double> > > synthSpikeAmplitude;
-    QVector<QVector<QVector<double> > > synthSpikeDuration;
-    QVector<QVector<double> > synthRelativeSpikeRate;
-    QVector<QVector<double> > synthEcgAmplitude;
-    double tPulse;
+    SyntheticDataGenerator *syntheticDataGenerator;
     unsigned int synthTimeStamp;
+    qint32 lastSavedTimestamp;
 
     // To speed up writing to disk, we must create a char array which we fill with bytes of raw data
     // and use QDataStream::writeRawData(const char *s, int len) to stream out more efficiently.
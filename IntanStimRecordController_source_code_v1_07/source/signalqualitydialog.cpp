@@ -0,0 +1,241 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "globalconstants.h"
+#include "signalqualitydialog.h"
+#include "signalqualitymonitor.h"
+#include "signalprocessor.h"
+#include "signalsources.h"
+#include "signalchannel.h"
+
+// Table columns
+enum QualityColumn {
+    ChannelColumn,
+    NameColumn,
+    RmsColumn,
+    NoiseColumn,
+    MainsColumn,
+    DcColumn,
+    RailColumn,
+    ComplianceColumn,
+    NumQualityColumns
+};
+
+// Signal quality dialog.
+// This dialog shows running signal quality statistics of every enabled
+// amplifier channel (see SignalQualityMonitor), for finding dead, saturated or
+// noisy channels before a long recording.  Statistics are only gathered while
+// the dialog is visible.  Cells outside the chosen limits are highlighted:
+// red for flat signals, rail hits and compliance limit hits, and yellow for
+// high noise or mains pickup.
+
+SignalQualityDialog::SignalQualityDialog(SignalProcessor *inSignalProcessor, SignalSources *inSignalSources,
+                                         QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle(tr("Signal Quality"));
+
+    signalProcessor = inSignalProcessor;
+    signalSources = inSignalSources;
+    lineFrequency = 60.0;
+    sampleRate = 30000.0;
+    lastUpdate = 0;
+
+    refreshTimer = new QTimer(this);
+
+    flatSpinBox = new QDoubleSpinBox();
+    flatSpinBox->setRange(0.0, 100.0);
+    flatSpinBox->setSingleStep(0.5);
+    flatSpinBox->setDecimals(1);
+    flatSpinBox->setValue(1.0);
+    flatSpinBox->setSuffix(" " + QSTRING_MU_SYMBOL + "V");
+
+    noisySpinBox = new QDoubleSpinBox();
+    noisySpinBox->setRange(1.0, 1000.0);
+    noisySpinBox->setSingleStep(1.0);
+    noisySpinBox->setDecimals(1);
+    noisySpinBox->setValue(20.0);
+    noisySpinBox->setSuffix(" " + QSTRING_MU_SYMBOL + "V");
+
+    mainsSpinBox = new QDoubleSpinBox();
+    mainsSpinBox->setRange(1.0, 10000.0);
+    mainsSpinBox->setSingleStep(5.0);
+    mainsSpinBox->setDecimals(1);
+    mainsSpinBox->setValue(20.0);
+    mainsSpinBox->setSuffix(" " + QSTRING_MU_SYMBOL + "V");
+
+    resetButton = new QPushButton(tr("Reset Counts"));
+    summaryLabel = new QLabel();
+    summaryLabel->setWordWrap(true);
+
+    table = new QTableWidget(this);
+    table->setColumnCount(NumQualityColumns);
+    table->setHorizontalHeaderLabels(QStringList() << tr("Channel") << tr("Name") <<
+                                     tr("RMS (") + QSTRING_MU_SYMBOL + "V)" <<
+                                     tr("Noise (") + QSTRING_MU_SYMBOL + "V)" <<
+                                     tr("Mains (") + QSTRING_MU_SYMBOL + "V)" <<
+                                     tr("DC (V)") << tr("Rail Hits") << tr("Compliance Hits"));
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    table->verticalHeader()->hide();
+
+    connect(resetButton, SIGNAL(clicked()), this, SLOT(resetCounts()));
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+
+    QFormLayout *limitLayout = new QFormLayout();
+    limitLayout->addRow(tr("Flat below"), flatSpinBox);
+    limitLayout->addRow(tr("Noisy above"), noisySpinBox);
+    limitLayout->addRow(tr("Mains above"), mainsSpinBox);
+
+    QGroupBox *limitGroupBox = new QGroupBox(tr("Limits"));
+    limitGroupBox->setLayout(limitLayout);
+
+    QVBoxLayout *leftLayout = new QVBoxLayout;
+    leftLayout->addWidget(limitGroupBox);
+    leftLayout->addWidget(resetButton);
+    leftLayout->addWidget(summaryLabel);
+    leftLayout->addStretch(1);
+
+    QHBoxLayout *mainLayout = new QHBoxLayout;
+    mainLayout->addLayout(leftLayout);
+    mainLayout->addWidget(table);
+    mainLayout->setStretch(1, 1);
+
+    setLayout(mainLayout);
+    resize(900, 500);
+}
+
+// Set the line frequency whose pickup is measured and the sample rate, both in Hz.
+void SignalQualityDialog::setParameters(double newLineFrequency, double newSampleRate)
+{
+    lineFrequency = newLineFrequency;
+    sampleRate = newSampleRate;
+    applyMonitoring();
+}
+
+void SignalQualityDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    applyMonitoring();
+    refreshTimer->start(250);
+}
+
+void SignalQualityDialog::hideEvent(QHideEvent *event)
+{
+    refreshTimer->stop();
+    QDialog::hideEvent(event);
+    applyMonitoring();
+}
+
+// Gather statistics only while the dialog is visible.
+void SignalQualityDialog::applyMonitoring()
+{
+    signalProcessor->setSignalQualityMonitoring(isVisible(), lineFrequency, sampleRate);
+    lastUpdate = 0;
+}
+
+void SignalQualityDialog::resetCounts()
+{
+    signalProcessor->resetSignalQualityCounts();
+}
+
+// Create one row for each enabled amplifier channel.
+void SignalQualityDialog::rebuildTable()
+{
+    table->setRowCount(channels.size());
+    for (int row = 0; row < channels.size(); ++row) {
+        table->setItem(row, ChannelColumn, new QTableWidgetItem(channels[row]->nativeChannelName));
+        table->setItem(row, NameColumn, new QTableWidgetItem(channels[row]->customChannelName));
+        for (int column = RmsColumn; column < NumQualityColumns; ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem();
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, column, item);
+        }
+    }
+}
+
+// Show the latest statistics.
+void SignalQualityDialog::refresh()
+{
+    const SignalQualityMonitor *monitor = signalProcessor->getSignalQualityMonitor();
+    if (monitor->getNumUpdates() == lastUpdate) return;
+    lastUpdate = monitor->getNumUpdates();
+
+    QVector<SignalChannel*> enabledChannels;
+    int numStreams = signalProcessor->getNumAmplifierLanes() / CHANNELS_PER_STREAM;
+    for (int stream = 0; stream < numStreams; ++stream) {
+        for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+            SignalChannel *signalChannel = signalSources->findAmplifierChannel(stream, channel);
+            if (signalChannel && signalChannel->enabled) {
+                enabledChannels.append(signalChannel);
+            }
+        }
+    }
+    if (enabledChannels != channels) {
+        channels = enabledChannels;
+        rebuildTable();
+    }
+
+    const QBrush normal = table->palette().base();
+    const QBrush warning(QColor(255, 235, 150));
+    const QBrush fault(QColor(255, 180, 180));
+    int numFlat = 0, numNoisy = 0, numMains = 0, numRail = 0, numCompliance = 0;
+
+    for (int row = 0; row < channels.size(); ++row) {
+        int lane = signalProcessor->amplifierLane(channels[row]->boardStream, channels[row]->chipChannel);
+        double rms = monitor->getRms(lane);
+        double noise = monitor->getMadNoise(lane);
+        double mains = monitor->getMainsAmplitude(lane);
+        qint64 railHits = monitor->getRailHits(lane);
+        qint64 complianceHits = monitor->getComplianceHits(lane);
+
+        bool flat = rms < flatSpinBox->value();
+        bool noisy = noise > noisySpinBox->value();
+        bool mainsHigh = mains > mainsSpinBox->value();
+        numFlat += flat;
+        numNoisy += noisy;
+        numMains += mainsHigh;
+        numRail += (railHits > 0);
+        numCompliance += (complianceHits > 0);
+
+        table->item(row, RmsColumn)->setText(QString::number(rms, 'f', 1));
+        table->item(row, RmsColumn)->setBackground(flat ? fault : normal);
+        table->item(row, NoiseColumn)->setText(QString::number(noise, 'f', 1));
+        table->item(row, NoiseColumn)->setBackground(noisy ? warning : normal);
+        table->item(row, MainsColumn)->setText(QString::number(mains, 'f', 1));
+        table->item(row, MainsColumn)->setBackground(mainsHigh ? warning : normal);
+        table->item(row, DcColumn)->setText(QString::number(monitor->getDcVoltage(lane), 'f', 3));
+        table->item(row, RailColumn)->setText(QString::number(railHits));
+        table->item(row, RailColumn)->setBackground((railHits > 0) ? fault : normal);
+        table->item(row, ComplianceColumn)->setText(QString::number(complianceHits));
+        table->item(row, ComplianceColumn)->setBackground((complianceHits > 0) ? fault : normal);
+    }
+
+    summaryLabel->setText(tr("%1 channels\n%2 flat\n%3 noisy\n%4 with mains pickup\n"
+                             "%5 with rail hits\n%6 with compliance limit hits")
+                          .arg(channels.size()).arg(numFlat).arg(numNoisy).arg(numMains)
+                          .arg(numRail).arg(numCompliance));
+}
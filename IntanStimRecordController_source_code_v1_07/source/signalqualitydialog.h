@@ -0,0 +1,78 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SIGNALQUALITYDIALOG_H
+#define SIGNALQUALITYDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+class QDoubleSpinBox;
+class QPushButton;
+class QLabel;
+class QTableWidget;
+class QTimer;
+class SignalProcessor;
+class SignalSources;
+class SignalChannel;
+
+class SignalQualityDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit SignalQualityDialog(SignalProcessor *inSignalProcessor, SignalSources *inSignalSources,
+                                 QWidget *parent = 0);
+
+    void setParameters(double newLineFrequency, double newSampleRate);
+
+signals:
+
+public slots:
+
+protected:
+    void showEvent(QShowEvent *event);
+    void hideEvent(QHideEvent *event);
+
+private slots:
+    void refresh();
+    void resetCounts();
+
+private:
+    SignalProcessor *signalProcessor;
+    SignalSources *signalSources;
+    QTimer *refreshTimer;
+    double lineFrequency;
+    double sampleRate;
+    quint64 lastUpdate;
+    QVector<SignalChannel*> channels;
+
+    QDoubleSpinBox *flatSpinBox;
+    QDoubleSpinBox *noisySpinBox;
+    QDoubleSpinBox *mainsSpinBox;
+    QPushButton *resetButton;
+    QLabel *summaryLabel;
+    QTableWidget *table;
+
+    void applyMonitoring();
+    void rebuildTable();
+};
+
+#endif // SIGNALQUALITYDIALOG_H
@@ -0,0 +1,358 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cmath>
+
+#include "signalqualitymonitor.h"
+#include "samplevector.h"
+
+// Length of the statistics window, in seconds.
+static const double WindowSeconds = 0.25;
+
+// Time constant of the median estimate, in seconds.
+static const double MedianTimeConstant = 1.0;
+
+// Ratio of the median absolute deviation to the standard deviation of Gaussian noise
+static const double MadPerSigma = 0.6745;
+
+// Ratio of the median to the mean of |x| for Gaussian noise, used to start the
+// median estimate.
+static const double MedianPerMeanAbs = 0.8453;
+
+// Lower limit on the median of |x|, in microvolts, so that the estimate of a
+// silent lane can always grow again.
+static const Sample MinimumMedianAbs = (Sample) 0.01;
+
+// Samples further than this from zero, in microvolts, are within one step of
+// the amplifier rails.
+static const Sample RailMicrovolts = (Sample) (32766.5 * AMPLIFIER_MICROVOLTS_PER_BIT);
+
+// Gain that turns any positive difference of microvolt values into at least 1.
+static const Sample StepGain = (Sample) 1.0e30;
+
+// Constructor.
+SignalQualityMonitor::SignalQualityMonitor()
+{
+    enabled = false;
+    lineFrequency = 60.0;
+    sampleRate = 30000.0;
+    numLanes = 0;
+    windowFrames = qRound(WindowSeconds * sampleRate);
+    medianRate = 1.0 / (MedianTimeConstant * sampleRate);
+    framesInWindow = 0;
+    mainsPhase = 0.0;
+    mainsCosSum = 0.0;
+    mainsSinSum = 0.0;
+    mainsWeightSum = 0.0;
+    numUpdates = 0;
+}
+
+void SignalQualityMonitor::setNumLanes(int numLanes_)
+{
+    numLanes = numLanes_;
+    rawSum.resize(numLanes);
+    rawCos.resize(numLanes);
+    rawSin.resize(numLanes);
+    railSum.resize(numLanes);
+    filteredSum.resize(numLanes);
+    filteredSquares.resize(numLanes);
+    medianAbs.resize(numLanes);
+    dcSum.resize(numLanes);
+    complianceSum.resize(numLanes);
+    rms.resize(numLanes);
+    madNoise.resize(numLanes);
+    mainsAmplitude.resize(numLanes);
+    dcVoltage.resize(numLanes);
+    railHits.resize(numLanes);
+    complianceHits.resize(numLanes);
+    resetState();
+}
+
+// Set the line frequency and sample rate (both in Hz).  Clears all statistics.
+void SignalQualityMonitor::setParameters(bool enabled_, double lineFrequency_, double sampleRate_)
+{
+    enabled = enabled_;
+    lineFrequency = lineFrequency_;
+    sampleRate = sampleRate_;
+    windowFrames = qMax(1, qRound(WindowSeconds * sampleRate));
+    medianRate = 1.0 / (MedianTimeConstant * sampleRate);
+    resetState();
+}
+
+// Clear all statistics, including rail and compliance hit counts.
+void SignalQualityMonitor::resetState()
+{
+    clearWindow();
+    medianAbs.fill(0);
+    mainsPhase = 0.0;
+    numUpdates = 0;
+    rms.fill(0.0);
+    madNoise.fill(0.0);
+    mainsAmplitude.fill(0.0);
+    dcVoltage.fill(0.0);
+    resetCounts();
+}
+
+// Clear the rail and compliance hit counts.
+void SignalQualityMonitor::resetCounts()
+{
+    railHits.fill(0);
+    complianceHits.fill(0);
+}
+
+bool SignalQualityMonitor::isEnabled() const
+{
+    return enabled;
+}
+
+void SignalQualityMonitor::clearWindow()
+{
+    framesInWindow = 0;
+    mainsCosSum = 0.0;
+    mainsSinSum = 0.0;
+    mainsWeightSum = 0.0;
+    rawSum.fill(0);
+    rawCos.fill(0);
+    rawSin.fill(0);
+    railSum.fill(0);
+    filteredSum.fill(0);
+    filteredSquares.fill(0);
+    dcSum.fill(0);
+    complianceSum.fill(0);
+}
+
+// Accumulate statistics of raw amplifier data, given as signed ADC codes: the
+// sum, the products with the line frequency reference, and the number of
+// samples at the rails.  Must be called before the data are modified by
+// artifact suppression or re-referencing.
+void SignalQualityMonitor::measureRaw(const qint16 *codes, int numFrames)
+{
+    if (!enabled || numLanes == 0) return;
+
+    // Line frequency reference for this block, shared by all lanes, with the
+    // Hann window of the statistics window folded in.  Frames past the nominal
+    // window length (the window ends on a block boundary) get no weight.
+    if (mainsCos.size() < numFrames) {
+        mainsCos.resize(numFrames);
+        mainsSin.resize(numFrames);
+    }
+    double step = TWO_PI * lineFrequency / sampleRate;
+    double c = cos(mainsPhase);
+    double s = sin(mainsPhase);
+    double cosStep = cos(step);
+    double sinStep = sin(step);
+    for (int t = 0; t < numFrames; ++t) {
+        int k = framesInWindow + t;
+        double w = (k < windowFrames) ? 0.5 - 0.5 * cos(TWO_PI * k / windowFrames) : 0.0;
+        mainsCos[t] = (Sample) (w * c);
+        mainsSin[t] = (Sample) (w * s);
+        mainsCosSum += w * c;
+        mainsSinSum += w * s;
+        mainsWeightSum += w;
+        double next = c * cosStep - s * sinStep;
+        s = s * cosStep + c * sinStep;
+        c = next;
+    }
+    mainsPhase = fmod(mainsPhase + step * numFrames, TWO_PI);
+
+    // Frames are the outer loop so that successive updates of a lane's sums are
+    // independent of each other's latency.  The rail test uses the same
+    // branch-free step as SpikeDetector::screenLanes(): (|x| - rail) times a
+    // huge gain, clamped to [0, 1].
+    typedef SampleVector SV;
+    const SV::V vZero = SV::set1(0);
+    const SV::V vOne = SV::set1(1);
+    const SV::V vGain = SV::set1(StepGain);
+    const SV::V vRail = SV::set1(RailMicrovolts);
+    const Sample scale = (Sample) AMPLIFIER_MICROVOLTS_PER_BIT;
+    const SV::V vScale = SV::set1(scale);
+    Sample *sum = rawSum.data();
+    Sample *sumCos = rawCos.data();
+    Sample *sumSin = rawSin.data();
+    Sample *rail = railSum.data();
+
+    for (int t = 0; t < numFrames; ++t) {
+        const qint16 *x = codes + t * numLanes;
+        const SV::V vCos = SV::set1(mainsCos[t]);
+        const SV::V vSin = SV::set1(mainsSin[t]);
+        int lane = 0;
+        for (; lane + SV::Width <= numLanes; lane += SV::Width) {
+            SV::V v = SV::mul(SV::loadCodes(x + lane), vScale);
+            SV::storeu(sum + lane, SV::add(SV::loadu(sum + lane), v));
+            SV::storeu(sumCos + lane, SV::add(SV::loadu(sumCos + lane), SV::mul(v, vCos)));
+            SV::storeu(sumSin + lane, SV::add(SV::loadu(sumSin + lane), SV::mul(v, vSin)));
+            SV::V a = SV::max(v, SV::sub(vZero, v));
+            SV::V hit = SV::min(SV::max(SV::mul(SV::sub(a, vRail), vGain), vZero), vOne);
+            SV::storeu(rail + lane, SV::add(SV::loadu(rail + lane), hit));
+        }
+        for (; lane < numLanes; ++lane) {
+            Sample v = scale * x[lane];
+            sum[lane] += v;
+            sumCos[lane] += v * mainsCos[t];
+            sumSin[lane] += v * mainsSin[t];
+            if (qAbs(v) > RailMicrovolts) rail[lane] += 1;
+        }
+    }
+}
+
+// Accumulate statistics of the displayed data of lanes [firstLane, lastLane):
+// the sum, the sum of squares, and the running median of |x|.  The median
+// estimate m is multiplied by (1 + medianRate) if |x| > m and by
+// (1 - medianRate) otherwise, as in SpikeDetector.
+void SignalQualityMonitor::measureFiltered(const Sample *data, int numFrames, int firstLane, int lastLane)
+{
+    if (!enabled || numFrames == 0) return;
+
+    // Start the median estimate of new lanes from the mean of |x|.
+    for (int lane = firstLane; lane < lastLane; ++lane) {
+        if (medianAbs[lane] > 0) continue;
+        double meanAbs = 0.0;
+        for (int t = 0; t < numFrames; ++t) {
+            meanAbs += qAbs(data[t * numLanes + lane]);
+        }
+        medianAbs[lane] = qMax((Sample) (MedianPerMeanAbs * meanAbs / numFrames), MinimumMedianAbs);
+    }
+
+    typedef SampleVector SV;
+    const Sample down = (Sample) (1.0 - medianRate);
+    const Sample up = (Sample) (2.0 * medianRate);
+    const SV::V vZero = SV::set1(0);
+    const SV::V vOne = SV::set1(1);
+    const SV::V vGain = SV::set1(StepGain);
+    const SV::V vDown = SV::set1(down);
+    const SV::V vUp = SV::set1(up);
+    const SV::V vFloor = SV::set1(MinimumMedianAbs);
+
+    Sample *sum = filteredSum.data();
+    Sample *squares = filteredSquares.data();
+    Sample *m = medianAbs.data();
+
+    for (int t = 0; t < numFrames; ++t) {
+        const Sample *x = data + t * numLanes;
+        int lane = firstLane;
+        for (; lane + SV::Width <= lastLane; lane += SV::Width) {
+            SV::V v = SV::loadu(x + lane);
+            SV::storeu(sum + lane, SV::add(SV::loadu(sum + lane), v));
+            SV::storeu(squares + lane, SV::add(SV::loadu(squares + lane), SV::mul(v, v)));
+            SV::V vm = SV::loadu(m + lane);
+            SV::V a = SV::max(v, SV::sub(vZero, v));
+            SV::V above = SV::min(SV::max(SV::mul(SV::sub(a, vm), vGain), vZero), vOne);
+            SV::storeu(m + lane, SV::max(SV::mul(vm, SV::add(vDown, SV::mul(vUp, above))), vFloor));
+        }
+        for (; lane < lastLane; ++lane) {
+            sum[lane] += x[lane];
+            squares[lane] += x[lane] * x[lane];
+            m[lane] = qMax(m[lane] * ((qAbs(x[lane]) > m[lane]) ? down + up : down), MinimumMedianAbs);
+        }
+    }
+}
+
+// Accumulate the DC amplifier codes and compliance limit flags of one lane.
+void SignalQualityMonitor::measureAuxiliary(int lane, const qint16 *dcCodes, const int *compliance, int numFrames)
+{
+    if (!enabled) return;
+
+    qint64 dc = 0;
+    qint64 limit = 0;
+    for (int t = 0; t < numFrames; ++t) {
+        dc += dcCodes[t];
+        limit += (compliance[t] != 0);
+    }
+    dcSum[lane] += dc;
+    complianceSum[lane] += limit;
+}
+
+// Count the frames of a block whose statistics have been accumulated, and
+// publish the statistics once the window is full.
+void SignalQualityMonitor::finishBlock(int numFrames)
+{
+    if (!enabled) return;
+
+    framesInWindow += numFrames;
+    if (framesInWindow >= windowFrames) {
+        publishWindow();
+        clearWindow();
+    }
+}
+
+void SignalQualityMonitor::publishWindow()
+{
+    double n = framesInWindow;
+    for (int lane = 0; lane < numLanes; ++lane) {
+        double mean = rawSum[lane] / n;
+        double re = rawCos[lane] - mean * mainsCosSum;
+        double im = rawSin[lane] - mean * mainsSinSum;
+        mainsAmplitude[lane] = (mainsWeightSum > 0.0) ? 2.0 * sqrt(re * re + im * im) / mainsWeightSum : 0.0;
+
+        double filteredMean = filteredSum[lane] / n;
+        rms[lane] = sqrt(qMax(0.0, filteredSquares[lane] / n - filteredMean * filteredMean));
+        madNoise[lane] = medianAbs[lane] / MadPerSigma;
+
+        dcVoltage[lane] = DC_AMPLIFIER_VOLTS_PER_BIT * dcSum[lane] / n;
+        railHits[lane] += qRound64(railSum[lane]);
+        complianceHits[lane] += complianceSum[lane];
+    }
+    ++numUpdates;
+}
+
+// Number of windows published since the last reset.
+quint64 SignalQualityMonitor::getNumUpdates() const
+{
+    return numUpdates;
+}
+
+// RMS of the displayed signal of lane, in microvolts.
+double SignalQualityMonitor::getRms(int lane) const
+{
+    return rms.value(lane, 0.0);
+}
+
+// Noise standard deviation of the displayed signal of lane estimated from its
+// median absolute value, in microvolts.
+double SignalQualityMonitor::getMadNoise(int lane) const
+{
+    return madNoise.value(lane, 0.0);
+}
+
+// Amplitude of the line frequency component of the raw signal of lane, in microvolts.
+double SignalQualityMonitor::getMainsAmplitude(int lane) const
+{
+    return mainsAmplitude.value(lane, 0.0);
+}
+
+// Mean DC amplifier voltage of lane, in volts.
+double SignalQualityMonitor::getDcVoltage(int lane) const
+{
+    return dcVoltage.value(lane, 0.0);
+}
+
+// Samples of lane at the amplifier rails since the last reset.
+qint64 SignalQualityMonitor::getRailHits(int lane) const
+{
+    return railHits.value(lane, 0);
+}
+
+// Samples of lane with the compliance limit flag set since the last reset.
+qint64 SignalQualityMonitor::getComplianceHits(int lane) const
+{
+    return complianceHits.value(lane, 0);
+}
@@ -0,0 +1,113 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SIGNALQUALITYMONITOR_H
+#define SIGNALQUALITYMONITOR_H
+
+#include <QVector>
+
+#include "globalconstants.h"
+
+// Running signal quality statistics for every amplifier channel, for finding
+// dead, saturated or noisy channels at a glance.
+//
+// Statistics are gathered over consecutive windows of about a quarter of a
+// second, with constant work per sample, and published at the end of each
+// window:
+//   - RMS of the displayed (filtered) signal;
+//   - noise level from the median absolute value of the displayed signal,
+//     tracked with the same stochastic quantile update as SpikeDetector, which
+//     unlike the RMS is insensitive to spikes and artifacts;
+//   - mains amplitude, from a Hann-windowed single-bin DFT at the line
+//     frequency of the raw signal (before notch filtering and re-referencing);
+//   - samples within one step of the amplifier rails;
+//   - mean DC amplifier voltage; and
+//   - samples with the stimulator compliance limit flag set.
+// Rail and compliance hits are accumulated since the last reset.
+//
+// Amplifier statistics work on time-major data (the layout of
+// SignalProcessor::amplifierPreFilterFast) with SIMD vectors across lanes.
+// measureFiltered() is called by the filter worker threads for disjoint lane
+// ranges; all other functions are called from one thread.
+class SignalQualityMonitor
+{
+public:
+    SignalQualityMonitor();
+
+    void setNumLanes(int numLanes_);
+    void setParameters(bool enabled_, double lineFrequency_, double sampleRate_);
+    void resetState();
+    void resetCounts();
+    bool isEnabled() const;
+
+    void measureRaw(const qint16 *codes, int numFrames);
+    void measureFiltered(const Sample *data, int numFrames, int firstLane, int lastLane);
+    void measureAuxiliary(int lane, const qint16 *dcCodes, const int *compliance, int numFrames);
+    void finishBlock(int numFrames);
+
+    quint64 getNumUpdates() const;
+    double getRms(int lane) const;
+    double getMadNoise(int lane) const;
+    double getMainsAmplitude(int lane) const;
+    double getDcVoltage(int lane) const;
+    qint64 getRailHits(int lane) const;
+    qint64 getComplianceHits(int lane) const;
+
+private:
+    bool enabled;
+    double lineFrequency;
+    double sampleRate;
+    int numLanes;
+    int windowFrames;
+    double medianRate;          // relative step of the median estimate per sample
+
+    // Accumulated over the current window.
+    int framesInWindow;
+    double mainsPhase;          // line frequency phase at the start of the block
+    QVector<Sample> mainsCos;   // Hann-weighted line frequency reference for one block
+    QVector<Sample> mainsSin;
+    double mainsCosSum;
+    double mainsSinSum;
+    double mainsWeightSum;
+    QVector<Sample> rawSum;
+    QVector<Sample> rawCos;
+    QVector<Sample> rawSin;
+    QVector<Sample> railSum;
+    QVector<Sample> filteredSum;
+    QVector<Sample> filteredSquares;
+    QVector<Sample> medianAbs;  // running median of |x| of the filtered signal
+    QVector<qint64> dcSum;
+    QVector<qint64> complianceSum;
+
+    // Published at the end of each window.
+    quint64 numUpdates;
+    QVector<double> rms;
+    QVector<double> madNoise;
+    QVector<double> mainsAmplitude;
+    QVector<double> dcVoltage;
+    QVector<qint64> railHits;
+    QVector<qint64> complianceHits;
+
+    void clearWindow();
+    void publishWindow();
+};
+
+#endif // SIGNALQUALITYMONITOR_H
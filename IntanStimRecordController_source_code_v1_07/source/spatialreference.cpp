@@ -0,0 +1,395 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "spatialreference.h"
+#include "samplevector.h"
+
+using namespace std;
+
+// Number of time steps processed together.  A multiple of every SampleVector width.
+static const int BlockFrames = 16;
+
+// Largest group whose median is found with a sorting network.
+static const int MaxNetworkSize = 64;
+
+// Constructor.
+SpatialReference::SpatialReference()
+{
+    mode = ReferenceOff;
+    numLanes = 0;
+    block = nullptr;
+    rowBlock = nullptr;
+}
+
+SpatialReference::~SpatialReference()
+{
+    freeBlocks();
+}
+
+void SpatialReference::freeBlocks()
+{
+    qFreeAligned(block);
+    qFreeAligned(rowBlock);
+    block = nullptr;
+    rowBlock = nullptr;
+}
+
+// Set the number of interleaved lanes.  Any existing referencing is turned off,
+// since its lane numbers no longer apply.
+void SpatialReference::setNumLanes(int numLanes_)
+{
+    numLanes = numLanes_;
+    setOff();
+
+    freeBlocks();
+    size_t bytes = qMax(numLanes, MaxNetworkSize) * BlockFrames * sizeof(Sample);
+    block = static_cast<Sample*>(qMallocAligned(bytes, 64));
+    rowBlock = static_cast<Sample*>(qMallocAligned(bytes, 64));
+    memset(block, 0, bytes);
+    memset(rowBlock, 0, bytes);
+}
+
+void SpatialReference::setOff()
+{
+    mode = ReferenceOff;
+    groups.clear();
+    medianPlans.clear();
+    rowLanes.clear();
+    rowStart.clear();
+    termLanes.clear();
+    termWeights.clear();
+}
+
+SpatialReference::Mode SpatialReference::getMode() const
+{
+    return mode;
+}
+
+// Reference each lane in each group to the common average or common median of
+// its group.  Lanes not in any group are unchanged.
+void SpatialReference::setGroups(Mode mode_, const QVector<QVector<int> > &groups_)
+{
+    setOff();
+    for (int g = 0; g < groups_.size(); ++g) {
+        if (!groups_[g].isEmpty()) groups.append(groups_[g]);
+    }
+    if (groups.isEmpty() || (mode_ != ReferenceCommonAverage && mode_ != ReferenceCommonMedian)) return;
+
+    mode = mode_;
+    if (mode == ReferenceCommonMedian) {
+        for (int g = 0; g < groups.size(); ++g) {
+            medianPlans.append(medianPlan(groups[g].size()));
+        }
+    }
+}
+
+// Replace each lane i for which rows[i] is not empty by the weighted sum of
+// lanes given in rows[i].  All sums use the original (unreferenced) inputs.
+void SpatialReference::setMatrix(const QVector<QVector<SpatialReferenceTerm> > &rows)
+{
+    setOff();
+    for (int lane = 0; lane < rows.size() && lane < numLanes; ++lane) {
+        if (rows[lane].isEmpty()) continue;
+        rowLanes.append(lane);
+        rowStart.append(termLanes.size());
+        for (int i = 0; i < rows[lane].size(); ++i) {
+            termLanes.append(rows[lane][i].lane);
+            termWeights.append(rows[lane][i].weight);
+        }
+    }
+    rowStart.append(termLanes.size());
+    if (!rowLanes.isEmpty()) mode = ReferenceMatrix;
+}
+
+// Plan the median of groupSize values using Batcher's odd-even merge sort
+// network, keeping only the comparators on which the median depends.
+SpatialReference::MedianPlan SpatialReference::medianPlan(int groupSize)
+{
+    MedianPlan plan;
+    int n = 2;
+    while (n < groupSize) n <<= 1;
+    plan.networkSize = n;
+
+    int pads = n - groupSize;
+    if (groupSize % 2 == 0) {
+        plan.numLowPads = pads / 2;
+        plan.numHighPads = pads / 2;
+        plan.medianLow = n / 2 - 1;
+        plan.medianHigh = n / 2;
+    } else {
+        plan.numLowPads = (pads - 1) / 2;
+        plan.numHighPads = (pads + 1) / 2;
+        plan.medianLow = n / 2 - 1;
+        plan.medianHigh = n / 2 - 1;
+    }
+    if (n > MaxNetworkSize) return plan;
+
+    QVector<int> all;
+    for (int p = 1; p < n; p <<= 1) {
+        for (int k = p; k >= 1; k >>= 1) {
+            for (int j = k % p; j <= n - 1 - k; j += 2 * k) {
+                for (int i = 0; i <= qMin(k - 1, n - j - k - 1); ++i) {
+                    if ((i + j) / (p * 2) == (i + j + k) / (p * 2)) {
+                        all.append(i + j);
+                        all.append(i + j + k);
+                    }
+                }
+            }
+        }
+    }
+
+    // Work backwards from the median positions, keeping comparators whose
+    // outputs are needed.
+    QVector<bool> needed(n);
+    needed.fill(false);
+    needed[plan.medianLow] = true;
+    needed[plan.medianHigh] = true;
+    QVector<int> kept;
+    for (int c = all.size() - 2; c >= 0; c -= 2) {
+        if (needed[all[c]] || needed[all[c + 1]]) {
+            needed[all[c]] = true;
+            needed[all[c + 1]] = true;
+            kept.append(all[c + 1]);
+            kept.append(all[c]);
+        }
+    }
+    for (int c = kept.size() - 1; c >= 0; --c) {
+        plan.comparators.append(kept[c]);
+    }
+    return plan;
+}
+
+// Apply re-referencing in place to numFrames time steps of data.
+void SpatialReference::apply(Sample *data, int numFrames)
+{
+    if (mode == ReferenceOff) return;
+
+    for (int t0 = 0; t0 < numFrames; t0 += BlockFrames) {
+        int frames = qMin(BlockFrames, numFrames - t0);
+        Sample *frameData = data + t0 * numLanes;
+
+        // Transpose the block so that each lane's samples are contiguous.
+        for (int w = 0; w < frames; ++w) {
+            const Sample *src = frameData + w * numLanes;
+            for (int lane = 0; lane < numLanes; ++lane) {
+                block[lane * BlockFrames + w] = src[lane];
+            }
+        }
+
+        switch (mode) {
+        case ReferenceCommonAverage:
+            applyCommonAverage(frames);
+            break;
+        case ReferenceCommonMedian:
+            applyCommonMedian(frames);
+            break;
+        case ReferenceMatrix:
+            applyMatrix(frames);
+            break;
+        default:
+            break;
+        }
+
+        // Copy referenced lanes back.
+        if (mode == ReferenceMatrix) {
+            for (int r = 0; r < rowLanes.size(); ++r) {
+                const Sample *src = rowBlock + r * BlockFrames;
+                Sample *dst = frameData + rowLanes[r];
+                for (int w = 0; w < frames; ++w) {
+                    dst[w * numLanes] = src[w];
+                }
+            }
+        } else {
+            for (int g = 0; g < groups.size(); ++g) {
+                for (int i = 0; i < groups[g].size(); ++i) {
+                    int lane = groups[g][i];
+                    const Sample *src = block + lane * BlockFrames;
+                    Sample *dst = frameData + lane;
+                    for (int w = 0; w < frames; ++w) {
+                        dst[w * numLanes] = src[w];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Subtract the group mean from each lane of each group in the current block.
+void SpatialReference::applyCommonAverage(int numFrames)
+{
+    typedef SampleVector Vec;
+    Q_UNUSED(numFrames);
+
+    for (int g = 0; g < groups.size(); ++g) {
+        const QVector<int> &group = groups[g];
+        const Vec::V scale = Vec::set1((Sample) (1.0 / group.size()));
+        for (int v = 0; v < BlockFrames; v += Vec::Width) {
+            Vec::V sum = Vec::set1(0);
+            for (int i = 0; i < group.size(); ++i) {
+                sum = Vec::add(sum, Vec::loadu(block + group[i] * BlockFrames + v));
+            }
+            Vec::V mean = Vec::mul(sum, scale);
+            for (int i = 0; i < group.size(); ++i) {
+                Sample *p = block + group[i] * BlockFrames + v;
+                Vec::storeu(p, Vec::sub(Vec::loadu(p), mean));
+            }
+        }
+    }
+}
+
+// Subtract the group median from each lane of each group in the current block.
+void SpatialReference::applyCommonMedian(int numFrames)
+{
+    typedef SampleVector Vec;
+    const Sample Infinity = numeric_limits<Sample>::infinity();
+
+    for (int g = 0; g < groups.size(); ++g) {
+        const QVector<int> &group = groups[g];
+        const MedianPlan &plan = medianPlans[g];
+        if (plan.networkSize > MaxNetworkSize) {
+            applyMedianScalar(group, numFrames);
+            continue;
+        }
+
+        // Load the group, with padding, into the sorting network workspace.
+        Sample *work = rowBlock;
+        int position = 0;
+        for (int i = 0; i < plan.numLowPads; ++i, ++position) {
+            for (int w = 0; w < BlockFrames; ++w) work[position * BlockFrames + w] = -Infinity;
+        }
+        for (int i = 0; i < group.size(); ++i, ++position) {
+            memcpy(work + position * BlockFrames, block + group[i] * BlockFrames, BlockFrames * sizeof(Sample));
+        }
+        for (int i = 0; i < plan.numHighPads; ++i, ++position) {
+            for (int w = 0; w < BlockFrames; ++w) work[position * BlockFrames + w] = Infinity;
+        }
+
+        const int *comparators = plan.comparators.constData();
+        const int numComparators = plan.comparators.size() / 2;
+        const Vec::V half = Vec::set1((Sample) 0.5);
+        for (int v = 0; v < BlockFrames; v += Vec::Width) {
+            for (int c = 0; c < numComparators; ++c) {
+                Sample *pLow = work + comparators[2 * c] * BlockFrames + v;
+                Sample *pHigh = work + comparators[2 * c + 1] * BlockFrames + v;
+                Vec::V a = Vec::loadu(pLow);
+                Vec::V b = Vec::loadu(pHigh);
+                Vec::storeu(pLow, Vec::min(a, b));
+                Vec::storeu(pHigh, Vec::max(a, b));
+            }
+            Vec::V median = Vec::loadu(work + plan.medianLow * BlockFrames + v);
+            if (plan.medianHigh != plan.medianLow) {
+                median = Vec::mul(half, Vec::add(median, Vec::loadu(work + plan.medianHigh * BlockFrames + v)));
+            }
+            for (int i = 0; i < group.size(); ++i) {
+                Sample *p = block + group[i] * BlockFrames + v;
+                Vec::storeu(p, Vec::sub(Vec::loadu(p), median));
+            }
+        }
+    }
+}
+
+// Median referencing for groups too large for a sorting network.
+void SpatialReference::applyMedianScalar(const QVector<int> &group, int numFrames)
+{
+    QVector<Sample> values(group.size());
+    int middle = group.size() / 2;
+    for (int w = 0; w < numFrames; ++w) {
+        for (int i = 0; i < group.size(); ++i) {
+            values[i] = block[group[i] * BlockFrames + w];
+        }
+        nth_element(values.begin(), values.begin() + middle, values.end());
+        Sample median = values[middle];
+        if (group.size() % 2 == 0) {
+            median = (Sample) 0.5 * (median + *max_element(values.begin(), values.begin() + middle));
+        }
+        for (int i = 0; i < group.size(); ++i) {
+            block[group[i] * BlockFrames + w] -= median;
+        }
+    }
+}
+
+// Compute each matrix row for the current block.
+void SpatialReference::applyMatrix(int numFrames)
+{
+    typedef SampleVector Vec;
+    Q_UNUSED(numFrames);
+
+    for (int r = 0; r < rowLanes.size(); ++r) {
+        for (int v = 0; v < BlockFrames; v += Vec::Width) {
+            Vec::V sum = Vec::set1(0);
+            for (int term = rowStart[r]; term < rowStart[r + 1]; ++term) {
+                sum = Vec::add(sum, Vec::mul(Vec::set1(termWeights[term]),
+                                             Vec::loadu(block + termLanes[term] * BlockFrames + v)));
+            }
+            Vec::storeu(rowBlock + r * BlockFrames + v, sum);
+        }
+    }
+}
+
+// Matrix rows for bipolar referencing: the first lane of each pair has the
+// second lane subtracted from it.
+QVector<QVector<SpatialReferenceTerm> > SpatialReference::bipolarMatrix(int numLanes, const QVector<QPair<int, int> > &pairs)
+{
+    QVector<QVector<SpatialReferenceTerm> > rows(numLanes);
+    for (int i = 0; i < pairs.size(); ++i) {
+        SpatialReferenceTerm signal = { pairs[i].first, 1.0 };
+        SpatialReferenceTerm reference = { pairs[i].second, -1.0 };
+        rows[pairs[i].first].clear();
+        rows[pairs[i].first].append(signal);
+        rows[pairs[i].first].append(reference);
+    }
+    return rows;
+}
+
+// Matrix rows for a Laplacian montage: each lane, at the given position on the
+// probe, has the mean of its numNeighbors nearest lanes subtracted from it.
+QVector<QVector<SpatialReferenceTerm> > SpatialReference::laplacianMatrix(int numLanes, const QVector<int> &lanes,
+                                                                          const QVector<QPointF> &positions,
+                                                                          int numNeighbors)
+{
+    QVector<QVector<SpatialReferenceTerm> > rows(numLanes);
+    int k = qMin(numNeighbors, lanes.size() - 1);
+    if (k < 1) return rows;
+
+    for (int i = 0; i < lanes.size(); ++i) {
+        QVector<QPair<double, int> > distances;
+        for (int j = 0; j < lanes.size(); ++j) {
+            if (j == i) continue;
+            QPointF d = positions[j] - positions[i];
+            distances.append(qMakePair(d.x() * d.x() + d.y() * d.y(), lanes[j]));
+        }
+        partial_sort(distances.begin(), distances.begin() + k, distances.end());
+
+        SpatialReferenceTerm self = { lanes[i], 1.0 };
+        rows[lanes[i]].append(self);
+        for (int n = 0; n < k; ++n) {
+            SpatialReferenceTerm neighbor = { distances[n].second, -1.0 / k };
+            rows[lanes[i]].append(neighbor);
+        }
+    }
+    return rows;
+}
@@ -0,0 +1,115 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPATIALREFERENCE_H
+#define SPATIALREFERENCE_H
+
+#include <QVector>
+#include <QPair>
+#include <QPointF>
+
+#include "globalconstants.h"
+
+// One term of a re-referencing matrix row: weight times the input on lane.
+struct SpatialReferenceTerm
+{
+    int lane;
+    double weight;
+};
+
+// Spatial re-referencing of multichannel amplifier data.
+//
+// Works in place on time-major data (sample t of lane i at data[t * numLanes + i],
+// the layout of SignalProcessor::amplifierPreFilterFast).  Each channel in a
+// group can be referenced to the group's common average or median, or any
+// set of channels can be replaced by a sparse linear combination of channels
+// (bipolar pairs, Laplacian montages, or an arbitrary matrix).
+//
+// Frames are processed in blocks of BlockFrames time steps, transposed so that
+// each lane's samples are contiguous; every operation is then applied to
+// several time steps at once with SIMD vectors, whatever lanes it involves.
+// Medians of up to 64 channels use a precomputed sorting network pruned to
+// the comparators that affect the median, so a median of 16 or 32 channels
+// costs a few dozen vector min/max operations per block.
+class SpatialReference
+{
+public:
+    enum Mode {
+        ReferenceOff,
+        ReferenceCommonAverage,
+        ReferenceCommonMedian,
+        ReferenceMatrix
+    };
+
+    SpatialReference();
+    ~SpatialReference();
+
+    void setNumLanes(int numLanes_);
+    void setOff();
+    void setGroups(Mode mode_, const QVector<QVector<int> > &groups_);
+    void setMatrix(const QVector<QVector<SpatialReferenceTerm> > &rows);
+    Mode getMode() const;
+
+    void apply(Sample *data, int numFrames);
+
+    static QVector<QVector<SpatialReferenceTerm> > bipolarMatrix(int numLanes, const QVector<QPair<int, int> > &pairs);
+    static QVector<QVector<SpatialReferenceTerm> > laplacianMatrix(int numLanes, const QVector<int> &lanes,
+                                                                   const QVector<QPointF> &positions,
+                                                                   int numNeighbors);
+
+private:
+    // Median of one group: the group's samples are padded with numLowPads
+    // copies of -infinity and numHighPads copies of +infinity to the size of
+    // a sorting network, and the median is found at medianLow (and medianHigh,
+    // if the group has an even number of channels).
+    struct MedianPlan
+    {
+        int networkSize;
+        int numLowPads;
+        int numHighPads;
+        int medianLow;
+        int medianHigh;
+        QVector<int> comparators;   // pairs of positions (low, high)
+    };
+
+    Mode mode;
+    int numLanes;
+    QVector<QVector<int> > groups;
+    QVector<MedianPlan> medianPlans;
+
+    // Matrix rows, in compressed sparse row form.
+    QVector<int> rowLanes;
+    QVector<int> rowStart;
+    QVector<int> termLanes;
+    QVector<Sample> termWeights;
+
+    Sample *block;          // numLanes x BlockFrames, lane-major
+    Sample *rowBlock;       // matrix outputs, or sorting network workspace
+
+    void freeBlocks();
+    void applyCommonAverage(int numFrames);
+    void applyCommonMedian(int numFrames);
+    void applyMatrix(int numFrames);
+    void applyMedianScalar(const QVector<int> &group, int numFrames);
+    static MedianPlan medianPlan(int groupSize);
+};
+
+#endif // SPATIALREFERENCE_H
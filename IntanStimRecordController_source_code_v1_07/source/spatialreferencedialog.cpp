@@ -0,0 +1,154 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "spatialreferencedialog.h"
+
+// Spatial re-referencing dialog.
+// This dialog allows users to reference amplifier channels to the common average
+// or common median of their headstage or port, or to apply a montage read from a
+// text file: bipolar channel pairs, a Laplacian montage computed from electrode
+// positions, or an arbitrary re-referencing matrix.  Changes take effect
+// immediately, without stopping acquisition.
+
+SpatialReferenceDialog::SpatialReferenceDialog(const SpatialReferenceSettings &settings, QWidget *parent) :
+    QDialog(parent)
+{
+    montageComboBox = new QComboBox();
+    montageComboBox->addItem(tr("Off"));
+    montageComboBox->addItem(tr("Common average reference"));
+    montageComboBox->addItem(tr("Common median reference"));
+    montageComboBox->addItem(tr("Bipolar pairs"));
+    montageComboBox->addItem(tr("Laplacian from electrode positions"));
+    montageComboBox->addItem(tr("Custom reference matrix"));
+    montageComboBox->setCurrentIndex(settings.montage);
+
+    groupingComboBox = new QComboBox();
+    groupingComboBox->addItem(tr("Each headstage"));
+    groupingComboBox->addItem(tr("Each port"));
+    groupingComboBox->setCurrentIndex(settings.grouping);
+
+    fileLineEdit = new QLineEdit(settings.fileName);
+    browseButton = new QPushButton(tr("Browse..."));
+
+    neighborsSpinBox = new QSpinBox();
+    neighborsSpinBox->setRange(1, 8);
+    neighborsSpinBox->setValue(settings.numNeighbors);
+
+    formatLabel = new QLabel();
+    formatLabel->setWordWrap(true);
+
+    connect(montageComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateControls()));
+    connect(fileLineEdit, SIGNAL(textChanged(const QString &)), this, SLOT(updateControls()));
+    connect(browseButton, SIGNAL(clicked()), this, SLOT(browse()));
+
+    QHBoxLayout *fileLayout = new QHBoxLayout();
+    fileLayout->addWidget(fileLineEdit);
+    fileLayout->addWidget(browseButton);
+
+    QFormLayout *formLayout = new QFormLayout();
+    formLayout->addRow(tr("Montage"), montageComboBox);
+    formLayout->addRow(tr("Reference group"), groupingComboBox);
+    formLayout->addRow(tr("Montage file"), fileLayout);
+    formLayout->addRow(tr("Nearest neighbors"), neighborsSpinBox);
+
+    QLabel *noteLabel = new QLabel(tr("Re-referencing is applied to all amplifier channels before the software "
+                                      "filters, and affects displayed waveforms and filtered outputs.  Saved "
+                                      "data and the channel selected under Reference Selection are not affected.  "
+                                      "Common references include the amplifier channels that are enabled when "
+                                      "OK is clicked."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(formatLabel);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Spatial Re-Referencing"));
+
+    updateControls();
+}
+
+// Enable the controls that apply to the selected montage and describe the
+// format of its montage file.
+void SpatialReferenceDialog::updateControls()
+{
+    SpatialMontage montage = (SpatialMontage) montageComboBox->currentIndex();
+    bool usesFile = (montage == MontageBipolar || montage == MontageLaplacian || montage == MontageCustom);
+
+    groupingComboBox->setEnabled(montage == MontageCommonAverage || montage == MontageCommonMedian);
+    fileLineEdit->setEnabled(usesFile);
+    browseButton->setEnabled(usesFile);
+    neighborsSpinBox->setEnabled(montage == MontageLaplacian);
+
+    switch (montage) {
+    case MontageBipolar:
+        formatLabel->setText(tr("Each line of the montage file names a channel and the channel subtracted "
+                                "from it, e.g. \"A-001 A-000\".  Text after # is ignored."));
+        break;
+    case MontageLaplacian:
+        formatLabel->setText(tr("Each line of the montage file gives a channel and its electrode position, "
+                                "e.g. \"A-000 0 25\".  Each listed channel has the mean of its nearest "
+                                "listed neighbors subtracted from it.  Text after # is ignored."));
+        break;
+    case MontageCustom:
+        formatLabel->setText(tr("Each line of the montage file gives an output channel, an input channel, "
+                                "and a weight, e.g. \"A-000 A-001 -0.5\".  Each output channel is replaced "
+                                "by the weighted sum of its inputs.  Text after # is ignored."));
+        break;
+    default:
+        formatLabel->setText("");
+        break;
+    }
+
+    buttonBox->button(QDialogButtonBox::Ok)->setEnabled(!usesFile || !fileLineEdit->text().isEmpty());
+}
+
+void SpatialReferenceDialog::browse()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Select Montage File"), fileLineEdit->text(),
+                                                    tr("Text files (*.txt);;All files (*)"));
+    if (!fileName.isEmpty()) {
+        fileLineEdit->setText(fileName);
+    }
+}
+
+SpatialReferenceSettings SpatialReferenceDialog::getSettings() const
+{
+    SpatialReferenceSettings settings;
+    settings.montage = (SpatialMontage) montageComboBox->currentIndex();
+    settings.grouping = (SpatialGrouping) groupingComboBox->currentIndex();
+    settings.fileName = fileLineEdit->text();
+    settings.numNeighbors = neighborsSpinBox->value();
+    return settings;
+}
@@ -0,0 +1,85 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPATIALREFERENCEDIALOG_H
+#define SPATIALREFERENCEDIALOG_H
+
+#include <QDialog>
+#include <QString>
+
+class QDialogButtonBox;
+class QComboBox;
+class QLineEdit;
+class QPushButton;
+class QSpinBox;
+class QLabel;
+
+// Spatial re-referencing montage selected by the user.
+enum SpatialMontage {
+    MontageOff,
+    MontageCommonAverage,
+    MontageCommonMedian,
+    MontageBipolar,
+    MontageLaplacian,
+    MontageCustom
+};
+
+// Channels referenced together by common average or common median referencing.
+enum SpatialGrouping {
+    GroupByHeadstage,
+    GroupByPort
+};
+
+struct SpatialReferenceSettings
+{
+    SpatialMontage montage;
+    SpatialGrouping grouping;
+    QString fileName;       // pair, geometry, or matrix file
+    int numNeighbors;       // Laplacian montage only
+};
+
+class SpatialReferenceDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit SpatialReferenceDialog(const SpatialReferenceSettings &settings, QWidget *parent);
+
+    SpatialReferenceSettings getSettings() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateControls();
+    void browse();
+
+private:
+    QComboBox *montageComboBox;
+    QComboBox *groupingComboBox;
+    QLineEdit *fileLineEdit;
+    QPushButton *browseButton;
+    QSpinBox *neighborsSpinBox;
+    QLabel *formatLabel;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // SPATIALREFERENCEDIALOG_H
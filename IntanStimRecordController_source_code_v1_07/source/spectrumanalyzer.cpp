@@ -0,0 +1,337 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <QMutexLocker>
+#include <cstring>
+#include <cmath>
+
+#include "spectrumanalyzer.h"
+#include "filterbank.h"
+#include "realfft.h"
+
+// Frames of input filtered at a time.
+static const int AnalysisChunkFrames = 4096;
+
+// Constructor.
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent) :
+    QThread(parent)
+{
+    stopping = false;
+    numLanes = 0;
+    sampleRate = 30000.0;
+    segmentLength = 1024;
+    decimation = 1;
+    numAveraged = 1;
+    refreshMsec = 250;
+    inputCapacity = 0;
+    inputFrames = 0;
+    inputGap.storeRelease(0);
+    droppedFrames = 0;
+    antiAliasFilter = new FilterBank();
+    fft = nullptr;
+    densityScale = 1.0;
+    historyPosition = 0;
+    historyFill = 0;
+    framesSinceSegment = 0;
+    decimationPhase = 0;
+    numAverageSegments = 0;
+    numSegments = 0;
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    stop();
+    wait();
+    delete antiAliasFilter;
+    delete fft;
+}
+
+// Ask the analysis thread to finish.
+void SpectrumAnalyzer::stop()
+{
+    waitMutex.lock();
+    stopping = true;
+    wakeCondition.wakeAll();
+    waitMutex.unlock();
+}
+
+// Set up analysis of numLanes lanes sampled at sampleRate.  segmentLength (a
+// power of two) is counted in decimated samples.  Clears all spectra.
+void SpectrumAnalyzer::configure(int numLanes_, double sampleRate_, int segmentLength_, int decimation_,
+                                 int numAveraged_, int refreshMsec_)
+{
+    QMutexLocker analysisLocker(&analysisMutex);
+
+    numLanes = numLanes_;
+    sampleRate = sampleRate_;
+    segmentLength = RealFft::isPowerOfTwo(segmentLength_) ? qMax(segmentLength_, 4) : 1024;
+    decimation = qMax(1, decimation_);
+    numAveraged = qMax(1, numAveraged_);
+    refreshMsec = qMax(10, refreshMsec_);
+
+    // Anti-aliasing filter ahead of decimation.
+    antiAliasFilter->setNumLanes(numLanes, AnalysisChunkFrames);
+    QVector<FilterBankBand> bands;
+    if (decimation > 1) {
+        FilterBankBand band;
+        band.name = "Anti-alias";
+        band.spec.prototype = FilterButterworth;
+        band.spec.response = FilterLowpass;
+        band.spec.order = 8;
+        band.spec.lowCutoff = 0.0;
+        band.spec.highCutoff = 0.4 * sampleRate / decimation;
+        band.spec.passbandRipple = 0.1;
+        band.spec.stopbandAttenuation = 60.0;
+        bands.append(band);
+    }
+    antiAliasFilter->setBands(bands, sampleRate);
+
+    delete fft;
+    fft = new RealFft(segmentLength);
+
+    // Hann window, and the scale factor from squared FFT magnitude to density.
+    window.resize(segmentLength);
+    double windowPower = 0.0;
+    for (int i = 0; i < segmentLength; ++i) {
+        window[i] = 0.5 - 0.5 * cos(TWO_PI * i / segmentLength);
+        windowPower += window[i] * window[i];
+    }
+    densityScale = 1.0 / (windowPower * sampleRate / decimation);
+
+    history.resize(numLanes * segmentLength);
+    history.fill(0.0);
+    historyPosition = 0;
+    historyFill = 0;
+    framesSinceSegment = 0;
+    decimationPhase = 0;
+    segment.resize(segmentLength);
+    power.resize(fft->numBins());
+
+    inputMutex.lock();
+    inputCapacity = qMax(AnalysisChunkFrames, (int) (2.0 * sampleRate * refreshMsec / 1000.0));
+    inputBuffer.resize(inputCapacity * numLanes);
+    inputFrames = 0;
+    inputGap.storeRelease(0);
+    droppedFrames = 0;
+    inputMutex.unlock();
+    workBuffer.resize(inputCapacity * numLanes);
+
+    resultMutex.lock();
+    averageSpectra.clear();
+    averageSpectra.resize(numLanes);
+    latestSpectra.clear();
+    latestSpectra.resize(numLanes);
+    numAverageSegments = 0;
+    numSegments = 0;
+    resultMutex.unlock();
+}
+
+// Queue numFrames frames of time-major data for analysis.  Never blocks: if the
+// analysis thread is using the input buffer, or the buffer is full, the data
+// are dropped and the next segment starts afresh.  Must be called from the
+// thread that calls configure().
+void SpectrumAnalyzer::addData(const Sample *data, int numFrames)
+{
+    if (!inputMutex.tryLock()) {
+        droppedFrames += numFrames;
+        inputGap.storeRelease(1);
+        return;
+    }
+    if (numLanes == 0 || inputFrames + numFrames > inputCapacity) {
+        droppedFrames += numFrames;
+        inputGap.storeRelease(1);
+    } else {
+        memcpy(inputBuffer.data() + inputFrames * numLanes, data, numFrames * numLanes * sizeof(Sample));
+        inputFrames += numFrames;
+    }
+    inputMutex.unlock();
+}
+
+// Queue numFrames frames of time-major raw amplifier data, given as signed ADC
+// codes, converting them to microvolts.  As addData() above.
+void SpectrumAnalyzer::addData(const qint16 *codes, int numFrames)
+{
+    if (!inputMutex.tryLock()) {
+        droppedFrames += numFrames;
+        inputGap.storeRelease(1);
+        return;
+    }
+    if (numLanes == 0 || inputFrames + numFrames > inputCapacity) {
+        droppedFrames += numFrames;
+        inputGap.storeRelease(1);
+    } else {
+        Sample *dst = inputBuffer.data() + inputFrames * numLanes;
+        const Sample scale = (Sample) AMPLIFIER_MICROVOLTS_PER_BIT;
+        for (int i = 0; i < numFrames * numLanes; ++i) {
+            dst[i] = scale * codes[i];
+        }
+        inputFrames += numFrames;
+    }
+    inputMutex.unlock();
+}
+
+void SpectrumAnalyzer::run()
+{
+    while (!stopping) {
+        waitMutex.lock();
+        if (!stopping) {
+            wakeCondition.wait(&waitMutex, refreshMsec);
+        }
+        waitMutex.unlock();
+        if (stopping) break;
+
+        QMutexLocker analysisLocker(&analysisMutex);
+
+        // Swap buffers rather than copying, so addData() is locked out only briefly.
+        inputMutex.lock();
+        int numFrames = inputFrames;
+        inputBuffer.swap(workBuffer);
+        inputFrames = 0;
+        inputMutex.unlock();
+        bool gap = inputGap.fetchAndStoreAcquire(0) != 0;
+
+        if (gap) {
+            historyFill = 0;
+            framesSinceSegment = 0;
+        }
+        for (int start = 0; start < numFrames; start += AnalysisChunkFrames) {
+            processInput(workBuffer.constData() + start * numLanes, qMin(AnalysisChunkFrames, numFrames - start));
+        }
+    }
+}
+
+// Filter, decimate, and append frames to the segment history, analyzing a new
+// segment every half segment length.
+void SpectrumAnalyzer::processInput(const Sample *data, int numFrames)
+{
+    const Sample *decimationInput = data;
+    if (decimation > 1) {
+        antiAliasFilter->filter(data, numFrames, 0, numLanes);
+        decimationInput = antiAliasFilter->getOutput(0);
+    }
+
+    int t;
+    for (t = decimationPhase; t < numFrames; t += decimation) {
+        const Sample *frame = decimationInput + t * numLanes;
+        double *column = history.data() + historyPosition;
+        for (int lane = 0; lane < numLanes; ++lane) {
+            column[lane * segmentLength] = frame[lane];
+        }
+        historyPosition = (historyPosition + 1) % segmentLength;
+        if (historyFill < segmentLength) ++historyFill;
+        ++framesSinceSegment;
+
+        if (historyFill == segmentLength && framesSinceSegment >= segmentLength / 2) {
+            analyzeSegments();
+            framesSinceSegment = 0;
+        }
+    }
+    decimationPhase = t - numFrames;
+}
+
+// Compute the spectrum of the latest segment of every lane, and fold it into
+// the running averages.
+void SpectrumAnalyzer::analyzeSegments()
+{
+    int numBins = fft->numBins();
+    QVector<QVector<double> > spectra(numLanes);
+
+    for (int lane = 0; lane < numLanes; ++lane) {
+        const double *laneHistory = history.constData() + lane * segmentLength;
+
+        // Oldest sample first; remove the mean so DC leakage does not mask low frequencies.
+        double mean = 0.0;
+        for (int i = 0; i < segmentLength; ++i) mean += laneHistory[i];
+        mean /= segmentLength;
+        for (int i = 0; i < segmentLength; ++i) {
+            segment[i] = (laneHistory[(historyPosition + i) % segmentLength] - mean) * window[i];
+        }
+        fft->powerSpectrum(segment.constData(), power.data());
+
+        spectra[lane].resize(numBins);
+        for (int k = 0; k < numBins; ++k) {
+            double onesided = (k == 0 || k == numBins - 1) ? 1.0 : 2.0;
+            spectra[lane][k] = onesided * densityScale * power[k];
+        }
+    }
+
+    QMutexLocker resultLocker(&resultMutex);
+    if (numAverageSegments < numAveraged) ++numAverageSegments;
+    for (int lane = 0; lane < numLanes; ++lane) {
+        QVector<double> &average = averageSpectra[lane];
+        if (average.size() != numBins) {
+            average = spectra[lane];
+        } else {
+            for (int k = 0; k < numBins; ++k) {
+                average[k] += (spectra[lane][k] - average[k]) / numAverageSegments;
+            }
+        }
+    }
+    latestSpectra = spectra;
+    ++numSegments;
+}
+
+int SpectrumAnalyzer::getNumLanes() const
+{
+    return numLanes;
+}
+
+int SpectrumAnalyzer::getNumBins() const
+{
+    return segmentLength / 2 + 1;
+}
+
+// Frequency spacing of spectrum bins, in Hz.
+double SpectrumAnalyzer::getBinWidth() const
+{
+    return sampleRate / (decimation * segmentLength);
+}
+
+// Number of segments analyzed since the last call to configure().
+quint64 SpectrumAnalyzer::getNumSegments() const
+{
+    QMutexLocker resultLocker(&resultMutex);
+    return numSegments;
+}
+
+qint64 SpectrumAnalyzer::getDroppedFrames() const
+{
+    return droppedFrames;
+}
+
+// Running average spectrum of one lane.  Returns false if no segment has been analyzed yet.
+bool SpectrumAnalyzer::getAverageSpectrum(int lane, QVector<double> &psd) const
+{
+    QMutexLocker resultLocker(&resultMutex);
+    if (lane < 0 || lane >= averageSpectra.size() || averageSpectra[lane].isEmpty()) return false;
+    psd = averageSpectra[lane];
+    return true;
+}
+
+// Spectrum of the latest segment of one lane.  Returns false if no segment has been analyzed yet.
+bool SpectrumAnalyzer::getLatestSpectrum(int lane, QVector<double> &psd) const
+{
+    QMutexLocker resultLocker(&resultMutex);
+    if (lane < 0 || lane >= latestSpectra.size() || latestSpectra[lane].isEmpty()) return false;
+    psd = latestSpectra[lane];
+    return true;
+}
@@ -0,0 +1,119 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QVector>
+
+#include "globalconstants.h"
+
+class FilterBank;
+class RealFft;
+
+// Rolling Welch power spectral density estimates for every amplifier channel,
+// computed in a background thread.
+//
+// The acquisition thread passes each block of time-major amplifier data to
+// addData(), which only copies it into an input buffer; if the buffer is busy
+// or full the block is dropped, so acquisition never waits for analysis.  The
+// analysis thread wakes every refresh period, low-pass filters and decimates
+// the new data, and for every hop of half a segment computes a Hann-windowed
+// power spectrum of the latest segment of each channel with a planned real
+// FFT.  Each channel keeps the latest segment's spectrum (for spectrograms)
+// and a running average over the last numAveraged segments.  CPU use is
+// bounded by the decimation factor, which reduces the rate of segments, and
+// by the refresh period.  Spectra are one-sided densities in uV^2/Hz.
+class SpectrumAnalyzer : public QThread
+{
+    Q_OBJECT
+public:
+    explicit SpectrumAnalyzer(QObject *parent = 0);
+    ~SpectrumAnalyzer();
+
+    void run() override;
+    void stop();
+
+    void configure(int numLanes_, double sampleRate_, int segmentLength_, int decimation_,
+                   int numAveraged_, int refreshMsec_);
+    void addData(const Sample *data, int numFrames);
+    void addData(const qint16 *codes, int numFrames);
+
+    int getNumLanes() const;
+    int getNumBins() const;
+    double getBinWidth() const;
+    quint64 getNumSegments() const;
+    qint64 getDroppedFrames() const;
+    bool getAverageSpectrum(int lane, QVector<double> &psd) const;
+    bool getLatestSpectrum(int lane, QVector<double> &psd) const;
+
+private:
+    volatile bool stopping;
+    QMutex waitMutex;
+    QWaitCondition wakeCondition;
+
+    // Held by the analysis thread while processing, and by configure().
+    QMutex analysisMutex;
+    int numLanes;
+    double sampleRate;
+    int segmentLength;
+    int decimation;
+    int numAveraged;
+    int refreshMsec;
+
+    // Input buffer, written by addData() and read by the analysis thread.
+    QMutex inputMutex;
+    QVector<Sample> inputBuffer;
+    int inputCapacity;
+    int inputFrames;
+    QAtomicInt inputGap;        // set when input has been dropped
+    qint64 droppedFrames;
+
+    // Analysis state, used only by the analysis thread.
+    QVector<Sample> workBuffer;
+    FilterBank *antiAliasFilter;
+    RealFft *fft;
+    QVector<double> window;
+    double densityScale;
+    QVector<double> history;        // segmentLength samples per lane, circular
+    int historyPosition;
+    int historyFill;
+    int framesSinceSegment;
+    int decimationPhase;
+    QVector<double> segment;
+    QVector<double> power;
+
+    // Results, read by the GUI thread.
+    mutable QMutex resultMutex;
+    QVector<QVector<double> > averageSpectra;
+    QVector<QVector<double> > latestSpectra;
+    int numAverageSegments;
+    quint64 numSegments;
+
+    void processInput(const Sample *data, int numFrames);
+    void analyzeSegments();
+};
+
+#endif // SPECTRUMANALYZER_H
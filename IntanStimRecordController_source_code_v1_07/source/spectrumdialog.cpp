@@ -0,0 +1,294 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+#include <iostream>
+
+#include "globalconstants.h"
+#include "spectrumdialog.h"
+#include "spectrumanalyzer.h"
+#include "spectrumplot.h"
+#include "signalprocessor.h"
+#include "signalsources.h"
+#include "signalchannel.h"
+#include "rhs2000datablock.h"
+
+using namespace std;
+
+// Spectrum dialog.
+// This dialog shows the power spectral density and spectrogram of the selected
+// amplifier channel, for checking line noise and electrode quality while
+// recording.  Spectra of all amplifier channels are computed in a background
+// thread (see SpectrumAnalyzer) while the dialog is visible, and the averaged
+// spectra of all enabled channels can be exported to a CSV file.
+
+SpectrumDialog::SpectrumDialog(SignalProcessor *inSignalProcessor, SignalSources *inSignalSources,
+                               SignalChannel *initialChannel, QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle(tr("Spectrum"));
+
+    signalProcessor = inSignalProcessor;
+    signalSources = inSignalSources;
+    currentChannel = initialChannel;
+    sampleRate = 30000.0;
+    lastSegment = 0;
+
+    analyzer = new SpectrumAnalyzer();
+    spectrumPlot = new SpectrumPlot(this);
+    refreshTimer = new QTimer(this);
+
+    sourceComboBox = new QComboBox();
+    sourceComboBox->addItem(tr("Filtered (as displayed)"));
+    sourceComboBox->addItem(tr("Before notch and high-pass filters"));
+
+    segmentComboBox = new QComboBox();
+    segmentComboBox->addItem("256", 256);
+    segmentComboBox->addItem("512", 512);
+    segmentComboBox->addItem("1024", 1024);
+    segmentComboBox->addItem("2048", 2048);
+    segmentComboBox->addItem("4096", 4096);
+    segmentComboBox->setCurrentIndex(2);
+
+    decimationComboBox = new QComboBox();
+    decimationComboBox->addItem(tr("None"), 1);
+    decimationComboBox->addItem("2", 2);
+    decimationComboBox->addItem("4", 4);
+    decimationComboBox->addItem("8", 8);
+    decimationComboBox->addItem("16", 16);
+    decimationComboBox->setCurrentIndex(0);
+
+    refreshComboBox = new QComboBox();
+    refreshComboBox->addItem("100 ms", 100);
+    refreshComboBox->addItem("250 ms", 250);
+    refreshComboBox->addItem("500 ms", 500);
+    refreshComboBox->addItem("1 s", 1000);
+    refreshComboBox->setCurrentIndex(1);
+
+    averageSpinBox = new QSpinBox();
+    averageSpinBox->setRange(1, 1000);
+    averageSpinBox->setValue(20);
+
+    topSpinBox = new QSpinBox();
+    topSpinBox->setRange(-60, 100);
+    topSpinBox->setSingleStep(10);
+    topSpinBox->setValue(40);
+    topSpinBox->setSuffix(" dB");
+
+    rangeSpinBox = new QSpinBox();
+    rangeSpinBox->setRange(20, 160);
+    rangeSpinBox->setSingleStep(10);
+    rangeSpinBox->setValue(80);
+    rangeSpinBox->setSuffix(" dB");
+
+    exportButton = new QPushButton(tr("Export Spectra..."));
+    statusLabel = new QLabel();
+
+    connect(sourceComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(reconfigure()));
+    connect(segmentComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(reconfigure()));
+    connect(decimationComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(reconfigure()));
+    connect(refreshComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(reconfigure()));
+    connect(averageSpinBox, SIGNAL(editingFinished()), this, SLOT(reconfigure()));
+    connect(topSpinBox, SIGNAL(valueChanged(int)), this, SLOT(changeDecibelRange()));
+    connect(rangeSpinBox, SIGNAL(valueChanged(int)), this, SLOT(changeDecibelRange()));
+    connect(exportButton, SIGNAL(clicked()), this, SLOT(exportSpectra()));
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+
+    QFormLayout *analysisLayout = new QFormLayout();
+    analysisLayout->addRow(tr("Data"), sourceComboBox);
+    analysisLayout->addRow(tr("Segment length"), segmentComboBox);
+    analysisLayout->addRow(tr("Decimation"), decimationComboBox);
+    analysisLayout->addRow(tr("Segments averaged"), averageSpinBox);
+    analysisLayout->addRow(tr("Refresh"), refreshComboBox);
+
+    QGroupBox *analysisGroupBox = new QGroupBox(tr("Analysis"));
+    analysisGroupBox->setLayout(analysisLayout);
+
+    QFormLayout *displayLayout = new QFormLayout();
+    displayLayout->addRow(tr("Top"), topSpinBox);
+    displayLayout->addRow(tr("Range"), rangeSpinBox);
+
+    QGroupBox *displayGroupBox = new QGroupBox(tr("Display"));
+    displayGroupBox->setLayout(displayLayout);
+
+    statusLabel->setWordWrap(true);
+
+    QVBoxLayout *leftLayout = new QVBoxLayout;
+    leftLayout->addWidget(analysisGroupBox);
+    leftLayout->addWidget(displayGroupBox);
+    leftLayout->addWidget(exportButton);
+    leftLayout->addWidget(statusLabel);
+    leftLayout->addStretch(1);
+
+    QHBoxLayout *mainLayout = new QHBoxLayout;
+    mainLayout->addLayout(leftLayout);
+    mainLayout->addWidget(spectrumPlot);
+    mainLayout->setStretch(1, 1);
+
+    setLayout(mainLayout);
+
+    setNewChannel(initialChannel);
+    changeDecibelRange();
+    analyzer->start(QThread::LowPriority);
+    reconfigure();
+}
+
+SpectrumDialog::~SpectrumDialog()
+{
+    delete analyzer;
+}
+
+void SpectrumDialog::setSampleRate(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reconfigure();
+}
+
+// Restart analysis with the current settings.
+void SpectrumDialog::reconfigure()
+{
+    int refreshMsec = refreshComboBox->itemData(refreshComboBox->currentIndex()).toInt();
+    analyzer->configure(signalProcessor->getNumAmplifierLanes(), sampleRate,
+                        segmentComboBox->itemData(segmentComboBox->currentIndex()).toInt(),
+                        decimationComboBox->itemData(decimationComboBox->currentIndex()).toInt(),
+                        averageSpinBox->value(), refreshMsec);
+    refreshTimer->start(refreshMsec);
+    lastSegment = 0;
+    spectrumPlot->clear();
+}
+
+// Pass new amplifier data to the analyzer.  Called after each call to
+// SignalProcessor::filterData(); does nothing while the dialog is hidden.
+void SpectrumDialog::updateData(int numBlocks)
+{
+    if (!isVisible()) return;
+
+    if (analyzer->getNumLanes() != signalProcessor->getNumAmplifierLanes()) {
+        reconfigure();
+    }
+    if (sourceComboBox->currentIndex() == 0) {
+        analyzer->addData(signalProcessor->getFilteredDataFast(), SAMPLES_PER_DATA_BLOCK * numBlocks);
+    } else {
+        analyzer->addData(signalProcessor->amplifierPreFilterFast, SAMPLES_PER_DATA_BLOCK * numBlocks);
+    }
+}
+
+void SpectrumDialog::setNewChannel(SignalChannel *newChannel)
+{
+    currentChannel = newChannel;
+    if (currentChannel && currentChannel->signalType == AmplifierSignal) {
+        spectrumPlot->setChannelName(currentChannel->nativeChannelName + " (" + currentChannel->customChannelName + ")");
+    } else {
+        spectrumPlot->setChannelName(tr("ONLY AMPLIFIER CHANNELS CAN BE DISPLAYED"));
+    }
+    spectrumPlot->clear();
+    lastSegment = 0;
+}
+
+// Lane of the selected channel, or -1 if it is not an amplifier channel.
+int SpectrumDialog::currentLane() const
+{
+    if (!currentChannel || currentChannel->signalType != AmplifierSignal) return -1;
+    return signalProcessor->amplifierLane(currentChannel->boardStream, currentChannel->chipChannel);
+}
+
+// Show any newly analyzed spectra of the selected channel.
+void SpectrumDialog::refresh()
+{
+    statusLabel->setText(tr("Resolution ") + QString::number(analyzer->getBinWidth(), 'f', 2) + " Hz\n" +
+                         tr("Range 0 - ") + QString::number(analyzer->getBinWidth() * (analyzer->getNumBins() - 1), 'f', 0) +
+                         " Hz\n" + tr("Dropped ") + QString::number(analyzer->getDroppedFrames()) + tr(" samples"));
+
+    quint64 numSegments = analyzer->getNumSegments();
+    if (numSegments == lastSegment) return;
+    lastSegment = numSegments;
+
+    int lane = currentLane();
+    QVector<double> psd;
+    if (analyzer->getAverageSpectrum(lane, psd)) {
+        spectrumPlot->setSpectrum(psd, analyzer->getBinWidth());
+    }
+    if (analyzer->getLatestSpectrum(lane, psd)) {
+        spectrumPlot->addSpectrogramColumn(psd);
+    }
+}
+
+void SpectrumDialog::changeDecibelRange()
+{
+    spectrumPlot->setDecibelRange(topSpinBox->value(), rangeSpinBox->value());
+}
+
+// Write the averaged spectra of all enabled amplifier channels to a CSV file,
+// one row per frequency bin and one column per channel.
+void SpectrumDialog::exportSpectra()
+{
+    QString csvFileName = QFileDialog::getSaveFileName(this, tr("Export Spectra As"), ".",
+                                                       tr("CSV (Comma delimited) (*.csv)"));
+    if (csvFileName.isEmpty()) return;
+
+    QVector<SignalChannel*> channels;
+    QVector<QVector<double> > spectra;
+    int numStreams = signalProcessor->getNumAmplifierLanes() / CHANNELS_PER_STREAM;
+    for (int stream = 0; stream < numStreams; ++stream) {
+        for (int channel = 0; channel < CHANNELS_PER_STREAM; ++channel) {
+            SignalChannel *signalChannel = signalSources->findAmplifierChannel(stream, channel);
+            QVector<double> psd;
+            if (signalChannel && signalChannel->enabled &&
+                    analyzer->getAverageSpectrum(signalProcessor->amplifierLane(stream, channel), psd)) {
+                channels.append(signalChannel);
+                spectra.append(psd);
+            }
+        }
+    }
+    if (spectra.isEmpty()) {
+        QMessageBox::warning(this, tr("Export Spectra"), tr("No spectra have been computed yet."));
+        return;
+    }
+
+    QFile csvFile(csvFileName);
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        cerr << "Cannot open CSV file for writing: " <<
+                qPrintable(csvFile.errorString()) << endl;
+        return;
+    }
+    QTextStream out(&csvFile);
+
+    out << "Frequency (Hz)";
+    for (int i = 0; i < channels.size(); ++i) {
+        out << "," << channels[i]->nativeChannelName << " PSD (uV^2/Hz)";
+    }
+    out << endl;
+
+    out.setRealNumberNotation(QTextStream::ScientificNotation);
+    out.setRealNumberPrecision(4);
+    double binWidth = analyzer->getBinWidth();
+    for (int k = 0; k < spectra[0].size(); ++k) {
+        out << k * binWidth;
+        for (int i = 0; i < spectra.size(); ++i) {
+            out << "," << spectra[i][k];
+        }
+        out << endl;
+    }
+    csvFile.close();
+}
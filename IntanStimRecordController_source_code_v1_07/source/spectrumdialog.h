@@ -0,0 +1,83 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPECTRUMDIALOG_H
+#define SPECTRUMDIALOG_H
+
+#include <QDialog>
+
+class QComboBox;
+class QSpinBox;
+class QPushButton;
+class QLabel;
+class QTimer;
+class SignalProcessor;
+class SignalSources;
+class SignalChannel;
+class SpectrumAnalyzer;
+class SpectrumPlot;
+
+class SpectrumDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit SpectrumDialog(SignalProcessor *inSignalProcessor, SignalSources *inSignalSources,
+                            SignalChannel *initialChannel, QWidget *parent = 0);
+    ~SpectrumDialog();
+
+    void setSampleRate(double newSampleRate);
+    void updateData(int numBlocks);
+    void setNewChannel(SignalChannel *newChannel);
+
+signals:
+
+public slots:
+
+private slots:
+    void reconfigure();
+    void refresh();
+    void changeDecibelRange();
+    void exportSpectra();
+
+private:
+    SignalProcessor *signalProcessor;
+    SignalSources *signalSources;
+    SignalChannel *currentChannel;
+    SpectrumAnalyzer *analyzer;
+    SpectrumPlot *spectrumPlot;
+    QTimer *refreshTimer;
+    double sampleRate;
+    quint64 lastSegment;
+
+    QComboBox *sourceComboBox;
+    QComboBox *segmentComboBox;
+    QComboBox *decimationComboBox;
+    QComboBox *refreshComboBox;
+    QSpinBox *averageSpinBox;
+    QSpinBox *topSpinBox;
+    QSpinBox *rangeSpinBox;
+    QPushButton *exportButton;
+    QLabel *statusLabel;
+
+    int currentLane() const;
+};
+
+#endif // SPECTRUMDIALOG_H
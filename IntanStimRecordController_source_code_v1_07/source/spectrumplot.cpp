@@ -0,0 +1,188 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+#include <cmath>
+#include <cstring>
+
+#include "globalconstants.h"
+#include "spectrumplot.h"
+
+// Spectrum plot widget.
+// Draws the averaged power spectral density of the selected channel on a dB
+// scale, and below it a spectrogram in which each column is the spectrum of
+// one recent segment, with time increasing to the right.
+
+SpectrumPlot::SpectrumPlot(QWidget *parent) :
+    QWidget(parent)
+{
+    setBackgroundRole(QPalette::Window);
+    setAutoFillBackground(true);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+
+    binWidth = 1.0;
+    topDecibels = 40.0;
+    rangeDecibels = 60.0;
+    spectrogramColumn = 0;
+}
+
+QSize SpectrumPlot::minimumSizeHint() const
+{
+    return QSize(SPECTRUMPLOT_X_SIZE, SPECTRUMPLOT_Y_SIZE);
+}
+
+QSize SpectrumPlot::sizeHint() const
+{
+    return QSize(SPECTRUMPLOT_X_SIZE, SPECTRUMPLOT_Y_SIZE);
+}
+
+void SpectrumPlot::setChannelName(const QString &name)
+{
+    channelName = name;
+    update();
+}
+
+// Set the dB scale: top is the level at the top of the plot, range the span shown.
+void SpectrumPlot::setDecibelRange(double top, double range)
+{
+    topDecibels = top;
+    rangeDecibels = range;
+    update();
+}
+
+// Clear the spectrum and spectrogram (e.g., when the channel or analysis settings change).
+void SpectrumPlot::clear()
+{
+    spectrum.clear();
+    spectrogram = QImage();
+    spectrogramColumn = 0;
+    update();
+}
+
+void SpectrumPlot::setSpectrum(const QVector<double> &psd, double binWidth_)
+{
+    spectrum = psd;
+    binWidth = binWidth_;
+    update();
+}
+
+// Append one spectrum as the newest spectrogram column, one pixel row per bin
+// with low frequencies at the bottom.
+void SpectrumPlot::addSpectrogramColumn(const QVector<double> &psd)
+{
+    if (spectrogram.height() != psd.size()) {
+        spectrogram = QImage(SPECTROGRAM_NUM_COLUMNS, psd.size(), QImage::Format_RGB32);
+        spectrogram.fill(Qt::black);
+        spectrogramColumn = 0;
+    }
+
+    // Scroll left once the image is full.
+    if (spectrogramColumn == SPECTROGRAM_NUM_COLUMNS) {
+        for (int y = 0; y < spectrogram.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(spectrogram.scanLine(y));
+            memmove(line, line + 1, (SPECTROGRAM_NUM_COLUMNS - 1) * sizeof(QRgb));
+        }
+        --spectrogramColumn;
+    }
+    for (int k = 0; k < psd.size(); ++k) {
+        spectrogram.setPixel(spectrogramColumn, psd.size() - 1 - k, colorOf(10.0 * log10(psd[k] + 1.0e-30)));
+    }
+    ++spectrogramColumn;
+    update();
+}
+
+// Spectrogram color: black through red and yellow to white over the dB range.
+QRgb SpectrumPlot::colorOf(double decibels) const
+{
+    double x = (decibels - (topDecibels - rangeDecibels)) / rangeDecibels;
+    x = qBound(0.0, x, 1.0);
+    int red = qBound(0, (int) (255 * 3.0 * x), 255);
+    int green = qBound(0, (int) (255 * (3.0 * x - 1.0)), 255);
+    int blue = qBound(0, (int) (255 * (3.0 * x - 2.0)), 255);
+    return qRgb(red, green, blue);
+}
+
+void SpectrumPlot::paintEvent(QPaintEvent * /* event */)
+{
+    QPainter painter(this);
+    const int textHeight = painter.fontMetrics().height();
+    const int textWidth = painter.fontMetrics().width("-000 dB");
+
+    QRect psdFrame(textWidth + 8, textHeight + 4, width() - textWidth - 16, (height() - 3 * textHeight) * 11 / 20);
+    QRect gramFrame(psdFrame.left(), psdFrame.bottom() + 2 * textHeight + 4, psdFrame.width(),
+                    height() - psdFrame.bottom() - 3 * textHeight - 8);
+
+    painter.fillRect(rect(), Qt::white);
+    painter.setPen(Qt::darkGray);
+    painter.drawRect(psdFrame);
+    painter.drawText(psdFrame.left(), 0, psdFrame.width(), textHeight, Qt::AlignLeft | Qt::AlignTop,
+                     channelName + tr("  Power spectral density (dB re 1 ") + QSTRING_MU_SYMBOL + "V" +
+                     QChar(0x00b2) + "/Hz)");
+
+    // Horizontal grid lines every 10 dB.
+    for (double db = topDecibels; db >= topDecibels - rangeDecibels; db -= 10.0) {
+        int y = psdFrame.top() + (int) ((topDecibels - db) / rangeDecibels * psdFrame.height());
+        painter.setPen(Qt::lightGray);
+        painter.drawLine(psdFrame.left(), y, psdFrame.right(), y);
+        painter.setPen(Qt::darkGray);
+        painter.drawText(0, y - textHeight / 2, textWidth + 4, textHeight, Qt::AlignRight | Qt::AlignVCenter,
+                         QString::number(db, 'f', 0));
+    }
+
+    if (spectrum.size() < 2) {
+        painter.drawText(psdFrame, Qt::AlignCenter, tr("Waiting for data"));
+        return;
+    }
+
+    // Frequency axis labels.
+    double maxFrequency = binWidth * (spectrum.size() - 1);
+    for (int i = 0; i <= 4; ++i) {
+        int x = psdFrame.left() + i * psdFrame.width() / 4;
+        QString label = QString::number(maxFrequency * i / 4.0, 'f', 0) + " Hz";
+        painter.drawText(x - textWidth, psdFrame.bottom() + 2, 2 * textWidth, textHeight, Qt::AlignHCenter | Qt::AlignTop, label);
+    }
+
+    // Spectrum trace.
+    QPolygonF trace;
+    for (int k = 0; k < spectrum.size(); ++k) {
+        double db = qBound(topDecibels - rangeDecibels, 10.0 * log10(spectrum[k] + 1.0e-30), topDecibels);
+        trace.append(QPointF(psdFrame.left() + (double) k / (spectrum.size() - 1) * psdFrame.width(),
+                             psdFrame.top() + (topDecibels - db) / rangeDecibels * psdFrame.height()));
+    }
+    painter.setPen(Qt::blue);
+    painter.drawPolyline(trace);
+
+    // Spectrogram, frequency increasing upward.
+    if (!spectrogram.isNull()) {
+        painter.drawImage(gramFrame, spectrogram);
+    }
+    painter.setPen(Qt::darkGray);
+    painter.drawRect(gramFrame);
+    painter.drawText(0, gramFrame.top(), textWidth + 4, textHeight, Qt::AlignRight | Qt::AlignTop,
+                     QString::number(maxFrequency / 1000.0, 'f', 1) + " kHz");
+    painter.drawText(0, gramFrame.bottom() - textHeight, textWidth + 4, textHeight, Qt::AlignRight | Qt::AlignBottom,
+                     "0 Hz");
+    painter.drawText(gramFrame.left(), gramFrame.bottom() + 2, gramFrame.width(), textHeight,
+                     Qt::AlignRight | Qt::AlignTop, tr("Spectrogram (newest at right)"));
+}
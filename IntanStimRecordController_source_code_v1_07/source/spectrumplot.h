@@ -0,0 +1,65 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPECTRUMPLOT_H
+#define SPECTRUMPLOT_H
+
+#define SPECTRUMPLOT_X_SIZE 560
+#define SPECTRUMPLOT_Y_SIZE 480
+#define SPECTROGRAM_NUM_COLUMNS 240
+
+#include <QWidget>
+#include <QImage>
+#include <QVector>
+
+// Power spectral density of one channel (top) and a scrolling spectrogram of
+// recent segments (bottom), in dB relative to 1 uV^2/Hz.
+class SpectrumPlot : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SpectrumPlot(QWidget *parent = 0);
+
+    void setChannelName(const QString &name);
+    void setSpectrum(const QVector<double> &psd, double binWidth_);
+    void addSpectrogramColumn(const QVector<double> &psd);
+    void setDecibelRange(double top, double range);
+    void clear();
+
+    QSize minimumSizeHint() const;
+    QSize sizeHint() const;
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private:
+    QString channelName;
+    QVector<double> spectrum;
+    double binWidth;
+    double topDecibels;
+    double rangeDecibels;
+    QImage spectrogram;
+    int spectrogramColumn;
+
+    QRgb colorOf(double decibels) const;
+};
+
+#endif // SPECTRUMPLOT_H
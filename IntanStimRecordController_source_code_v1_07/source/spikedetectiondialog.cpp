@@ -0,0 +1,184 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "spikedetectiondialog.h"
+#include "spikesorter.h"
+
+// Spike detection dialog.
+// This dialog allows users to set up online spike detection on all amplifier
+// channels, with a threshold that follows the noise level of each channel, to
+// sort the detected spikes of each channel into clusters, and to choose
+// whether detected spikes and their waveform snippets are saved while
+// recording.
+
+SpikeDetectionDialog::SpikeDetectionDialog(const SpikeDetectionSettings &settings, QWidget *parent) :
+    QDialog(parent)
+{
+    enableCheckBox = new QCheckBox(tr("Detect spikes on all amplifier channels"));
+    enableCheckBox->setChecked(settings.enabled);
+
+    polarityComboBox = new QComboBox();
+    polarityComboBox->addItem(tr("Negative"));
+    polarityComboBox->addItem(tr("Positive"));
+    polarityComboBox->addItem(tr("Negative and positive"));
+    polarityComboBox->setCurrentIndex(settings.polarity);
+
+    thresholdSpinBox = new QDoubleSpinBox();
+    thresholdSpinBox->setRange(2.0, 20.0);
+    thresholdSpinBox->setDecimals(1);
+    thresholdSpinBox->setSingleStep(0.5);
+    thresholdSpinBox->setSuffix(tr(" x noise"));
+    thresholdSpinBox->setValue(settings.thresholdMultiplier);
+
+    noiseTimeConstantSpinBox = new QDoubleSpinBox();
+    noiseTimeConstantSpinBox->setRange(0.1, 60.0);
+    noiseTimeConstantSpinBox->setDecimals(1);
+    noiseTimeConstantSpinBox->setSingleStep(0.5);
+    noiseTimeConstantSpinBox->setSuffix(" s");
+    noiseTimeConstantSpinBox->setValue(settings.noiseTimeConstantSec);
+
+    refractorySpinBox = new QDoubleSpinBox();
+    refractorySpinBox->setRange(0.0, 10.0);
+    refractorySpinBox->setDecimals(2);
+    refractorySpinBox->setSingleStep(0.1);
+    refractorySpinBox->setSuffix(" ms");
+    refractorySpinBox->setValue(settings.refractoryMsec);
+
+    peakWindowSpinBox = new QDoubleSpinBox();
+    peakWindowSpinBox->setRange(0.05, 2.0);
+    peakWindowSpinBox->setDecimals(2);
+    peakWindowSpinBox->setSingleStep(0.05);
+    peakWindowSpinBox->setSuffix(" ms");
+    peakWindowSpinBox->setValue(settings.peakWindowMsec);
+
+    sortCheckBox = new QCheckBox(tr("Sort spikes of each channel into clusters"));
+    sortCheckBox->setChecked(settings.sortSpikes);
+
+    maxClustersSpinBox = new QSpinBox();
+    maxClustersSpinBox->setRange(1, SPIKE_SORTER_MAX_CLUSTERS);
+    maxClustersSpinBox->setValue(settings.maxClusters);
+
+    saveEventsCheckBox = new QCheckBox(tr("Save spike events when recording"));
+    saveEventsCheckBox->setChecked(settings.saveEvents);
+
+    saveSnippetsCheckBox = new QCheckBox(tr("Save waveform snippets with spike events"));
+    saveSnippetsCheckBox->setChecked(settings.saveSnippets);
+
+    preSpinBox = new QDoubleSpinBox();
+    preSpinBox->setRange(0.0, 2.0);
+    preSpinBox->setDecimals(2);
+    preSpinBox->setSingleStep(0.1);
+    preSpinBox->setSuffix(" ms");
+    preSpinBox->setValue(settings.preMsec);
+
+    postSpinBox = new QDoubleSpinBox();
+    postSpinBox->setRange(0.0, 5.0);
+    postSpinBox->setDecimals(2);
+    postSpinBox->setSingleStep(0.1);
+    postSpinBox->setSuffix(" ms");
+    postSpinBox->setValue(settings.postMsec);
+
+    connect(enableCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateControls()));
+    connect(sortCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateControls()));
+    connect(saveEventsCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateControls()));
+    connect(saveSnippetsCheckBox, SIGNAL(toggled(bool)), this, SLOT(updateControls()));
+
+    QFormLayout *detectionLayout = new QFormLayout();
+    detectionLayout->addRow(tr("Threshold polarity"), polarityComboBox);
+    detectionLayout->addRow(tr("Threshold"), thresholdSpinBox);
+    detectionLayout->addRow(tr("Noise estimate time constant"), noiseTimeConstantSpinBox);
+    detectionLayout->addRow(tr("Refractory period after peak"), refractorySpinBox);
+    detectionLayout->addRow(tr("Peak search window"), peakWindowSpinBox);
+
+    QFormLayout *sortLayout = new QFormLayout();
+    sortLayout->addRow(tr("Maximum clusters per channel"), maxClustersSpinBox);
+
+    QFormLayout *snippetLayout = new QFormLayout();
+    snippetLayout->addRow(tr("Snippet start before peak"), preSpinBox);
+    snippetLayout->addRow(tr("Snippet end after peak"), postSpinBox);
+
+    QLabel *noteLabel = new QLabel(tr("The noise level of each channel is estimated continuously from the "
+                                      "median absolute value of its filtered waveform.  Spikes are detected "
+                                      "in the waveforms shown in the display, so enable the software "
+                                      "high-pass filter or display a spike band of the filter bank.  "
+                                      "Spikes are sorted by the shape of their waveform snippets, and "
+                                      "their clusters are shown in color in the Spike Scope.  "
+                                      "Spike events are saved in a *.spikes file next to the data files.  "
+                                      "To save spike events without continuous data, select the "
+                                      "\"Spike Events Only\" save file format, which always enables detection."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(enableCheckBox);
+    mainLayout->addLayout(detectionLayout);
+    mainLayout->addWidget(sortCheckBox);
+    mainLayout->addLayout(sortLayout);
+    mainLayout->addWidget(saveEventsCheckBox);
+    mainLayout->addWidget(saveSnippetsCheckBox);
+    mainLayout->addLayout(snippetLayout);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Spike Detection"));
+
+    updateControls();
+}
+
+// Enable the controls that apply to the selected options.  Detection settings
+// remain available when detection is off, since the "Spike Events Only" save
+// file format uses them.
+void SpikeDetectionDialog::updateControls()
+{
+    saveEventsCheckBox->setEnabled(enableCheckBox->isChecked());
+    maxClustersSpinBox->setEnabled(sortCheckBox->isChecked());
+    preSpinBox->setEnabled(saveSnippetsCheckBox->isChecked() || sortCheckBox->isChecked());
+    postSpinBox->setEnabled(saveSnippetsCheckBox->isChecked() || sortCheckBox->isChecked());
+}
+
+SpikeDetectionSettings SpikeDetectionDialog::getSettings() const
+{
+    SpikeDetectionSettings settings;
+    settings.enabled = enableCheckBox->isChecked();
+    settings.polarity = (SpikeDetector::Polarity) polarityComboBox->currentIndex();
+    settings.thresholdMultiplier = thresholdSpinBox->value();
+    settings.noiseTimeConstantSec = noiseTimeConstantSpinBox->value();
+    settings.refractoryMsec = refractorySpinBox->value();
+    settings.peakWindowMsec = peakWindowSpinBox->value();
+    settings.sortSpikes = sortCheckBox->isChecked();
+    settings.maxClusters = maxClustersSpinBox->value();
+    settings.saveEvents = saveEventsCheckBox->isChecked();
+    settings.saveSnippets = saveSnippetsCheckBox->isChecked();
+    settings.preMsec = preSpinBox->value();
+    settings.postMsec = postSpinBox->value();
+    return settings;
+}
@@ -0,0 +1,84 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPIKEDETECTIONDIALOG_H
+#define SPIKEDETECTIONDIALOG_H
+
+#include <QDialog>
+
+#include "spikedetector.h"
+
+class QDialogButtonBox;
+class QCheckBox;
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+
+// Online spike detection settings, with times in seconds or milliseconds so
+// they are independent of the sample rate.
+struct SpikeDetectionSettings
+{
+    bool enabled;
+    SpikeDetector::Polarity polarity;
+    double thresholdMultiplier;
+    double noiseTimeConstantSec;
+    double refractoryMsec;
+    double peakWindowMsec;
+    bool sortSpikes;
+    int maxClusters;
+    bool saveEvents;
+    bool saveSnippets;
+    double preMsec;
+    double postMsec;
+};
+
+class SpikeDetectionDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit SpikeDetectionDialog(const SpikeDetectionSettings &settings, QWidget *parent);
+
+    SpikeDetectionSettings getSettings() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateControls();
+
+private:
+    QCheckBox *enableCheckBox;
+    QComboBox *polarityComboBox;
+    QDoubleSpinBox *thresholdSpinBox;
+    QDoubleSpinBox *noiseTimeConstantSpinBox;
+    QDoubleSpinBox *refractorySpinBox;
+    QDoubleSpinBox *peakWindowSpinBox;
+    QCheckBox *sortCheckBox;
+    QSpinBox *maxClustersSpinBox;
+    QCheckBox *saveEventsCheckBox;
+    QCheckBox *saveSnippetsCheckBox;
+    QDoubleSpinBox *preSpinBox;
+    QDoubleSpinBox *postSpinBox;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // SPIKEDETECTIONDIALOG_H
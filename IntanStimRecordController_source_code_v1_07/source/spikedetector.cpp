@@ -0,0 +1,319 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#include "spikedetector.h"
+#include "samplevector.h"
+
+// Ratio of the median absolute deviation to the standard deviation of Gaussian noise
+static const double MadPerSigma = 0.6745;
+
+// Lower limit on the median of |x|, in microvolts, so that the estimate of a
+// silent lane can always grow again.
+static const Sample MinimumMedianAbs = (Sample) 0.01;
+
+// Gain that turns any positive difference of microvolt values into at least 1
+// (see screenLanes()).
+static const Sample StepGain = (Sample) 1.0e30;
+
+static bool eventBefore(const SpikeEvent &a, const SpikeEvent &b)
+{
+    return (a.frame < b.frame) || (a.frame == b.frame && a.lane < b.lane);
+}
+
+// Constructor.
+SpikeDetector::SpikeDetector()
+{
+    enabled = false;
+    polarity = DetectNegative;
+    thresholdMultiplier = 4.5;
+    noiseRate = 1.0 / 60000.0;
+    refractorySamples = 30;
+    peakWindow = 15;
+    preSamples = 15;
+    postSamples = 45;
+    numLanes = 0;
+    maxFrames = 0;
+    keptFrames = 0;
+    bufferStartFrame = 0;
+    noiseInitialized = false;
+}
+
+// Allocate state for numLanes lanes and data blocks of up to maxFrames time
+// steps, and clear all detector state.
+void SpikeDetector::setNumLanes(int numLanes_, int maxFrames_)
+{
+    numLanes = numLanes_;
+    maxFrames = maxFrames_;
+    medianAbs.resize(numLanes);
+    lowThreshold.resize(numLanes);
+    highThreshold.resize(numLanes);
+    margin.resize(numLanes);
+    refractoryEnd.resize(numLanes);
+    scratch.resize(maxFrames);
+    resetState();
+}
+
+// Set detection parameters.  The threshold is thresholdMultiplier_ times the
+// estimated noise standard deviation, and noiseTimeConstant is the time constant
+// of the noise estimate; all lengths are in samples.  Snippets run from
+// preSamples_ before to postSamples_ after each spike peak (both may be zero).
+// Detector state is cleared if detection is turned on or any length changes.
+void SpikeDetector::setParameters(bool enabled_, Polarity polarity_, double thresholdMultiplier_,
+                                  int noiseTimeConstant, int refractorySamples_, int peakWindow_,
+                                  int preSamples_, int postSamples_)
+{
+    bool clear = (enabled_ && !enabled) || refractorySamples_ != refractorySamples ||
+            peakWindow_ != peakWindow || preSamples_ != preSamples || postSamples_ != postSamples;
+
+    enabled = enabled_;
+    polarity = polarity_;
+    thresholdMultiplier = thresholdMultiplier_;
+    noiseRate = 1.0 / qMax(1, noiseTimeConstant);
+    refractorySamples = qMax(0, refractorySamples_);
+    peakWindow = qMax(1, peakWindow_);
+    preSamples = qMax(0, preSamples_);
+    postSamples = qMax(0, postSamples_);
+
+    if (clear) resetState();
+}
+
+// Clear retained data, noise estimates and refractory periods.  The noise
+// estimate restarts from the median of the next block.
+void SpikeDetector::resetState()
+{
+    keptFrames = qMax(preSamples, 1) + peakWindow + postSamples;
+    buffer.resize((keptFrames + maxFrames) * numLanes);
+    buffer.fill(0);
+    bufferTimestamps.resize(keptFrames + maxFrames);
+    bufferTimestamps.fill(0);
+    bufferStartFrame = -keptFrames;
+    refractoryEnd.fill(std::numeric_limits<qint64>::min());
+    noiseInitialized = false;
+    events.clear();
+    snippets.clear();
+}
+
+bool SpikeDetector::isEnabled() const
+{
+    return enabled;
+}
+
+// Detect spikes in numFrames time steps of data, with board timestamps for each
+// time step.  Replaces the events (and snippets) found by the previous call.
+void SpikeDetector::detect(const Sample *data, int numFrames, const qint32 *timestamps)
+{
+    events.clear();
+    snippets.clear();
+    if (!enabled || numLanes == 0) return;
+
+    numFrames = qMin(numFrames, maxFrames);
+    memcpy(buffer.data() + keptFrames * numLanes, data, numFrames * numLanes * sizeof(Sample));
+    memcpy(bufferTimestamps.data() + keptFrames, timestamps, numFrames * sizeof(qint32));
+
+    if (!noiseInitialized) {
+        initializeNoise(keptFrames, numFrames);
+        noiseInitialized = true;
+    }
+
+    // Thresholds are fixed for the block, at the noise level found so far.
+    const Sample disabled = std::numeric_limits<Sample>::max();
+    double scale = thresholdMultiplier / MadPerSigma;
+    for (int lane = 0; lane < numLanes; ++lane) {
+        Sample threshold = (Sample) (scale * medianAbs[lane]);
+        lowThreshold[lane] = (polarity != DetectPositive) ? -threshold : -disabled;
+        highThreshold[lane] = (polarity != DetectNegative) ? threshold : disabled;
+    }
+
+    // Scan the numFrames frames that are followed by enough data to locate the
+    // peak and complete the snippet of a spike at the last of them.
+    int firstFrame = keptFrames - peakWindow - postSamples;
+    screenLanes(firstFrame, numFrames);
+    for (int lane = 0; lane < numLanes; ++lane) {
+        if (margin[lane] <= 0) {
+            scanLane(lane, firstFrame, firstFrame + numFrames);
+        }
+    }
+    std::sort(events.begin(), events.end(), eventBefore);
+
+    memmove(buffer.data(), buffer.constData() + numFrames * numLanes, keptFrames * numLanes * sizeof(Sample));
+    memmove(bufferTimestamps.data(), bufferTimestamps.constData() + numFrames, keptFrames * sizeof(qint32));
+    bufferStartFrame += numFrames;
+}
+
+// Start the noise estimate of each lane at the median of |x| over the given frames.
+void SpikeDetector::initializeNoise(int firstFrame, int numFrames)
+{
+    int middle = numFrames / 2;
+    for (int lane = 0; lane < numLanes; ++lane) {
+        const Sample *x = buffer.constData() + firstFrame * numLanes + lane;
+        for (int t = 0; t < numFrames; ++t) {
+            scratch[t] = qAbs(x[t * numLanes]);
+        }
+        std::nth_element(scratch.begin(), scratch.begin() + middle, scratch.begin() + numFrames);
+        medianAbs[lane] = qMax(scratch[middle], MinimumMedianAbs);
+    }
+}
+
+// Update the noise estimate of every lane with the given frames, and find the
+// smallest margin between each lane and its thresholds (zero or less if the
+// lane reached a threshold).  The estimate m is multiplied by (1 + noiseRate)
+// if |x| > m and by (1 - noiseRate) otherwise.  The comparison is done without
+// branches: (|x| - m) times a huge gain, clamped to [0, 1], is 1 if |x| > m and
+// 0 otherwise.
+void SpikeDetector::screenLanes(int firstFrame, int numFrames)
+{
+    typedef SampleVector SV;
+
+    const Sample down = (Sample) (1.0 - noiseRate);
+    const Sample up = (Sample) (2.0 * noiseRate);
+    const Sample largest = std::numeric_limits<Sample>::max();
+
+    const SV::V vZero = SV::set1(0);
+    const SV::V vOne = SV::set1(1);
+    const SV::V vGain = SV::set1(StepGain);
+    const SV::V vDown = SV::set1(down);
+    const SV::V vUp = SV::set1(up);
+    const SV::V vFloor = SV::set1(MinimumMedianAbs);
+
+    int lane = 0;
+    for (; lane + SV::Width <= numLanes; lane += SV::Width) {
+        SV::V m = SV::loadu(medianAbs.constData() + lane);
+        SV::V low = SV::loadu(lowThreshold.constData() + lane);
+        SV::V high = SV::loadu(highThreshold.constData() + lane);
+        SV::V minMargin = SV::set1(largest);
+        const Sample *x = buffer.constData() + firstFrame * numLanes + lane;
+        for (int t = 0; t < numFrames; ++t, x += numLanes) {
+            SV::V v = SV::loadu(x);
+            minMargin = SV::min(minMargin, SV::min(SV::sub(v, low), SV::sub(high, v)));
+            SV::V a = SV::max(v, SV::sub(vZero, v));
+            SV::V above = SV::min(SV::max(SV::mul(SV::sub(a, m), vGain), vZero), vOne);
+            m = SV::max(SV::mul(m, SV::add(vDown, SV::mul(vUp, above))), vFloor);
+        }
+        SV::storeu(medianAbs.data() + lane, m);
+        SV::storeu(margin.data() + lane, minMargin);
+    }
+    for (; lane < numLanes; ++lane) {
+        Sample m = medianAbs[lane];
+        Sample minMargin = largest;
+        const Sample *x = buffer.constData() + firstFrame * numLanes + lane;
+        for (int t = 0; t < numFrames; ++t, x += numLanes) {
+            minMargin = qMin(minMargin, qMin(*x - lowThreshold[lane], highThreshold[lane] - *x));
+            m = qMax(m * ((qAbs(*x) > m) ? down + up : down), MinimumMedianAbs);
+        }
+        medianAbs[lane] = m;
+        margin[lane] = minMargin;
+    }
+}
+
+// Find threshold crossings of one lane in frames firstFrame to lastFrame - 1
+// of buffer, and record a spike event (and snippet) for each.
+void SpikeDetector::scanLane(int lane, int firstFrame, int lastFrame)
+{
+    const Sample *x = buffer.constData() + lane;
+    const Sample low = lowThreshold[lane];
+    const Sample high = highThreshold[lane];
+    const int snippetLength = preSamples + postSamples;
+
+    for (int t = firstFrame; t < lastFrame; ++t) {
+        Sample v = x[t * numLanes];
+        Sample previous = x[(t - 1) * numLanes];
+        bool negative = (v <= low && previous > low);
+        bool positive = (v >= high && previous < high);
+        if (!negative && !positive) continue;
+        if (bufferStartFrame + t < refractoryEnd[lane]) continue;
+
+        int peak = t;
+        for (int i = t + 1; i < t + peakWindow; ++i) {
+            Sample s = x[i * numLanes];
+            if (negative ? (s < x[peak * numLanes]) : (s > x[peak * numLanes])) peak = i;
+        }
+
+        SpikeEvent event;
+        event.frame = bufferStartFrame + peak;
+        event.timestamp = bufferTimestamps[peak];
+        event.lane = lane;
+        event.peak = x[peak * numLanes];
+        event.snippetOffset = snippets.size();
+        event.cluster = 0;
+        for (int i = peak - preSamples; i < peak - preSamples + snippetLength; ++i) {
+            snippets.append(x[i * numLanes]);
+        }
+        events.append(event);
+
+        // Refractory period starts at the peak, and always covers the samples up to it.
+        refractoryEnd[lane] = event.frame + qMax(1, refractorySamples);
+        t = peak;
+    }
+}
+
+const QVector<SpikeEvent>& SpikeDetector::getEvents() const
+{
+    return events;
+}
+
+// Set the cluster ID of event number index from getEvents().
+void SpikeDetector::setCluster(int index, int cluster)
+{
+    events[index].cluster = cluster;
+}
+
+// Waveform snippet of event, getSnippetLength() samples starting getPreSamples()
+// before the peak.
+const Sample* SpikeDetector::getSnippet(const SpikeEvent &event) const
+{
+    return snippets.constData() + event.snippetOffset;
+}
+
+int SpikeDetector::getPeakWindow() const
+{
+    return peakWindow;
+}
+
+int SpikeDetector::getPreSamples() const
+{
+    return preSamples;
+}
+
+int SpikeDetector::getSnippetLength() const
+{
+    return preSamples + postSamples;
+}
+
+SpikeDetector::Polarity SpikeDetector::getPolarity() const
+{
+    return polarity;
+}
+
+double SpikeDetector::getThresholdMultiplier() const
+{
+    return thresholdMultiplier;
+}
+
+// Estimated noise standard deviation of lane, in microvolts.
+double SpikeDetector::getNoiseLevel(int lane) const
+{
+    return medianAbs[lane] / MadPerSigma;
+}
@@ -0,0 +1,125 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPIKEDETECTOR_H
+#define SPIKEDETECTOR_H
+
+#include <QVector>
+
+#include "globalconstants.h"
+
+// One detected spike.  frame counts samples since the detector was reset, and
+// timestamp is the board timestamp of the spike peak.
+struct SpikeEvent
+{
+    qint64 frame;
+    qint32 timestamp;
+    int lane;
+    Sample peak;
+    int snippetOffset;      // start of the waveform snippet in the detector's snippet buffer
+    int cluster;            // cluster ID assigned by SpikeSorter, or 0 if unsorted
+};
+
+// Online threshold spike detector for all amplifier channels.
+//
+// Works on time-major filtered data (sample t of lane l at data[t * numLanes + l],
+// the layout of SignalProcessor::amplifierPostFilterFast).  For each lane, the
+// noise level is estimated as the running median of |x| divided by 0.6745 (the
+// median absolute deviation of Gaussian noise), which is insensitive to the
+// spikes themselves.  The median is tracked with a multiplicative stochastic
+// quantile update: each sample scales the estimate up or down by a small
+// factor depending on whether |x| lies above or below it, so the estimate
+// settles where half the samples lie on either side and follows slow changes
+// with the selected time constant.  The threshold is thresholdMultiplier times
+// the noise level, below zero, above zero, or both.
+//
+// Spikes are rare, so each block is first screened with SIMD vectors across
+// lanes: the noise update and the smallest margin to threshold of each lane
+// are computed in one pass.  Only lanes that came within threshold are then
+// scanned sample by sample for crossings.  A spike is placed at the extreme
+// value within peakWindow samples after the crossing, and no new crossing is
+// accepted on that lane for refractorySamples after the peak.  The last few
+// samples of each block are kept, so that spikes and snippets spanning
+// block boundaries are complete; events are therefore reported up to
+// peakWindow + postSamples samples after they occur.
+class SpikeDetector
+{
+public:
+    enum Polarity {
+        DetectNegative,
+        DetectPositive,
+        DetectBoth
+    };
+
+    SpikeDetector();
+
+    void setNumLanes(int numLanes_, int maxFrames_);
+    void setParameters(bool enabled_, Polarity polarity_, double thresholdMultiplier_, int noiseTimeConstant,
+                       int refractorySamples_, int peakWindow_, int preSamples_, int postSamples_);
+    void resetState();
+    bool isEnabled() const;
+
+    void detect(const Sample *data, int numFrames, const qint32 *timestamps);
+
+    const QVector<SpikeEvent>& getEvents() const;
+    void setCluster(int index, int cluster);
+    const Sample* getSnippet(const SpikeEvent &event) const;
+    int getPeakWindow() const;
+    int getPreSamples() const;
+    int getSnippetLength() const;
+    Polarity getPolarity() const;
+    double getThresholdMultiplier() const;
+    double getNoiseLevel(int lane) const;
+
+private:
+    bool enabled;
+    Polarity polarity;
+    double thresholdMultiplier;
+    double noiseRate;           // relative step of the median estimate per sample
+    int refractorySamples;
+    int peakWindow;
+    int preSamples;
+    int postSamples;
+
+    int numLanes;
+    int maxFrames;
+    int keptFrames;             // frames retained from the previous block
+    qint64 bufferStartFrame;    // frame number of the first frame in buffer
+    bool noiseInitialized;
+
+    QVector<Sample> buffer;     // retained frames followed by the new block, time-major
+    QVector<qint32> bufferTimestamps;
+    QVector<Sample> medianAbs;  // running median of |x| for each lane
+    QVector<Sample> lowThreshold;
+    QVector<Sample> highThreshold;
+    QVector<Sample> margin;     // smallest distance to threshold in the current block
+    QVector<qint64> refractoryEnd;
+    QVector<Sample> scratch;
+
+    QVector<SpikeEvent> events;
+    QVector<Sample> snippets;
+
+    void initializeNoise(int firstFrame, int numFrames);
+    void screenLanes(int firstFrame, int numFrames);
+    void scanLane(int lane, int firstFrame, int lastFrame);
+};
+
+#endif // SPIKEDETECTOR_H
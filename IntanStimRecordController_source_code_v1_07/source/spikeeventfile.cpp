@@ -0,0 +1,172 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QDataStream>
+#include <iostream>
+
+#include "spikeeventfile.h"
+#include "spikedetector.h"
+#include "checksummedfile.h"
+#include "signalchannel.h"
+#include "globalconstants.h"
+
+using namespace std;
+
+// Voltage in microvolts converted to a saturated 16-bit value in units of
+// AMPLIFIER_MICROVOLTS_PER_BIT.
+static inline qint16 toBits(Sample microvolts)
+{
+    double bits = microvolts / AMPLIFIER_MICROVOLTS_PER_BIT;
+    if (bits >= 32767.0) return 32767;
+    if (bits <= -32768.0) return -32768;
+    return (qint16) qRound(bits);
+}
+
+// Constructor.
+SpikeEventFile::SpikeEventFile()
+{
+    file = nullptr;
+    snippetLength = 0;
+}
+
+SpikeEventFile::~SpikeEventFile()
+{
+    if (file) {
+        close();
+    }
+}
+
+// Return the spike event filename for a recording with the specified base name.
+QString SpikeEventFile::spikeFileName(const QString &path, const QString &baseName)
+{
+    return path + "/" + baseName + ".spikes";
+}
+
+// Create a new spike event file and write its header.  channels lists the
+// amplifier channels whose events are saved, and channelLanes the detector lane
+// of each.  Returns false if the file cannot be created.
+bool SpikeEventFile::open(const QString &fileName, bool checksumsEnabled, double sampleRate,
+                          const SpikeDetector &detector, bool saveSnippets,
+                          const QVector<SignalChannel*> &channels, const QVector<int> &channelLanes)
+{
+    file = new ChecksummedFile(fileName, checksumsEnabled);
+    if (!file->open(QIODevice::WriteOnly)) {
+        cerr << "Cannot open spike event file for writing: " <<
+                qPrintable(file->errorString()) << endl;
+        delete file;
+        file = nullptr;
+        return false;
+    }
+
+    snippetLength = saveSnippets ? detector.getSnippetLength() : 0;
+
+    int maxLane = -1;
+    for (int i = 0; i < channelLanes.size(); ++i) {
+        maxLane = qMax(maxLane, channelLanes[i]);
+    }
+    laneChannelIndex.fill(-1, maxLane + 1);
+    for (int i = 0; i < channels.size(); ++i) {
+        laneChannelIndex[channelLanes[i]] = i;
+    }
+
+    QDataStream out(file);
+    out.setVersion(QDataStream::Qt_4_8);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << (quint32) SPIKE_FILE_MAGIC_NUMBER;
+    out << (qint16) SPIKE_FILE_MAIN_VERSION_NUMBER;
+    out << (qint16) SPIKE_FILE_SECONDARY_VERSION_NUMBER;
+    out << (float) sampleRate;
+    out << (qint16) detector.getPolarity();
+    out << (float) detector.getThresholdMultiplier();
+    out << (qint16) (saveSnippets ? detector.getPreSamples() : 0);
+    out << (qint16) snippetLength;
+    out << (qint16) channels.size();
+    for (int i = 0; i < channels.size(); ++i) {
+        out << channels[i]->nativeChannelName;
+        out << channels[i]->customChannelName;
+    }
+    return true;
+}
+
+// Append the events found by the detector's last call to detect() for the
+// channels listed in the header.  Timestamps are saved relative to
+// timestampOffset, like those of the continuous data.  Returns the number of
+// bytes written.
+qint64 SpikeEventFile::write(const SpikeDetector &detector, qint32 timestampOffset)
+{
+    if (!file) return 0;
+
+    const QVector<SpikeEvent> &events = detector.getEvents();
+    const int recordLength = 10 + 2 * snippetLength;
+
+    recordBuffer.resize(events.size() * recordLength);
+    char *p = recordBuffer.data();
+    int numRecords = 0;
+
+    for (int i = 0; i < events.size(); ++i) {
+        const SpikeEvent &event = events[i];
+        if (event.lane >= laneChannelIndex.size() || laneChannelIndex[event.lane] < 0) continue;
+
+        qint32 timestamp = event.timestamp - timestampOffset;
+        quint16 channelIndex = laneChannelIndex[event.lane];
+        quint16 cluster = event.cluster;
+        qint16 peak = toBits(event.peak);
+        *p++ = timestamp & 0x000000ff;          // Save qint32 in little-endian format
+        *p++ = (timestamp & 0x0000ff00) >> 8;
+        *p++ = (timestamp & 0x00ff0000) >> 16;
+        *p++ = (timestamp & 0xff000000) >> 24;
+        *p++ = channelIndex & 0x00ff;
+        *p++ = (channelIndex & 0xff00) >> 8;
+        *p++ = cluster & 0x00ff;
+        *p++ = (cluster & 0xff00) >> 8;
+        *p++ = peak & 0x00ff;
+        *p++ = (peak & 0xff00) >> 8;
+
+        const Sample *snippet = detector.getSnippet(event);
+        for (int t = 0; t < snippetLength; ++t) {
+            qint16 value = toBits(snippet[t]);
+            *p++ = value & 0x00ff;
+            *p++ = (value & 0xff00) >> 8;
+        }
+        ++numRecords;
+    }
+
+    if (numRecords == 0) return 0;
+    return file->write(recordBuffer.constData(), numRecords * recordLength);
+}
+
+void SpikeEventFile::close()
+{
+    if (!file) return;
+
+    file->close();
+    delete file;
+    file = nullptr;
+}
+
+// The open spike event file, for the save journal and checksum file (null if
+// no file is open).
+ChecksummedFile* SpikeEventFile::getFile() const
+{
+    return file;
+}
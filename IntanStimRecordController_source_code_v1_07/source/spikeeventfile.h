@@ -0,0 +1,63 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPIKEEVENTFILE_H
+#define SPIKEEVENTFILE_H
+
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+class ChecksummedFile;
+class SignalChannel;
+class SpikeDetector;
+
+// Spike event file, written next to (or instead of) the continuous data files
+// while recording.  The header records the sample rate, detection settings and
+// the channels events may come from; it is followed by one fixed-size record
+// per spike, in time order: timestamp (qint32), channel index in the header
+// (quint16), cluster ID from the online spike sorter (quint16, 0 if unsorted),
+// peak value (qint16), and optionally a waveform snippet (qint16 per sample).
+// Voltages are in units of 0.195 microvolts, like amplifier data in *.rhs
+// files.  (Version 1 files have no cluster ID.)
+class SpikeEventFile
+{
+public:
+    SpikeEventFile();
+    ~SpikeEventFile();
+
+    bool open(const QString &fileName, bool checksumsEnabled, double sampleRate,
+              const SpikeDetector &detector, bool saveSnippets,
+              const QVector<SignalChannel*> &channels, const QVector<int> &channelLanes);
+    qint64 write(const SpikeDetector &detector, qint32 timestampOffset);
+    void close();
+    ChecksummedFile* getFile() const;
+
+    static QString spikeFileName(const QString &path, const QString &baseName);
+
+private:
+    ChecksummedFile *file;
+    QVector<int> laneChannelIndex;      // channel index in the header for each lane, or -1
+    int snippetLength;
+    QByteArray recordBuffer;
+};
+
+#endif // SPIKEEVENTFILE_H
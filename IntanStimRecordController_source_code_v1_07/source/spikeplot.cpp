@@ -37,6 +37,8 @@
 // so users may compare their shapes.  The RMS value of the waveform is
 // displayed in the plot.  Users may select a new threshold value by clicking
 // on the plot.  Keypresses are used to change the voltage scale of the plot.
+// If online spike sorting is enabled, spikes are drawn in the color of their
+// cluster.
 
 SpikePlot::SpikePlot(SignalProcessor *inSignalProcessor, SignalChannel *initialChannel,
                      SpikeScopeDialog *inSpikeScopeDialog, QWidget *parent) :
@@ -74,6 +76,10 @@ SpikePlot::SpikePlot(SignalProcessor *inSignalProcessor, SignalChannel *initialC
         spikeWaveform[i].fill(0.0);
     }
 
+    // Cluster ID of each captured waveform (0 if unsorted)
+    spikeWaveformCluster.resize(spikeWaveform.size());
+    spikeWaveformCluster.fill(0);
+
     // Buffers to hold recent history of spike waveform and digital input,
     // used to find trigger events.
     spikeWaveformBuffer.resize(10000);
@@ -290,6 +296,7 @@ void SpikePlot::updateWaveform(int numBlocks)
                  i < index + totalTSteps - preTriggerTSteps; ++i) {
                 spikeWaveform[spikeWaveformIndex][index2++] = spikeWaveformBuffer.at(i);
             }
+            spikeWaveformCluster[spikeWaveformIndex] = spikeCluster(spikeWaveform.at(spikeWaveformIndex), stream, channel);
             if (++spikeWaveformIndex == spikeWaveform.size()) {
                 spikeWaveformIndex = 0;
             }
@@ -316,6 +323,52 @@ void SpikePlot::updateWaveform(int numBlocks)
     updateSpikePlot(rms);
 }
 
+// Returns the cluster ID assigned by the online spike sorter to a captured
+// waveform, or 0 if it is unsorted.  The sorter's snippet is taken around the
+// spike peak, found the same way as by the spike detector: the extreme value
+// within its peak search window after the threshold crossing.
+int SpikePlot::spikeCluster(const QVector<double> &waveform, int stream, int channel) const
+{
+    const SpikeSorter *sorter = signalProcessor->getSpikeSorter();
+    if (!voltageTriggerMode || !sorter->isEnabled()) return 0;
+
+    int peakWindow = signalProcessor->getSpikeDetector()->getPeakWindow();
+    int peak = preTriggerTSteps;
+    for (int i = preTriggerTSteps + 1; i < qMin(preTriggerTSteps + peakWindow, totalTSteps); ++i) {
+        if ((voltageThreshold >= 0) ? (waveform.at(i) > waveform.at(peak)) : (waveform.at(i) < waveform.at(peak))) {
+            peak = i;
+        }
+    }
+
+    int start = peak - sorter->getPreSamples();
+    int length = sorter->getSnippetLength();
+    if (start < 0 || start + length > totalTSteps) return 0;
+
+    QVector<Sample> snippet(length);
+    for (int i = 0; i < length; ++i) {
+        snippet[i] = waveform.at(start + i);
+    }
+    return sorter->classify(signalProcessor->amplifierLane(stream, channel), snippet.constData());
+}
+
+// Color of a waveform in the given cluster (0 if unsorted).  Older waveforms
+// are drawn in lighter shades, following ageColor, the color used for
+// unsorted waveforms of that age.
+QColor SpikePlot::clusterColor(int cluster, const QColor &ageColor) const
+{
+    static const QColor ClusterColors[] = {
+        QColor(0, 160, 0), QColor(200, 0, 200), QColor(255, 140, 0), QColor(0, 170, 200),
+        QColor(140, 90, 40), QColor(120, 0, 255), QColor(160, 160, 0), QColor(255, 0, 120)
+    };
+
+    if (cluster <= 0) return ageColor;
+
+    QColor color = ClusterColors[(cluster - 1) % 8];
+    if (ageColor == QColor(Qt::lightGray)) return color.lighter(175);
+    if (ageColor == QColor(Qt::darkGray)) return color.lighter(130);
+    return color;
+}
+
 // Plots spike waveforms and writes RMS value to display.
 void SpikePlot::updateSpikePlot(double rms)
 {
@@ -362,7 +415,8 @@ void SpikePlot::updateSpikePlot(double rms)
         }
 
         // Draw waveform
-        painter.setPen(scopeColors.at(colorIndex).at(index++));
+        painter.setPen(clusterColor(spikeWaveformCluster.at((j + 30) % spikeWaveform.size()),
+                                    scopeColors.at(colorIndex).at(index++)));
         painter.drawPolyline(polyline, totalTSteps);
     }
 
@@ -70,11 +70,14 @@ private:
     void drawAxisText();
     void updateSpikePlot(double rms);
     void initializeDisplay();
+    int spikeCluster(const QVector<double> &waveform, int stream, int channel) const;
+    QColor clusterColor(int cluster, const QColor &ageColor) const;
 
     SignalProcessor *signalProcessor;
     SpikeScopeDialog *spikeScopeDialog;
 
     QVector<QVector<double> > spikeWaveform;
+    QVector<int> spikeWaveformCluster;
     QVector<double> spikeWaveformBuffer;
     QVector<int> digitalInputBuffer;
     int spikeWaveformIndex;
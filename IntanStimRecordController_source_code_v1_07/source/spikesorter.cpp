@@ -0,0 +1,649 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include "spikesorter.h"
+#include "spikedetector.h"
+
+// Spikes per lane over which the mean and principal components are averaged
+// once the lane has seen that many spikes.
+static const int PcaAdaptationSpikes = 1000;
+
+// Spikes per cluster over which its template and spread are averaged.
+static const int ClusterAdaptationSpikes = 200;
+
+// Spikes a lane must see before clusters are formed, so the principal
+// components have settled.
+static const int MinSpikesForClustering = 50;
+
+// Spikes between recomputations of the normalized basis and cluster centroids.
+static const int BasisUpdateInterval = 16;
+
+// A spike belongs to a cluster if its Mahalanobis distance from the centroid
+// (distance in units of the cluster's standard deviation in each feature) is
+// at most AcceptanceSigma.
+static const double AcceptanceSigma = 4.0;
+
+// Clusters whose centroids are closer than MergeSigma times their combined
+// standard deviation are merged.
+static const double MergeSigma = 2.0;
+
+// Published model of one cluster: centroid, inverse variance of each feature
+// (all zero for an unused slot), and the sum of log variances.
+static const int ClusterModelSize = 2 * SPIKE_SORTER_NUM_FEATURES + 1;
+
+// Initial spread of a new cluster, relative to the lane's noise variance.
+static const double InitialVarianceFactor = 2.0;
+
+// Spikes a cluster must receive before it is published and its spikes are labelled.
+static const int MinClusterSpikes = 10;
+
+// Clusters are dropped if the lane sees this many spikes without one assigned
+// to them (fewer for clusters that have not yet been published).
+static const int ProvisionalClusterLifetime = 200;
+static const int ClusterLifetime = 5000;
+
+// Largest number of spikes queued for learning; further spikes are labelled
+// but not learned.
+static const int MaxPendingSpikes = 16384;
+
+// Lower limit on the noise variance, in microvolts squared.
+static const double MinNoiseVariance = 1.0e-4;
+
+// Samples on either side of the detected peak used to align snippets.
+static const int AlignmentHalfWidth = 3;
+
+// Align a snippet on the centre of energy of its peak, to a fraction of a
+// sample, by linear interpolation.  The detector places the peak at the
+// largest sample, which noise easily moves by a sample or two on broad
+// spikes; snippets of one unit aligned that way form several clusters.
+static void alignSnippet(const Sample *snippet, Sample *aligned, int preSamples, int length)
+{
+    double energy = 0.0;
+    double moment = 0.0;
+    int first = qMax(0, preSamples - AlignmentHalfWidth);
+    int last = qMin(length - 1, preSamples + AlignmentHalfWidth);
+    for (int t = first; t <= last; ++t) {
+        double e = (double) snippet[t] * snippet[t];
+        energy += e;
+        moment += e * (t - preSamples);
+    }
+    double shift = (energy > 0.0) ? moment / energy : 0.0;
+
+    for (int s = 0; s < length; ++s) {
+        double position = qBound(0.0, s + shift, length - 1.0);
+        int i = qMin((int) position, length - 2);
+        Sample fraction = (Sample) (position - i);
+        aligned[s] = snippet[i] + fraction * (snippet[i + 1] - snippet[i]);
+    }
+}
+
+// Worker thread task that learns the spikes of one batch.
+class SortTask : public QRunnable
+{
+public:
+    SortTask(SpikeSorter *spikeSorter_) : spikeSorter(spikeSorter_) { setAutoDelete(true); }
+
+    void run() override
+    {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        spikeSorter->learnLanes();
+    }
+
+private:
+    SpikeSorter *spikeSorter;
+};
+
+// Constructor.
+SpikeSorter::SpikeSorter()
+{
+    enabled = false;
+    maxClusters = 4;
+    preSamples = 0;
+    snippetLength = 0;
+    numLanes = 0;
+    droppedSpikes = 0;
+
+    // Learning is light work, so a few threads keep up with all channels and
+    // leave the remaining cores for filtering.
+    threadPool = new QThreadPool();
+    threadPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 4));
+    learning.store(0);
+}
+
+SpikeSorter::~SpikeSorter()
+{
+    waitForLearning();
+    delete threadPool;
+    for (int i = 0; i < laneStates.size(); ++i) {
+        delete laneStates[i];
+    }
+}
+
+// Allocate models for numLanes lanes, and clear all sorter state.
+void SpikeSorter::setNumLanes(int numLanes_)
+{
+    waitForLearning();
+    for (int i = 0; i < laneStates.size(); ++i) {
+        delete laneStates[i];
+    }
+    numLanes = numLanes_;
+    laneStates.fill(nullptr, numLanes);
+    resetState();
+}
+
+// Set sorting parameters.  Snippets of snippetLength_ samples starting
+// preSamples_ before the spike peak must match those of the spike detector.
+// Sorter state is cleared if sorting is turned on or any other parameter changes.
+void SpikeSorter::setParameters(bool enabled_, int maxClusters_, int preSamples_, int snippetLength_)
+{
+    maxClusters_ = qBound(1, maxClusters_, SPIKE_SORTER_MAX_CLUSTERS);
+    bool clear = (enabled_ && !enabled) || maxClusters_ != maxClusters ||
+            preSamples_ != preSamples || snippetLength_ != snippetLength;
+
+    // Workers read the snippet length, so it may only change between batches.
+    if (clear) waitForLearning();
+
+    enabled = enabled_;
+    maxClusters = maxClusters_;
+    preSamples = preSamples_;
+    snippetLength = snippetLength_;
+
+    if (clear) resetState();
+}
+
+// Clear all learned models and queued spikes.
+void SpikeSorter::resetState()
+{
+    waitForLearning();
+    for (int i = 0; i < laneStates.size(); ++i) {
+        delete laneStates[i];
+        laneStates[i] = nullptr;
+    }
+    modelBasis.fill(0, numLanes * SPIKE_SORTER_NUM_FEATURES * snippetLength);
+    modelClusters.fill(0, numLanes * SPIKE_SORTER_MAX_CLUSTERS * ClusterModelSize);
+    pending.clear();
+    pendingSnippets.clear();
+    droppedSpikes = 0;
+}
+
+bool SpikeSorter::isEnabled() const
+{
+    return enabled;
+}
+
+// Label the events found by the detector's last call to detect() with their
+// cluster IDs, and queue their snippets for learning.  Called from the
+// acquisition thread after each call to detect().
+void SpikeSorter::sort(SpikeDetector &detector)
+{
+    if (!enabled || numLanes == 0 || snippetLength < SPIKE_SORTER_NUM_FEATURES) return;
+    if (detector.getPreSamples() != preSamples || detector.getSnippetLength() != snippetLength) return;
+
+    const QVector<SpikeEvent> &events = detector.getEvents();
+    if (events.isEmpty() && pending.isEmpty()) return;
+
+    alignedSnippet.resize(snippetLength);
+    modelMutex.lock();
+    for (int i = 0; i < events.size(); ++i) {
+        alignSnippet(detector.getSnippet(events[i]), alignedSnippet.data(), preSamples, snippetLength);
+        detector.setCluster(i, classifyLocked(events[i].lane, alignedSnippet.constData()));
+
+        if (pending.size() >= MaxPendingSpikes) {
+            ++droppedSpikes;
+            continue;
+        }
+        PendingSpike spike;
+        spike.lane = events[i].lane;
+        spike.noise = detector.getNoiseLevel(spike.lane);
+        spike.snippetOffset = pendingSnippets.size();
+        pending.append(spike);
+        pendingSnippets.resize(spike.snippetOffset + snippetLength);
+        memcpy(pendingSnippets.data() + spike.snippetOffset, alignedSnippet.constData(),
+               snippetLength * sizeof(Sample));
+    }
+    modelMutex.unlock();
+
+    if (!pending.isEmpty() && learning.loadAcquire() == 0) {
+        startLearning();
+    }
+}
+
+// Cluster ID (1 to getMaxClusters()) of a snippet from lane, of
+// getSnippetLength() samples starting getPreSamples() before the spike peak,
+// according to the lane's published model.  Returns 0 if the spike does not
+// belong to any cluster.  May be called from any thread.
+int SpikeSorter::classify(int lane, const Sample *snippet) const
+{
+    if (!enabled || lane < 0 || lane >= numLanes || snippetLength < SPIKE_SORTER_NUM_FEATURES) return 0;
+
+    QVector<Sample> aligned(snippetLength);
+    alignSnippet(snippet, aligned.data(), preSamples, snippetLength);
+
+    QMutexLocker locker(&modelMutex);
+    return classifyLocked(lane, aligned.constData());
+}
+
+// Most likely published cluster whose acceptance radius contains an aligned
+// snippet.  Must be called with modelMutex locked.
+int SpikeSorter::classifyLocked(int lane, const Sample *snippet) const
+{
+    const int numFeatures = SPIKE_SORTER_NUM_FEATURES;
+    const Sample *basis = modelBasis.constData() + lane * numFeatures * snippetLength;
+    const Sample *model = modelClusters.constData() + lane * SPIKE_SORTER_MAX_CLUSTERS * ClusterModelSize;
+    const Sample acceptance = (Sample) (AcceptanceSigma * AcceptanceSigma);
+
+    Sample features[SPIKE_SORTER_NUM_FEATURES];
+    for (int i = 0; i < numFeatures; ++i) {
+        Sample sum = 0;
+        for (int s = 0; s < snippetLength; ++s) {
+            sum += basis[i * snippetLength + s] * snippet[s];
+        }
+        features[i] = sum;
+    }
+
+    int cluster = 0;
+    Sample best = 0;
+    for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+        const Sample *centroid = model + k * ClusterModelSize;
+        const Sample *inverseVariance = centroid + numFeatures;
+        if (inverseVariance[0] == 0) continue;
+        Sample distance = 0;
+        for (int i = 0; i < numFeatures; ++i) {
+            Sample d = features[i] - centroid[i];
+            distance += d * d * inverseVariance[i];
+        }
+        Sample score = distance + inverseVariance[numFeatures];
+        if (distance <= acceptance && (cluster == 0 || score < best)) {
+            cluster = k + 1;
+            best = score;
+        }
+    }
+    return cluster;
+}
+
+// Hand the queued spikes to the worker threads, grouped by lane.
+void SpikeSorter::startLearning()
+{
+    work.swap(pending);
+    workSnippets.swap(pendingSnippets);
+    pending.resize(0);
+    pendingSnippets.resize(0);
+
+    // Stable sort keeps the spikes of each lane in time order.
+    workOrder.resize(work.size());
+    for (int i = 0; i < workOrder.size(); ++i) {
+        workOrder[i] = i;
+    }
+    const PendingSpike *spikes = work.constData();
+    std::stable_sort(workOrder.begin(), workOrder.end(),
+                     [spikes](int a, int b) { return spikes[a].lane < spikes[b].lane; });
+
+    workLanes.resize(0);
+    workStart.resize(0);
+    for (int i = 0; i < workOrder.size(); ++i) {
+        int lane = spikes[workOrder[i]].lane;
+        if (workLanes.isEmpty() || workLanes.last() != lane) {
+            workLanes.append(lane);
+            workStart.append(i);
+        }
+    }
+    workStart.append(workOrder.size());
+
+    const int numFeatures = SPIKE_SORTER_NUM_FEATURES;
+    for (int i = 0; i < workLanes.size(); ++i) {
+        if (laneStates[workLanes[i]]) continue;
+        LaneState *state = new LaneState;
+        state->numSpikes = 0;
+        state->mean.fill(0.0, snippetLength);
+        state->components.fill(0.0, numFeatures * snippetLength);
+        state->basis.fill(0.0, numFeatures * snippetLength);
+        state->templates.fill(0.0, SPIKE_SORTER_MAX_CLUSTERS * snippetLength);
+        state->centroids.fill(0.0, SPIKE_SORTER_MAX_CLUSTERS * numFeatures);
+        state->residual.fill(0.0, snippetLength);
+        for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+            state->clusterSpikes[k] = 0;
+            state->lastSpike[k] = 0;
+            for (int i = 0; i < numFeatures; ++i) state->variance[k][i] = 0.0;
+        }
+        laneStates[workLanes[i]] = state;
+    }
+
+    int numTasks = qMin(workLanes.size(), threadPool->maxThreadCount());
+    nextWorkLane.store(0);
+    activeTasks.store(numTasks);
+    learning.storeRelease(1);
+    for (int i = 0; i < numTasks; ++i) {
+        threadPool->start(new SortTask(this));
+    }
+}
+
+// Learn the spikes of the current batch, lane by lane, until no lanes are
+// left.  Called concurrently by the worker threads; each lane is learned by
+// one thread only.  The last thread to finish marks the batch as done.
+void SpikeSorter::learnLanes()
+{
+    int i;
+    while ((i = nextWorkLane.fetchAndAddRelaxed(1)) < workLanes.size()) {
+        int lane = workLanes.at(i);
+        LaneState *state = laneStates.at(lane);
+        for (int j = workStart.at(i); j < workStart.at(i + 1); ++j) {
+            const PendingSpike &spike = work.at(workOrder.at(j));
+            learnSpike(state, workSnippets.constData() + spike.snippetOffset, spike.noise);
+        }
+        publish(lane, state);
+    }
+
+    if (activeTasks.fetchAndAddOrdered(-1) == 1) {
+        learning.storeRelease(0);
+    }
+}
+
+// Wait until the current batch, if any, has been learned.
+void SpikeSorter::waitForLearning()
+{
+    threadPool->waitForDone();
+}
+
+// Update a lane's principal components and clusters with one spike.
+void SpikeSorter::learnSpike(LaneState *state, const Sample *snippet, double noise)
+{
+    const int numFeatures = SPIKE_SORTER_NUM_FEATURES;
+    const int length = snippetLength;
+    int n = ++state->numSpikes;
+    double rate = 1.0 / qMin(n, PcaAdaptationSpikes);
+
+    double *mean = state->mean.data();
+    double *u = state->residual.data();
+    for (int s = 0; s < length; ++s) {
+        mean[s] += rate * (snippet[s] - mean[s]);
+        u[s] = snippet[s] - mean[s];
+    }
+
+    // Candid covariance-free incremental PCA: each component moves towards the
+    // residual, in proportion to the residual's projection on it, and the
+    // residual is then deflated by the component before the next is updated.
+    // The components converge to the eigenvectors of the covariance, scaled by
+    // their eigenvalues.
+    for (int i = 0; i < numFeatures; ++i) {
+        double *v = state->components.data() + i * length;
+        double norm2 = 0.0;
+        for (int s = 0; s < length; ++s) norm2 += v[s] * v[s];
+        if (norm2 == 0.0) {
+            for (int s = 0; s < length; ++s) v[s] = u[s];
+        } else {
+            double projection = 0.0;
+            for (int s = 0; s < length; ++s) projection += u[s] * v[s];
+            double weight = rate * projection / sqrt(norm2);
+            for (int s = 0; s < length; ++s) v[s] = (1.0 - rate) * v[s] + weight * u[s];
+        }
+
+        norm2 = 0.0;
+        double projection = 0.0;
+        for (int s = 0; s < length; ++s) {
+            norm2 += v[s] * v[s];
+            projection += u[s] * v[s];
+        }
+        if (norm2 > 0.0) {
+            double scale = projection / norm2;
+            for (int s = 0; s < length; ++s) u[s] -= scale * v[s];
+        }
+    }
+
+    if (n <= MinSpikesForClustering || n % BasisUpdateInterval == 0) {
+        updateBasis(state);
+    }
+    if (n < MinSpikesForClustering) return;
+
+    // Drop clusters that no longer receive spikes.
+    for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+        if (state->clusterSpikes[k] == 0) continue;
+        int lifetime = (state->clusterSpikes[k] < MinClusterSpikes) ? ProvisionalClusterLifetime : ClusterLifetime;
+        if (n - state->lastSpike[k] > lifetime) state->clusterSpikes[k] = 0;
+    }
+
+    const double *basis = state->basis.constData();
+    double features[SPIKE_SORTER_NUM_FEATURES];
+    for (int i = 0; i < numFeatures; ++i) {
+        double sum = 0.0;
+        for (int s = 0; s < length; ++s) sum += basis[i * length + s] * snippet[s];
+        features[i] = sum;
+    }
+
+    double distance;
+    int cluster = mostLikelyCluster(state, features, distance);
+    double noiseVariance = qMax(noise * noise, MinNoiseVariance);
+    bool newCluster = (cluster < 0 || distance > AcceptanceSigma * AcceptanceSigma);
+    if (newCluster) {
+        // Start a new cluster in the first free slot, if there is one.
+        cluster = -1;
+        for (int k = 0; k < maxClusters; ++k) {
+            if (state->clusterSpikes[k] == 0) {
+                cluster = k;
+                break;
+            }
+        }
+        if (cluster < 0) return;
+        for (int i = 0; i < numFeatures; ++i) {
+            state->variance[cluster][i] = InitialVarianceFactor * noiseVariance;
+        }
+    }
+
+    // Streaming update of the cluster's Gaussian: move the template and the
+    // variance of each feature towards the spike.
+    int count = ++state->clusterSpikes[cluster];
+    double clusterRate = 1.0 / qMin(count, ClusterAdaptationSpikes);
+    double *templ = state->templates.data() + cluster * length;
+    double *centroid = state->centroids.data() + cluster * numFeatures;
+    if (!newCluster) {
+        for (int i = 0; i < numFeatures; ++i) {
+            double d = features[i] - centroid[i];
+            double v = state->variance[cluster][i] + clusterRate * (d * d - state->variance[cluster][i]);
+            state->variance[cluster][i] = qMax(v, noiseVariance);
+        }
+    }
+    for (int s = 0; s < length; ++s) {
+        templ[s] += clusterRate * (snippet[s] - templ[s]);
+    }
+    for (int i = 0; i < numFeatures; ++i) {
+        double sum = 0.0;
+        for (int s = 0; s < length; ++s) sum += basis[i * length + s] * templ[s];
+        centroid[i] = sum;
+    }
+    state->lastSpike[cluster] = n;
+
+    mergeClusters(state, cluster);
+}
+
+// Most likely cluster of a spike with the given features, or -1 if the lane
+// has no clusters.  distance is set to the spike's squared Mahalanobis
+// distance from the cluster.
+int SpikeSorter::mostLikelyCluster(const LaneState *state, const double *features, double &distance) const
+{
+    const int numFeatures = SPIKE_SORTER_NUM_FEATURES;
+    int cluster = -1;
+    double best = 0.0;
+    distance = 0.0;
+
+    for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+        if (state->clusterSpikes[k] == 0) continue;
+        double d2 = 0.0;
+        double logVariance = 0.0;
+        for (int i = 0; i < numFeatures; ++i) {
+            double d = features[i] - state->centroids[k * numFeatures + i];
+            d2 += d * d / state->variance[k][i];
+            logVariance += log(state->variance[k][i]);
+        }
+        double score = d2 + logVariance;
+        if (cluster < 0 || score < best) {
+            cluster = k;
+            best = score;
+            distance = d2;
+        }
+    }
+    return cluster;
+}
+
+// Normalize and orthogonalize the principal components (Gram-Schmidt), and
+// project all cluster templates onto the new basis.
+void SpikeSorter::updateBasis(LaneState *state)
+{
+    const int numFeatures = SPIKE_SORTER_NUM_FEATURES;
+    const int length = snippetLength;
+    double *basis = state->basis.data();
+
+    for (int i = 0; i < numFeatures; ++i) {
+        double *b = basis + i * length;
+        memcpy(b, state->components.constData() + i * length, length * sizeof(double));
+        for (int j = 0; j < i; ++j) {
+            const double *c = basis + j * length;
+            double projection = 0.0;
+            for (int s = 0; s < length; ++s) projection += b[s] * c[s];
+            for (int s = 0; s < length; ++s) b[s] -= projection * c[s];
+        }
+        double norm2 = 0.0;
+        for (int s = 0; s < length; ++s) norm2 += b[s] * b[s];
+        double scale = (norm2 > 0.0) ? 1.0 / sqrt(norm2) : 0.0;
+        for (int s = 0; s < length; ++s) b[s] *= scale;
+    }
+
+    for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+        if (state->clusterSpikes[k] == 0) continue;
+        const double *templ = state->templates.constData() + k * length;
+        for (int i = 0; i < numFeatures; ++i) {
+            double sum = 0.0;
+            for (int s = 0; s < length; ++s) sum += basis[i * length + s] * templ[s];
+            state->centroids[k * numFeatures + i] = sum;
+        }
+    }
+}
+
+// Merge any cluster that has come too close to cluster into it, keeping the
+// ID of whichever of the two has received more spikes.
+void SpikeSorter::mergeClusters(LaneState *state, int cluster)
+{
+    const int numFeatures = SPIKE_SORTER_NUM_FEATURES;
+    const int length = snippetLength;
+
+    for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+        if (k == cluster || state->clusterSpikes[k] == 0) continue;
+        double distance = 0.0;
+        for (int i = 0; i < numFeatures; ++i) {
+            double d = state->centroids[cluster * numFeatures + i] - state->centroids[k * numFeatures + i];
+            distance += d * d / (state->variance[cluster][i] + state->variance[k][i]);
+        }
+        if (distance >= MergeSigma * MergeSigma) continue;
+
+        int keep = (state->clusterSpikes[k] > state->clusterSpikes[cluster]) ? k : cluster;
+        int drop = (keep == k) ? cluster : k;
+        double keepWeight = qMin(state->clusterSpikes[keep], ClusterAdaptationSpikes);
+        double dropWeight = qMin(state->clusterSpikes[drop], ClusterAdaptationSpikes);
+        double fraction = dropWeight / (keepWeight + dropWeight);
+
+        double *keepTemplate = state->templates.data() + keep * length;
+        const double *dropTemplate = state->templates.constData() + drop * length;
+        for (int s = 0; s < length; ++s) {
+            keepTemplate[s] += fraction * (dropTemplate[s] - keepTemplate[s]);
+        }
+        for (int i = 0; i < numFeatures; ++i) {
+            state->centroids[keep * numFeatures + i] += fraction *
+                    (state->centroids[drop * numFeatures + i] - state->centroids[keep * numFeatures + i]);
+        }
+        for (int i = 0; i < numFeatures; ++i) {
+            state->variance[keep][i] = qMax(state->variance[keep][i], state->variance[drop][i]);
+        }
+        state->clusterSpikes[keep] += state->clusterSpikes[drop];
+        state->lastSpike[keep] = qMax(state->lastSpike[keep], state->lastSpike[drop]);
+        state->clusterSpikes[drop] = 0;
+        cluster = keep;
+    }
+}
+
+// Copy a lane's basis and established clusters to the published model.
+void SpikeSorter::publish(int lane, const LaneState *state)
+{
+    const int numFeatures = SPIKE_SORTER_NUM_FEATURES;
+    bool ready = (state->numSpikes >= MinSpikesForClustering);
+
+    QMutexLocker locker(&modelMutex);
+    Sample *basis = modelBasis.data() + lane * numFeatures * snippetLength;
+    Sample *model = modelClusters.data() + lane * SPIKE_SORTER_MAX_CLUSTERS * ClusterModelSize;
+
+    for (int i = 0; i < numFeatures * snippetLength; ++i) {
+        basis[i] = (Sample) state->basis[i];
+    }
+    for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+        Sample *centroid = model + k * ClusterModelSize;
+        Sample *inverseVariance = centroid + numFeatures;
+        if (ready && state->clusterSpikes[k] >= MinClusterSpikes) {
+            double logVariance = 0.0;
+            for (int i = 0; i < numFeatures; ++i) {
+                centroid[i] = (Sample) state->centroids[k * numFeatures + i];
+                inverseVariance[i] = (Sample) (1.0 / state->variance[k][i]);
+                logVariance += log(state->variance[k][i]);
+            }
+            inverseVariance[numFeatures] = (Sample) logVariance;
+        } else {
+            for (int i = 0; i < ClusterModelSize; ++i) centroid[i] = 0;
+        }
+    }
+}
+
+int SpikeSorter::getMaxClusters() const
+{
+    return maxClusters;
+}
+
+int SpikeSorter::getPreSamples() const
+{
+    return preSamples;
+}
+
+int SpikeSorter::getSnippetLength() const
+{
+    return snippetLength;
+}
+
+// Number of clusters currently published for lane.
+int SpikeSorter::getNumClusters(int lane) const
+{
+    QMutexLocker locker(&modelMutex);
+    int count = 0;
+    for (int k = 0; k < SPIKE_SORTER_MAX_CLUSTERS; ++k) {
+        if (modelClusters[(lane * SPIKE_SORTER_MAX_CLUSTERS + k) * ClusterModelSize + SPIKE_SORTER_NUM_FEATURES] != 0) ++count;
+    }
+    return count;
+}
+
+// Number of spikes that were labelled but not learned because the workers
+// fell behind, since the sorter was last reset.
+qint64 SpikeSorter::getDroppedSpikes() const
+{
+    return droppedSpikes;
+}
@@ -0,0 +1,154 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPIKESORTER_H
+#define SPIKESORTER_H
+
+#include <QVector>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include "globalconstants.h"
+
+class QThreadPool;
+class SpikeDetector;
+class SortTask;
+
+// Number of principal components used as waveform features, and the largest
+// number of clusters kept for one channel.
+#define SPIKE_SORTER_NUM_FEATURES 3
+#define SPIKE_SORTER_MAX_CLUSTERS 8
+
+// Online spike sorter for all amplifier channels, fed by SpikeDetector.
+//
+// Each detected spike is labelled at once in the acquisition thread with the
+// published model of its lane: the snippet is aligned to a fraction of a
+// sample on the centre of energy of its peak, projected onto the lane's
+// principal components, and the spike is assigned to the most likely cluster,
+// each cluster being modelled as a Gaussian with its own variance in each
+// feature, if it lies within that cluster's acceptance radius (otherwise it is
+// left unsorted, cluster 0).  This costs a few hundred multiplications per
+// spike and never waits for the model to be updated.
+//
+// The snippets are also queued for learning, which runs on low-priority
+// worker threads.  Whenever the previous batch has been learned, the queue is
+// handed to the workers, which claim lanes one at a time.  For each lane, the
+// principal components are updated spike by spike with candid covariance-free
+// incremental PCA, and clusters are maintained with a streaming k-means
+// update: a spike moves its most likely cluster's template and variances a
+// step towards itself, or starts a new cluster if it is outside every
+// acceptance radius.  Clusters
+// that come too close are merged, and clusters that stop receiving spikes are
+// dropped.  Templates are kept in waveform space, so they survive changes of
+// the principal components.  After each batch, the lane's components and
+// cluster centroids are published for the acquisition thread.  Cluster IDs are
+// the cluster's slot number, so they stay the same while the cluster exists.
+class SpikeSorter
+{
+public:
+    SpikeSorter();
+    ~SpikeSorter();
+
+    void setNumLanes(int numLanes_);
+    void setParameters(bool enabled_, int maxClusters_, int preSamples_, int snippetLength_);
+    void resetState();
+    bool isEnabled() const;
+
+    void sort(SpikeDetector &detector);
+    int classify(int lane, const Sample *snippet) const;
+
+    int getMaxClusters() const;
+    int getPreSamples() const;
+    int getSnippetLength() const;
+    int getNumClusters(int lane) const;
+    qint64 getDroppedSpikes() const;
+
+private:
+    friend class SortTask;
+
+    // Learning state of one lane.  Only the worker thread learning the lane's
+    // spikes touches it.
+    struct LaneState
+    {
+        int numSpikes;
+        QVector<double> mean;
+        QVector<double> components;     // NumFeatures x snippetLength, scaled by their eigenvalues
+        QVector<double> basis;          // normalized components
+        QVector<double> templates;      // MaxClusters x snippetLength
+        QVector<double> centroids;      // MaxClusters x NumFeatures, templates projected on basis
+        QVector<double> residual;
+        int clusterSpikes[SPIKE_SORTER_MAX_CLUSTERS];     // 0 for an unused slot
+        int lastSpike[SPIKE_SORTER_MAX_CLUSTERS];         // numSpikes when the cluster was last hit
+        double variance[SPIKE_SORTER_MAX_CLUSTERS][SPIKE_SORTER_NUM_FEATURES];
+    };
+
+    // Spike waiting to be learned.
+    struct PendingSpike
+    {
+        int lane;
+        double noise;
+        int snippetOffset;
+    };
+
+    bool enabled;
+    int maxClusters;
+    int preSamples;
+    int snippetLength;
+    int numLanes;
+
+    // Published models, written by the learning threads under modelMutex.
+    mutable QMutex modelMutex;
+    QVector<Sample> modelBasis;         // numLanes x NumFeatures x snippetLength
+    QVector<Sample> modelClusters;      // numLanes x MaxClusters x ClusterModelSize (see publish())
+
+    QVector<LaneState*> laneStates;
+
+    // Spikes collected while the workers learn the previous batch.
+    QVector<PendingSpike> pending;
+    QVector<Sample> pendingSnippets;
+    QVector<Sample> alignedSnippet;
+    qint64 droppedSpikes;
+
+    // Batch being learned, grouped by lane: the spikes of workLanes[i] are
+    // work[workOrder[workStart[i]]] ... work[workOrder[workStart[i + 1] - 1]].
+    QVector<PendingSpike> work;
+    QVector<Sample> workSnippets;
+    QVector<int> workOrder;
+    QVector<int> workStart;
+    QVector<int> workLanes;
+
+    QThreadPool *threadPool;
+    QAtomicInt learning;                // 1 while a batch is being learned
+    QAtomicInt activeTasks;
+    QAtomicInt nextWorkLane;
+
+    void waitForLearning();
+    void startLearning();
+    void learnLanes();
+    void learnSpike(LaneState *state, const Sample *snippet, double noise);
+    void updateBasis(LaneState *state);
+    int mostLikelyCluster(const LaneState *state, const double *features, double &distance) const;
+    void mergeClusters(LaneState *state, int cluster);
+    void publish(int lane, const LaneState *state);
+    int classifyLocked(int lane, const Sample *snippet) const;
+};
+
+#endif // SPIKESORTER_H
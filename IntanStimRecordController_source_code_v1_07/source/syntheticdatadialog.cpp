@@ -0,0 +1,158 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGui>
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtWidgets>
+#endif
+
+#include "syntheticdatadialog.h"
+#include "globalconstants.h"
+#include "rhs2000evalboard.h"
+
+// Synthesized data dialog.
+// In demonstration mode, this dialog sets the number of simulated headstage
+// data streams and the content of the synthesized waveforms, so that the full
+// processing pipeline can be loaded without hardware.
+
+SyntheticDataDialog::SyntheticDataDialog(const SyntheticDataSettings &settings, QWidget *parent) :
+    QDialog(parent)
+{
+    numStreamsSpinBox = new QSpinBox();
+    numStreamsSpinBox->setRange(1, MAX_NUM_DATA_STREAMS);
+    numStreamsSpinBox->setValue(settings.numStreams);
+
+    noiseSpinBox = new QDoubleSpinBox();
+    noiseSpinBox->setRange(0.0, 100.0);
+    noiseSpinBox->setDecimals(1);
+    noiseSpinBox->setSingleStep(0.5);
+    noiseSpinBox->setSuffix(" " + QSTRING_MU_SYMBOL + "V rms");
+    noiseSpinBox->setValue(settings.noiseRms);
+
+    spikeRateSpinBox = new QDoubleSpinBox();
+    spikeRateSpinBox->setRange(0.0, 10.0);
+    spikeRateSpinBox->setDecimals(1);
+    spikeRateSpinBox->setSingleStep(0.5);
+    spikeRateSpinBox->setPrefix(QString((QChar) 0x00d7) + " ");
+    spikeRateSpinBox->setValue(settings.spikeRateScale);
+
+    lfpAmplitudeSpinBox = new QDoubleSpinBox();
+    lfpAmplitudeSpinBox->setRange(0.0, 2000.0);
+    lfpAmplitudeSpinBox->setDecimals(0);
+    lfpAmplitudeSpinBox->setSingleStep(10.0);
+    lfpAmplitudeSpinBox->setSuffix(" " + QSTRING_MU_SYMBOL + "V");
+    lfpAmplitudeSpinBox->setSpecialValueText(tr("Off"));
+    lfpAmplitudeSpinBox->setValue(settings.lfpAmplitude);
+
+    lfpFrequencySpinBox = new QDoubleSpinBox();
+    lfpFrequencySpinBox->setRange(0.5, 100.0);
+    lfpFrequencySpinBox->setDecimals(1);
+    lfpFrequencySpinBox->setSuffix(" Hz");
+    lfpFrequencySpinBox->setValue(settings.lfpFrequency);
+
+    lineAmplitudeSpinBox = new QDoubleSpinBox();
+    lineAmplitudeSpinBox->setRange(0.0, 1000.0);
+    lineAmplitudeSpinBox->setDecimals(0);
+    lineAmplitudeSpinBox->setSingleStep(5.0);
+    lineAmplitudeSpinBox->setSuffix(" " + QSTRING_MU_SYMBOL + "V");
+    lineAmplitudeSpinBox->setSpecialValueText(tr("Off"));
+    lineAmplitudeSpinBox->setValue(settings.lineNoiseAmplitude);
+
+    lineFrequencyComboBox = new QComboBox();
+    lineFrequencyComboBox->addItem(tr("50 Hz"));
+    lineFrequencyComboBox->addItem(tr("60 Hz"));
+    lineFrequencyComboBox->setCurrentIndex(settings.lineFrequency == 50.0 ? 0 : 1);
+
+    artifactAmplitudeSpinBox = new QDoubleSpinBox();
+    artifactAmplitudeSpinBox->setRange(0.0, 5000.0);
+    artifactAmplitudeSpinBox->setDecimals(0);
+    artifactAmplitudeSpinBox->setSingleStep(100.0);
+    artifactAmplitudeSpinBox->setSuffix(" " + QSTRING_MU_SYMBOL + "V");
+    artifactAmplitudeSpinBox->setValue(settings.artifactAmplitude);
+
+    artifactRateSpinBox = new QDoubleSpinBox();
+    artifactRateSpinBox->setRange(0.0, 1000.0);
+    artifactRateSpinBox->setDecimals(1);
+    artifactRateSpinBox->setSuffix(" Hz");
+    artifactRateSpinBox->setSpecialValueText(tr("Off"));
+    artifactRateSpinBox->setValue(settings.artifactRate);
+
+    connect(lfpAmplitudeSpinBox, SIGNAL(valueChanged(double)), this, SLOT(updateControls()));
+    connect(lineAmplitudeSpinBox, SIGNAL(valueChanged(double)), this, SLOT(updateControls()));
+    connect(artifactRateSpinBox, SIGNAL(valueChanged(double)), this, SLOT(updateControls()));
+
+    QFormLayout *formLayout = new QFormLayout();
+    formLayout->addRow(tr("Simulated headstage data streams"), numStreamsSpinBox);
+    formLayout->addRow(tr("Background noise"), noiseSpinBox);
+    formLayout->addRow(tr("Spike rate"), spikeRateSpinBox);
+    formLayout->addRow(tr("Local field potential amplitude"), lfpAmplitudeSpinBox);
+    formLayout->addRow(tr("Local field potential frequency"), lfpFrequencySpinBox);
+    formLayout->addRow(tr("Line noise amplitude"), lineAmplitudeSpinBox);
+    formLayout->addRow(tr("Line frequency"), lineFrequencyComboBox);
+    formLayout->addRow(tr("Stimulation artifact rate"), artifactRateSpinBox);
+    formLayout->addRow(tr("Stimulation artifact amplitude"), artifactAmplitudeSpinBox);
+
+    QLabel *noteLabel = new QLabel(tr("Each data stream carries 16 amplifier channels; two streams are "
+                                      "assigned to each port.  Changing the number of data streams rescans "
+                                      "the ports.  Spikes and local field potentials are generated at "
+                                      "sample rates of 5 kS/s and above; ECG waveforms are generated at "
+                                      "lower sample rates."));
+    noteLabel->setWordWrap(true);
+
+    buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+
+    connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(noteLabel);
+    mainLayout->addWidget(buttonBox);
+
+    setLayout(mainLayout);
+
+    setWindowTitle(tr("Synthesized Data"));
+
+    updateControls();
+}
+
+// Enable the controls of the components that are turned on.
+void SyntheticDataDialog::updateControls()
+{
+    lfpFrequencySpinBox->setEnabled(lfpAmplitudeSpinBox->value() > 0.0);
+    lineFrequencyComboBox->setEnabled(lineAmplitudeSpinBox->value() > 0.0);
+    artifactAmplitudeSpinBox->setEnabled(artifactRateSpinBox->value() > 0.0);
+}
+
+SyntheticDataSettings SyntheticDataDialog::getSettings() const
+{
+    SyntheticDataSettings settings;
+    settings.numStreams = numStreamsSpinBox->value();
+    settings.noiseRms = noiseSpinBox->value();
+    settings.spikeRateScale = spikeRateSpinBox->value();
+    settings.lfpAmplitude = lfpAmplitudeSpinBox->value();
+    settings.lfpFrequency = lfpFrequencySpinBox->value();
+    settings.lineNoiseAmplitude = lineAmplitudeSpinBox->value();
+    settings.lineFrequency = (lineFrequencyComboBox->currentIndex() == 0) ? 50.0 : 60.0;
+    settings.artifactAmplitude = artifactAmplitudeSpinBox->value();
+    settings.artifactRate = artifactRateSpinBox->value();
+    return settings;
+}
@@ -0,0 +1,76 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SYNTHETICDATADIALOG_H
+#define SYNTHETICDATADIALOG_H
+
+#include <QDialog>
+
+class QDialogButtonBox;
+class QComboBox;
+class QSpinBox;
+class QDoubleSpinBox;
+
+// Content of synthesized data in demonstration mode.  Amplitudes are in
+// microvolts; an LFP or line noise amplitude of zero, or an artifact rate of
+// zero, turns that component off.
+struct SyntheticDataSettings
+{
+    int numStreams;
+    double noiseRms;
+    double spikeRateScale;
+    double lfpAmplitude;
+    double lfpFrequency;
+    double lineNoiseAmplitude;
+    double lineFrequency;
+    double artifactAmplitude;
+    double artifactRate;
+};
+
+class SyntheticDataDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit SyntheticDataDialog(const SyntheticDataSettings &settings, QWidget *parent);
+
+    SyntheticDataSettings getSettings() const;
+
+signals:
+
+public slots:
+
+private slots:
+    void updateControls();
+
+private:
+    QSpinBox *numStreamsSpinBox;
+    QDoubleSpinBox *noiseSpinBox;
+    QDoubleSpinBox *spikeRateSpinBox;
+    QDoubleSpinBox *lfpAmplitudeSpinBox;
+    QDoubleSpinBox *lfpFrequencySpinBox;
+    QDoubleSpinBox *lineAmplitudeSpinBox;
+    QComboBox *lineFrequencyComboBox;
+    QDoubleSpinBox *artifactAmplitudeSpinBox;
+    QDoubleSpinBox *artifactRateSpinBox;
+    QDialogButtonBox *buttonBox;
+};
+
+#endif // SYNTHETICDATADIALOG_H
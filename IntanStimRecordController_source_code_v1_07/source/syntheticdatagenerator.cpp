@@ -0,0 +1,434 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QDateTime>
+#include <qmath.h>
+
+#include "syntheticdatagenerator.h"
+#include "rhs2000datablock.h"
+
+// Spike and ECG waveform constants, as in earlier versions of demonstration mode
+static const double MaxSpikeDelayMsec = 0.3;       // random time jitter of spike onset
+static const double SecondSpikeTypeProbability = 0.3;
+static const double EcgPeriodMsec = 840.0;
+
+// Stimulation artifact waveform: a biphasic pulse followed by an exponential tail
+static const double ArtifactPhaseMsec = 0.2;
+static const double ArtifactTailMsec = 1.0;        // time constant of the tail
+static const double ArtifactTailFraction = 0.25;   // size of the tail relative to the pulse
+static const double ArtifactLengthMsec = 5.0;
+
+// Worker for generate(): generates blocks until none are left.
+class SyntheticBlockTask : public QRunnable
+{
+public:
+    SyntheticBlockTask(SyntheticDataGenerator *generator_) : generator(generator_) { setAutoDelete(true); }
+
+    void run() override
+    {
+        generator->generateBlocks();
+        generator->tasksDone.release();
+    }
+
+private:
+    SyntheticDataGenerator *generator;
+};
+
+// Constructor.
+SyntheticDataGenerator::SyntheticDataGenerator()
+{
+    numStreams = 0;
+    numLanes = 0;
+
+    noiseRms = 2.4;     // realistic background noise (would be more in cortex)
+    spikeRateScale = 1.0;
+    lfpAmplitude = 0.0;
+    lfpFrequency = 8.0;
+    lineNoiseAmplitude = 0.0;
+    lineFrequency = 60.0;
+    artifactAmplitude = 0.0;
+    artifactRate = 0.0;
+
+    seed = (quint64) QDateTime::currentMSecsSinceEpoch();
+    sampleCounter = 0;
+    templateSampleRate = 0.0;
+    artifactPeriod = 0;
+
+    blockCodes = nullptr;
+    numBlocksToGenerate = 0;
+    firstSample = 0;
+    blockSampleRate = 0.0;
+
+    initZiggurat();
+}
+
+// Set the number of data streams and assign random waveform parameters to every
+// channel.
+void SyntheticDataGenerator::setNumStreams(int numStreams_)
+{
+    numStreams = numStreams_;
+    numLanes = numStreams * CHANNELS_PER_STREAM;
+
+    spikeAmplitude.resize(2 * numLanes);
+    spikeDuration.resize(2 * numLanes);
+    spikeRate.resize(numLanes);
+    ecgAmplitude.resize(numLanes);
+    lfpCos.resize(numLanes);
+    lfpSin.resize(numLanes);
+    lineCos.resize(numLanes);
+    lineSin.resize(numLanes);
+    artifactGain.resize(numLanes);
+
+    quint64 x = seed;
+    RandomState state;
+    for (int i = 0; i < 4; i += 2) {
+        quint64 z = splitMix64(x);
+        state.s[i] = (quint32) z;
+        state.s[i + 1] = (quint32) (z >> 32);
+    }
+
+    for (int lane = 0; lane < numLanes; ++lane) {
+        ecgAmplitude[lane] = 0.5 + 2.5 * uniform(state);
+        for (int spikeNum = 0; spikeNum < 2; ++spikeNum) {
+            spikeAmplitude[2 * lane + spikeNum] = -400.0 + 500.0 * uniform(state);
+            spikeDuration[2 * lane + spikeNum] = 0.3 + 1.4 * uniform(state);
+        }
+        spikeRate[lane] = 0.1 + 4.9 * uniform(state);
+
+        // Nearby electrodes see similar field potentials and line noise, so only the
+        // size and a small phase shift vary from channel to channel.
+        double gain = 0.5 + 0.5 * uniform(state);
+        double phase = 0.5 * uniform(state);
+        lfpCos[lane] = gain * qCos(phase);
+        lfpSin[lane] = gain * qSin(phase);
+        gain = 0.5 + 0.5 * uniform(state);
+        phase = 0.2 * uniform(state);
+        lineCos[lane] = gain * qCos(phase);
+        lineSin[lane] = gain * qSin(phase);
+        artifactGain[lane] = 0.5 + uniform(state);
+    }
+
+    templateSampleRate = 0.0;
+}
+
+// Set the signal content.  noiseRms is the background noise level, and
+// lfpAmplitude, lineNoiseAmplitude and artifactAmplitude the largest amplitudes
+// of the local field potential, line noise and stimulation artifacts, all in
+// microvolts.  spikeRateScale multiplies the spike rate of every channel.
+// Stimulation artifacts occur artifactRate times per second on all channels.
+void SyntheticDataGenerator::setParameters(double noiseRms_, double spikeRateScale_,
+                                           double lfpAmplitude_, double lfpFrequency_,
+                                           double lineNoiseAmplitude_, double lineFrequency_,
+                                           double artifactAmplitude_, double artifactRate_)
+{
+    noiseRms = noiseRms_;
+    spikeRateScale = spikeRateScale_;
+    lfpAmplitude = lfpAmplitude_;
+    lfpFrequency = lfpFrequency_;
+    lineNoiseAmplitude = lineNoiseAmplitude_;
+    lineFrequency = lineFrequency_;
+    artifactAmplitude = artifactAmplitude_;
+    artifactRate = artifactRate_;
+
+    templateSampleRate = 0.0;
+}
+
+// Generate numBlocks data blocks of synthetic amplifier data into codes.  Blocks
+// are divided among the calling thread and the threads of threadPool, if not null.
+void SyntheticDataGenerator::generate(qint16 *codes, int numBlocks, double sampleRate, QThreadPool *threadPool)
+{
+    if (sampleRate != templateSampleRate) {
+        updateTemplates(sampleRate);
+    }
+
+    blockCodes = codes;
+    if (blockMicrovolts.size() < SAMPLES_PER_DATA_BLOCK * numBlocks * numLanes) {
+        blockMicrovolts.resize(SAMPLES_PER_DATA_BLOCK * numBlocks * numLanes);
+    }
+    numBlocksToGenerate = numBlocks;
+    firstSample = sampleCounter;
+    blockSampleRate = sampleRate;
+    nextBlock.store(0);
+
+    int numWorkers = threadPool ? qMin(numBlocks - 1, threadPool->maxThreadCount()) : 0;
+    for (int i = 0; i < numWorkers; ++i) {
+        threadPool->start(new SyntheticBlockTask(this));
+    }
+    generateBlocks();
+    tasksDone.acquire(numWorkers);
+
+    sampleCounter += SAMPLES_PER_DATA_BLOCK * numBlocks;
+}
+
+// Generate blocks until none are left.  Called concurrently by generate() and the
+// pool threads; blocks never share state or output, so no locking is needed.
+void SyntheticDataGenerator::generateBlocks()
+{
+    int block;
+    while ((block = nextBlock.fetchAndAddRelaxed(1)) < numBlocksToGenerate) {
+        generateBlock(block);
+    }
+}
+
+// Generate one data block.
+void SyntheticDataGenerator::generateBlock(int block)
+{
+    const qint64 blockStart = firstSample + (qint64) SAMPLES_PER_DATA_BLOCK * block;
+    const double tStepMsec = 1000.0 / blockSampleRate;
+    Sample *out = blockMicrovolts.data() + (qint64) SAMPLES_PER_DATA_BLOCK * block * numLanes;
+    int t, lane;
+
+    // Each block has its own random number sequence, seeded from its position.
+    quint64 x = seed ^ ((quint64) blockStart * 0x9e3779b97f4a7c15ULL);
+    RandomState state;
+    for (int i = 0; i < 4; i += 2) {
+        quint64 z = splitMix64(x);
+        state.s[i] = (quint32) z;
+        state.s[i + 1] = (quint32) (z >> 32);
+    }
+
+    // Background Gaussian noise
+    const float noiseScale = noiseRms;
+    for (int i = 0; i < SAMPLES_PER_DATA_BLOCK * numLanes; ++i) {
+        out[i] = noiseScale * gaussian(state);
+    }
+
+    // If the sample rate is 5 kS/s or higher, generate synthetic neural data;
+    // otherwise, generate synthetic ECG data.
+    if (blockSampleRate > 4999.9) {
+        if (lfpAmplitude > 0.0) {
+            for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
+                double cycles = lfpFrequency * (blockStart + t) / blockSampleRate;
+                double phase = TWO_PI * (cycles - qFloor(cycles));
+                const Sample s = lfpAmplitude * qSin(phase);
+                const Sample c = lfpAmplitude * qCos(phase);
+                Sample *row = out + t * numLanes;
+                for (lane = 0; lane < numLanes; ++lane) {
+                    row[lane] += lfpCos[lane] * s + lfpSin[lane] * c;
+                }
+            }
+        }
+
+        // At most one spike per channel per block, with a random onset delay
+        for (lane = 0; lane < numLanes; ++lane) {
+            if (uniform(state) < spikeRate[lane] * spikeRateScale * tStepMsec) {
+                int delay = (int) (uniform(state) * MaxSpikeDelayMsec / tStepMsec);
+                int spikeNum = (uniform(state) < SecondSpikeTypeProbability) ? 1 : 0;
+                const QVector<Sample> &spike = spikeTemplate[2 * lane + spikeNum];
+                int length = qMin(spike.size(), SAMPLES_PER_DATA_BLOCK - delay - 1);
+                for (int i = 0; i < length; ++i) {
+                    out[(delay + 1 + i) * numLanes + lane] += spike[i];
+                }
+            }
+        }
+    } else {
+        for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
+            double tMsec = (blockStart + t) * tStepMsec;
+            const Sample ecgValue = ecgWaveform(tMsec - EcgPeriodMsec * qFloor(tMsec / EcgPeriodMsec));
+            Sample *row = out + t * numLanes;
+            for (lane = 0; lane < numLanes; ++lane) {
+                row[lane] += ecgAmplitude[lane] * ecgValue;
+            }
+        }
+    }
+
+    if (lineNoiseAmplitude > 0.0) {
+        for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
+            double cycles = lineFrequency * (blockStart + t) / blockSampleRate;
+            double phase = TWO_PI * (cycles - qFloor(cycles));
+            const Sample s = lineNoiseAmplitude * qSin(phase);
+            const Sample c = lineNoiseAmplitude * qCos(phase);
+            Sample *row = out + t * numLanes;
+            for (lane = 0; lane < numLanes; ++lane) {
+                row[lane] += lineCos[lane] * s + lineSin[lane] * c;
+            }
+        }
+    }
+
+    if (artifactPeriod > 0 && artifactAmplitude > 0.0) {
+        for (t = 0; t < SAMPLES_PER_DATA_BLOCK; ++t) {
+            int phase = (blockStart + t) % artifactPeriod;
+            if (phase >= artifactTemplate.size()) continue;
+            const Sample value = artifactAmplitude * artifactTemplate[phase];
+            Sample *row = out + t * numLanes;
+            for (lane = 0; lane < numLanes; ++lane) {
+                row[lane] += artifactGain[lane] * value;
+            }
+        }
+    }
+
+    qint16 *codes = blockCodes + (qint64) SAMPLES_PER_DATA_BLOCK * block * numLanes;
+    for (int i = 0; i < SAMPLES_PER_DATA_BLOCK * numLanes; ++i) {
+        codes[i] = amplifierCode(out[i]);
+    }
+}
+
+// Sample the spike and stimulation artifact waveforms at sampleRate.
+void SyntheticDataGenerator::updateTemplates(double sampleRate)
+{
+    const double tStepMsec = 1000.0 / sampleRate;
+
+    // Spike waveforms start one sample after their onset delay.
+    spikeTemplate.resize(2 * numLanes);
+    for (int i = 0; i < 2 * numLanes; ++i) {
+        QVector<Sample> &spike = spikeTemplate[i];
+        spike.clear();
+        for (int t = 1; t * tStepMsec < spikeDuration[i]; ++t) {
+            double tMsec = t * tStepMsec;
+            spike.append(spikeAmplitude[i] * qExp(-2.0 * tMsec) * qSin(TWO_PI * tMsec / spikeDuration[i]));
+        }
+    }
+
+    artifactTemplate.resize(qCeil(ArtifactLengthMsec / tStepMsec));
+    for (int t = 0; t < artifactTemplate.size(); ++t) {
+        double tMsec = t * tStepMsec;
+        if (tMsec < ArtifactPhaseMsec) {
+            artifactTemplate[t] = 1.0;
+        } else if (tMsec < 2.0 * ArtifactPhaseMsec) {
+            artifactTemplate[t] = -1.0;
+        } else {
+            artifactTemplate[t] = ArtifactTailFraction * qExp(-(tMsec - 2.0 * ArtifactPhaseMsec) / ArtifactTailMsec);
+        }
+    }
+    artifactPeriod = (artifactRate > 0.0) ? qMax(1, qRound(sampleRate / artifactRate)) : 0;
+
+    templateSampleRate = sampleRate;
+}
+
+// ECG waveform at time tMsec (0-840 ms) into a heartbeat, pieced together from half
+// sine waves modelling the QRS complex, P wave, and T wave.
+double SyntheticDataGenerator::ecgWaveform(double tMsec)
+{
+    if (tMsec < 80.0) {
+        return 40.0 * qSin(TWO_PI * tMsec / 160.0); // P wave
+    } else if (tMsec > 100.0 && tMsec < 120.0) {
+        return -250.0 * qSin(TWO_PI * (tMsec - 100.0) / 40.0); // Q
+    } else if (tMsec > 120.0 && tMsec < 180.0) {
+        return 1000.0 * qSin(TWO_PI * (tMsec - 120.0) / 120.0); // R
+    } else if (tMsec > 180.0 && tMsec < 260.0) {
+        return -120.0 * qSin(TWO_PI * (tMsec - 180.0) / 160.0); // S
+    } else if (tMsec > 340.0 && tMsec < 400.0) {
+        return 60.0 * qSin(TWO_PI * (tMsec - 340.0) / 120.0); // T wave
+    }
+    return 0.0;
+}
+
+// SplitMix64, used to expand seeds into generator states.
+quint64 SyntheticDataGenerator::splitMix64(quint64 &x)
+{
+    quint64 z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Next 32-bit output of the xoshiro128++ generator.
+inline quint32 SyntheticDataGenerator::nextRandom(RandomState &state)
+{
+    quint32 *s = state.s;
+    const quint32 sum = s[0] + s[3];
+    const quint32 result = ((sum << 7) | (sum >> 25)) + s[0];
+    const quint32 t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+    return result;
+}
+
+// Random number from a uniform distribution in (0.0, 1.0].
+inline float SyntheticDataGenerator::uniform(RandomState &state)
+{
+    return ((nextRandom(state) >> 8) + 1) * (1.0f / 16777216.0f);
+}
+
+// Random number from a Gaussian distribution with variance 1.0, by the ziggurat
+// method: a random word picks one of 128 layers and a position in it, and the
+// position is returned directly unless it falls outside the layer's rectangle
+// under the Gaussian curve (about 1% of the time).
+inline float SyntheticDataGenerator::gaussian(RandomState &state) const
+{
+    const qint32 hz = (qint32) nextRandom(state);
+    const int iz = hz & 127;
+    const quint32 magnitude = (hz < 0) ? 0u - (quint32) hz : (quint32) hz;
+    if (magnitude < kn[iz]) {
+        return hz * wn[iz];
+    }
+    return gaussianTail(state, hz, iz);
+}
+
+// Slow path of gaussian(): sample the edge of a layer, or the tail beyond the
+// base layer.
+float SyntheticDataGenerator::gaussianTail(RandomState &state, qint32 hz, int iz) const
+{
+    const float r = 3.442620f;     // start of the tail
+    for (;;) {
+        float x = hz * wn[iz];
+        if (iz == 0) {
+            float y;
+            do {
+                x = -qLn(uniform(state)) / r;
+                y = -qLn(uniform(state));
+            } while (y + y < x * x);
+            return (hz > 0) ? r + x : -r - x;
+        }
+        if (fn[iz] + uniform(state) * (fn[iz - 1] - fn[iz]) < qExp(-0.5f * x * x)) {
+            return x;
+        }
+
+        hz = (qint32) nextRandom(state);
+        iz = hz & 127;
+        const quint32 magnitude = (hz < 0) ? 0u - (quint32) hz : (quint32) hz;
+        if (magnitude < kn[iz]) {
+            return hz * wn[iz];
+        }
+    }
+}
+
+// Build the ziggurat tables for 128 layers (Marsaglia and Tsang, 2000).
+void SyntheticDataGenerator::initZiggurat()
+{
+    const double m1 = 2147483648.0;
+    const double vn = 9.91256303526217e-3;     // area of each layer
+    double dn = 3.442619855899;
+    double tn = dn;
+
+    double q = vn / qExp(-0.5 * dn * dn);
+    kn[0] = (quint32) ((dn / q) * m1);
+    kn[1] = 0;
+    wn[0] = q / m1;
+    wn[127] = dn / m1;
+    fn[0] = 1.0f;
+    fn[127] = qExp(-0.5 * dn * dn);
+
+    for (int i = 126; i >= 1; --i) {
+        dn = qSqrt(-2.0 * qLn(vn / dn + qExp(-0.5 * dn * dn)));
+        kn[i + 1] = (quint32) ((dn / tn) * m1);
+        tn = dn;
+        fn[i] = qExp(-0.5 * dn * dn);
+        wn[i] = dn / m1;
+    }
+}
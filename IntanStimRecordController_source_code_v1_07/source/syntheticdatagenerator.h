@@ -0,0 +1,128 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SYNTHETICDATAGENERATOR_H
+#define SYNTHETICDATAGENERATOR_H
+
+#include <QVector>
+#include <QAtomicInt>
+#include <QSemaphore>
+
+#include "globalconstants.h"
+
+class QThreadPool;
+
+// Synthetic amplifier data for demonstration mode and load testing.
+//
+// Writes time-major signed ADC codes (sample t of the lane for stream s and
+// channel c at codes[t * numLanes + c * numStreams + s], the layout of
+// SignalProcessor::amplifierPreFilterFast).  Each block is generated in
+// microvolts and then rounded to codes, as the amplifier would digitize it.  At sample rates of 5 kS/s and above
+// each channel carries Gaussian background noise and two spike types, plus an
+// optional local field potential; below 5 kS/s it carries an ECG waveform.  Line
+// noise and periodic stimulation artifacts can be added in either case.
+//
+// Noise comes from a xoshiro128++ generator and Marsaglia and Tsang's ziggurat
+// method, which needs one random word and a table lookup for almost every
+// sample.  Spike waveforms are sampled once per sample rate, and oscillations
+// are evaluated once per time step and scaled for each lane, so the cost per
+// sample is a few multiply-adds.  Every data block is generated from its own
+// seed and from its absolute sample index, so blocks are independent: they are
+// divided among the threads of a thread pool, and the data do not depend on the
+// number of threads.
+class SyntheticDataGenerator
+{
+public:
+    SyntheticDataGenerator();
+
+    void setNumStreams(int numStreams_);
+    void setParameters(double noiseRms_, double spikeRateScale_, double lfpAmplitude_, double lfpFrequency_,
+                       double lineNoiseAmplitude_, double lineFrequency_,
+                       double artifactAmplitude_, double artifactRate_);
+    void generate(qint16 *codes, int numBlocks, double sampleRate, QThreadPool *threadPool);
+
+private:
+    friend class SyntheticBlockTask;
+
+    // xoshiro128++ generator state
+    struct RandomState
+    {
+        quint32 s[4];
+    };
+
+    int numStreams;
+    int numLanes;
+
+    double noiseRms;
+    double spikeRateScale;
+    double lfpAmplitude;
+    double lfpFrequency;
+    double lineNoiseAmplitude;
+    double lineFrequency;
+    double artifactAmplitude;
+    double artifactRate;
+
+    quint64 seed;
+    qint64 sampleCounter;           // absolute index of the next sample generated
+
+    // Per-lane waveform parameters, assigned at random by setNumStreams()
+    QVector<double> spikeAmplitude;     // two spike types per lane, in microvolts
+    QVector<double> spikeDuration;      // in milliseconds
+    QVector<double> spikeRate;          // relative spike rate of each lane
+    QVector<double> ecgAmplitude;       // relative ECG amplitude of each lane
+    QVector<Sample> lfpCos, lfpSin;     // LFP phase of each lane, as cos and sin
+    QVector<Sample> lineCos, lineSin;   // line noise phase of each lane
+    QVector<Sample> artifactGain;       // relative stimulation artifact size of each lane
+
+    // Spike and stimulation artifact waveforms sampled at templateSampleRate
+    double templateSampleRate;
+    QVector<QVector<Sample> > spikeTemplate;    // indexed by lane * 2 + spike type
+    QVector<Sample> artifactTemplate;
+    int artifactPeriod;
+
+    // Ziggurat tables
+    quint32 kn[128];
+    float wn[128];
+    float fn[128];
+
+    // Work shared with the pool threads during generate()
+    qint16 *blockCodes;
+    QVector<Sample> blockMicrovolts;
+    int numBlocksToGenerate;
+    qint64 firstSample;
+    double blockSampleRate;
+    QAtomicInt nextBlock;
+    QSemaphore tasksDone;
+
+    void initZiggurat();
+    void updateTemplates(double sampleRate);
+    void generateBlocks();
+    void generateBlock(int block);
+
+    static quint64 splitMix64(quint64 &x);
+    static inline quint32 nextRandom(RandomState &state);
+    static inline float uniform(RandomState &state);
+    inline float gaussian(RandomState &state) const;
+    float gaussianTail(RandomState &state, qint32 hz, int iz) const;
+    static double ecgWaveform(double tMsec);
+};
+
+#endif // SYNTHETICDATAGENERATOR_H
@@ -0,0 +1,41 @@
+TEMPLATE      = app
+TARGET        = kerneltest
+
+QT           -= gui
+
+CONFIG       += console c++11
+CONFIG       -= app_bundle
+
+# "qmake CONFIG+=float" builds the single-precision variant of the kernels, as
+# SIGNAL_PROCESSOR_FLOAT does in the main project file.
+float {
+    DEFINES  += SIGNAL_PROCESSOR_FLOAT
+    TARGET    = kerneltest-float
+}
+
+# SSE2 for 32-bit GCC and Clang, as in the main project file.
+!msvc:contains(QT_ARCH, i386): QMAKE_CXXFLAGS += -msse2 -mfpmath=sse
+
+INCLUDEPATH  += ../..
+
+HEADERS       = \
+    ../../globalconstants.h \
+    ../../samplevector.h \
+    ../../multichannelbiquad.h \
+    ../../multichannelnotch.h \
+    ../../multichannelfixednotch.h \
+    ../../multichannelfixedbiquad.h \
+    ../../filterdesign.h \
+    ../../filterbank.h \
+    ../../signalqualitymonitor.h \
+    ../../waveformdecimator.h
+
+SOURCES       = main.cpp \
+    ../../multichannelbiquad.cpp \
+    ../../multichannelnotch.cpp \
+    ../../multichannelfixednotch.cpp \
+    ../../multichannelfixedbiquad.cpp \
+    ../../filterdesign.cpp \
+    ../../filterbank.cpp \
+    ../../signalqualitymonitor.cpp \
+    ../../waveformdecimator.cpp
@@ -0,0 +1,619 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QPointF>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <cstring>
+
+#include "globalconstants.h"
+#include "multichannelnotch.h"
+#include "multichannelfixednotch.h"
+#include "multichannelfixedbiquad.h"
+#include "multichannelbiquad.h"
+#include "filterbank.h"
+#include "filterdesign.h"
+#include "signalqualitymonitor.h"
+#include "waveformdecimator.h"
+
+using namespace std;
+
+// kerneltest: accuracy and speed checks of the signal processing kernels.
+//
+// Usage: kerneltest [<test> ...]
+//
+// Runs the named tests, or all of them, on synthetic amplifier data.  Each
+// test prints the largest deviation of a kernel from a plain double-precision
+// reference computed here, the limit it is checked against, and the speed of
+// the kernel in ns per sample (one lane, one time step), measured over lane
+// chunks of the size SignalProcessor uses.  Exits with status 1 if any
+// deviation exceeds its limit.
+//
+// Kernels working on Sample data run in the precision the program is built
+// with: build it once as is and once with "qmake CONFIG+=float" (which defines
+// SIGNAL_PROCESSOR_FLOAT) to check and time both builds on the same input.
+
+// Lanes per chunk, as FILTER_LANES_PER_CHUNK in SignalProcessor
+static const int LanesPerChunk = 128 / sizeof(Sample);
+
+// Frames per call, as for SignalProcessor::filterData() with eight USB data
+// blocks of 128 samples
+static const int FramesPerCall = 8 * 128;
+
+// Synthetic time-major amplifier data, as signed amplifier codes: Gaussian
+// noise, a DC offset, mains interference with harmonics, a slow oscillation,
+// and, on a few lanes, steps to the rails and back.
+struct AmplifierData
+{
+    int numLanes;
+    int numFrames;
+    double sampleRate;
+    QVector<qint16> codes;
+};
+
+static AmplifierData makeAmplifierData(int numLanes, double seconds, double sampleRate, double lineFrequency)
+{
+    AmplifierData data;
+    data.numLanes = numLanes;
+    data.numFrames = FramesPerCall * (int) ceil(seconds * sampleRate / FramesPerCall);
+    data.sampleRate = sampleRate;
+    data.codes.resize(data.numLanes * data.numFrames);
+
+    mt19937 generator(1);
+    normal_distribution<double> noise(0.0, 10.0);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    QVector<double> offset(numLanes), phase(numLanes);
+    for (int lane = 0; lane < numLanes; ++lane) {
+        offset[lane] = 4000.0 * (uniform(generator) - 0.5);
+        phase[lane] = TWO_PI * uniform(generator);
+    }
+    for (int t = 0; t < data.numFrames; ++t) {
+        double time = t / sampleRate;
+        for (int lane = 0; lane < numLanes; ++lane) {
+            double x = offset[lane] + noise(generator) + 80.0 * sin(TWO_PI * 7.0 * time + phase[lane]);
+            for (int h = 1; h <= 4; ++h) {
+                x += (200.0 / h) * sin(TWO_PI * h * lineFrequency * time + h * phase[lane]);
+            }
+            if (lane % 16 == 5 && (t / FramesPerCall) % 8 == 3) {
+                x = (lane % 32 == 5) ? 1.0e5 : -1.0e5;
+            }
+            double code = x / AMPLIFIER_MICROVOLTS_PER_BIT;
+            data.codes[t * numLanes + lane] = (qint16) qBound(-32768.0, floor(code + 0.5), 32767.0);
+        }
+    }
+    return data;
+}
+
+static double nsPerSample(qint64 nsec, int numLanes, int numFrames, int repeats)
+{
+    return (double) nsec / ((double) numLanes * numFrames * repeats);
+}
+
+// Notch and highpass filter settings checked by the fixedfilters and
+// samplefilters tests.
+struct NotchSetting
+{
+    double sampleRate;
+    double lineFrequency;
+    int numHarmonics;
+    double highpassCutoff;
+};
+
+static const NotchSetting NotchSettings[] = {
+    { 30000.0, 60.0, 1, 1.0 },
+    { 30000.0, 60.0, 4, 0.1 },
+    { 20000.0, 50.0, 8, 300.0 },
+    { 1000.0, 50.0, 1, 1.0 }
+};
+
+static const double NotchBandwidth = 10.0;
+
+// Highpass filter pole, as in SignalProcessor::setHighpassFilter()
+static double highpassPole(const NotchSetting &setting)
+{
+    return exp(-1.0 * TWO_PI * setting.highpassCutoff / setting.sampleRate);
+}
+
+// Notch filter with numSections sections followed by the highpass filter, in
+// double precision, applied in place to one lane of data in microvolts.
+static void referenceNotchHighpass(QVector<double> &x, const NotchSetting &setting, int numSections)
+{
+    const int n = x.size();
+    double d = exp(-PI * NotchBandwidth / setting.sampleRate);
+    double gain = (1.0 + d * d) / 2.0;
+    double a2 = d * d;
+    for (int s = 0; s < numSections; ++s) {
+        double a1 = -(1.0 + d * d) * cos(2.0 * PI * (s + 1) * setting.lineFrequency / setting.sampleRate);
+        double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+        for (int t = 0; t < n; ++t) {
+            double y = gain * (x[t] + x2) + a1 * (x1 - y1) - a2 * y2;
+            x2 = x1;
+            x1 = x[t];
+            y2 = y1;
+            y1 = y;
+            x[t] = y;
+        }
+    }
+    double aHpf = highpassPole(setting);
+    double x1 = 0.0, y1 = 0.0;
+    for (int t = 0; t < n; ++t) {
+        double y = x[t] - x1 + aHpf * y1;
+        x1 = x[t];
+        y1 = y;
+        x[t] = y;
+    }
+}
+
+// Fixed-point mains notch (MultiChannelFixedNotch) followed by the fixed-point
+// highpass filter (MultiChannelFixedBiquad), as run by SignalProcessor in the
+// SIGNAL_PROCESSOR_FIXED_POINT build, against the same notch and highpass
+// filters in double precision, for several notch and highpass settings.  The
+// limit is the worst-case bound reported by the filters (the notch bound
+// passes through the highpass filter, whose L1 norm is 2), and is itself
+// required to be below one amplifier LSB.
+static bool testFixedFilters()
+{
+    const int numLanes = 128;
+    const double toMicrovolts = AMPLIFIER_MICROVOLTS_PER_BIT / (1 << MultiChannelFixedNotch::FractionBits);
+    bool pass = true;
+
+    for (const NotchSetting &setting : NotchSettings) {
+        AmplifierData data = makeAmplifierData(numLanes, 2.0, setting.sampleRate, setting.lineFrequency);
+        const int n = data.numFrames;
+
+        MultiChannelFixedNotch notch;
+        notch.setNumLanes(numLanes);
+        notch.setNotch(setting.lineFrequency, NotchBandwidth, setting.sampleRate, setting.numHarmonics);
+        MultiChannelFixedBiquad highpass;
+        highpass.setNumLanes(numLanes);
+        highpass.setCoefficients(1.0, -1.0, 0.0, -highpassPole(setting), 0.0);
+
+        QVector<qint32> fixedData(numLanes * n);
+        for (int i = 0; i < fixedData.size(); ++i) {
+            fixedData[i] = data.codes[i] * (1 << MultiChannelFixedNotch::FractionBits);
+        }
+        QElapsedTimer timer;
+        timer.start();
+        for (int t0 = 0; t0 < n; t0 += FramesPerCall) {
+            qint32 *block = fixedData.data() + t0 * numLanes;
+            for (int lane = 0; lane < numLanes; lane += LanesPerChunk) {
+                notch.filter(block, block, FramesPerCall, lane, lane + LanesPerChunk);
+                highpass.filter(block, block, FramesPerCall, lane, lane + LanesPerChunk);
+            }
+        }
+        double fixedNs = nsPerSample(timer.nsecsElapsed(), numLanes, n, 1);
+
+        // Double-precision reference, one lane at a time.
+        int numSections = notch.getNumSections();
+        double maxError = 0.0;
+        QVector<double> x(n);
+        timer.start();
+        for (int lane = 0; lane < numLanes; ++lane) {
+            for (int t = 0; t < n; ++t) {
+                x[t] = AMPLIFIER_MICROVOLTS_PER_BIT * data.codes[t * numLanes + lane];
+            }
+            referenceNotchHighpass(x, setting, numSections);
+            for (int t = 0; t < n; ++t) {
+                maxError = qMax(maxError, fabs(x[t] - toMicrovolts * fixedData[t * numLanes + lane]));
+            }
+        }
+        double referenceNs = nsPerSample(timer.nsecsElapsed(), numLanes, n, 1);
+
+        double inputPeak = 2.0 * 32768.0 * (1 << MultiChannelFixedNotch::FractionBits);
+        double bound = 2.0 * notch.errorBound(32768.0) + toMicrovolts * highpass.errorBound(inputPeak);
+        bool ok = maxError <= bound && bound < AMPLIFIER_MICROVOLTS_PER_BIT;
+        cout << "fixedfilters: " << setting.lineFrequency << " Hz notch x" << numSections << ", " <<
+                setting.highpassCutoff << " Hz highpass, " << setting.sampleRate / 1000.0 << " kS/s: " <<
+                "max error " << maxError << " uV (bound " << bound << " uV), " <<
+                fixedNs << " ns/sample (double reference " << referenceNs << " ns/sample)" <<
+                (ok ? "" : "  FAILED") << endl;
+        pass = pass && ok;
+    }
+    return pass;
+}
+
+// Floating-point mains notch (MultiChannelNotch) followed by the highpass filter
+// on MultiChannelBiquad, as run by SignalProcessor by default, in the precision
+// the program is built with, against the same double-precision reference as
+// fixedfilters.  The limit is one amplifier LSB in the double build.  In the
+// float build it is 10 uV: the notch poles lie within 0.002 of the unit circle
+// at high sample rates, which amplifies single-precision rounding of the mains
+// signal to several microvolts (see SIGNAL_PROCESSOR_FLOAT in the .pro file).
+static bool testSampleFilters()
+{
+    const int numLanes = 128;
+    const double maxErrorLimit = sizeof(Sample) == 4 ? 10.0 : AMPLIFIER_MICROVOLTS_PER_BIT;
+    bool pass = true;
+
+    for (const NotchSetting &setting : NotchSettings) {
+        AmplifierData data = makeAmplifierData(numLanes, 2.0, setting.sampleRate, setting.lineFrequency);
+        const int n = data.numFrames;
+
+        MultiChannelNotch notch;
+        notch.setNumLanes(numLanes);
+        notch.setNotch(setting.lineFrequency, NotchBandwidth, setting.sampleRate, setting.numHarmonics);
+        MultiChannelBiquad highpass;
+        highpass.setNumLanes(numLanes);
+        highpass.setCoefficients(1.0, -1.0, 0.0, -highpassPole(setting), 0.0);
+
+        QVector<Sample> sampleData(numLanes * n);
+        for (int i = 0; i < sampleData.size(); ++i) {
+            sampleData[i] = (Sample) AMPLIFIER_MICROVOLTS_PER_BIT * data.codes[i];
+        }
+        QElapsedTimer timer;
+        timer.start();
+        for (int t0 = 0; t0 < n; t0 += FramesPerCall) {
+            Sample *block = sampleData.data() + t0 * numLanes;
+            for (int lane = 0; lane < numLanes; lane += LanesPerChunk) {
+                notch.filter(block, block, FramesPerCall, lane, lane + LanesPerChunk);
+                highpass.filter(block, block, FramesPerCall, lane, lane + LanesPerChunk);
+            }
+        }
+        double sampleNs = nsPerSample(timer.nsecsElapsed(), numLanes, n, 1);
+
+        int numSections = notch.getNumSections();
+        double maxError = 0.0;
+        QVector<double> x(n);
+        for (int lane = 0; lane < numLanes; ++lane) {
+            for (int t = 0; t < n; ++t) {
+                x[t] = AMPLIFIER_MICROVOLTS_PER_BIT * data.codes[t * numLanes + lane];
+            }
+            referenceNotchHighpass(x, setting, numSections);
+            for (int t = 0; t < n; ++t) {
+                maxError = qMax(maxError, fabs(x[t] - sampleData[t * numLanes + lane]));
+            }
+        }
+
+        bool ok = maxError <= maxErrorLimit;
+        cout << "samplefilters: " << setting.lineFrequency << " Hz notch x" << numSections << ", " <<
+                setting.highpassCutoff << " Hz highpass, " << setting.sampleRate / 1000.0 << " kS/s, " <<
+                (sizeof(Sample) == 4 ? "float" : "double") << " (" << MultiChannelBiquad::instructionSet() <<
+                "): max error " << maxError << " uV (limit " << maxErrorLimit << " uV), " <<
+                sampleNs << " ns/sample" << (ok ? "" : "  FAILED") << endl;
+        pass = pass && ok;
+    }
+    return pass;
+}
+
+// The filter bank (FilterBank, run on MultiChannelBiquad in Sample precision) on
+// the output of the notch filter, as in SignalProcessor, against the same
+// cascades of sections from FilterDesign in double precision.  Run in both builds (see kerneltest.pro), this gives the
+// deviation of the float build from the double build, as well as the speed of
+// each.  The limits are those of the float build on this input, which steps
+// between the rails: half an amplifier LSB in the spike band, and 0.5 uV in
+// the LFP band, whose poles lie close to z = 1 where single-precision rounding
+// is amplified most.  The LFP limit exceeds two LSBs, so the float build is
+// documented as not LSB-accurate (see SIGNAL_PROCESSOR_FLOAT in the .pro
+// file); both limits are well below the amplifier noise of about 2.4 uV rms.
+static bool testFilterBank()
+{
+    struct Limit
+    {
+        FilterBankBand band;
+        double maxError;            // uV
+    };
+    Limit limits[2];
+    limits[0].band.name = "spike band";
+    limits[0].band.spec = { FilterButterworth, FilterBandpass, 4, 300.0, 6000.0, 0.0, 0.0 };
+    limits[0].maxError = 0.5 * AMPLIFIER_MICROVOLTS_PER_BIT;
+    limits[1].band.name = "LFP band";
+    limits[1].band.spec = { FilterElliptic, FilterLowpass, 6, 0.0, 250.0, 0.1, 60.0 };
+    limits[1].maxError = 0.5;
+    const int numBands = 2;
+    const double sampleRate = 30000.0;
+    const int numLanes = 128;
+
+    AmplifierData data = makeAmplifierData(numLanes, 2.0, sampleRate, 60.0);
+    const int n = data.numFrames;
+
+    QVector<Sample> in(numLanes * n);
+    for (int i = 0; i < in.size(); ++i) {
+        in[i] = (Sample) AMPLIFIER_MICROVOLTS_PER_BIT * data.codes[i];
+    }
+    MultiChannelNotch notch;
+    notch.setNumLanes(numLanes);
+    notch.setNotch(60.0, 10.0, sampleRate, 1);
+    for (int t0 = 0; t0 < n; t0 += FramesPerCall) {
+        Sample *block = in.data() + t0 * numLanes;
+        notch.filter(block, block, FramesPerCall, 0, numLanes);
+    }
+
+    QVector<FilterBankBand> bands;
+    for (int band = 0; band < numBands; ++band) {
+        bands.append(limits[band].band);
+    }
+    FilterBank filterBank;
+    filterBank.setNumLanes(numLanes, FramesPerCall);
+    filterBank.setBands(bands, sampleRate);
+    QVector<QVector<Sample> > out(numBands, QVector<Sample>(numLanes * n));
+
+    QElapsedTimer timer;
+    qint64 nsec = 0;
+    for (int t0 = 0; t0 < n; t0 += FramesPerCall) {
+        timer.start();
+        for (int lane = 0; lane < numLanes; lane += LanesPerChunk) {
+            filterBank.filter(in.constData() + t0 * numLanes, FramesPerCall, lane, lane + LanesPerChunk);
+        }
+        nsec += timer.nsecsElapsed();
+        for (int band = 0; band < numBands; ++band) {
+            memcpy(out[band].data() + t0 * numLanes, filterBank.getOutput(band), numLanes * FramesPerCall * sizeof(Sample));
+        }
+    }
+    double sampleNs = nsPerSample(nsec, numLanes, n, 1);
+
+    bool pass = true;
+    QVector<double> x(n);
+    for (int band = 0; band < numBands; ++band) {
+        QVector<BiquadSection> sections;
+        FilterDesign::design(limits[band].band.spec, sampleRate, sections);
+        double maxError = 0.0;
+        for (int lane = 0; lane < numLanes; ++lane) {
+            for (int t = 0; t < n; ++t) {
+                x[t] = in[t * numLanes + lane];
+            }
+            for (const BiquadSection &section : sections) {
+                double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+                for (int t = 0; t < n; ++t) {
+                    double y = section.b0 * x[t] + section.b1 * x1 + section.b2 * x2 - section.a1 * y1 - section.a2 * y2;
+                    x2 = x1;
+                    x1 = x[t];
+                    y2 = y1;
+                    y1 = y;
+                    x[t] = y;
+                }
+            }
+            for (int t = 0; t < n; ++t) {
+                maxError = qMax(maxError, fabs(x[t] - out[band][t * numLanes + lane]));
+            }
+        }
+        bool ok = maxError <= limits[band].maxError;
+        cout << "filterbank: " << qPrintable(limits[band].band.name) << ", " << sections.size() << " sections, " <<
+                (sizeof(Sample) == 4 ? "float" : "double") << ": max error " << maxError << " uV (limit " <<
+                limits[band].maxError << " uV)" << (ok ? "" : "  FAILED") << endl;
+        pass = pass && ok;
+    }
+    cout << "filterbank: " << (sizeof(Sample) == 4 ? "float" : "double") << " (" <<
+            MultiChannelBiquad::instructionSet() << ") " << sampleNs << " ns/sample for all bands" << endl;
+    return pass;
+}
+
+// Signal quality statistics of raw amplifier codes (SignalQualityMonitor::
+// measureRaw()): the line frequency amplitude of lanes that stay off the rails
+// against the 200 uV the test data carry, and the rail hit count of every lane
+// against a count of codes at the rails in the frames of the published windows.
+static bool testSignalQuality()
+{
+    const double sampleRate = 30000.0;
+    const int numLanes = 128;
+    const double maxAmplitudeError = 1.0;       // uV
+    AmplifierData data = makeAmplifierData(numLanes, 4.0, sampleRate, 60.0);
+    const int n = data.numFrames;
+
+    SignalQualityMonitor monitor;
+    monitor.setNumLanes(numLanes);
+    monitor.setParameters(true, 60.0, sampleRate);
+
+    QElapsedTimer timer;
+    qint64 nsec = 0;
+    int framesPublished = 0;
+    quint64 numUpdates = 0;
+    for (int t0 = 0; t0 < n; t0 += FramesPerCall) {
+        timer.start();
+        monitor.measureRaw(data.codes.constData() + t0 * numLanes, FramesPerCall);
+        monitor.finishBlock(FramesPerCall);
+        nsec += timer.nsecsElapsed();
+        if (monitor.getNumUpdates() != numUpdates) {
+            numUpdates = monitor.getNumUpdates();
+            framesPublished = t0 + FramesPerCall;
+        }
+    }
+    double rawNs = nsPerSample(nsec, numLanes, n, 1);
+
+    double maxError = 0.0;
+    int railErrors = 0;
+    for (int lane = 0; lane < numLanes; ++lane) {
+        qint64 railCodes = 0;
+        for (int t = 0; t < framesPublished; ++t) {
+            qint16 code = data.codes[t * numLanes + lane];
+            if (code == 32767 || code == -32768) ++railCodes;
+        }
+        if (monitor.getRailHits(lane) != railCodes) ++railErrors;
+        if (lane % 16 != 5) {
+            maxError = qMax(maxError, fabs(monitor.getMainsAmplitude(lane) - 200.0));
+        }
+    }
+
+    bool ok = numUpdates > 0 && maxError <= maxAmplitudeError && railErrors == 0;
+    cout << "signalquality: " << numUpdates << " windows, mains amplitude max error " << maxError <<
+            " uV (limit " << maxAmplitudeError << " uV), " << railErrors << " lanes with wrong rail counts, " <<
+            rawNs << " ns/sample" << (ok ? "" : "  FAILED") << endl;
+    return ok;
+}
+
+// Column extents (lowest and highest y) of the line segments of a polyline of
+// numPoints points, in pixel columns [0, numColumns).  Columns no segment
+// crosses get an empty range (low > high).
+static void polylineExtents(const QPointF *points, int numPoints, int numColumns,
+                            QVector<double> &low, QVector<double> &high)
+{
+    low.fill(1.0e30, numColumns);
+    high.fill(-1.0e30, numColumns);
+    for (int k = 0; k + 1 < numPoints; ++k) {
+        QPointF p0 = points[k];
+        QPointF p1 = points[k + 1];
+        if (p1.x() < p0.x()) qSwap(p0, p1);
+        int first = qMax(0, (int) floor(p0.x()));
+        int last = qMin(numColumns - 1, (int) floor(p1.x()));
+        for (int column = first; column <= last; ++column) {
+            double x0 = qMax((double) column, p0.x());
+            double x1 = qMin(column + 1.0, p1.x());
+            double y0 = p0.y(), y1 = p1.y();
+            if (p1.x() > p0.x()) {
+                double slope = (p1.y() - p0.y()) / (p1.x() - p0.x());
+                y0 = p0.y() + slope * (x0 - p0.x());
+                y1 = p0.y() + slope * (x1 - p0.x());
+            }
+            low[column] = qMin(low[column], qMin(y0, y1));
+            high[column] = qMax(high[column], qMax(y0, y1));
+        }
+    }
+}
+
+// Decimated WavePlot polylines (WaveformDecimator) against the full polylines
+// at several zoom levels: in every pixel column the decimated polyline must
+// cover the same range of y as the full one, so both light the same pixels.
+static bool testDecimator()
+{
+    const int length = 6000;
+    const double maxError = 1.0e-6;            // pixels
+    AmplifierData data = makeAmplifierData(1, 0.2, 30000.0, 60.0);
+    QVector<Sample> samples(length);
+    for (int i = 0; i < length; ++i) {
+        samples[i] = (Sample) (AMPLIFIER_MICROVOLTS_PER_BIT * data.codes[i]);
+    }
+    QVector<QPointF> full(length + 1), decimated(length + 1);
+    WaveformDecimator decimator;
+    const double scales[] = { 0.01, 0.05, 0.1, 0.2, 0.26, 0.5, 1.0 };
+
+    bool pass = true;
+    for (double xScale : scales) {
+        const int numColumns = (int) (xScale * length) + 1;
+        const double yScale = -0.01;
+        int numFull = decimator.buildPolyline(samples.constData(), length, xScale, 0.0, yScale, 100.0,
+                                              false, full.data());
+        int numDecimated = decimator.buildPolyline(samples.constData(), length, xScale, 0.0, yScale, 100.0,
+                                                   true, decimated.data());
+        QVector<double> lowFull, highFull, lowDecimated, highDecimated;
+        polylineExtents(full.constData() + 1, numFull, numColumns, lowFull, highFull);
+        polylineExtents(decimated.constData() + 1, numDecimated, numColumns, lowDecimated, highDecimated);
+        double error = 0.0;
+        for (int column = 0; column < numColumns; ++column) {
+            if (lowFull[column] > highFull[column]) continue;
+            error = qMax(error, qMax(fabs(lowFull[column] - lowDecimated[column]),
+                                     fabs(highFull[column] - highDecimated[column])));
+        }
+
+        const int repeats = 2000;
+        QElapsedTimer timer;
+        timer.start();
+        for (int r = 0; r < repeats; ++r) {
+            decimator.buildPolyline(samples.constData(), length, xScale, 0.0, yScale, 100.0, true, decimated.data());
+        }
+        double ns = nsPerSample(timer.nsecsElapsed(), 1, length, repeats);
+
+        bool ok = error <= maxError;
+        cout << "decimator: " << 1.0 / xScale << " samples/pixel: " << numFull << " -> " << numDecimated <<
+                " points, max extent error " << error << " px (limit " << maxError << " px), " << ns <<
+                " ns/sample" << (ok ? "" : "  FAILED") << endl;
+        pass = pass && ok;
+    }
+    return pass;
+}
+
+// The notch cascade in fixed point (MultiChannelFixedNotch) and in Sample
+// precision (MultiChannelNotch), for speed comparison.
+static bool benchmarkNotch()
+{
+    const int numLanes = 128;
+    const int numSections = 4;
+    AmplifierData data = makeAmplifierData(numLanes, 2.0, 30000.0, 60.0);
+    const int n = data.numFrames;
+
+    QVector<Sample> sampleData(numLanes * n);
+    QVector<qint32> fixedData(numLanes * n);
+    for (int i = 0; i < sampleData.size(); ++i) {
+        sampleData[i] = (Sample) AMPLIFIER_MICROVOLTS_PER_BIT * data.codes[i];
+        fixedData[i] = data.codes[i] * (1 << MultiChannelFixedNotch::FractionBits);
+    }
+    MultiChannelNotch notch;
+    notch.setNumLanes(numLanes);
+    notch.setNotch(60.0, 10.0, 30000.0, numSections);
+    MultiChannelFixedNotch fixedNotch;
+    fixedNotch.setNumLanes(numLanes);
+    fixedNotch.setNotch(60.0, 10.0, 30000.0, numSections);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int t0 = 0; t0 < n; t0 += FramesPerCall) {
+        Sample *block = sampleData.data() + t0 * numLanes;
+        for (int lane = 0; lane < numLanes; lane += LanesPerChunk) {
+            notch.filter(block, block, FramesPerCall, lane, lane + LanesPerChunk);
+        }
+    }
+    double sampleNs = nsPerSample(timer.nsecsElapsed(), numLanes, n, 1);
+
+    timer.start();
+    for (int t0 = 0; t0 < n; t0 += FramesPerCall) {
+        qint32 *block = fixedData.data() + t0 * numLanes;
+        for (int lane = 0; lane < numLanes; lane += LanesPerChunk) {
+            fixedNotch.filter(block, block, FramesPerCall, lane, lane + LanesPerChunk);
+        }
+    }
+    double fixedNs = nsPerSample(timer.nsecsElapsed(), numLanes, n, 1);
+
+    cout << "notchspeed: 60 Hz notch x" << numSections << ", 30 kS/s: fixed point " << fixedNs <<
+            " ns/sample, " << (sizeof(Sample) == 4 ? "float" : "double") << " (" <<
+            MultiChannelBiquad::instructionSet() << ") " << sampleNs << " ns/sample" << endl;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    struct Test
+    {
+        const char *name;
+        bool (*run)();
+    };
+    const Test tests[] = {
+        { "fixedfilters", testFixedFilters },
+        { "samplefilters", testSampleFilters },
+        { "filterbank", testFilterBank },
+        { "signalquality", testSignalQuality },
+        { "decimator", testDecimator },
+        { "notchspeed", benchmarkNotch }
+    };
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    int failures = 0;
+    int numRun = 0;
+    for (const Test &test : tests) {
+        if (args.isEmpty() || args.contains(test.name)) {
+            if (!test.run()) ++failures;
+            ++numRun;
+        }
+    }
+    if (numRun == 0) {
+        cerr << "Usage: kerneltest [fixedfilters | samplefilters | filterbank | signalquality | decimator | notchspeed] ..." << endl;
+        return 2;
+    }
+
+    cout << numRun << " tests run.  " << (failures == 0 ? "All passed." : "Failures found.") << endl;
+    return (failures == 0) ? 0 : 1;
+}
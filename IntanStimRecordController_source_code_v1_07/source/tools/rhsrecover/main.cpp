@@ -0,0 +1,159 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QDateTime>
+#include <iostream>
+
+#include "savejournal.h"
+#include "rhs2000datablock.h"
+
+using namespace std;
+
+// rhsrecover: trim a recording interrupted by a crash back to its last
+// consistent checkpoint.
+//
+// Usage: rhsrecover [--dry-run] <recording>.journal
+//
+// The journal written alongside each recording lists the data files and, at
+// each checkpoint, the length of every file at a data block boundary after it
+// was synced to disk.  This tool finds the latest checkpoint that every data
+// file still satisfies and truncates each file to the length recorded there,
+// discarding any partially written data beyond it.  With --dry-run, it only
+// reports what would be done.
+
+static void printUsage()
+{
+    cerr << "Usage: rhsrecover [--dry-run] <recording>.journal" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    bool dryRun = false;
+    if (!args.isEmpty() && args.first() == "--dry-run") {
+        dryRun = true;
+        args.removeFirst();
+    }
+    if (args.size() != 1) {
+        printUsage();
+        return 2;
+    }
+
+    QString journalFileName = args.first();
+    SaveJournalContents journal;
+    QString errorMessage;
+
+    if (!SaveJournal::readJournal(journalFileName, journal, errorMessage)) {
+        cerr << qPrintable(journalFileName) << ": " << qPrintable(errorMessage) << endl;
+        return 1;
+    }
+
+    cout << "Journal " << qPrintable(journalFileName) << ": " << journal.fileNames.size() << " data files, " <<
+            journal.records.size() << " valid checkpoints" <<
+            (journal.truncatedRecord ? " (damaged record at end ignored)" : "") << endl;
+
+    if (journal.records.isEmpty()) {
+        cerr << "No checkpoint was written before the recording stopped; the amount of valid data "
+                "cannot be determined." << endl;
+        return 1;
+    }
+
+    // Current length of each data file.
+    QDir journalDir = QFileInfo(journalFileName).absoluteDir();
+    QVector<qint64> fileSize(journal.fileNames.size());
+    for (int i = 0; i < journal.fileNames.size(); ++i) {
+        QFileInfo dataFileInfo(journalDir.filePath(journal.fileNames[i]));
+        if (!dataFileInfo.exists()) {
+            cerr << "Data file " << qPrintable(journal.fileNames[i]) << " is missing." << endl;
+            return 1;
+        }
+        fileSize[i] = dataFileInfo.size();
+    }
+
+    // Find the latest checkpoint that all data files still contain.
+    int consistentRecord = -1;
+    for (int r = journal.records.size() - 1; r >= 0; --r) {
+        bool allPresent = true;
+        for (int i = 0; i < fileSize.size(); ++i) {
+            if (fileSize[i] < journal.records[r].offsets[i]) {
+                allPresent = false;
+                break;
+            }
+        }
+        if (allPresent) {
+            consistentRecord = r;
+            break;
+        }
+    }
+    if (consistentRecord == -1) {
+        cerr << "Data files are shorter than every checkpoint; they may have been modified after recording." << endl;
+        return 1;
+    }
+
+    const SaveJournalRecord &record = journal.records[consistentRecord];
+
+    bool needsTrim = false;
+    for (int i = 0; i < fileSize.size(); ++i) {
+        if (fileSize[i] != record.offsets[i]) needsTrim = true;
+    }
+
+    if (record.closedCleanly && !needsTrim) {
+        cout << "Recording was closed normally; no recovery needed." << endl;
+        return 0;
+    }
+
+    double seconds = (journal.sampleRate > 0.0) ?
+                (double) record.blocksWritten * SAMPLES_PER_DATA_BLOCK / journal.sampleRate : 0.0;
+    cout << "Last consistent checkpoint: " << record.blocksWritten << " data blocks (" << seconds <<
+            " s), last timestamp " << record.lastTimestamp << ", written " <<
+            qPrintable(QDateTime::fromMSecsSinceEpoch(record.wallClockMSecs).toString("yyyy-MM-dd HH:mm:ss")) << endl;
+
+    if (!needsTrim) {
+        cout << "All data files already end at this checkpoint." << endl;
+        return 0;
+    }
+
+    int result = 0;
+    for (int i = 0; i < fileSize.size(); ++i) {
+        if (fileSize[i] == record.offsets[i]) continue;
+
+        cout << (dryRun ? "Would trim " : "Trimming ") << qPrintable(journal.fileNames[i]) << " from " <<
+                fileSize[i] << " to " << record.offsets[i] << " bytes" << endl;
+        if (!dryRun) {
+            QFile dataFile(journalDir.filePath(journal.fileNames[i]));
+            if (!dataFile.resize(record.offsets[i])) {
+                cerr << "Cannot trim " << qPrintable(journal.fileNames[i]) << ": " <<
+                        qPrintable(dataFile.errorString()) << endl;
+                result = 1;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,21 @@
+TEMPLATE      = app
+TARGET        = rhsrecover
+
+QT           -= gui
+
+CONFIG       += console c++11
+CONFIG       -= app_bundle
+
+INCLUDEPATH  += ../..
+
+HEADERS       = \
+    ../../globalconstants.h \
+    ../../rhs2000datablock.h \
+    ../../crc32c.h \
+    ../../checksummedfile.h \
+    ../../savejournal.h
+
+SOURCES       = main.cpp \
+    ../../crc32c.cpp \
+    ../../checksummedfile.cpp \
+    ../../savejournal.cpp
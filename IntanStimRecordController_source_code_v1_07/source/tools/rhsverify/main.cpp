@@ -0,0 +1,250 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <iostream>
+
+#include "crc32c.h"
+#include "checksummedfile.h"
+#include "savejournal.h"
+
+using namespace std;
+
+// rhsverify: check recorded data files against their CRC-32C checksums.
+//
+// Usage: rhsverify <path> [<path> ...]
+//
+// Each path may be a *.crc32c checksum file, a *.journal crash recovery
+// journal, or a directory, which is searched recursively for both.  Checksum
+// files are written when a recording is closed normally; every chunk of every
+// data file is checked against them.  For recordings that were not closed
+// normally (journal present, but no checksum file), each data file is checked
+// up to the last journal checkpoint.
+//
+// Files are read sequentially in large pieces, and checksums are computed with
+// the SSE4.2 crc32 instruction when available, so verification normally runs
+// at the speed of the storage device.
+
+static qint64 totalBytesRead = 0;
+
+// Compute the CRC-32C of the first length bytes of file, reading it in pieces
+// of pieceSize bytes.  If pieceCrcs is not null, the CRC of each piece is also
+// returned.  Returns false if the file cannot be read.
+static bool checksumFile(const QString &fileName, qint64 length, qint64 pieceSize,
+                         quint32 &fileCrc, QVector<quint32> *pieceCrcs)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return false;
+    }
+
+    QByteArray buffer(pieceSize, 0);
+    fileCrc = 0;
+    qint64 remaining = length;
+    while (remaining > 0) {
+        qint64 n = file.read(buffer.data(), qMin(remaining, pieceSize));
+        if (n <= 0) {
+            return false;
+        }
+        quint32 pieceCrc = crc32c(0, buffer.constData(), n);
+        if (pieceCrcs) pieceCrcs->append(pieceCrc);
+        fileCrc = crc32cCombine(fileCrc, pieceCrc, n);
+        remaining -= n;
+        totalBytesRead += n;
+    }
+    return true;
+}
+
+// Verify all data files listed in a checksum file.  Returns the number of failures.
+static int verifyChecksumFile(const QString &fileName)
+{
+    qint64 chunkSize;
+    QVector<ChecksumFileEntry> entries;
+    QString errorMessage;
+
+    if (!ChecksummedFile::readChecksumFile(fileName, chunkSize, entries, errorMessage)) {
+        cout << qPrintable(fileName) << ": " << qPrintable(errorMessage) << endl;
+        return 1;
+    }
+
+    QDir dir = QFileInfo(fileName).absoluteDir();
+    int failures = 0;
+
+    for (int i = 0; i < entries.size(); ++i) {
+        const ChecksumFileEntry &entry = entries[i];
+        QString dataFileName = dir.filePath(entry.fileName);
+        QFileInfo dataFileInfo(dataFileName);
+
+        if (!dataFileInfo.exists()) {
+            cout << qPrintable(entry.fileName) << ": MISSING" << endl;
+            ++failures;
+            continue;
+        }
+        if (dataFileInfo.size() != entry.length) {
+            cout << qPrintable(entry.fileName) << ": length is " << dataFileInfo.size() <<
+                    " bytes, expected " << entry.length << endl;
+            ++failures;
+        }
+
+        quint32 fileCrc;
+        QVector<quint32> chunkCrcs;
+        if (!checksumFile(dataFileName, qMin(entry.length, dataFileInfo.size()), chunkSize, fileCrc, &chunkCrcs)) {
+            cout << qPrintable(entry.fileName) << ": READ ERROR" << endl;
+            ++failures;
+            continue;
+        }
+
+        int badChunks = 0;
+        for (int j = 0; j < chunkCrcs.size() && j < entry.chunkCrcs.size(); ++j) {
+            if (chunkCrcs[j] != entry.chunkCrcs[j]) {
+                cout << qPrintable(entry.fileName) << ": CORRUPT bytes " << j * chunkSize << " to " <<
+                        qMin((j + 1) * chunkSize, entry.length) - 1 << endl;
+                ++badChunks;
+            }
+        }
+        if (badChunks > 0) {
+            ++failures;
+        } else if (dataFileInfo.size() == entry.length && fileCrc != entry.fileCrc) {
+            cout << qPrintable(entry.fileName) << ": CORRUPT (file checksum mismatch)" << endl;
+            ++failures;
+        }
+    }
+
+    cout << qPrintable(fileName) << ": " << entries.size() << " data files, " <<
+            (failures == 0 ? "OK" : "FAILED") << endl;
+    return failures;
+}
+
+// Verify all data files listed in a journal up to its last checkpoint.
+// Returns the number of failures.
+static int verifyJournal(const QString &fileName)
+{
+    SaveJournalContents journal;
+    QString errorMessage;
+
+    if (!SaveJournal::readJournal(fileName, journal, errorMessage)) {
+        cout << qPrintable(fileName) << ": " << qPrintable(errorMessage) << endl;
+        return 1;
+    }
+    if (!journal.hasChecksums) {
+        cout << qPrintable(fileName) << ": recorded without checksums; nothing to verify" << endl;
+        return 0;
+    }
+    if (journal.records.isEmpty()) {
+        cout << qPrintable(fileName) << ": no checkpoints" << endl;
+        return 1;
+    }
+
+    const SaveJournalRecord &record = journal.records.last();
+    QDir dir = QFileInfo(fileName).absoluteDir();
+    int failures = 0;
+
+    for (int i = 0; i < journal.fileNames.size(); ++i) {
+        QString dataFileName = dir.filePath(journal.fileNames[i]);
+        QFileInfo dataFileInfo(dataFileName);
+        quint32 fileCrc;
+
+        if (!dataFileInfo.exists()) {
+            cout << qPrintable(journal.fileNames[i]) << ": MISSING" << endl;
+            ++failures;
+        } else if (dataFileInfo.size() < record.offsets[i]) {
+            cout << qPrintable(journal.fileNames[i]) << ": shorter than last checkpoint (" <<
+                    dataFileInfo.size() << " < " << record.offsets[i] << " bytes)" << endl;
+            ++failures;
+        } else if (!checksumFile(dataFileName, record.offsets[i], CHECKSUM_CHUNK_SIZE, fileCrc, nullptr)) {
+            cout << qPrintable(journal.fileNames[i]) << ": READ ERROR" << endl;
+            ++failures;
+        } else if (fileCrc != record.crcs[i]) {
+            cout << qPrintable(journal.fileNames[i]) << ": CORRUPT before last checkpoint" << endl;
+            ++failures;
+        } else if (dataFileInfo.size() > record.offsets[i]) {
+            cout << qPrintable(journal.fileNames[i]) << ": " << dataFileInfo.size() - record.offsets[i] <<
+                    " bytes after last checkpoint not verified" << endl;
+        }
+    }
+
+    cout << qPrintable(fileName) << ": " << journal.fileNames.size() << " data files to checkpoint " <<
+            record.sequence << (record.closedCleanly ? " (closed normally), " : ", ") <<
+            (failures == 0 ? "OK" : "FAILED") << endl;
+    return failures;
+}
+
+// Verify one checksum file or journal, ignoring journals that have a checksum
+// file from the same recording (which is more complete).
+static int verifyPath(const QFileInfo &fileInfo)
+{
+    if (fileInfo.suffix() == "crc32c") {
+        return verifyChecksumFile(fileInfo.filePath());
+    }
+    if (fileInfo.suffix() == "journal") {
+        QString checksumFileName = ChecksummedFile::checksumFileName(fileInfo.path(), fileInfo.completeBaseName());
+        if (QFileInfo(checksumFileName).exists()) {
+            return 0;
+        }
+        return verifyJournal(fileInfo.filePath());
+    }
+    cout << qPrintable(fileInfo.filePath()) << ": not a checksum file or journal" << endl;
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+    if (args.isEmpty()) {
+        cerr << "Usage: rhsverify <file.crc32c | file.journal | directory> ..." << endl;
+        return 2;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int failures = 0;
+    for (int i = 0; i < args.size(); ++i) {
+        QFileInfo argInfo(args[i]);
+        if (argInfo.isDir()) {
+            QDirIterator it(args[i], QStringList() << "*.crc32c" << "*.journal",
+                            QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                failures += verifyPath(QFileInfo(it.next()));
+            }
+        } else {
+            failures += verifyPath(argInfo);
+        }
+    }
+
+    double seconds = timer.elapsed() / 1000.0;
+    cout << "Read " << totalBytesRead / 1.0e6 << " MB in " << seconds << " s (" <<
+            (seconds > 0.0 ? totalBytesRead / 1.0e6 / seconds : 0.0) << " MB/s, " <<
+            (crc32cHardwareAvailable() ? "SSE4.2" : "software") << " CRC-32C).  " <<
+            (failures == 0 ? "All files OK." : "Errors found.") << endl;
+
+    return (failures == 0) ? 0 : 1;
+}
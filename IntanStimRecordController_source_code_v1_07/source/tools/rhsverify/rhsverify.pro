@@ -0,0 +1,20 @@
+TEMPLATE      = app
+TARGET        = rhsverify
+
+QT           -= gui
+
+CONFIG       += console c++11
+CONFIG       -= app_bundle
+
+INCLUDEPATH  += ../..
+
+HEADERS       = \
+    ../../globalconstants.h \
+    ../../crc32c.h \
+    ../../checksummedfile.h \
+    ../../savejournal.h
+
+SOURCES       = main.cpp \
+    ../../crc32c.cpp \
+    ../../checksummedfile.cpp \
+    ../../savejournal.cpp
@@ -0,0 +1,107 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtGlobal>
+#include <cmath>
+
+#include "waveformdecimator.h"
+#include "samplevector.h"
+
+// Constructor.
+WaveformDecimator::WaveformDecimator()
+{
+}
+
+// Build the polyline for length samples of data in polyline[1] onward, sample i
+// being plotted at (xScaleFactor * i + xOffset, yScaleFactor * data[i] + yOffset),
+// and return the number of points written.  polyline[0] is left for the caller
+// to join the segment to the previous one, and must have room for length + 1
+// points.  If decimate is true and pixel columns hold at least
+// WAVEPLOT_DECIMATION_SAMPLES_PER_PIXEL samples, each column is reduced to its
+// first, minimum, maximum and last samples.
+int WaveformDecimator::buildPolyline(const Sample *data, int length, double xScaleFactor, double xOffset,
+                                     double yScaleFactor, double yOffset, bool decimate, QPointF *polyline)
+{
+    int i;
+    int numPoints = 0;
+
+    // Samples are assigned to pixel columns by their offset from the first
+    // sample, and plotted at their exact positions, so the points kept are
+    // the same points the full polyline passes through.
+    int numColumns = (int) floor(xScaleFactor * (length - 1)) + 1;
+    if (!decimate || xScaleFactor <= 0.0 ||
+            (double) length < WAVEPLOT_DECIMATION_SAMPLES_PER_PIXEL * numColumns) {
+        for (i = 0; i < length; ++i) {
+            polyline[i + 1] = QPointF(xScaleFactor * i + xOffset, yScaleFactor * data[i] + yOffset);
+        }
+        return length;
+    }
+
+    int start = 0;
+    for (int column = 0; column < numColumns && start < length; ++column) {
+        int end = qMin(length, (int) ceil((column + 1) / xScaleFactor));
+        if (end <= start) continue;
+
+        Sample minValue, maxValue;
+        columnRange(data, start, end, minValue, maxValue);
+
+        double x = xScaleFactor * start + xOffset;
+        polyline[++numPoints] = QPointF(x, yScaleFactor * data[start] + yOffset);
+        if (end - start > 1) {
+            polyline[++numPoints] = QPointF(x, yScaleFactor * minValue + yOffset);
+            polyline[++numPoints] = QPointF(x, yScaleFactor * maxValue + yOffset);
+            polyline[++numPoints] = QPointF(xScaleFactor * (end - 1) + xOffset,
+                                            yScaleFactor * data[end - 1] + yOffset);
+        }
+        start = end;
+    }
+    return numPoints;
+}
+
+// Find the minimum and maximum of data[start] to data[end - 1].
+void WaveformDecimator::columnRange(const Sample *data, int start, int end, Sample &minValue, Sample &maxValue) const
+{
+    int i = start;
+    minValue = data[i];
+    maxValue = data[i];
+
+    if (end - start >= SampleVector::Width) {
+        SampleVector::V vMin = SampleVector::loadu(data + i);
+        SampleVector::V vMax = vMin;
+        for (i += SampleVector::Width; i + SampleVector::Width <= end; i += SampleVector::Width) {
+            SampleVector::V v = SampleVector::loadu(data + i);
+            vMin = SampleVector::min(vMin, v);
+            vMax = SampleVector::max(vMax, v);
+        }
+        Sample mins[SampleVector::Width];
+        Sample maxs[SampleVector::Width];
+        SampleVector::storeu(mins, vMin);
+        SampleVector::storeu(maxs, vMax);
+        for (int k = 0; k < SampleVector::Width; ++k) {
+            if (mins[k] < minValue) minValue = mins[k];
+            if (maxs[k] > maxValue) maxValue = maxs[k];
+        }
+    }
+    for (; i < end; ++i) {
+        if (data[i] < minValue) minValue = data[i];
+        if (data[i] > maxValue) maxValue = data[i];
+    }
+}
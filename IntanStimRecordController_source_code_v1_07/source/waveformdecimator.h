@@ -0,0 +1,53 @@
+//  ------------------------------------------------------------------------
+//
+//  This file is part of the Intan Technologies RHS2000 Interface
+//  Version 1.01
+//  Copyright (C) 2013-2017 Intan Technologies
+//
+//  ------------------------------------------------------------------------
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Lesser General Public License as published
+//  by the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WAVEFORMDECIMATOR_H
+#define WAVEFORMDECIMATOR_H
+
+#include <QVector>
+#include <QPointF>
+
+#include "globalconstants.h"
+
+// Builds the polylines WavePlot draws for each waveform segment.
+//
+// When many samples fall on each pixel column, every sample but the first and
+// last in a column lands on the same column of pixels, so the segment is
+// reduced to the first, minimum, maximum and last sample of each column: a
+// vertical span from minimum to maximum, joined to its neighbours by the same
+// line segments the full polyline would have drawn between columns.  This
+// gives the same pixels as drawing every sample while stroking a few points
+// per column instead of a few hundred.  The minima and maxima are found with
+// SampleVector.  When zoomed in far enough that columns hold only a few
+// samples, every sample is drawn.
+class WaveformDecimator
+{
+public:
+    WaveformDecimator();
+
+    int buildPolyline(const Sample *data, int length, double xScaleFactor, double xOffset,
+                      double yScaleFactor, double yOffset, bool decimate, QPointF *polyline);
+
+private:
+    void columnRange(const Sample *data, int start, int end, Sample &minValue, Sample &maxValue) const;
+};
+
+#endif // WAVEFORMDECIMATOR_H
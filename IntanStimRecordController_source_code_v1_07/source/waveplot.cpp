@@ -28,6 +28,8 @@
 #include <iostream>
 #include <QtAlgorithms>
 #include <QKeySequence>
+#include <QThreadPool>
+#include <QRunnable>
 
 #include "globalconstants.h"
 #include "waveplot.h"
@@ -36,6 +38,33 @@
 #include "signalsources.h"
 #include "signalprocessor.h"
 #include "stimparameters.h"
+#include "waveformdecimator.h"
+
+// Worker thread task for WavePlot::drawWaveforms().
+class FrameTask : public QRunnable
+{
+public:
+    FrameTask(WavePlot *wavePlot_) : wavePlot(wavePlot_) { setAutoDelete(true); }
+
+    void run() override
+    {
+        wavePlot->drawFrames();
+        wavePlot->drawTasksDone.release();
+    }
+
+private:
+    WavePlot *wavePlot;
+};
+
+// Copy length values of display ring data into a batch snapshot.
+template <typename Dest, typename Source>
+static void copyRingData(QVector<Dest> &dest, const Source *data, int length)
+{
+    dest.resize(length);
+    for (int i = 0; i < length; ++i) {
+        dest[i] = data[i];
+    }
+}
 
 // The WavePlot widget displays multiple waveform plots in the Main Window.
 // Five types of waveforms may be displayed: amplifier, auxiliary input, supply
@@ -65,6 +94,29 @@ WavePlot::WavePlot(SignalProcessor *inSignalProcessor, SignalSources *inSignalSo
 
     lastMarkerValue = true;
     plotDc = false;
+    v0AxisVisible = true;
+
+    // Frame drawing threads, leaving a core for the GUI thread.
+    drawThreadPool = new QThreadPool();
+    drawThreadPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    drawThreadPool->setExpiryTimeout(-1);
+    numFramesToDraw = 0;
+    numDrawWorkers = 0;
+    drawLength = 0;
+
+    // Display refresh timer, started and stopped with each run.
+    refreshTimer = new QTimer(this);
+    refreshTimer->setTimerType(Qt::PreciseTimer);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refreshDisplay()));
+    setRefreshRate(DEFAULT_DISPLAY_REFRESH_RATE);
+    drawnPosition = 0;
+    lateFrames = 0;
+    droppedFrames = 0;
+}
+
+WavePlot::~WavePlot()
+{
+    delete drawThreadPool;
 }
 
 // Initialize WavePlot object.
@@ -159,21 +211,6 @@ void WavePlot::createFrames(unsigned int frameIndex, unsigned int maxX, unsigned
     }
 }
 
-// Allocates memory for a 3-D array of doubles.
-void WavePlot::allocateDoubleArray3D(QVector<QVector<QVector<double> > > &array3D,
-                                     int xSize, int ySize, int zSize)
-{
-    int i, j;
-
-    array3D.resize(xSize);
-    for (i = 0; i < xSize; ++i) {
-        array3D[i].resize(ySize);
-        for (j = 0; j < ySize; ++j) {
-            array3D[i][j].resize(zSize);
-        }
-    }
-}
-
 // Allocates memory for a 2-D array of doubles.
 void WavePlot::allocateDoubleArray2D(QVector<QVector<double> > &array2D,
                                      int xSize, int ySize)
@@ -387,6 +424,21 @@ void WavePlot::contractTScale()
 void WavePlot::setSampleRate(double newSampleRate)
 {
     sampleRate = newSampleRate;
+    displayRing.setCapacity(qCeil(DISPLAY_RING_MSEC * sampleRate / 1000.0));
+}
+
+// Set the rate at which the display is refreshed during a run.  The timer
+// period is rounded to a whole number of screen refresh periods; the timer is
+// not synchronized to the screen's vertical blanking.
+void WavePlot::setRefreshRate(double rate)
+{
+    double screenRate = 60.0;
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 1.0) {
+        screenRate = screen->refreshRate();
+    }
+    int screenPeriods = qMax(1, qRound(screenRate / rate));
+    refreshTimer->setInterval(qMax(1, qRound(1000.0 * screenPeriods / screenRate)));
 }
 
 QSize WavePlot::minimumSizeHint() const
@@ -399,10 +451,25 @@ QSize WavePlot::sizeHint() const
     return QSize(860, 690);
 }
 
-void WavePlot::paintEvent(QPaintEvent * /* event */)
+// Paint the frames, axes and labels from the pixel map, and the waveforms from
+// the frame tiles over it.  Usually only the parts of the tiles that changed
+// need repainting.
+void WavePlot::paintEvent(QPaintEvent *event)
 {
     QStylePainter stylePainter(this);
-    stylePainter.drawPixmap(0, 0, pixmap);
+    QVector<QRect> rects = event->region().rects();
+    for (int i = 0; i < rects.size(); ++i) {
+        stylePainter.drawPixmap(rects[i], pixmap, rects[i]);
+        for (int j = 0; j < frameTiles.size(); ++j) {
+            QRect r = rects[i] & tileRects[j];
+            if (!r.isEmpty()) {
+                stylePainter.drawImage(r, frameTiles[j], r.translated(-tileRects[j].topLeft()));
+            }
+        }
+    }
+    if (dragging) {
+        paintGhost(stylePainter);
+    }
 }
 
 // Returns the index of the closest waveform frame to a point on the screen.
@@ -503,7 +570,7 @@ void WavePlot::mouseMoveEvent(QMouseEvent *event)
         ghost.setSize(size);
 
         // Paint ghost rectangle
-        paintGhost();
+        update();
     }
 }
 
@@ -809,21 +876,14 @@ void WavePlot::highlightFrame(int frameIndex, bool eraseOldFrame)
 
     // Emit signal.
     emit selectedChannelChanged(selectedChannel());
-
-    // Update list of visible channels.
-    for (int i = 0; i < MAX_NUM_DATA_STREAMS; ++i) {
-        mainWindow->channelVisible[i].fill(false);
-    }
-    for (int i = topLeftFrame[selectedPort];
-         i < topLeftFrame[selectedPort] + frameList[numFramesIndex[selectedPort]].size();
-         ++i) {
-        mainWindow->channelVisible[selectedChannel(i)->boardStream][selectedChannel(i)->chipChannel] = true;
-    }
 }
 
 // Refresh pixel map used in double buffered graphics.
 void WavePlot::refreshPixmap()
 {
+    // The tiles are about to be replaced, so let any frames in flight finish.
+    finishDrawing();
+
     // Pixel map used for double buffering.
     pixmap = QPixmap(size());
     pixmap.fill();
@@ -841,10 +901,28 @@ void WavePlot::refreshPixmap()
     painter.drawRect(r);
 
     // Plot all frames.
+    v0AxisVisible = mainWindow->showV0Axis();
     for (int i = 0; i < frameList[numFramesIndex[selectedPort]].size(); i++) {
         drawAxes(painter, i);
     }
 
+    // Waveforms are drawn in tiles covering the inside of each frame.
+    int numFrames = frameList[numFramesIndex[selectedPort]].size();
+    frameTiles.resize(numFrames);
+    drawTiles.resize(numFrames);
+    tileRects.resize(numFrames);
+    dirtyRects.resize(numFrames);
+    for (int i = 0; i < numFrames; i++) {
+        tileRects[i] = frameList[numFramesIndex[selectedPort]][i].adjusted(1, 1, 0, 0);
+        frameTiles[i] = QImage(tileRects[i].size(), QImage::Format_RGB32);
+        frameTiles[i].fill(backgroundColor);
+        QPainter tilePainter(&frameTiles[i]);
+        tilePainter.translate(-tileRects[i].topLeft());
+        drawAxisLines(tilePainter, i);
+        tilePainter.end();
+        drawTiles[i] = frameTiles[i].copy();
+    }
+
     tPosition = 0;
     update();
 }
@@ -901,12 +979,19 @@ SignalChannel* WavePlot::selectedChannel(int index)
 // Draw axis lines inside a frame.
 void WavePlot::drawAxisLines(QPainter &painter, int frameNumber)
 {
-    QRect frame = frameList[numFramesIndex[selectedPort]][frameNumber];
+    SignalChannel *signalChannel = selectedChannel(frameNumber + topLeftFrame[selectedPort]);
+    drawAxisLines(painter, frameList[numFramesIndex[selectedPort]][frameNumber],
+                  signalChannel->signalType, signalChannel->enabled);
+}
+
+// Draw axis lines inside a frame showing a channel of the given type.  Does not
+// read the channel list, so it may be called from the frame drawing threads.
+void WavePlot::drawAxisLines(QPainter &painter, QRect frame, SignalType type, bool enabled)
+{
     painter.setPen(frameColor);
 
-    SignalType type = selectedChannel(frameNumber + topLeftFrame[selectedPort])->signalType;
-    if (selectedChannel(frameNumber + topLeftFrame[selectedPort])->enabled) {
-        if (type == AmplifierSignal && mainWindow->showV0Axis()) {
+    if (enabled) {
+        if (type == AmplifierSignal && v0AxisVisible) {
             // Draw V = 0V axis line.
             painter.drawLine(frame.left(), frame.center().y(), frame.right(), frame.center().y());
         } else if (type == SupplyVoltageSignal) {
@@ -1189,328 +1274,423 @@ void WavePlot::drawAxisText(QPainter &painter, int frameNumber)
     }
 }
 
-void WavePlot::setNumUsbBlocksToPlot(int numBlocks)
-{
-    numUsbBlocksToPlot = numBlocks;
-}
-
-// Plot waveforms on screen.
-void WavePlot::drawWaveforms()
+// Start drawing length samples of waveform data, starting at index offset of
+// the display ring.  The data of each frame is copied out of the ring, and each
+// frame is drawn into its own image tile (QImage, unlike QPixmap, may be painted
+// outside the GUI thread) by worker threads; this returns as soon as they are
+// started.  The finished batch is put on screen by
+// showDrawnFrames(), and only the parts of the tiles that changed are repainted.
+void WavePlot::drawWaveforms(int offset, int length)
 {
-    int i, j, xOffset, yOffset, stream, channel;
-    double yAxisLength, tAxisLength;
-    QRect adjustedFrame, eraseBlock;
-    SignalType type;
-    double tStepMsec, xScaleFactor, yScaleFactor;
-    QPainter painter(&pixmap);
-    painter.initFrom(this);
-    QPen pen;
-    double oldTPosition = -1.0;
-
-    int length = Rhs2000DataBlock::getSamplesPerDataBlock() * numUsbBlocksToPlot;
+    int i, j;
+    double tStepMsec;
 
-    QPointF *polyline = new QPointF[length + 1];
+    drawLength = length;
 
     ReferenceSource referenceSource = mainWindow->getReferenceSource();
+    drawReferenceStream = referenceSource.softwareMode ? referenceSource.stream : -1;
+    drawReferenceChannel = referenceSource.softwareMode ? referenceSource.channel : -1;
+    v0AxisVisible = mainWindow->showV0Axis();
+    drawPlotDc = plotDc;
+    drawPointPlotMode = pointPlotMode;
+    drawYScale = yScale;
+    drawYScaleDcAmp = yScaleDcAmp;
+    drawYScaleAdc = yScaleAdc;
 
     // Assume all frames are the same size.
-    yAxisLength = (frameList[numFramesIndex[selectedPort]][0].height() - 2) / 2.0;
-    tAxisLength = frameList[numFramesIndex[selectedPort]][0].width() - 1;
+    drawYAxisLength = (frameList[numFramesIndex[selectedPort]][0].height() - 2) / 2.0;
+    drawTAxisLength = frameList[numFramesIndex[selectedPort]][0].width() - 1;
 
     tStepMsec = 1000.0 / sampleRate;
-    xScaleFactor = tAxisLength * tStepMsec / tScale;
+    drawXScaleFactor = drawTAxisLength * tStepMsec / tScale;
 
-    bool markerMode = mainWindow->markerMode();
+    drawOldXOffset = -1.0;
+    drawMarkerMode = mainWindow->markerMode();
     bool resetXOnMarker = mainWindow->resetXOnMarker();
-    int markerChannel = mainWindow->markerChannel();
-    if (markerMode && resetXOnMarker) {
+    drawMarkerChannel = mainWindow->markerChannel();
+    copyRingData(drawMarkerData, displayRing.boardDigIn(drawMarkerChannel) + offset, length);
+    const quint8 *markerData = drawMarkerData.constData();
+    if (drawMarkerMode && resetXOnMarker) {
         for (i = 1; i < length; ++i) {
-            if (signalProcessor->boardDigIn.at(markerChannel).at(i - 1) == 0 &&
-                    signalProcessor->boardDigIn.at(markerChannel).at(i) != 0) {
-                oldTPosition = tPosition;
-                tPosition = -i * xScaleFactor;
-                if (-tPosition > tAxisLength) {
+            if (markerData[i - 1] == 0 && markerData[i] != 0) {
+                drawOldXOffset = tPosition * drawTAxisLength / tScale;
+                tPosition = -i * drawXScaleFactor;
+                if (-tPosition > drawTAxisLength) {
                     tPosition = 0.0;
                 }
                 break;
             }
         }
-        if (lastMarkerValue == false && signalProcessor->boardDigIn.at(markerChannel).at(0) != 0) {
+        if (lastMarkerValue == false && markerData[0] != 0) {
             tPosition = 0.0;
         }
     }
-    lastMarkerValue = (signalProcessor->boardDigIn.at(markerChannel).at(length - 1) != 0);
-
-    for (j = 0; j < frameList[numFramesIndex[selectedPort]].size(); ++j) {
-        stream = selectedChannel(j + topLeftFrame[selectedPort])->boardStream;
-        channel = selectedChannel(j + topLeftFrame[selectedPort])->chipChannel;
-        type = selectedChannel(j + topLeftFrame[selectedPort])->signalType;
-
-        if (selectedChannel(j + topLeftFrame[selectedPort])->enabled) {
-            xOffset = frameList[numFramesIndex[selectedPort]][j].left() + 1;
-            xOffset += tPosition * tAxisLength / tScale;
-
-            tStepMsec = 1000.0 / sampleRate;
-            xScaleFactor = tAxisLength * tStepMsec / tScale;
-
-            // Set clipping region
-            adjustedFrame = frameList[numFramesIndex[selectedPort]][j];
-            adjustedFrame.adjust(1, 1, 0, 0);
-            painter.setClipRect(adjustedFrame);
-
-            // Erase segment of old waveform
-            eraseBlock = adjustedFrame;
-            eraseBlock.setLeft(xOffset);
-            eraseBlock.setRight((tAxisLength * (1000.0 / sampleRate) / tScale) * (length - 1) + 1 + xOffset);
-            painter.fillRect(eraseBlock, backgroundColor);
-
-            // If we trigger the display, erase remaining old waveform
-            if (oldTPosition >= 0.0) {
-                eraseBlock.setLeft(frameList[numFramesIndex[selectedPort]][j].left() + 1 + oldTPosition * tAxisLength / tScale);
-                eraseBlock.setRight(frameList[numFramesIndex[selectedPort]][j].right());
-                painter.fillRect(eraseBlock, backgroundColor);
+    lastMarkerValue = (markerData[length - 1] != 0);
+
+    drawXOffset = tPosition * drawTAxisLength / tScale;
+    drawJoinToOld = (tPosition != 0.0);
+
+    numFramesToDraw = frameTiles.size();
+    drawJobs.resize(numFramesToDraw);
+    for (j = 0; j < numFramesToDraw; ++j) {
+        SignalChannel *signalChannel = selectedChannel(j + topLeftFrame[selectedPort]);
+        FrameDrawJob &job = drawJobs[j];
+        job.frame = frameList[numFramesIndex[selectedPort]][j];
+        job.type = signalChannel->signalType;
+        job.enabled = signalChannel->enabled;
+        job.stream = signalChannel->boardStream;
+        job.channel = signalChannel->chipChannel;
+        job.plotIndex = j + topLeftFrame[selectedPort];
+        if (!job.enabled) continue;
+
+        switch (job.type) {
+        case AmplifierSignal:
+            if (drawPlotDc) {
+                copyRingData(job.samples, displayRing.dcAmplifier(job.stream, job.channel) + offset, length);
+            } else {
+                copyRingData(job.samples, displayRing.amplifier(job.stream, job.channel) + offset, length);
             }
+            copyRingData(job.flags, displayRing.amplifierFlags(job.stream, job.channel) + offset, length);
+            break;
+        case BoardAdcSignal:
+            copyRingData(job.samples, displayRing.boardAdc(job.channel) + offset, length);
+            break;
+        case BoardDacSignal:
+            copyRingData(job.samples, displayRing.boardDac(job.channel) + offset, length);
+            break;
+        case BoardDigInSignal:
+            copyRingData(job.samples, displayRing.boardDigIn(job.channel) + offset, length);
+            break;
+        case BoardDigOutSignal:
+            copyRingData(job.samples, displayRing.boardDigOut(job.channel) + offset, length);
+            break;
+        default:
+            break;
+        }
+    }
 
-            // Optional: Highlight background if selected digital input is high
-            if (markerMode) {
-                highlightEvent(signalProcessor->boardDigIn[markerChannel], markerColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
-            }
+    nextFrame.store(0);
+    numDrawWorkers = qMin(numFramesToDraw, drawThreadPool->maxThreadCount());
+    for (i = 0; i < numDrawWorkers; ++i) {
+        drawThreadPool->start(new FrameTask(this));
+    }
 
-            if (type == AmplifierSignal) {
-                // Highlight amp settle pulses
-                highlightEvent(signalProcessor->ampSettle[stream][channel], ampSettleColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
+    tPosition += length * tStepMsec;
+    if (tPosition >= tScale) {
+        tPosition = 0.0;
+    }
+}
 
-                // Highlight charge recovery pulses
-                highlightEvent(signalProcessor->chargeRecov[stream][channel], chargeRecovColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
+// Wait for the batch of frames in flight, if any, and put it on screen.  Only
+// used where the tiles are about to change under it, or when a run stops.
+void WavePlot::finishDrawing()
+{
+    if (numDrawWorkers > 0) {
+        drawTasksDone.acquire(numDrawWorkers);
+        showDrawnFrames();
+    }
+}
 
-                // Highlight stimulation pulses
-                highlightEvent(signalProcessor->stimOn[stream][channel], stimColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
+// Copy the parts of the tiles changed by the finished batch of frames to the
+// tiles on screen, and repaint them.
+void WavePlot::showDrawnFrames()
+{
+    numDrawWorkers = 0;
+    for (int j = 0; j < numFramesToDraw; ++j) {
+        if (!dirtyRects[j].isEmpty()) {
+            QRect r = dirtyRects[j].translated(-tileRects[j].topLeft());
+            QPainter painter(&frameTiles[j]);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.drawImage(r.topLeft(), drawTiles[j], r);
+            update(dirtyRects[j]);
+        }
+    }
+}
 
-                // Highlight compliance limits
-                highlightEvent(signalProcessor->complianceLimit[stream][channel], complianceLimitColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
-            }
+// Draw frames handed out through nextFrame until none are left.  Each thread
+// has its own polyline buffer and decimator.
+void WavePlot::drawFrames()
+{
+    WaveformDecimator waveformDecimator;
+    QPointF *polyline = new QPointF[drawLength + 1];
+    int j;
 
-            // Redraw y = 0 axis
-            drawAxisLines(painter, j);
+    while ((j = nextFrame.fetchAndAddRelaxed(1)) < numFramesToDraw) {
+        drawFrameWaveform(j, waveformDecimator, polyline);
+    }
 
-            if (type == AmplifierSignal) {
-                // Plot RHS2000 amplifier waveform
-                if (plotDc) {
-                    yScaleFactor = -yAxisLength / (yScaleDcAmp);
-                } else {
-                    yScaleFactor = -yAxisLength / yScale;
-                }
-                yOffset = frameList[numFramesIndex[selectedPort]][j].center().y();
-
-                // build waveform
-                for (i = 0; i < length; ++i) {
-                    if (plotDc) {
-                        polyline[i+1] =
-                                QPointF(xScaleFactor * i + xOffset,
-                                        yScaleFactor * signalProcessor->dcAmplifier.at(stream).at(channel).at(i) + yOffset);
-                    } else {
-                        polyline[i+1] =
-                                QPointF(xScaleFactor * i + xOffset,
-                                        yScaleFactor * signalProcessor->amplifierPostFilter.at(stream).at(channel).at(i) + yOffset);
-                    }
-                }
+    delete [] polyline;
+}
 
-                // join to old waveform
-                if (tPosition == 0.0) {
-                    polyline[0] = polyline[1];
-                } else {
-                    polyline[0] =
-                            QPointF(xScaleFactor * -1 + xOffset,
-                                    yScaleFactor * plotDataOld.at(j + topLeftFrame[selectedPort]) + yOffset);
-                }
+// Draw the newest segment of waveform j into its tile.  Called from worker
+// threads, so it only reads drawJobs[j] and the shared display state, and
+// writes tile j and its entry in plotDataOld.
+void WavePlot::drawFrameWaveform(int j, WaveformDecimator &waveformDecimator, QPointF *polyline)
+{
+    int xOffset, yOffset, stream, channel, numPoints;
+    QRect adjustedFrame, eraseBlock, changedBlock;
+    SignalType type;
+    double yScaleFactor;
+    QPen pen;
+    int length = drawLength;
+    double xScaleFactor = drawXScaleFactor;
 
-                // save last point in waveform to join to next segment
-                if (plotDc) {
-                    plotDataOld[j + topLeftFrame[selectedPort]] =
-                            signalProcessor->dcAmplifier.at(stream).at(channel).at(length - 1);
-                } else {
-                    plotDataOld[j + topLeftFrame[selectedPort]] =
-                            signalProcessor->amplifierPostFilter.at(stream).at(channel).at(length - 1);
-                }
+    const FrameDrawJob &job = drawJobs[j];
+    double &oldData = plotDataOld[job.plotIndex];
 
-                // draw waveform
-                painter.setPen(traceAmpColor);
-                if (referenceSource.softwareMode == true) {
-                    if (referenceSource.stream == stream && referenceSource.channel == channel) {
-                        painter.setPen(traceRefColor); // plot selected re-reference waveform in a different color
-                    }
-                }
-                if (pointPlotMode) {
-                    painter.drawPoints(polyline, length + 1);
-                } else {
-                    painter.drawPolyline(polyline, length + 1);
-                }
+    dirtyRects[j] = QRect();
 
-            } else if (type == AuxInputSignal) {
-                // error: aux inputs not present in RHS2000 system
-            } else if (type == SupplyVoltageSignal) {
-                // error: supply voltage not present in RHS2000 system
-            } else if (type == BoardAdcSignal) {
-                // Plot USB interface board ADC input signal
-                yScaleFactor = -1.0 * yAxisLength / yScaleAdc;
-                yOffset = frameList[numFramesIndex[selectedPort]][j].center().y();
-
-                // build waveform
-                for (i = 0; i < length; ++i) {
-                    polyline[i+1] =
-                            QPointF(xScaleFactor * i + xOffset,
-                                    yScaleFactor * signalProcessor->boardAdc.at(channel).at(i) + yOffset);
-                }
+    if (!job.enabled) return;
 
-                // join to old waveform
-                if (tPosition == 0.0) {
-                    polyline[0] = polyline[1];
-                } else {
-                    polyline[0] =
-                            QPointF(xScaleFactor * -1 + xOffset,
-                                    yScaleFactor * plotDataOld.at(j + topLeftFrame[selectedPort]) + yOffset);
-                }
+    stream = job.stream;
+    channel = job.channel;
+    type = job.type;
 
-                // save last point in waveform to join to next segment
-                plotDataOld[j + topLeftFrame[selectedPort]] =
-                        signalProcessor->boardAdc.at(channel).at(length - 1);
+    xOffset = job.frame.left() + 1;
+    xOffset += drawXOffset;
 
-                // draw waveform
-                painter.setPen(traceAnalogInColor);
-                if (pointPlotMode) {
-                    painter.drawPoints(polyline, length + 1);
-                } else {
-                    painter.drawPolyline(polyline, length + 1);
-                }
+    // The tile covers the inside of the frame; the painter keeps widget coordinates.
+    adjustedFrame = tileRects[j];
+    QPainter painter(&drawTiles[j]);
+    painter.translate(-adjustedFrame.topLeft());
 
-            } else if (type == BoardDacSignal) {
-                // Plot USB interface board DAC output signal
-                yScaleFactor = -1.0 * yAxisLength / yScaleAdc;
-                yOffset = frameList[numFramesIndex[selectedPort]][j].center().y();
+    // Erase segment of old waveform
+    eraseBlock = adjustedFrame;
+    eraseBlock.setLeft(xOffset);
+    eraseBlock.setRight(xScaleFactor * (length - 1) + 1 + xOffset);
+    painter.fillRect(eraseBlock, backgroundColor);
+    changedBlock = eraseBlock;
 
-                // build waveform
-                for (i = 0; i < length; ++i) {
-                    polyline[i+1] =
-                            QPointF(xScaleFactor * i + xOffset,
-                                    yScaleFactor * signalProcessor->boardDac.at(channel).at(i) + yOffset);
-                }
+    // If we trigger the display, erase remaining old waveform
+    if (drawOldXOffset >= 0.0) {
+        eraseBlock.setLeft(job.frame.left() + 1 + drawOldXOffset);
+        eraseBlock.setRight(job.frame.right());
+        painter.fillRect(eraseBlock, backgroundColor);
+        changedBlock |= eraseBlock;
+    }
 
-                // join to old waveform
-                if (tPosition == 0.0) {
-                    polyline[0] = polyline[1];
-                } else {
-                    polyline[0] =
-                            QPointF(xScaleFactor * -1 + xOffset,
-                                    yScaleFactor * plotDataOld.at(j + topLeftFrame[selectedPort]) + yOffset);
-                }
+    // Optional: Highlight background if selected digital input is high
+    if (drawMarkerMode) {
+        highlightEvent(drawMarkerData.constData(), 1, markerColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
+    }
 
-                // save last point in waveform to join to next segment
-                plotDataOld[j + topLeftFrame[selectedPort]] =
-                        signalProcessor->boardDac.at(channel).at(length - 1);
+    if (type == AmplifierSignal) {
+        const quint8 *flags = job.flags.constData();
 
-                // draw waveform
-                painter.setPen(traceAnalogInColor);
-                if (pointPlotMode) {
-                    painter.drawPoints(polyline, length + 1);
-                } else {
-                    painter.drawPolyline(polyline, length + 1);
-                }
+        // Highlight amp settle pulses
+        highlightEvent(flags, DisplayRing::AmpSettleFlag, ampSettleColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
 
-            } else if (type == BoardDigInSignal) {
-                // Plot USB interface board digital input signal
-                yScaleFactor = -(2.0 * yAxisLength) / 2.0;
-                yOffset = (frameList[numFramesIndex[selectedPort]][j].bottom() +
-                           frameList[numFramesIndex[selectedPort]][j].center().y()) / 2.0;
-
-                // build waveform
-                for (i = 0; i < length; ++i) {
-                    polyline[i+1] =
-                            QPointF(xScaleFactor * i + xOffset,
-                                    yScaleFactor * signalProcessor->boardDigIn.at(channel).at(i) + yOffset);
-                }
+        // Highlight charge recovery pulses
+        highlightEvent(flags, DisplayRing::ChargeRecovFlag, chargeRecovColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
 
-                // join to old waveform
-                if (tPosition == 0.0) {
-                    polyline[0] = polyline[1];
-                } else {
-                    polyline[0] =
-                            QPointF(xScaleFactor * -1 + xOffset,
-                                    yScaleFactor * plotDataOld.at(j + topLeftFrame[selectedPort]) + yOffset);
-                }
+        // Highlight stimulation pulses
+        highlightEvent(flags, DisplayRing::StimOnFlag, stimColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
 
-                // save last point in waveform to join to next segment
-                plotDataOld[j + topLeftFrame[selectedPort]] =
-                        signalProcessor->boardDigIn.at(channel).at(length - 1);
+        // Highlight compliance limits
+        highlightEvent(flags, DisplayRing::ComplianceLimitFlag, complianceLimitColor, length, adjustedFrame, painter, xScaleFactor, xOffset);
+    }
 
-                // draw waveform
-                pen.setColor(traceDigitalInColor);
-                painter.setPen(pen);
-                if (pointPlotMode) {
-                    painter.drawPoints(polyline, length + 1);
-                } else {
-                    painter.drawPolyline(polyline, length + 1);
-                }
-            } else if (type == BoardDigOutSignal) {
-                // Plot USB interface board digital output signal
-                yScaleFactor = -(2.0 * yAxisLength) / 2.0;
-                yOffset = (frameList[numFramesIndex[selectedPort]][j].bottom() +
-                           frameList[numFramesIndex[selectedPort]][j].center().y()) / 2.0;
-
-                // build waveform
-                for (i = 0; i < length; ++i) {
-                    polyline[i+1] =
-                            QPointF(xScaleFactor * i + xOffset,
-                                    yScaleFactor * signalProcessor->boardDigOut.at(channel).at(i) + yOffset);
-                }
+    // Redraw y = 0 axis where the old waveform was erased
+    painter.setClipRect(changedBlock);
+    drawAxisLines(painter, job.frame, type, job.enabled);
+    painter.setClipping(false);
 
-                // join to old waveform
-                if (tPosition == 0.0) {
-                    polyline[0] = polyline[1];
-                } else {
-                    polyline[0] =
-                            QPointF(xScaleFactor * -1 + xOffset,
-                                    yScaleFactor * plotDataOld.at(j + topLeftFrame[selectedPort]) + yOffset);
-                }
+    if (type == AmplifierSignal) {
+        // Plot RHS2000 amplifier waveform
+        if (drawPlotDc) {
+            yScaleFactor = -drawYAxisLength / drawYScaleDcAmp;
+        } else {
+            yScaleFactor = -drawYAxisLength / drawYScale;
+        }
+        yOffset = job.frame.center().y();
 
-                // save last point in waveform to join to next segment
-                plotDataOld[j + topLeftFrame[selectedPort]] =
-                        signalProcessor->boardDigOut.at(channel).at(length - 1);
+        // build waveform
+        if (drawPlotDc) {
+            numPoints = waveformDecimator.buildPolyline(
+                        job.samples.constData(), length, xScaleFactor, xOffset, yScaleFactor * DC_AMPLIFIER_VOLTS_PER_BIT, yOffset,
+                        !drawPointPlotMode, polyline);
+        } else {
+            numPoints = waveformDecimator.buildPolyline(
+                        job.samples.constData(), length, xScaleFactor, xOffset, yScaleFactor, yOffset, !drawPointPlotMode, polyline);
+        }
 
-                // draw waveform
-                pen.setColor(traceDigitalOutColor);
-                painter.setPen(pen);
-                if (pointPlotMode) {
-                    painter.drawPoints(polyline, length + 1);
-                } else {
-                    painter.drawPolyline(polyline, length + 1);
-                }
-            }
-            painter.setClipping(false);
+        // join to old waveform
+        if (!drawJoinToOld) {
+            polyline[0] = polyline[1];
+        } else {
+            polyline[0] =
+                    QPointF(xScaleFactor * -1 + xOffset,
+                            yScaleFactor * oldData + yOffset);
         }
-    }
 
-    tStepMsec = 1000.0 / sampleRate;
-    tPosition += length * tStepMsec;
-    if (tPosition >= tScale) {
-        tPosition = 0.0;
+        // save last point in waveform to join to next segment
+        if (drawPlotDc) {
+            oldData =
+                    DC_AMPLIFIER_VOLTS_PER_BIT * job.samples[length - 1];
+        } else {
+            oldData =
+                    job.samples[length - 1];
+        }
+
+        // draw waveform
+        painter.setPen(traceAmpColor);
+        if (drawReferenceStream == stream && drawReferenceChannel == channel) {
+            painter.setPen(traceRefColor); // plot selected re-reference waveform in a different color
+        }
+        if (drawPointPlotMode) {
+            painter.drawPoints(polyline, numPoints + 1);
+        } else {
+            painter.drawPolyline(polyline, numPoints + 1);
+        }
+
+    } else if (type == AuxInputSignal) {
+        // error: aux inputs not present in RHS2000 system
+    } else if (type == SupplyVoltageSignal) {
+        // error: supply voltage not present in RHS2000 system
+    } else if (type == BoardAdcSignal) {
+        // Plot USB interface board ADC input signal
+        yScaleFactor = -1.0 * drawYAxisLength / drawYScaleAdc;
+        yOffset = job.frame.center().y();
+
+        // build waveform
+        numPoints = waveformDecimator.buildPolyline(job.samples.constData(), length,
+                                                    xScaleFactor, xOffset, yScaleFactor, yOffset,
+                                                    !drawPointPlotMode, polyline);
+
+        // join to old waveform
+        if (!drawJoinToOld) {
+            polyline[0] = polyline[1];
+        } else {
+            polyline[0] =
+                    QPointF(xScaleFactor * -1 + xOffset,
+                            yScaleFactor * oldData + yOffset);
+        }
+
+        // save last point in waveform to join to next segment
+        oldData =
+                job.samples[length - 1];
+
+        // draw waveform
+        painter.setPen(traceAnalogInColor);
+        if (drawPointPlotMode) {
+            painter.drawPoints(polyline, numPoints + 1);
+        } else {
+            painter.drawPolyline(polyline, numPoints + 1);
+        }
+
+    } else if (type == BoardDacSignal) {
+        // Plot USB interface board DAC output signal
+        yScaleFactor = -1.0 * drawYAxisLength / drawYScaleAdc;
+        yOffset = job.frame.center().y();
+
+        // build waveform
+        numPoints = waveformDecimator.buildPolyline(job.samples.constData(), length,
+                                                    xScaleFactor, xOffset, yScaleFactor, yOffset,
+                                                    !drawPointPlotMode, polyline);
+
+        // join to old waveform
+        if (!drawJoinToOld) {
+            polyline[0] = polyline[1];
+        } else {
+            polyline[0] =
+                    QPointF(xScaleFactor * -1 + xOffset,
+                            yScaleFactor * oldData + yOffset);
+        }
+
+        // save last point in waveform to join to next segment
+        oldData =
+                job.samples[length - 1];
+
+        // draw waveform
+        painter.setPen(traceAnalogInColor);
+        if (drawPointPlotMode) {
+            painter.drawPoints(polyline, numPoints + 1);
+        } else {
+            painter.drawPolyline(polyline, numPoints + 1);
+        }
+
+    } else if (type == BoardDigInSignal) {
+        // Plot USB interface board digital input signal
+        yScaleFactor = -(2.0 * drawYAxisLength) / 2.0;
+        yOffset = (job.frame.bottom() + job.frame.center().y()) / 2.0;
+
+        // build waveform
+        numPoints = waveformDecimator.buildPolyline(
+                    job.samples.constData(), length,
+                    xScaleFactor, xOffset, yScaleFactor, yOffset, !drawPointPlotMode, polyline);
+
+        // join to old waveform
+        if (!drawJoinToOld) {
+            polyline[0] = polyline[1];
+        } else {
+            polyline[0] =
+                    QPointF(xScaleFactor * -1 + xOffset,
+                            yScaleFactor * oldData + yOffset);
+        }
+
+        // save last point in waveform to join to next segment
+        oldData =
+                job.samples[length - 1];
+
+        // draw waveform
+        pen.setColor(traceDigitalInColor);
+        painter.setPen(pen);
+        if (drawPointPlotMode) {
+            painter.drawPoints(polyline, numPoints + 1);
+        } else {
+            painter.drawPolyline(polyline, numPoints + 1);
+        }
+    } else if (type == BoardDigOutSignal) {
+        // Plot USB interface board digital output signal
+        yScaleFactor = -(2.0 * drawYAxisLength) / 2.0;
+        yOffset = (job.frame.bottom() + job.frame.center().y()) / 2.0;
+
+        // build waveform
+        numPoints = waveformDecimator.buildPolyline(
+                    job.samples.constData(), length,
+                    xScaleFactor, xOffset, yScaleFactor, yOffset, !drawPointPlotMode, polyline);
+
+        // join to old waveform
+        if (!drawJoinToOld) {
+            polyline[0] = polyline[1];
+        } else {
+            polyline[0] =
+                    QPointF(xScaleFactor * -1 + xOffset,
+                            yScaleFactor * oldData + yOffset);
+        }
+
+        // save last point in waveform to join to next segment
+        oldData =
+                job.samples[length - 1];
+
+        // draw waveform
+        pen.setColor(traceDigitalOutColor);
+        painter.setPen(pen);
+        if (drawPointPlotMode) {
+            painter.drawPoints(polyline, numPoints + 1);
+        } else {
+            painter.drawPolyline(polyline, numPoints + 1);
+        }
     }
 
-    delete [] polyline;
+    // The join to the old waveform starts up to a pixel left of the erased block.
+    dirtyRects[j] = changedBlock.adjusted(-1, 0, 0, 0) & adjustedFrame;
 }
 
-void WavePlot::highlightEvent(QVector<int> &data, QColor color, int length, QRect frame, QPainter &painter, double xScaleFactor, double xOffset)
+// Fill the background of the frame where (data & mask) is nonzero.
+void WavePlot::highlightEvent(const quint8 *data, quint8 mask, QColor color, int length, QRect frame, QPainter &painter, double xScaleFactor, double xOffset)
 {
     QRect markerFrame = frame;
     bool markerFound = false;
     int i = 0;
     while (i < length) {
         if (!markerFound) {
-            if (data.at(i) != 0) {
+            if ((data[i] & mask) != 0) {
                 markerFound = true;
                 markerFrame.setLeft(xScaleFactor * i + xOffset);
             }
         } else {
-            if (data.at(i) == 0) {
+            if ((data[i] & mask) == 0) {
                 markerFound = false;
                 markerFrame.setRight(xScaleFactor * i + xOffset);
                 painter.fillRect(markerFrame, color);
@@ -1625,14 +1805,97 @@ void WavePlot::disableAllChannels()
     refreshScreen();
 }
 
-// Update display when new data is available.
-void WavePlot::passFilteredData()
+// Add the latest numSamples samples of filtered data to the display ring.  They
+// are drawn on the next display refresh.  Never waits for the drawing threads,
+// which work on their own copy of the data.
+void WavePlot::passFilteredData(int numSamples)
 {
-    drawWaveforms();
-    if (dragging) {
-        paintGhost();
+    displayRing.write(signalProcessor, numSamples);
+}
+
+// Start refreshing the display from an empty display ring.  Called when a run
+// starts.
+void WavePlot::startDisplay()
+{
+    displayRing.reset();
+    drawnPosition = 0;
+    lateFrames = 0;
+    droppedFrames = 0;
+    frameTimer.invalidate();
+    refreshTimer->start();
+}
+
+// Stop refreshing the display, after drawing any data not yet shown.  This
+// waits for the drawing threads.
+void WavePlot::stopDisplay()
+{
+    refreshTimer->stop();
+    finishDrawing();
+    while (drawnPosition < displayRing.getWritePosition()) {
+        refreshDisplay();
+        finishDrawing();
+    }
+}
+
+// Number of display refreshes since startDisplay() that came more than half a
+// refresh period late, and number of refreshes skipped altogether, either
+// because the timer fired late or because the drawing threads were still busy
+// with the previous batch of frames.
+int WavePlot::getLateFrames() const
+{
+    return lateFrames;
+}
+
+int WavePlot::getDroppedFrames() const
+{
+    return droppedFrames;
+}
+
+// Put the last batch of frames on screen if the drawing threads have finished
+// it, and start drawing the data added to the display ring since then.  Called
+// by refreshTimer; never waits for the drawing threads.  If more than one sweep
+// of data is waiting, or data has been overwritten before it could be drawn,
+// only the latest part is drawn.
+void WavePlot::refreshDisplay()
+{
+    if (refreshTimer->isActive()) {
+        if (frameTimer.isValid()) {
+            double period = refreshTimer->interval();
+            double elapsed = frameTimer.nsecsElapsed() / 1.0e6;
+            int skipped = (int) (elapsed / period) - 1;
+            if (skipped > 0) {
+                droppedFrames += skipped;
+            } else if (elapsed > 1.5 * period) {
+                ++lateFrames;
+            }
+        }
+        frameTimer.start();
+    }
+
+    if (numDrawWorkers > 0) {
+        if (!drawTasksDone.tryAcquire(numDrawWorkers)) {
+            if (refreshTimer->isActive()) {
+                ++droppedFrames;
+            }
+            return;
+        }
+        showDrawnFrames();
+    }
+
+    qint64 writePosition = displayRing.getWritePosition();
+    qint64 maxLength = qMin((qint64) displayRing.getCapacity(), (qint64) qCeil(tScale * sampleRate / 1000.0));
+    if (writePosition - drawnPosition > maxLength) {
+        drawnPosition = writePosition - maxLength;
+    }
+
+    // A batch that wraps around the ring is drawn in two pieces, the second on
+    // the next refresh.
+    if (drawnPosition < writePosition) {
+        int offset = displayRing.offset(drawnPosition);
+        int length = (int) qMin(writePosition - drawnPosition, (qint64) (displayRing.getCapacity() - offset));
+        drawWaveforms(offset, length);
+        drawnPosition += length;
     }
-    update();
 }
 
 // Enable or disable electrode impedance labels on display.
@@ -1649,10 +1912,8 @@ void WavePlot::setPointPlotMode(bool enabled)
 }
 
 // Paint the global "ghost" QRect, with thickness of 2 pixels
-void WavePlot::paintGhost()
+void WavePlot::paintGhost(QPainter &painter)
 {
-    QPainter painter(&pixmap);
-    painter.initFrom(this);
     painter.setPen(frameSelectColor);
     painter.drawRect(ghost);
     QRect thickGhost = ghost;
@@ -23,7 +23,12 @@
 #define WAVEPLOT_H
 
 #include <QWidget>
+#include <QImage>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QElapsedTimer>
 #include "signalgroup.h"
+#include "displayring.h"
 
 using namespace std;
 
@@ -31,17 +36,28 @@ class Rhs2000DataBlock;
 class SignalProcessor;
 class SignalSources;
 class MainWindow;
+class WaveformDecimator;
+class QThreadPool;
+class QTimer;
 
 class WavePlot : public QWidget
 {
     Q_OBJECT
 
+    friend class FrameTask;
+
 public:
     WavePlot(SignalProcessor *inSignalProcessor, SignalSources *inSignalSources,
              MainWindow *inMainWindow, QWidget *parent = 0);
+    ~WavePlot();
 
     void initialize(int startingPort, int numPorts);
-    void passFilteredData();
+    void passFilteredData(int numSamples);
+    void startDisplay();
+    void stopDisplay();
+    void setRefreshRate(double rate);
+    int getLateFrames() const;
+    int getDroppedFrames() const;
     void refreshScreen();
 
     const QColor backgroundColor = Qt::white;
@@ -94,7 +110,6 @@ public:
     void setPlotDc(bool plotDc_);
     void setTScale(int newTScale);
     void setSampleRate(double newSampleRate);
-    void setNumUsbBlocksToPlot(int numBlocks);
 
     QSize minimumSizeHint() const;
     QSize sizeHint() const;
@@ -104,6 +119,9 @@ signals:
 
 public slots:
 
+private slots:
+    void refreshDisplay();
+
 protected:
     void paintEvent(QPaintEvent *event);
     void mousePressEvent(QMouseEvent *event);
@@ -119,8 +137,13 @@ private:
     void refreshPixmap();
     void drawAxes(QPainter &painter, int frameNumber);
     void drawAxisLines(QPainter &painter, int frameNumber);
+    void drawAxisLines(QPainter &painter, QRect frame, SignalType type, bool enabled);
     void drawAxisText(QPainter &painter, int frameNumber);
-    void drawWaveforms();
+    void drawWaveforms(int offset, int length);
+    void finishDrawing();
+    void showDrawnFrames();
+    void drawFrames();
+    void drawFrameWaveform(int j, WaveformDecimator &waveformDecimator, QPointF *polyline);
     void highlightFrame(int frameIndex, bool eraseOldFrame);
     void changeSelectedFrame(int newSelectedFrame, bool pageUpDown);
     int findClosestFrame(QPoint p);
@@ -130,10 +153,8 @@ private:
     void contractYScale();
     void expandTScale();
     void contractTScale();
-    void paintGhost();
+    void paintGhost(QPainter &painter);
 
-    void allocateDoubleArray3D(QVector<QVector<QVector<double> > > &array3D,
-                               int xSize, int ySize, int zSize);
     void allocateDoubleArray2D(QVector<QVector<double> > &array2D,
                                int xSize, int ySize);
     void allocateIntArray2D(QVector<QVector<int> > &array2D,
@@ -145,6 +166,69 @@ private:
 
     QPixmap pixmap;
 
+    // Recent data waiting to be drawn, and the timer that draws it.
+    // drawnPosition is the sample number of the next sample to draw.
+    DisplayRing displayRing;
+    QTimer *refreshTimer;
+    qint64 drawnPosition;
+    QElapsedTimer frameTimer;
+    int lateFrames;
+    int droppedFrames;
+
+    // Waveform tiles covering the inside of each frame on the screen, with
+    // their positions and the parts redrawn by the last drawWaveforms().  The
+    // drawing threads paint into drawTiles; paintEvent() shows frameTiles, to
+    // which the changed parts are copied once a whole batch is finished.
+    QVector<QImage> frameTiles;
+    QVector<QImage> drawTiles;
+    QVector<QRect> tileRects;
+    QVector<QRect> dirtyRects;
+
+    // Worker threads for drawWaveforms().  Frames are handed out through
+    // nextFrame; drawTasksDone counts worker threads that have finished.
+    // numDrawWorkers is the number of workers started for the batch in flight
+    // (0 if none).
+    QThreadPool *drawThreadPool;
+    QAtomicInt nextFrame;
+    QSemaphore drawTasksDone;
+    int numFramesToDraw;
+    int numDrawWorkers;
+
+    // Channel shown in each frame and its data for the batch, copied from the
+    // channel list and the display ring when a batch is started, so that the
+    // drawing threads read neither and the ring may be written at any time.
+    struct FrameDrawJob {
+        QRect frame;
+        SignalType type;
+        bool enabled;
+        int stream;
+        int channel;
+        int plotIndex;              // index into plotDataOld
+        QVector<Sample> samples;    // waveform, in DC amplifier codes if plotting DC
+        QVector<quint8> flags;      // amplifier flags (see DisplayRing::AmplifierFlag)
+    };
+    QVector<FrameDrawJob> drawJobs;
+
+    // Display state shared by the frame drawing threads, fixed for each batch.
+    QVector<quint8> drawMarkerData;
+    int drawLength;
+    double drawXScaleFactor;
+    double drawXOffset;     // position of the first sample from the left of a frame
+    double drawOldXOffset;  // old waveform to erase after a marker reset, or -1
+    bool drawJoinToOld;
+    double drawYAxisLength;
+    double drawTAxisLength;
+    bool drawMarkerMode;
+    int drawMarkerChannel;
+    int drawReferenceStream;
+    int drawReferenceChannel;
+    bool drawPlotDc;
+    bool drawPointPlotMode;
+    int drawYScale;
+    int drawYScaleDcAmp;
+    int drawYScaleAdc;
+    bool v0AxisVisible;
+
     QVector<double> plotDataOld;
     QVector<QVector<QRect> > frameList;
     QVector<int> frameNumColumns;
@@ -162,7 +246,6 @@ private:
     int tScale;
     double sampleRate;
     double tPosition;
-    int numUsbBlocksToPlot;
     bool dragging;
     int dragToIndex;
     bool impedanceLabels;
@@ -171,7 +254,7 @@ private:
 
     void createFrames(unsigned int frameIndex, unsigned int maxX, unsigned int maxY);
     void createAllFrames();
-    void highlightEvent(QVector<int> &data, QColor color, int length, QRect frame, QPainter &painter, double xScaleFactor, double xOffset);
+    void highlightEvent(const quint8 *data, quint8 mask, QColor color, int length, QRect frame, QPainter &painter, double xScaleFactor, double xOffset);
 };
 
 #endif // WAVEPLOT_H